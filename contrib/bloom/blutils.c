@@ -146,6 +146,7 @@ blhandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = blrescan;
 	amroutine->amgettuple = NULL;
 	amroutine->amgetbitmap = blgetbitmap;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = blendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
@@ -0,0 +1,49 @@
+-- Deletes of several rows of a page are logged as one record; each of the
+-- rows must still be decoded as a change of its own.
+
+-- predictability
+SET synchronous_commit = on;
+
+SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
+
+CREATE TABLE md_pkey (id int PRIMARY KEY, data text);
+CREATE TABLE md_full (id int, data text);
+ALTER TABLE md_full REPLICA IDENTITY FULL;
+CREATE TABLE md_nothing (id int PRIMARY KEY, data text);
+ALTER TABLE md_nothing REPLICA IDENTITY NOTHING;
+CREATE TABLE md_toast (id int PRIMARY KEY, data text);
+ALTER TABLE md_toast ALTER COLUMN data SET STORAGE EXTERNAL;
+
+INSERT INTO md_pkey SELECT g, 'row ' || g FROM generate_series(1, 5) g;
+INSERT INTO md_full SELECT g, 'row ' || g FROM generate_series(1, 3) g;
+INSERT INTO md_full VALUES (4, NULL);
+INSERT INTO md_nothing SELECT g, 'row ' || g FROM generate_series(1, 3) g;
+-- the second row has an out-of-line value, which leaves it to be deleted
+-- on its own after the others
+INSERT INTO md_toast VALUES (1, 'row 1'),
+	(2, (SELECT string_agg(g::text, '') FROM generate_series(1, 1000) g)),
+	(3, 'row 3');
+
+SELECT count(*) FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+DELETE FROM md_pkey WHERE id % 2 = 1;
+DELETE FROM md_full;
+DELETE FROM md_nothing;
+DELETE FROM md_toast;
+
+-- a row joined more than once is deleted once
+DELETE FROM md_pkey USING generate_series(1, 3) g WHERE md_pkey.id <= 4;
+
+-- rows deleted in a subtransaction that was rolled back are not decoded
+BEGIN;
+INSERT INTO md_pkey VALUES (6, 'row 6'), (7, 'row 7');
+SAVEPOINT s;
+DELETE FROM md_pkey;
+ROLLBACK TO SAVEPOINT s;
+DELETE FROM md_pkey WHERE id = 6;
+COMMIT;
+
+SELECT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+SELECT pg_drop_replication_slot('regression_slot');
+
+DROP TABLE md_pkey, md_full, md_nothing, md_toast;
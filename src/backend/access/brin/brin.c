@@ -288,6 +288,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = brinrescan;
 	amroutine->amgettuple = NULL;
 	amroutine->amgetbitmap = bringetbitmap;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = brinendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
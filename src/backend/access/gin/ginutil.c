@@ -78,6 +78,7 @@ ginhandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = ginrescan;
 	amroutine->amgettuple = NULL;
 	amroutine->amgetbitmap = gingetbitmap;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = ginendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
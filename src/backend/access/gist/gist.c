@@ -100,6 +100,7 @@ gisthandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = gistrescan;
 	amroutine->amgettuple = gistgettuple;
 	amroutine->amgetbitmap = gistgetbitmap;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = gistendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
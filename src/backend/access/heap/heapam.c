@@ -67,6 +67,7 @@
 #include "utils/datum.h"
 #include "utils/injection_point.h"
 #include "utils/inval.h"
+#include "utils/queryresultcache.h"
 #include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/spccache.h"
@@ -2172,6 +2173,7 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
 	/* Note: speculative insertions are counted too, even if aborted later */
 	pgstat_count_heap_insert(relation, 1);
+	QueryResultCacheNoteRelation(RelationGetRelid(relation));
 
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
@@ -2196,14 +2198,17 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 {
 	/*
 	 * To allow parallel inserts, we need to ensure that they are safe to be
-	 * performed in workers. We have the infrastructure to allow parallel
-	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * performed in workers.  Inserts from parallel workers are allowed only
+	 * in workers started for that purpose, whose leader checked that they
+	 * cannot generate a new CommandId (eg. inserts into a table having a
+	 * foreign key column) and marked the command ID used before entering
+	 * parallel mode.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !ParallelWorkerInsertsAllowed())
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
+	Assert(!IsParallelWorker() || cid == GetCurrentCommandId(false));
 
 	tup->t_data->t_infomask &= ~(HEAP_XACT_MASK);
 	tup->t_data->t_infomask2 &= ~(HEAP2_XACT_MASK);
@@ -2621,6 +2626,7 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		slots[i]->tts_tid = heaptuples[i]->t_self;
 
 	pgstat_count_heap_insert(relation, ntuples);
+	QueryResultCacheNoteRelation(RelationGetRelid(relation));
 }
 
 /*
@@ -3096,6 +3102,7 @@ l1:
 		UnlockTupleTuplock(relation, &(tp.t_self), LockTupleExclusive);
 
 	pgstat_count_heap_delete(relation);
+	QueryResultCacheNoteRelation(RelationGetRelid(relation));
 
 	if (old_key_tuple != NULL && old_key_copied)
 		heap_freetuple(old_key_tuple);
@@ -3103,6 +3110,291 @@ l1:
 	return TM_Ok;
 }
 
+/*
+ *	heap_multi_delete - delete several tuples on one page
+ *
+ * See table_multi_delete() for an explanation of the parameters.
+ *
+ * All the tuples are examined and deleted under a single exclusive lock on
+ * the buffer, and logged in a single WAL record.  We only take the tuples
+ * heap_delete() would delete without further ado: those with no valid xmax
+ * and no out-of-line attributes.  Anything else, including every case that
+ * might have to wait, is left for the caller to retry with heap_delete().
+ *
+ * For logically logged relations, the replica identity of each tuple is
+ * logged in the same record.  Catalogs, and user catalog tables when
+ * logical decoding might read them, are left entirely to heap_delete(),
+ * which also logs their combo CIDs.
+ */
+int
+heap_multi_delete(Relation relation, ItemPointer tids, int ntids,
+				  CommandId cid, bool *deleted)
+{
+	TransactionId xid;
+	BlockNumber block;
+	Buffer		buffer;
+	Buffer		vmbuffer = InvalidBuffer;
+	Page		page;
+	HeapTupleHeader *htups;
+	CommandId  *cids;
+	bool	   *iscombos;
+	OffsetNumber *offsets;
+	HeapTuple  *old_keys = NULL;
+	bool	   *old_keys_copied = NULL;
+	bool		taken[MaxHeapTuplesPerPage + 1] = {0};
+	int			ndeleted = 0;
+	bool		all_visible_cleared = false;
+	bool		logically_logged = RelationIsLogicallyLogged(relation);
+
+	Assert(ntids > 0);
+
+	memset(deleted, 0, ntids * sizeof(bool));
+
+	if (IsCatalogRelation(relation) ||
+		RelationIsAccessibleInLogicalDecoding(relation))
+		return 0;
+
+	/* see heap_delete() */
+	if (IsInParallelMode())
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
+				 errmsg("cannot delete tuples during a parallel operation")));
+
+	xid = GetCurrentTransactionId();
+
+	htups = palloc(ntids * sizeof(HeapTupleHeader));
+	cids = palloc(ntids * sizeof(CommandId));
+	iscombos = palloc(ntids * sizeof(bool));
+	offsets = palloc(ntids * sizeof(OffsetNumber));
+	if (logically_logged)
+	{
+		old_keys = palloc(ntids * sizeof(HeapTuple));
+		old_keys_copied = palloc(ntids * sizeof(bool));
+	}
+
+	block = ItemPointerGetBlockNumber(&tids[0]);
+	buffer = ReadBuffer(relation, block);
+	page = BufferGetPage(buffer);
+
+	/* Pin the visibility map page if needed, as in heap_delete() */
+	if (PageIsAllVisible(page))
+		visibilitymap_pin(relation, block, &vmbuffer);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	if (vmbuffer == InvalidBuffer && PageIsAllVisible(page))
+	{
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		visibilitymap_pin(relation, block, &vmbuffer);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	}
+
+	for (int i = 0; i < ntids; i++)
+	{
+		ItemId		lp;
+		HeapTupleData tp;
+
+		Assert(ItemPointerGetBlockNumber(&tids[i]) == block);
+
+		/*
+		 * A join can produce the same row more than once; leave the repeats
+		 * to heap_delete(), which will see them as already deleted by us.
+		 */
+		if (taken[ItemPointerGetOffsetNumber(&tids[i])])
+			continue;
+
+		lp = PageGetItemId(page, ItemPointerGetOffsetNumber(&tids[i]));
+		Assert(ItemIdIsNormal(lp));
+
+		tp.t_tableOid = RelationGetRelid(relation);
+		tp.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+		tp.t_len = ItemIdGetLength(lp);
+		tp.t_self = tids[i];
+
+		if (HeapTupleSatisfiesUpdate(&tp, cid, buffer) != TM_Ok ||
+			!(tp.t_data->t_infomask & HEAP_XMAX_INVALID) ||
+			HeapTupleHasExternal(&tp))
+			continue;
+
+		CheckForSerializableConflictIn(relation, &tp.t_self, block);
+
+		/* replace cid with a combo CID if necessary */
+		cids[ndeleted] = cid;
+		HeapTupleHeaderAdjustCmax(tp.t_data, &cids[ndeleted],
+								  &iscombos[ndeleted]);
+
+		/*
+		 * See heap_delete(); whether there is a key is the same for every
+		 * tuple of the relation.  With REPLICA_IDENTITY_FULL we get &tp back,
+		 * which won't survive this loop.
+		 */
+		if (logically_logged)
+		{
+			HeapTuple	key;
+
+			key = ExtractReplicaIdentity(relation, &tp, true,
+										 &old_keys_copied[ndeleted]);
+			if (key == &tp)
+			{
+				key = heap_copytuple(&tp);
+				old_keys_copied[ndeleted] = true;
+			}
+			old_keys[ndeleted] = key;
+		}
+
+		htups[ndeleted] = tp.t_data;
+		offsets[ndeleted] = ItemPointerGetOffsetNumber(&tp.t_self);
+		taken[offsets[ndeleted]] = true;
+		ndeleted++;
+		deleted[i] = true;
+	}
+
+	if (ndeleted > 0)
+	{
+		char	   *olddata = NULL;
+		char	   *olddata_end = NULL;
+
+		/*
+		 * Assemble the old tuple data to log before entering the critical
+		 * section, in the format of XLOG_HEAP2_MULTI_INSERT's tuple data.
+		 */
+		if (logically_logged && old_keys[0] != NULL &&
+			RelationNeedsWAL(relation))
+		{
+			Size		len = 0;
+
+			for (int i = 0; i < ndeleted; i++)
+			{
+				Assert(old_keys[i] != NULL);
+				len += SHORTALIGN(SizeOfMultiInsertTuple) +
+					SHORTALIGN(old_keys[i]->t_len - SizeofHeapTupleHeader);
+			}
+			olddata = olddata_end = palloc(len);
+
+			for (int i = 0; i < ndeleted; i++)
+			{
+				HeapTuple	key = old_keys[i];
+				xl_multi_insert_tuple *xlhdr;
+				int			datalen = key->t_len - SizeofHeapTupleHeader;
+
+				xlhdr = (xl_multi_insert_tuple *) SHORTALIGN(olddata_end);
+				olddata_end = ((char *) xlhdr) + SizeOfMultiInsertTuple;
+				xlhdr->datalen = datalen;
+				xlhdr->t_infomask2 = key->t_data->t_infomask2;
+				xlhdr->t_infomask = key->t_data->t_infomask;
+				xlhdr->t_hoff = key->t_data->t_hoff;
+				memcpy(olddata_end,
+					   (char *) key->t_data + SizeofHeapTupleHeader,
+					   datalen);
+				olddata_end += datalen;
+			}
+		}
+
+		MultiXactIdSetOldestMember();
+
+		START_CRIT_SECTION();
+
+		PageSetPrunable(page, xid);
+
+		if (PageIsAllVisible(page))
+		{
+			all_visible_cleared = true;
+			PageClearAllVisible(page);
+			visibilitymap_clear(relation, block,
+								vmbuffer, VISIBILITYMAP_VALID_BITS);
+		}
+
+		/*
+		 * With no previous xmax to merge with, the new xmax is just our XID,
+		 * as compute_new_xmax_infomask() would have it.
+		 */
+		for (int i = 0; i < ndeleted; i++)
+		{
+			HeapTupleHeader htup = htups[i];
+
+			htup->t_infomask &= ~(HEAP_XMAX_BITS | HEAP_MOVED);
+			htup->t_infomask2 |= HEAP_KEYS_UPDATED;
+			HeapTupleHeaderClearHotUpdated(htup);
+			HeapTupleHeaderSetXmax(htup, xid);
+			HeapTupleHeaderSetCmax(htup, cids[i], iscombos[i]);
+			/* Make sure there is no forward chain link in t_ctid */
+			ItemPointerSet(&htup->t_ctid, block, offsets[i]);
+		}
+
+		MarkBufferDirty(buffer);
+
+		if (RelationNeedsWAL(relation))
+		{
+			xl_heap_delete xlrec;
+			xl_heap_delete_multi xlmulti;
+			XLogRecPtr	recptr;
+
+			xlrec.flags = XLH_DELETE_IS_MULTI;
+			if (all_visible_cleared)
+				xlrec.flags |= XLH_DELETE_ALL_VISIBLE_CLEARED;
+			if (olddata != NULL)
+			{
+				if (relation->rd_rel->relreplident == REPLICA_IDENTITY_FULL)
+					xlrec.flags |= XLH_DELETE_CONTAINS_OLD_TUPLE;
+				else
+					xlrec.flags |= XLH_DELETE_CONTAINS_OLD_KEY;
+			}
+			xlrec.infobits_set = XLHL_KEYS_UPDATED;
+			xlrec.offnum = offsets[0];
+			xlrec.xmax = xid;
+			xlmulti.ntuples = ndeleted;
+
+			XLogBeginInsert();
+			XLogRegisterData((char *) &xlrec, SizeOfHeapDelete);
+			XLogRegisterData((char *) &xlmulti, SizeOfHeapDeleteMulti);
+			XLogRegisterData((char *) offsets, ndeleted * sizeof(OffsetNumber));
+
+			/*
+			 * The old tuple data goes into the main data, so that it's there
+			 * even with a full-page image.  What precedes it has an even
+			 * length, so the padding in olddata still aligns the structs.
+			 */
+			if (olddata != NULL)
+				XLogRegisterData(olddata, olddata_end - olddata);
+
+			XLogRegisterBuffer(0, buffer, REGBUF_STANDARD);
+
+			XLogSetRecordFlags(XLOG_INCLUDE_ORIGIN);
+
+			recptr = XLogInsert(RM_HEAP_ID, XLOG_HEAP_DELETE);
+
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
+
+		if (olddata != NULL)
+			pfree(olddata);
+	}
+
+	UnlockReleaseBuffer(buffer);
+	if (vmbuffer != InvalidBuffer)
+		ReleaseBuffer(vmbuffer);
+
+	for (int i = 0; i < ndeleted; i++)
+	{
+		pgstat_count_heap_delete(relation);
+		if (logically_logged && old_keys_copied[i])
+			heap_freetuple(old_keys[i]);
+	}
+	QueryResultCacheNoteRelation(RelationGetRelid(relation));
+
+	pfree(htups);
+	pfree(cids);
+	pfree(iscombos);
+	pfree(offsets);
+	if (logically_logged)
+	{
+		pfree(old_keys);
+		pfree(old_keys_copied);
+	}
+
+	return ndeleted;
+}
+
 /*
  *	simple_heap_delete - delete a tuple
  *
@@ -4092,6 +4384,7 @@ l2:
 		UnlockTupleTuplock(relation, &(oldtup.t_self), *lockmode);
 
 	pgstat_count_heap_update(relation, use_hot_update, newbuf != buffer);
+	QueryResultCacheNoteRelation(RelationGetRelid(relation));
 
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
@@ -9481,15 +9774,26 @@ heap_xlog_delete(XLogReaderState *record)
 	xl_heap_delete *xlrec = (xl_heap_delete *) XLogRecGetData(record);
 	Buffer		buffer;
 	Page		page;
-	ItemId		lp = NULL;
-	HeapTupleHeader htup;
 	BlockNumber blkno;
 	RelFileLocator target_locator;
-	ItemPointerData target_tid;
+	int			ntuples;
+	OffsetNumber *offsets;
 
 	XLogRecGetBlockTag(record, 0, &target_locator, NULL, &blkno);
-	ItemPointerSetBlockNumber(&target_tid, blkno);
-	ItemPointerSetOffsetNumber(&target_tid, xlrec->offnum);
+
+	if (xlrec->flags & XLH_DELETE_IS_MULTI)
+	{
+		xl_heap_delete_multi *xlmulti;
+
+		xlmulti = (xl_heap_delete_multi *) ((char *) xlrec + SizeOfHeapDelete);
+		ntuples = xlmulti->ntuples;
+		offsets = xlmulti->offsets;
+	}
+	else
+	{
+		ntuples = 1;
+		offsets = &xlrec->offnum;
+	}
 
 	/*
 	 * The visibility map may need to be fixed even if the heap page is
@@ -9510,24 +9814,36 @@ heap_xlog_delete(XLogReaderState *record)
 	{
 		page = BufferGetPage(buffer);
 
-		if (PageGetMaxOffsetNumber(page) >= xlrec->offnum)
-			lp = PageGetItemId(page, xlrec->offnum);
+		for (int i = 0; i < ntuples; i++)
+		{
+			ItemId		lp = NULL;
+			HeapTupleHeader htup;
 
-		if (PageGetMaxOffsetNumber(page) < xlrec->offnum || !ItemIdIsNormal(lp))
-			elog(PANIC, "invalid lp");
+			if (PageGetMaxOffsetNumber(page) >= offsets[i])
+				lp = PageGetItemId(page, offsets[i]);
 
-		htup = (HeapTupleHeader) PageGetItem(page, lp);
+			if (PageGetMaxOffsetNumber(page) < offsets[i] || !ItemIdIsNormal(lp))
+				elog(PANIC, "invalid lp");
 
-		htup->t_infomask &= ~(HEAP_XMAX_BITS | HEAP_MOVED);
-		htup->t_infomask2 &= ~HEAP_KEYS_UPDATED;
-		HeapTupleHeaderClearHotUpdated(htup);
-		fix_infomask_from_infobits(xlrec->infobits_set,
-								   &htup->t_infomask, &htup->t_infomask2);
-		if (!(xlrec->flags & XLH_DELETE_IS_SUPER))
-			HeapTupleHeaderSetXmax(htup, xlrec->xmax);
-		else
-			HeapTupleHeaderSetXmin(htup, InvalidTransactionId);
-		HeapTupleHeaderSetCmax(htup, FirstCommandId, false);
+			htup = (HeapTupleHeader) PageGetItem(page, lp);
+
+			htup->t_infomask &= ~(HEAP_XMAX_BITS | HEAP_MOVED);
+			htup->t_infomask2 &= ~HEAP_KEYS_UPDATED;
+			HeapTupleHeaderClearHotUpdated(htup);
+			fix_infomask_from_infobits(xlrec->infobits_set,
+									   &htup->t_infomask, &htup->t_infomask2);
+			if (!(xlrec->flags & XLH_DELETE_IS_SUPER))
+				HeapTupleHeaderSetXmax(htup, xlrec->xmax);
+			else
+				HeapTupleHeaderSetXmin(htup, InvalidTransactionId);
+			HeapTupleHeaderSetCmax(htup, FirstCommandId, false);
+
+			/* Make sure t_ctid is set correctly */
+			if (xlrec->flags & XLH_DELETE_IS_PARTITION_MOVE)
+				HeapTupleHeaderSetMovedPartitions(htup);
+			else
+				ItemPointerSet(&htup->t_ctid, blkno, offsets[i]);
+		}
 
 		/* Mark the page as a candidate for pruning */
 		PageSetPrunable(page, XLogRecGetXid(record));
@@ -9535,11 +9851,6 @@ heap_xlog_delete(XLogReaderState *record)
 		if (xlrec->flags & XLH_DELETE_ALL_VISIBLE_CLEARED)
 			PageClearAllVisible(page);
 
-		/* Make sure t_ctid is set correctly */
-		if (xlrec->flags & XLH_DELETE_IS_PARTITION_MOVE)
-			HeapTupleHeaderSetMovedPartitions(htup);
-		else
-			htup->t_ctid = target_tid;
 		PageSetLSN(page, lsn);
 		MarkBufferDirty(buffer);
 	}
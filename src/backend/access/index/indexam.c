@@ -27,6 +27,7 @@
  *		index_getnext_tid	- get the next TID from a scan
  *		index_fetch_heap		- get the scan's next heap tuple
  *		index_getnext_slot	- get the next tuple from a scan
+ *		index_skip		- skip past the current leading key value
  *		index_getbitmap - get all tuples from a scan
  *		index_bulk_delete	- bulk deletion of index tuples
  *		index_vacuum_cleanup	- post-deletion cleanup of an index
@@ -701,6 +702,31 @@ index_getnext_slot(IndexScanDesc scan, ScanDirection direction, TupleTableSlot *
 	return false;
 }
 
+/* ----------------
+ *		index_skip - skip past the current leading key value
+ *
+ * Repositions the scan so that the next index_getnext_tid call returns the
+ * first matching entry whose leading key column differs from that of the
+ * entry most recently returned.  The caller must have set xs_want_skip
+ * before starting the scan.  Returns false if the AM could not skip, in
+ * which case the scan just carries on with the next entry.
+ * ----------------
+ */
+bool
+index_skip(IndexScanDesc scan, ScanDirection direction)
+{
+	SCAN_CHECKS;
+	CHECK_SCAN_PROCEDURE(amskip);
+
+	Assert(scan->xs_want_skip);
+
+	/* We're abandoning the current entry, including any HOT chain */
+	scan->kill_prior_tuple = false;
+	scan->xs_heap_continue = false;
+
+	return scan->indexRelation->rd_indam->amskip(scan, direction);
+}
+
 /* ----------------
  *		index_getbitmap - get all tuples at once from an index scan
  *
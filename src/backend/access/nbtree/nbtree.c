@@ -142,6 +142,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = btrescan;
 	amroutine->amgettuple = btgettuple;
 	amroutine->amgetbitmap = btgetbitmap;
+	amroutine->amskip = btskip;
 	amroutine->amendscan = btendscan;
 	amroutine->ammarkpos = btmarkpos;
 	amroutine->amrestrpos = btrestrpos;
@@ -217,10 +218,28 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		/*
 		 * If we've already initialized this scan, we can just advance it in
 		 * the appropriate direction.  If we haven't done so yet, we call
-		 * _bt_first() to get the first item in the scan.
+		 * _bt_first() to get the first item in the scan.  Skip scans must
+		 * first find their first group.
 		 */
 		if (!BTScanPosIsValid(so->currPos))
+		{
+			if (so->skipScan && so->skipGroup == BTSKIP_END)
+			{
+				/* btskip ran out of groups; this scan is over */
+				so->skipGroup = BTSKIP_DONE;
+				res = false;
+				break;
+			}
+			if (so->skipScan && so->skipGroup == BTSKIP_DONE)
+				so->skipGroup = BTSKIP_START;
+			if (so->skipScan && so->skipGroup == BTSKIP_START &&
+				!_bt_skip_next_group(scan, dir))
+			{
+				res = false;
+				break;
+			}
 			res = _bt_first(scan, dir);
+		}
 		else
 		{
 			/*
@@ -254,7 +273,8 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (res)
 			break;
 		/* ... otherwise see if we need another primitive index scan */
-	} while (so->numArrayKeys && _bt_start_prim_scan(scan, dir));
+	} while ((so->numArrayKeys && _bt_start_prim_scan(scan, dir)) ||
+			 (so->skipScan && _bt_skip_next_group(scan, dir)));
 
 	return res;
 }
@@ -269,6 +289,10 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 	int64		ntids = 0;
 	ItemPointer heapTid;
 
+	/* Skip scans must first find their first group */
+	if (so->skipScan && !_bt_skip_next_group(scan, ForwardScanDirection))
+		return ntids;
+
 	/* Each loop iteration performs another primitive index scan */
 	do
 	{
@@ -300,11 +324,22 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 			}
 		}
 		/* Now see if we need another primitive index scan */
-	} while (so->numArrayKeys && _bt_start_prim_scan(scan, ForwardScanDirection));
+	} while ((so->numArrayKeys &&
+			  _bt_start_prim_scan(scan, ForwardScanDirection)) ||
+			 (so->skipScan && _bt_skip_next_group(scan, ForwardScanDirection)));
 
 	return ntids;
 }
 
+/*
+ *	btskip() -- skip past the current tuple's leading key value
+ */
+bool
+btskip(IndexScanDesc scan, ScanDirection dir)
+{
+	return _bt_skip_past_value(scan, dir);
+}
+
 /*
  *	btbeginscan() -- start a scan on a btree index
  */
@@ -335,6 +370,11 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->orderProcs = NULL;
 	so->arrayContext = NULL;
 
+	so->skipScan = false;
+	so->skipDistinct = false;
+	so->skipKeyData = NULL;
+	so->skipContext = NULL;
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
@@ -378,8 +418,22 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 	BTScanPosInvalidate(so->markPos);
 
 	/*
-	 * Allocate tuple workspace arrays, if needed for an index-only scan and
-	 * not already done in a previous rescan call.  To save on palloc
+	 * Reset the scan keys
+	 */
+	if (scankey && scan->numberOfKeys > 0)
+		memmove(scan->keyData,
+				scankey,
+				scan->numberOfKeys * sizeof(ScanKeyData));
+	so->numberOfKeys = 0;		/* until _bt_preprocess_keys sets it */
+	so->numArrayKeys = 0;		/* ditto */
+
+	/* Decide whether to skip over the leading attribute's values */
+	_bt_skip_setup(scan);
+
+	/*
+	 * Allocate tuple workspace arrays, if needed for an index-only scan or a
+	 * skip scan (which reads leading attribute values from the saved tuples)
+	 * and not already done in a previous rescan call.  To save on palloc
 	 * overhead, both workspaces are allocated as one palloc block; only this
 	 * function and btendscan know that.
 	 *
@@ -393,21 +447,12 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 	 * a SIGSEGV is not possible.  Yeah, this is ugly as sin, but it beats
 	 * adding special-case treatment for name_ops elsewhere.
 	 */
-	if (scan->xs_want_itup && so->currTuples == NULL)
+	if ((scan->xs_want_itup || so->skipScan || so->skipDistinct) &&
+		so->currTuples == NULL)
 	{
 		so->currTuples = (char *) palloc(BLCKSZ * 2);
 		so->markTuples = so->currTuples + BLCKSZ;
 	}
-
-	/*
-	 * Reset the scan keys
-	 */
-	if (scankey && scan->numberOfKeys > 0)
-		memmove(scan->keyData,
-				scankey,
-				scan->numberOfKeys * sizeof(ScanKeyData));
-	so->numberOfKeys = 0;		/* until _bt_preprocess_keys sets it */
-	so->numArrayKeys = 0;		/* ditto */
 }
 
 /*
@@ -438,6 +483,10 @@ btendscan(IndexScanDesc scan)
 	/* so->arrayKeys and so->orderProcs are in arrayContext */
 	if (so->arrayContext != NULL)
 		MemoryContextDelete(so->arrayContext);
+	if (so->skipKeyData != NULL)
+		pfree(so->skipKeyData);
+	if (so->skipContext != NULL)
+		MemoryContextDelete(so->skipContext);
 	if (so->killedItems != NULL)
 		pfree(so->killedItems);
 	if (so->currTuples != NULL)
@@ -470,6 +519,10 @@ btmarkpos(IndexScanDesc scan)
 		BTScanPosInvalidate(so->markPos);
 		so->markItemIndex = -1;
 	}
+
+	/* Skip scans must also remember which group the mark belongs to */
+	if (so->skipScan)
+		_bt_skip_mark(scan);
 }
 
 /*
@@ -524,9 +577,16 @@ btrestrpos(IndexScanDesc scan)
 				_bt_start_array_keys(scan, so->currPos.dir);
 				so->needPrimScan = false;
 			}
+			/* Likewise return a skip scan to the marked position's group */
+			if (so->skipScan)
+				_bt_skip_restore(scan);
 		}
 		else
+		{
 			BTScanPosInvalidate(so->currPos);
+			if (so->skipScan)
+				so->skipGroup = BTSKIP_START;
+		}
 	}
 }
 
@@ -21,6 +21,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
@@ -46,6 +47,10 @@ static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
 static Buffer _bt_walk_left(Relation rel, Buffer buf);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
 static inline void _bt_initialize_more_data(BTScanOpaque so, ScanDirection dir);
+static void _bt_skip_setkeys(IndexScanDesc scan, BTSkipGroupKind group,
+							 StrategyNumber strat, bool quals);
+static bool _bt_skip_peek(IndexScanDesc scan, ScanDirection dir,
+						  BTSkipGroupKind group, StrategyNumber strat);
 
 
 /*
@@ -1528,6 +1533,379 @@ _bt_next(IndexScanDesc scan, ScanDirection dir)
 	return true;
 }
 
+/*
+ *	_bt_skip_next_group() -- Advance a skip scan to its next group.
+ *
+ *		Called when the current group (if any) has been exhausted in the
+ *		given direction.  Determines the next group by descending the tree
+ *		with a key on the leading attribute alone, and sets up the scan keys
+ *		for that group, so that caller can go on to call _bt_first.
+ *
+ *		Returns false when there are no more groups in this direction.
+ */
+bool
+_bt_skip_next_group(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	int16		indoption = scan->indexRelation->rd_indoption[0];
+	bool		nullsfirst;
+	bool		ascending;
+	bool		found;
+
+	Assert(so->skipScan);
+	Assert(!BTScanPosIsValid(so->currPos));
+
+	/*
+	 * Do we come across the NULLs before the non-NULL values, and are the
+	 * values visited in ascending order?
+	 */
+	nullsfirst = ((indoption & INDOPTION_NULLS_FIRST) != 0) ==
+		ScanDirectionIsForward(dir);
+	ascending = ((indoption & INDOPTION_DESC) == 0) ==
+		ScanDirectionIsForward(dir);
+
+	switch (so->skipGroup)
+	{
+		case BTSKIP_START:
+			if (nullsfirst)
+			{
+				_bt_skip_setkeys(scan, BTSKIP_NULL, InvalidStrategy, true);
+				so->skipGroup = BTSKIP_NULL;
+				return true;
+			}
+			found = _bt_skip_peek(scan, dir, BTSKIP_START, InvalidStrategy);
+			break;
+		case BTSKIP_VALUE:
+			found = _bt_skip_peek(scan, dir, BTSKIP_VALUE,
+								  ascending ? BTGreaterStrategyNumber :
+								  BTLessStrategyNumber);
+			break;
+		case BTSKIP_NULL:
+			if (!nullsfirst)
+			{
+				so->skipGroup = BTSKIP_DONE;
+				return false;
+			}
+			found = _bt_skip_peek(scan, dir, BTSKIP_START, InvalidStrategy);
+			break;
+		case BTSKIP_REST:
+			/* Nothing is left after the rest, other than maybe NULLs */
+			if (dir == so->skipDir)
+				found = false;
+			else
+				found = _bt_skip_peek(scan, dir, BTSKIP_VALUE,
+									  ascending ? BTGreaterStrategyNumber :
+									  BTLessStrategyNumber);
+			break;
+		case BTSKIP_DONE:
+		case BTSKIP_END:
+		default:
+			return false;
+	}
+
+	if (!found)
+	{
+		if (!nullsfirst && so->skipGroup != BTSKIP_NULL)
+		{
+			_bt_skip_setkeys(scan, BTSKIP_NULL, InvalidStrategy, true);
+			so->skipGroup = BTSKIP_NULL;
+			return true;
+		}
+		so->skipGroup = BTSKIP_DONE;
+		return false;
+	}
+
+	/*
+	 * Found the leading value of the next group.  If the last several groups
+	 * each started on the same leaf page as the one before, the groups are
+	 * too small for skipping to pay off, and we just read everything from
+	 * here on.
+	 */
+	if (so->skipUseless >= BT_SKIP_MAX_USELESS)
+	{
+		_bt_skip_setkeys(scan, BTSKIP_REST,
+						 ascending ? BTGreaterEqualStrategyNumber :
+						 BTLessEqualStrategyNumber, true);
+		so->skipGroup = BTSKIP_REST;
+		so->skipDir = dir;
+	}
+	else
+	{
+		_bt_skip_setkeys(scan, BTSKIP_VALUE, BTEqualStrategyNumber, true);
+		so->skipGroup = BTSKIP_VALUE;
+	}
+
+	return true;
+}
+
+/*
+ *	_bt_skip_past_value() -- Move a scan on to the next leading value.
+ *
+ *		Implements btskip: leaves the current page, and sets up the scan keys
+ *		so that the next _bt_first call returns the first matching tuple
+ *		whose leading attribute differs from that of the current tuple.
+ *		Within a skip scan we just move to the next group; otherwise the scan
+ *		carries on with everything past the current value.
+ *
+ *		Callers only skip in the direction they are scanning in, and don't
+ *		change direction afterwards.  Returns false if we can't skip.
+ */
+bool
+_bt_skip_past_value(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int16		indoption = rel->rd_indoption[0];
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	BTScanPosItem *currItem;
+	IndexTuple	itup;
+	Datum		value;
+	bool		isnull;
+	bool		nullsfirst;
+	bool		ascending;
+	MemoryContext oldContext;
+
+	if (!so->skipDistinct || !BTScanPosIsValid(so->currPos))
+		return false;
+
+	nullsfirst = ((indoption & INDOPTION_NULLS_FIRST) != 0) ==
+		ScanDirectionIsForward(dir);
+	ascending = ((indoption & INDOPTION_DESC) == 0) ==
+		ScanDirectionIsForward(dir);
+
+	currItem = &so->currPos.items[so->currPos.itemIndex];
+	itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+	value = index_getattr(itup, 1, RelationGetDescr(rel), &isnull);
+
+	/* NULLs come last, so there's nothing past them */
+	if (isnull && !nullsfirst)
+		return false;
+
+	if (!isnull)
+	{
+		if (!attr->attbyval && DatumGetPointer(so->skipValue) != NULL)
+			pfree(DatumGetPointer(so->skipValue));
+		oldContext = MemoryContextSwitchTo(so->skipContext);
+		so->skipValue = datumCopy(value, attr->attbyval, attr->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	/* Before leaving current page, deal with any killed items */
+	if (so->numKilled > 0)
+		_bt_killitems(scan);
+	BTScanPosUnpinIfPinned(so->currPos);
+	BTScanPosInvalidate(so->currPos);
+
+	if (isnull)
+	{
+		/* Move on to the first non-NULL value */
+		so->skipGroup = BTSKIP_NULL;
+		if (!_bt_skip_next_group(scan, dir))
+			so->skipGroup = BTSKIP_END;
+	}
+	else if (so->skipScan && so->skipGroup == BTSKIP_VALUE)
+	{
+		/* Move on to the next group */
+		if (!_bt_skip_next_group(scan, dir))
+			so->skipGroup = BTSKIP_END;
+	}
+	else
+	{
+		/*
+		 * Read everything past the current value.  A single descent does
+		 * that, without first looking for the next value.
+		 */
+		_bt_skip_setkeys(scan, BTSKIP_REST,
+						 ascending ? BTGreaterStrategyNumber :
+						 BTLessStrategyNumber, true);
+		so->skipGroup = BTSKIP_REST;
+		so->skipDir = dir;
+	}
+
+	/* From here on, btgettuple steps through the groups */
+	so->skipScan = true;
+
+	return true;
+}
+
+/*
+ *	_bt_skip_setkeys() -- Set up the scan keys for a skip scan group.
+ *
+ * The key on the leading attribute is IS NULL for BTSKIP_NULL, IS NOT NULL
+ * for BTSKIP_START, and otherwise compares against so->skipValue using the
+ * given strategy.  The caller's own keys follow it if 'quals' is true;
+ * otherwise we still include any of them that are on the leading attribute,
+ * so that we don't go looking for values the scan can't return.  The new
+ * keys are preprocessed by the next _bt_first call.
+ */
+static void
+_bt_skip_setkeys(IndexScanDesc scan, BTSkipGroupKind group,
+				 StrategyNumber strat, bool quals)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ScanKey		skey = &so->skipKeyData[0];
+
+	if (group == BTSKIP_NULL || group == BTSKIP_START)
+		ScanKeyEntryInitialize(skey,
+							   SK_ISNULL | (group == BTSKIP_NULL ?
+											SK_SEARCHNULL : SK_SEARCHNOTNULL),
+							   1,
+							   InvalidStrategy,
+							   InvalidOid,
+							   InvalidOid,
+							   InvalidOid,
+							   (Datum) 0);
+	else
+	{
+		Assert(strat >= 1 && strat <= BTMaxStrategyNumber);
+		memcpy(skey, &so->skipOpKeys[strat - 1], sizeof(ScanKeyData));
+		skey->sk_argument = so->skipValue;
+	}
+
+	so->skipNumKeys = 1;
+	for (int i = 0; i < scan->numberOfKeys; i++)
+	{
+		if (!quals && scan->keyData[i].sk_attno != 1)
+			break;
+		memcpy(&so->skipKeyData[so->skipNumKeys++], &scan->keyData[i],
+			   sizeof(ScanKeyData));
+	}
+
+	/* force _bt_preprocess_keys to do its work again */
+	so->numberOfKeys = 0;
+}
+
+/*
+ *	_bt_skip_peek() -- Find the leading value of a skip scan's next group.
+ *
+ * Descends to the first tuple in the given direction whose leading attribute
+ * satisfies the key described by 'group' and 'strat' (see _bt_skip_setkeys),
+ * disregarding the caller's keys.  On success the leading value is saved in
+ * so->skipValue, and the page it was found on is compared with the page the
+ * previous group started on.  Either way, so->currPos is left invalid.
+ */
+static bool
+_bt_skip_peek(IndexScanDesc scan, ScanDirection dir, BTSkipGroupKind group,
+			  StrategyNumber strat)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	BTScanPosItem *currItem;
+	IndexTuple	itup;
+	Datum		value;
+	bool		isnull;
+	MemoryContext oldContext;
+
+	_bt_skip_setkeys(scan, group, strat, false);
+	if (!_bt_first(scan, dir))
+		return false;
+
+	currItem = &so->currPos.items[so->currPos.itemIndex];
+	itup = (IndexTuple) (so->currTuples + currItem->tupleOffset);
+	value = index_getattr(itup, 1, RelationGetDescr(rel), &isnull);
+	Assert(!isnull);
+
+	if (!attr->attbyval && DatumGetPointer(so->skipValue) != NULL)
+		pfree(DatumGetPointer(so->skipValue));
+	oldContext = MemoryContextSwitchTo(so->skipContext);
+	so->skipValue = datumCopy(value, attr->attbyval, attr->attlen);
+	MemoryContextSwitchTo(oldContext);
+
+	if (so->currPos.currPage == so->skipPage)
+		so->skipUseless++;
+	else
+		so->skipUseless = 0;
+	so->skipPage = so->currPos.currPage;
+
+	BTScanPosUnpinIfPinned(so->currPos);
+	BTScanPosInvalidate(so->currPos);
+
+	return true;
+}
+
+/*
+ *	_bt_skip_mark() -- Save a skip scan's group for btmarkpos.
+ */
+void
+_bt_skip_mark(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	MemoryContext oldContext;
+
+	if (!attr->attbyval && DatumGetPointer(so->skipMarkValue) != NULL)
+		pfree(DatumGetPointer(so->skipMarkValue));
+	so->skipMarkValue = (Datum) 0;
+
+	so->skipMarkGroup = so->skipGroup;
+	so->skipMarkDir = so->skipDir;
+	if (so->skipGroup == BTSKIP_VALUE || so->skipGroup == BTSKIP_REST)
+	{
+		oldContext = MemoryContextSwitchTo(so->skipContext);
+		so->skipMarkValue = datumCopy(so->skipValue, attr->attbyval,
+									  attr->attlen);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+/*
+ *	_bt_skip_restore() -- Return a skip scan to the group saved by btmarkpos.
+ *
+ * Called by btrestrpos when it restores a mark on a page other than the
+ * current one, which might belong to an earlier group.  The scan keys must
+ * match the restored position's group before _bt_next reads any further.
+ */
+void
+_bt_skip_restore(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	MemoryContext oldContext;
+
+	so->skipGroup = so->skipMarkGroup;
+	so->skipDir = so->skipMarkDir;
+	so->skipUseless = 0;
+	so->skipPage = InvalidBlockNumber;
+
+	switch (so->skipGroup)
+	{
+		case BTSKIP_VALUE:
+		case BTSKIP_REST:
+			if (!attr->attbyval && DatumGetPointer(so->skipValue) != NULL)
+				pfree(DatumGetPointer(so->skipValue));
+			oldContext = MemoryContextSwitchTo(so->skipContext);
+			so->skipValue = datumCopy(so->skipMarkValue, attr->attbyval,
+									  attr->attlen);
+			MemoryContextSwitchTo(oldContext);
+			if (so->skipGroup == BTSKIP_VALUE)
+				_bt_skip_setkeys(scan, BTSKIP_VALUE, BTEqualStrategyNumber,
+								 true);
+			else
+			{
+				bool		ascending;
+
+				ascending = ((rel->rd_indoption[0] & INDOPTION_DESC) == 0) ==
+					ScanDirectionIsForward(so->skipDir);
+				_bt_skip_setkeys(scan, BTSKIP_REST,
+								 ascending ? BTGreaterEqualStrategyNumber :
+								 BTLessEqualStrategyNumber, true);
+			}
+			break;
+		case BTSKIP_NULL:
+			_bt_skip_setkeys(scan, BTSKIP_NULL, InvalidStrategy, true);
+			break;
+		default:
+			/* a valid mark position is always within some group */
+			elog(ERROR, "unexpected skip scan group %d", (int) so->skipGroup);
+			break;
+	}
+
+	_bt_preprocess_keys(scan);
+}
+
 /*
  *	_bt_readpage() -- Load data from current index page into so->currPos
  *
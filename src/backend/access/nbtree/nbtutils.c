@@ -23,6 +23,7 @@
 #include "commands/progress.h"
 #include "lib/qunique.h"
 #include "miscadmin.h"
+#include "parser/parse_coerce.h"
 #include "utils/array.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
@@ -2610,6 +2611,15 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		keyDataMap = MemoryContextAlloc(so->arrayContext,
 										numberOfKeys * sizeof(int));
 	}
+	else if (so->skipScan)
+	{
+		/*
+		 * Skip scans preprocess the keys for the current group, which the
+		 * caller has set up in skipKeyData[] (see _bt_skip_setup)
+		 */
+		numberOfKeys = so->skipNumKeys;
+		inkeys = so->skipKeyData;
+	}
 	else
 		inkeys = scan->keyData;
 
@@ -2993,6 +3003,105 @@ _bt_preprocess_keys(IndexScanDesc scan)
 	/* Could pfree arrayKeyData/keyDataMap now, but not worth the cycles */
 }
 
+/*
+ *	_bt_skip_setup() -- decide whether a scan should skip over leading values
+ *
+ * Called by btrescan once the caller's scan keys are in scan->keyData[].  A
+ * scan qualifies for skipping when its first key constrains the second index
+ * attribute, so that the leading attribute is the only thing keeping the
+ * keys from being used as boundary keys by _bt_first.  See nbtree.h for an
+ * outline of how the groups are visited.  Independently of that, callers
+ * that set xs_want_skip can use btskip to move on to the next leading value
+ * whenever they like; we prepare for that here too.
+ *
+ * We don't support skipping in combination with array keys, nor in parallel
+ * scans.  We also need the leading attribute's stored type to be usable with
+ * the opclass's own comparison operators, since the values we skip to are
+ * taken directly from index tuples.
+ */
+void
+_bt_skip_setup(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Oid			opfamily = rel->rd_opfamily[0];
+	Oid			opcintype = rel->rd_opcintype[0];
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), 0);
+	bool		skipscan;
+
+	so->skipScan = false;
+	so->skipDistinct = false;
+	so->skipGroup = BTSKIP_START;
+	so->skipValue = (Datum) 0;
+	so->skipDir = NoMovementScanDirection;
+	so->skipUseless = 0;
+	so->skipPage = InvalidBlockNumber;
+	so->skipMarkGroup = BTSKIP_START;
+	so->skipMarkValue = (Datum) 0;
+	so->skipMarkDir = NoMovementScanDirection;
+	if (so->skipContext != NULL)
+		MemoryContextReset(so->skipContext);
+
+	skipscan = (scan->numberOfKeys > 0 &&
+				IndexRelationGetNumberOfKeyAttributes(rel) >= 2 &&
+				scan->keyData[0].sk_attno == 2);
+	if ((!skipscan && !scan->xs_want_skip) || scan->parallel_scan != NULL)
+		return;
+
+	for (int i = 0; i < scan->numberOfKeys; i++)
+	{
+		if (scan->keyData[i].sk_flags & SK_SEARCHARRAY)
+			return;
+	}
+
+	/*
+	 * The templates for the leading attribute's keys only need to be built
+	 * once per scan.  Also make room in so->keyData[] for the extra key.
+	 */
+	if (so->skipKeyData == NULL)
+	{
+		if (attr->atttypid != opcintype &&
+			!IsBinaryCoercible(attr->atttypid, opcintype))
+			return;
+
+		for (int strat = 1; strat <= BTMaxStrategyNumber; strat++)
+		{
+			Oid			opr = get_opfamily_member(opfamily, opcintype,
+												  opcintype, strat);
+
+			if (!OidIsValid(opr))
+				return;
+			ScanKeyEntryInitialize(&so->skipOpKeys[strat - 1],
+								   0,
+								   1,
+								   strat,
+								   opcintype,
+								   rel->rd_indcollation[0],
+								   get_opcode(opr),
+								   (Datum) 0);
+		}
+
+		so->skipKeyData = (ScanKey)
+			palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
+		if (so->keyData != NULL)
+			so->keyData = (ScanKey)
+				repalloc(so->keyData,
+						 (scan->numberOfKeys + 1) * sizeof(ScanKeyData));
+		else
+			so->keyData = (ScanKey)
+				palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
+	}
+
+	/* Make a scan-lifespan context to hold leading attribute values */
+	if (so->skipContext == NULL)
+		so->skipContext = AllocSetContextCreate(CurrentMemoryContext,
+												"BTree skip context",
+												ALLOCSET_SMALL_SIZES);
+
+	so->skipScan = skipscan;
+	so->skipDistinct = scan->xs_want_skip;
+}
+
 #ifdef USE_ASSERT_CHECKING
 /*
  * Verify that the scan's qual state matches what we expect at the point that
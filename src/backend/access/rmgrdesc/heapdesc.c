@@ -202,6 +202,16 @@ heap_desc(StringInfo buf, XLogReaderState *record)
 						 xlrec->xmax, xlrec->offnum);
 		infobits_desc(buf, xlrec->infobits_set, "infobits");
 		appendStringInfo(buf, ", flags: 0x%02X", xlrec->flags);
+
+		if (xlrec->flags & XLH_DELETE_IS_MULTI)
+		{
+			xl_heap_delete_multi *xlmulti;
+
+			xlmulti = (xl_heap_delete_multi *) (rec + SizeOfHeapDelete);
+			appendStringInfo(buf, ", ntuples: %d, offsets:", xlmulti->ntuples);
+			array_desc(buf, xlmulti->offsets, sizeof(OffsetNumber),
+					   xlmulti->ntuples, &offset_elem_desc, NULL);
+		}
 	}
 	else if (info == XLOG_HEAP_UPDATE)
 	{
@@ -85,6 +85,7 @@ spghandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = spgrescan;
 	amroutine->amgettuple = spggettuple;
 	amroutine->amgetbitmap = spggetbitmap;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = spgendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
@@ -104,6 +104,8 @@
 #include "storage/procarray.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/queryresultcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/timestamp.h"
 
 /*
@@ -1555,8 +1557,16 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	 * TransactionIdIsInProgress will stop saying the prepared xact is in
 	 * progress), then run the post-commit or post-abort callbacks. The
 	 * callbacks will release the locks the transaction held.
+	 *
+	 * We don't know which relations the transaction changed, so every cached
+	 * query result and shared plan becomes outdated when it commits.
 	 */
 	if (isCommit)
+	{
+		QueryResultCacheNoteAll();
+		PreCommit_QueryResultCache();
+		SharedPlanCacheNoteAll();
+		PreCommit_SharedPlanCache();
 		RecordTransactionCommitPrepared(xid,
 										hdr->nsubxacts, children,
 										hdr->ncommitrels, commitrels,
@@ -1564,6 +1574,7 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 										commitstats,
 										hdr->ninvalmsgs, invalmsgs,
 										hdr->initfileinval, gid);
+	}
 	else
 		RecordTransactionAbortPrepared(xid,
 									   hdr->nsubxacts, children,
@@ -1574,6 +1585,8 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 
 	ProcArrayRemove(proc, latestXid);
 
+	AtEOXact_QueryResultCache(isCommit);
+
 	/*
 	 * In case we fail while running the callbacks, mark the gxact invalid so
 	 * no one else will try to commit/rollback, and so it will be recycled if
@@ -1625,6 +1638,7 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 		if (hdr->initfileinval)
 			RelationCacheInitFilePostInvalidate();
 	}
+	AtEOXact_SharedPlanCache(isCommit);
 
 	/*
 	 * Acquire the two-phase lock.  We want to work on the two-phase callbacks
@@ -65,7 +65,9 @@
 #include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
+#include "utils/queryresultcache.h"
 #include "utils/relmapper.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/timeout.h"
 #include "utils/timestamp.h"
@@ -228,6 +230,7 @@ typedef struct SerializedTransactionState
 	FullTransactionId topFullTransactionId;
 	FullTransactionId currentFullTransactionId;
 	CommandId	currentCommandId;
+	bool		currentCommandIdUsed;
 	int			nParallelCurrentXids;
 	TransactionId parallelCurrentXids[FLEXIBLE_ARRAY_MEMBER];
 } SerializedTransactionState;
@@ -264,6 +267,12 @@ static SubTransactionId currentSubTransactionId;
 static CommandId currentCommandId;
 static bool currentCommandIdUsed;
 
+/*
+ * True in a parallel worker that inserts rows on behalf of its leader; see
+ * AllowParallelWorkerInserts().
+ */
+static bool parallelWorkerInserts = false;
+
 /*
  * xactStartTimestamp is the value of transaction_timestamp().
  * stmtStartTimestamp is the value of statement_timestamp().
@@ -830,11 +839,13 @@ GetCurrentCommandId(bool used)
 	{
 		/*
 		 * Forbid setting currentCommandIdUsed in a parallel worker, because
-		 * we have no provision for communicating this back to the leader.  We
-		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * we have no provision for communicating this back to the leader.
+		 * It's fine in a worker that was started to insert rows, if the
+		 * leader had already marked the command ID used before starting the
+		 * parallel operation.
 		 */
-		if (IsParallelWorker())
+		if (IsParallelWorker() &&
+			!(parallelWorkerInserts && currentCommandIdUsed))
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 					 errmsg("cannot modify data in a parallel worker")));
@@ -844,6 +855,29 @@ GetCurrentCommandId(bool used)
 	return currentCommandId;
 }
 
+/*
+ *	AllowParallelWorkerInserts
+ *
+ * Called by a parallel worker that inserts rows on behalf of its leader, as
+ * in parallel COPY FROM, INSERT ... SELECT and CREATE TABLE AS.  Other
+ * parallel workers may not insert tuples or use the command ID.
+ */
+void
+AllowParallelWorkerInserts(void)
+{
+	Assert(IsParallelWorker());
+	parallelWorkerInserts = true;
+}
+
+/*
+ *	ParallelWorkerInsertsAllowed
+ */
+bool
+ParallelWorkerInsertsAllowed(void)
+{
+	return parallelWorkerInserts;
+}
+
 /*
  *	SetParallelStartTimestamps
  *
@@ -2308,6 +2342,13 @@ CommitTransaction(void)
 
 	if (!is_parallel_worker)
 	{
+		/*
+		 * Cached query results depending on what we changed must not be used
+		 * once our changes become visible, and neither must shared plans.
+		 */
+		PreCommit_QueryResultCache();
+		PreCommit_SharedPlanCache();
+
 		/*
 		 * We need to mark our XIDs as committed in pg_xact.  This is where we
 		 * durably commit.
@@ -2338,6 +2379,8 @@ CommitTransaction(void)
 	 */
 	ProcArrayEndTransaction(MyProc, latestXid);
 
+	AtEOXact_QueryResultCache(true);
+
 	/*
 	 * This is all post-commit cleanup.  Note that if an error is raised here,
 	 * it's too late to abort the transaction.  This should be just
@@ -2377,6 +2420,9 @@ CommitTransaction(void)
 	 */
 	AtEOXact_Inval(true);
 
+	/* Shared plans may be stored again now that our changes were sent */
+	AtEOXact_SharedPlanCache(true);
+
 	AtEOXact_MultiXact();
 
 	ResourceOwnerRelease(TopTransactionResourceOwner,
@@ -2682,6 +2728,10 @@ PrepareTransaction(void)
 
 	PostPrepare_PredicateLocks(xid);
 
+	/* COMMIT PREPARED will outdate cached query results, see there */
+	AtEOXact_QueryResultCache(false);
+	AtEOXact_SharedPlanCache(false);
+
 	ResourceOwnerRelease(TopTransactionResourceOwner,
 						 RESOURCE_RELEASE_LOCKS,
 						 true, true);
@@ -2890,6 +2940,9 @@ AbortTransaction(void)
 	 */
 	ProcArrayEndTransaction(MyProc, latestXid);
 
+	AtEOXact_QueryResultCache(false);
+	AtEOXact_SharedPlanCache(false);
+
 	/*
 	 * Post-abort cleanup.  See notes in CommitTransaction() concerning
 	 * ordering.  We can skip all of it if the transaction failed before
@@ -5491,6 +5544,7 @@ SerializeTransactionState(Size maxsize, char *start_address)
 	result->currentFullTransactionId =
 		CurrentTransactionState->fullTransactionId;
 	result->currentCommandId = currentCommandId;
+	result->currentCommandIdUsed = currentCommandIdUsed;
 
 	/*
 	 * If we're running in a parallel worker and launching a parallel worker
@@ -5560,6 +5614,7 @@ StartParallelWorkerTransaction(char *tstatespace)
 	CurrentTransactionState->fullTransactionId =
 		tstate->currentFullTransactionId;
 	currentCommandId = tstate->currentCommandId;
+	currentCommandIdUsed = tstate->currentCommandIdUsed;
 	nParallelCurrentXids = tstate->nParallelCurrentXids;
 	ParallelCurrentXids = &tstate->parallelCurrentXids[0];
 
@@ -132,6 +132,10 @@ check_publication_add_schema(Oid schemaid)
  * dropped and reloaded and then it'll be considered publishable.  The best
  * long-term solution may be to add a "relispublishable" bool to pg_class,
  * and depend on that instead of OID checks.
+ *
+ * Tables that the system creates in pg_catalog after initdb, such as the
+ * change logs of incrementally maintained materialized views, are excluded
+ * by namespace.
  */
 static bool
 is_publishable_class(Oid relid, Form_pg_class reltuple)
@@ -139,6 +143,7 @@ is_publishable_class(Oid relid, Form_pg_class reltuple)
 	return (reltuple->relkind == RELKIND_RELATION ||
 			reltuple->relkind == RELKIND_PARTITIONED_TABLE) &&
 		!IsCatalogRelationOid(relid) &&
+		!IsCatalogNamespace(reltuple->relnamespace) &&
 		reltuple->relpersistence == RELPERSISTENCE_PERMANENT &&
 		relid >= FirstNormalObjectId;
 }
@@ -675,6 +675,8 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_slru(text) FROM public;
 
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_query_result_cache() FROM public;
+
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
@@ -751,12 +753,16 @@ REVOKE EXECUTE ON FUNCTION pg_ls_dir(text,boolean,boolean) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_log_backend_memory_contexts(integer) FROM PUBLIC;
 
+REVOKE EXECUTE ON FUNCTION pg_cardinality_feedback_reset() FROM PUBLIC;
+
 REVOKE EXECUTE ON FUNCTION pg_ls_logicalsnapdir() FROM PUBLIC;
 
 REVOKE EXECUTE ON FUNCTION pg_ls_logicalmapdir() FROM PUBLIC;
 
 REVOKE EXECUTE ON FUNCTION pg_ls_replslotdir(text) FROM PUBLIC;
 
+REVOKE EXECUTE ON FUNCTION incremental_matview_log() FROM PUBLIC;
+
 --
 -- We also set up some things as accessible to standard roles.
 --
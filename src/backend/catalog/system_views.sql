@@ -665,6 +665,14 @@ GRANT SELECT ON pg_backend_memory_contexts TO pg_read_all_stats;
 REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
 GRANT EXECUTE ON FUNCTION pg_get_backend_memory_contexts() TO pg_read_all_stats;
 
+CREATE VIEW pg_cardinality_feedback AS
+    SELECT * FROM pg_get_cardinality_feedback();
+
+REVOKE ALL ON pg_cardinality_feedback FROM PUBLIC;
+GRANT SELECT ON pg_cardinality_feedback TO pg_read_all_stats;
+REVOKE EXECUTE ON FUNCTION pg_get_cardinality_feedback() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_get_cardinality_feedback() TO pg_read_all_stats;
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -929,6 +937,18 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_query_result_cache AS
+    SELECT
+            s.hits,
+            s.misses,
+            s.invalidations,
+            s.stores,
+            s.evictions,
+            s.entries,
+            s.bytes,
+            s.stats_reset
+    FROM pg_stat_get_query_result_cache() s;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -0,0 +1,1002 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyarrow.c
+ *		Arrow IPC stream output for COPY TO
+ *
+ * COPY ... TO ... (FORMAT arrow) writes the result in the Apache Arrow
+ * columnar IPC streaming format: a Schema message, then a sequence of
+ * record batches, then an end-of-stream marker.  Rows are accumulated into
+ * per-column buffers until a batch is full, at which point the whole batch
+ * is written out.
+ *
+ * Fixed-width types with an exact Arrow counterpart (booleans, integers,
+ * floats, dates, times, timestamps and UUIDs) are copied straight out of
+ * their Datums, without going through any output function; bytea is written
+ * as Arrow Binary.  String types are dictionary-encoded with int32 indexes.
+ * A new dictionary is built for each batch and sent as a replacement
+ * DictionaryBatch just before the batch that uses it, which the streaming
+ * format allows.  Any other type is written as plain Utf8 using its text
+ * output function.  All strings are converted to UTF-8.
+ *
+ * Arrow messages are described by flatbuffers.  We need only a handful of
+ * tables, so rather than depending on the flatbuffers library we build them
+ * by hand, front to back: each table is preceded by its vtable, and
+ * references to child objects are patched in once the child has been
+ * written after its parent.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyarrow.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "commands/copyarrow.h"
+#include "common/hashfn.h"
+#include "common/int.h"
+#include "datatype/timestamp.h"
+#include "mb/pg_wchar.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
+
+/*
+ * A batch is written out once it holds this many rows, or once its buffers
+ * have grown past this many bytes, whichever comes first.
+ */
+#define ARROW_BATCH_ROWS		65536
+#define ARROW_BATCH_BYTES		(16 * 1024 * 1024)
+
+/* Values from the Arrow format's Schema.fbs and Message.fbs */
+#define ARROW_METADATA_V5			4
+
+#define ARROW_HEADER_SCHEMA			1
+#define ARROW_HEADER_DICTIONARY		2
+#define ARROW_HEADER_RECORDBATCH	3
+
+#define ARROW_TYPE_INT				2
+#define ARROW_TYPE_FLOATINGPOINT	3
+#define ARROW_TYPE_BINARY			4
+#define ARROW_TYPE_UTF8				5
+#define ARROW_TYPE_BOOL				6
+#define ARROW_TYPE_DATE				8
+#define ARROW_TYPE_TIME				9
+#define ARROW_TYPE_TIMESTAMP		10
+#define ARROW_TYPE_FIXEDSIZEBINARY	15
+
+#define ARROW_PRECISION_SINGLE		1
+#define ARROW_PRECISION_DOUBLE		2
+#define ARROW_DATEUNIT_DAY			0
+#define ARROW_TIMEUNIT_MICROSECOND	2
+
+#ifdef WORDS_BIGENDIAN
+#define ARROW_ENDIANNESS			1
+#else
+#define ARROW_ENDIANNESS			0
+#endif
+
+/* Days and microseconds between the Unix and Postgres epochs */
+#define ARROW_EPOCH_DAYS	(POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE)
+#define ARROW_EPOCH_USECS	((int64) ARROW_EPOCH_DAYS * USECS_PER_DAY)
+
+/* How the values of a column are laid out */
+typedef enum ArrowColumnKind
+{
+	ARROW_COL_BOOL,				/* bit-packed values */
+	ARROW_COL_FIXED,			/* fixed-width values */
+	ARROW_COL_BINARY,			/* offsets and bytes, from bytea */
+	ARROW_COL_UTF8,				/* offsets and bytes, from output function */
+	ARROW_COL_DICT,				/* int32 indexes into a Utf8 dictionary */
+} ArrowColumnKind;
+
+struct arrowdict_hash;
+
+typedef struct ArrowColumn
+{
+	int			attnum;			/* attribute number in the source tuple */
+	Oid			typid;			/* base type of the attribute */
+	ArrowColumnKind kind;
+	int			width;			/* value width, for ARROW_COL_FIXED */
+	char	   *name;			/* column name, in UTF-8 */
+	bool		nullable;
+	FmgrInfo   *out_function;	/* text output function, for ARROW_COL_UTF8 */
+
+	/*
+	 * Buffers of the current batch.  'values' holds the bits, fixed-width
+	 * values or dictionary indexes; 'offsets' and 'data' hold the variable
+	 * width values, or the dictionary entries for ARROW_COL_DICT.
+	 */
+	int64		null_count;
+	StringInfoData validity;
+	StringInfoData values;
+	StringInfoData offsets;
+	StringInfoData data;
+
+	/* Dictionary lookup, for ARROW_COL_DICT */
+	struct arrowdict_hash *dict;
+	int32		ndict;			/* number of entries in the dictionary */
+	const char *probe;			/* string being looked up */
+	int			probe_len;
+} ArrowColumn;
+
+struct ArrowWriter
+{
+	int			ncolumns;
+	ArrowColumn *columns;
+	int64		nrows;			/* rows in the current batch */
+	int64		nbytes;			/* approximate size of the current batch */
+	bool		to_utf8;		/* must strings be converted to UTF-8? */
+};
+
+/* A buffer of the message body */
+typedef struct ArrowBuffer
+{
+	const char *data;
+	int64		len;
+} ArrowBuffer;
+
+/*
+ * Dictionary entries are identified by their index.  The string being looked
+ * up is stashed in the column and identified by index -1, so that it needn't
+ * be copied unless it turns out to be new.
+ */
+typedef struct ArrowDictEntry
+{
+	int32		index;
+	uint32		hash;
+	char		status;
+} ArrowDictEntry;
+
+static inline const char *
+arrow_dict_string(ArrowColumn *col, int32 index, int *len)
+{
+	const int32 *offsets = (const int32 *) col->offsets.data;
+
+	if (index < 0)
+	{
+		*len = col->probe_len;
+		return col->probe;
+	}
+	*len = offsets[index + 1] - offsets[index];
+	return col->data.data + offsets[index];
+}
+
+static inline uint32
+arrow_dict_hash(ArrowColumn *col, int32 index)
+{
+	const char *str;
+	int			len;
+
+	str = arrow_dict_string(col, index, &len);
+	return hash_bytes((const unsigned char *) str, len);
+}
+
+static inline bool
+arrow_dict_equal(ArrowColumn *col, int32 a, int32 b)
+{
+	const char *stra;
+	const char *strb;
+	int			lena;
+	int			lenb;
+
+	stra = arrow_dict_string(col, a, &lena);
+	strb = arrow_dict_string(col, b, &lenb);
+	return lena == lenb && memcmp(stra, strb, lena) == 0;
+}
+
+#define SH_PREFIX		arrowdict
+#define SH_ELEMENT_TYPE	ArrowDictEntry
+#define SH_KEY_TYPE		int32
+#define SH_KEY			index
+#define SH_HASH_KEY(tb, key) arrow_dict_hash((ArrowColumn *) (tb)->private_data, key)
+#define SH_EQUAL(tb, a, b) arrow_dict_equal((ArrowColumn *) (tb)->private_data, a, b)
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_SCOPE		static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+
+/*
+ * Flatbuffer construction
+ *
+ * All flatbuffer scalars are little-endian, whatever the host byte order.
+ * Positions are offsets from the start of the flatbuffer.
+ */
+#define FB_MAX_FIELDS	8
+
+typedef struct FbTable
+{
+	int			nfields;
+	uint8		size[FB_MAX_FIELDS];	/* field width, 0 if absent */
+	uint64		value[FB_MAX_FIELDS];	/* scalar value */
+	int			pos[FB_MAX_FIELDS]; /* set by fb_table() */
+} FbTable;
+
+static void
+fb_append(StringInfo buf, uint64 value, int size)
+{
+	for (int i = 0; i < size; i++)
+		appendStringInfoCharMacro(buf, (char) (value >> (8 * i)));
+}
+
+static void
+fb_store(StringInfo buf, int pos, uint64 value, int size)
+{
+	for (int i = 0; i < size; i++)
+		buf->data[pos + i] = (char) (value >> (8 * i));
+}
+
+static void
+fb_pad(StringInfo buf, int align)
+{
+	while (buf->len % align != 0)
+		appendStringInfoCharMacro(buf, '\0');
+}
+
+/* Point the offset stored at 'pos' to the object at 'target' */
+static void
+fb_patch(StringInfo buf, int pos, int target)
+{
+	Assert(target > pos);
+	fb_store(buf, pos, target - pos, 4);
+}
+
+static void
+fb_scalar(FbTable *t, int id, int size, uint64 value)
+{
+	Assert(id < FB_MAX_FIELDS);
+	t->size[id] = size;
+	t->value[id] = value;
+	t->nfields = Max(t->nfields, id + 1);
+}
+
+/* A reference to a child object, to be filled in with fb_patch() */
+static void
+fb_offset(FbTable *t, int id)
+{
+	fb_scalar(t, id, 4, 0);
+}
+
+/*
+ * Write a table and its vtable, returning the table's position.  The
+ * positions of its fields are stored in t->pos[].
+ */
+static int
+fb_table(StringInfo buf, FbTable *t)
+{
+	int			fieldoff[FB_MAX_FIELDS] = {0};
+	int			tblsize = 4;	/* the table starts with its vtable offset */
+	int			vtpos;
+	int			tblpos;
+
+	/* Place the widest fields first, so that each one is aligned */
+	for (int size = 8; size > 0; size /= 2)
+	{
+		for (int i = 0; i < t->nfields; i++)
+		{
+			if (t->size[i] != size)
+				continue;
+			tblsize = TYPEALIGN(size, tblsize);
+			fieldoff[i] = tblsize;
+			tblsize += size;
+		}
+	}
+
+	fb_pad(buf, 2);
+	vtpos = buf->len;
+	fb_append(buf, 4 + 2 * t->nfields, 2);
+	fb_append(buf, tblsize, 2);
+	for (int i = 0; i < t->nfields; i++)
+		fb_append(buf, fieldoff[i], 2);
+
+	fb_pad(buf, 8);
+	tblpos = buf->len;
+	fb_append(buf, tblpos - vtpos, 4);
+	while (buf->len < tblpos + tblsize)
+		appendStringInfoCharMacro(buf, '\0');
+	for (int i = 0; i < t->nfields; i++)
+	{
+		if (t->size[i] == 0)
+			continue;
+		t->pos[i] = tblpos + fieldoff[i];
+		fb_store(buf, t->pos[i], t->value[i], t->size[i]);
+	}
+
+	return tblpos;
+}
+
+static int
+fb_string(StringInfo buf, const char *str)
+{
+	int			len = strlen(str);
+	int			pos;
+
+	fb_pad(buf, 4);
+	pos = buf->len;
+	fb_append(buf, len, 4);
+	appendBinaryStringInfo(buf, str, len + 1);
+	return pos;
+}
+
+/*
+ * Write a vector of 'n' offsets to be patched by the caller; element i is at
+ * the returned position + 4 + 4 * i.
+ */
+static int
+fb_offset_vector(StringInfo buf, int n)
+{
+	int			pos;
+
+	fb_pad(buf, 4);
+	pos = buf->len;
+	fb_append(buf, n, 4);
+	for (int i = 0; i < n; i++)
+		fb_append(buf, 0, 4);
+	return pos;
+}
+
+/* Write a vector of 'n' structs made of two longs, such as FieldNode */
+static int
+fb_pair_vector(StringInfo buf, int n, const int64 *pairs)
+{
+	int			pos;
+
+	/* The elements, not the length word, must be 8-byte aligned */
+	while ((buf->len + 4) % 8 != 0)
+		appendStringInfoCharMacro(buf, '\0');
+	pos = buf->len;
+	fb_append(buf, n, 4);
+	for (int i = 0; i < 2 * n; i++)
+		fb_append(buf, pairs[i], 8);
+	return pos;
+}
+
+
+/*
+ * Write an encapsulated IPC message: continuation marker, metadata length,
+ * the Message flatbuffer, and the body buffers, each padded to 8 bytes.
+ */
+static void
+arrow_write_message(StringInfo out, StringInfo meta,
+					const ArrowBuffer *bufs, int nbufs)
+{
+	fb_append(out, 0xFFFFFFFF, 4);
+	fb_append(out, TYPEALIGN(8, meta->len), 4);
+	appendBinaryStringInfo(out, meta->data, meta->len);
+	fb_pad(out, 8);
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		if (bufs[i].len == 0)
+			continue;
+		appendBinaryStringInfo(out, bufs[i].data, bufs[i].len);
+		fb_pad(out, 8);
+	}
+}
+
+/*
+ * Start a Message flatbuffer with the given header type and body length.
+ * Returns the position of the reference to the header table.
+ */
+static int
+arrow_begin_message(StringInfo meta, int header_type, int64 body_len)
+{
+	FbTable		msg = {0};
+
+	initStringInfo(meta);
+	fb_append(meta, 0, 4);		/* root offset */
+	fb_scalar(&msg, 0, 2, ARROW_METADATA_V5);
+	fb_scalar(&msg, 1, 1, header_type);
+	fb_offset(&msg, 2);
+	fb_scalar(&msg, 3, 8, body_len);
+	fb_patch(meta, 0, fb_table(meta, &msg));
+
+	return msg.pos[2];
+}
+
+/*
+ * Write a DictionaryBatch or RecordBatch message, with one FieldNode per
+ * entry of 'nodes' (pairs of length and null count) and the given buffers.
+ */
+static void
+arrow_write_batch(StringInfo out, int64 dict_id, int64 nrows,
+				  int nnodes, const int64 *nodes,
+				  int nbufs, const ArrowBuffer *bufs)
+{
+	StringInfoData meta;
+	FbTable		rb = {0};
+	int64	   *bufdesc;
+	int64		body_len = 0;
+	int			ref;
+
+	bufdesc = palloc(2 * nbufs * sizeof(int64));
+	for (int i = 0; i < nbufs; i++)
+	{
+		bufdesc[2 * i] = body_len;
+		bufdesc[2 * i + 1] = bufs[i].len;
+		body_len += TYPEALIGN64(8, bufs[i].len);
+	}
+
+	ref = arrow_begin_message(&meta, dict_id >= 0 ?
+							  ARROW_HEADER_DICTIONARY : ARROW_HEADER_RECORDBATCH,
+							  body_len);
+	if (dict_id >= 0)
+	{
+		FbTable		db = {0};
+
+		fb_scalar(&db, 0, 8, dict_id);
+		fb_offset(&db, 1);
+		fb_patch(&meta, ref, fb_table(&meta, &db));
+		ref = db.pos[1];
+	}
+
+	fb_scalar(&rb, 0, 8, nrows);
+	fb_offset(&rb, 1);
+	fb_offset(&rb, 2);
+	fb_patch(&meta, ref, fb_table(&meta, &rb));
+	fb_patch(&meta, rb.pos[1], fb_pair_vector(&meta, nnodes, nodes));
+	fb_patch(&meta, rb.pos[2], fb_pair_vector(&meta, nbufs, bufdesc));
+
+	arrow_write_message(out, &meta, bufs, nbufs);
+
+	pfree(meta.data);
+	pfree(bufdesc);
+}
+
+/*
+ * Write the Field table describing one column.
+ */
+static int
+arrow_write_field(StringInfo buf, ArrowColumn *col, int64 dict_id)
+{
+	FbTable		field = {0};
+	FbTable		type = {0};
+	int			type_id;
+	const char *timezone = NULL;
+	int			pos;
+
+	switch (col->typid)
+	{
+		case BOOLOID:
+			type_id = ARROW_TYPE_BOOL;
+			break;
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case OIDOID:
+			type_id = ARROW_TYPE_INT;
+			fb_scalar(&type, 0, 4, col->width * 8);
+			fb_scalar(&type, 1, 1, col->typid != OIDOID);
+			break;
+		case FLOAT4OID:
+			type_id = ARROW_TYPE_FLOATINGPOINT;
+			fb_scalar(&type, 0, 2, ARROW_PRECISION_SINGLE);
+			break;
+		case FLOAT8OID:
+			type_id = ARROW_TYPE_FLOATINGPOINT;
+			fb_scalar(&type, 0, 2, ARROW_PRECISION_DOUBLE);
+			break;
+		case DATEOID:
+			type_id = ARROW_TYPE_DATE;
+			fb_scalar(&type, 0, 2, ARROW_DATEUNIT_DAY);
+			break;
+		case TIMEOID:
+			type_id = ARROW_TYPE_TIME;
+			fb_scalar(&type, 0, 2, ARROW_TIMEUNIT_MICROSECOND);
+			fb_scalar(&type, 1, 4, 64);
+			break;
+		case TIMESTAMPTZOID:
+			timezone = "UTC";
+			/* FALLTHROUGH */
+		case TIMESTAMPOID:
+			type_id = ARROW_TYPE_TIMESTAMP;
+			fb_scalar(&type, 0, 2, ARROW_TIMEUNIT_MICROSECOND);
+			if (timezone)
+				fb_offset(&type, 1);
+			break;
+		case UUIDOID:
+			type_id = ARROW_TYPE_FIXEDSIZEBINARY;
+			fb_scalar(&type, 0, 4, UUID_LEN);
+			break;
+		case BYTEAOID:
+			type_id = ARROW_TYPE_BINARY;
+			break;
+		default:
+			type_id = ARROW_TYPE_UTF8;
+			break;
+	}
+
+	fb_offset(&field, 0);
+	fb_scalar(&field, 1, 1, col->nullable);
+	fb_scalar(&field, 2, 1, type_id);
+	fb_offset(&field, 3);
+	if (col->kind == ARROW_COL_DICT)
+		fb_offset(&field, 4);
+	fb_offset(&field, 5);
+	pos = fb_table(buf, &field);
+
+	fb_patch(buf, field.pos[0], fb_string(buf, col->name));
+	fb_patch(buf, field.pos[3], fb_table(buf, &type));
+	if (timezone)
+		fb_patch(buf, type.pos[1], fb_string(buf, timezone));
+
+	if (col->kind == ARROW_COL_DICT)
+	{
+		FbTable		dict = {0};
+		FbTable		index = {0};
+
+		fb_scalar(&dict, 0, 8, dict_id);
+		fb_offset(&dict, 1);
+		fb_patch(buf, field.pos[4], fb_table(buf, &dict));
+
+		fb_scalar(&index, 0, 4, 32);
+		fb_scalar(&index, 1, 1, true);
+		fb_patch(buf, dict.pos[1], fb_table(buf, &index));
+	}
+
+	/* Readers insist on a children vector, even an empty one */
+	fb_patch(buf, field.pos[5], fb_offset_vector(buf, 0));
+
+	return pos;
+}
+
+
+/*
+ * Reset the buffers of a column for a new batch.
+ */
+static void
+arrow_reset_column(ArrowColumn *col)
+{
+	int32		zero = 0;
+
+	col->null_count = 0;
+	resetStringInfo(&col->validity);
+	resetStringInfo(&col->values);
+	resetStringInfo(&col->offsets);
+	resetStringInfo(&col->data);
+
+	if (col->kind == ARROW_COL_BINARY ||
+		col->kind == ARROW_COL_UTF8 ||
+		col->kind == ARROW_COL_DICT)
+		appendBinaryStringInfo(&col->offsets, &zero, sizeof(int32));
+
+	if (col->kind == ARROW_COL_DICT)
+	{
+		arrowdict_reset(col->dict);
+		col->ndict = 0;
+	}
+}
+
+/*
+ * Prepare to write the given columns of tuples described by tupDesc.
+ * out_functions holds the text output functions of the attributes, used for
+ * types that have no direct Arrow counterpart.
+ */
+ArrowWriter *
+ArrowWriterBegin(TupleDesc tupDesc, List *attnumlist, FmgrInfo *out_functions)
+{
+	ArrowWriter *writer;
+	ListCell   *cur;
+	int			i = 0;
+
+	writer = palloc0(sizeof(ArrowWriter));
+	writer->ncolumns = list_length(attnumlist);
+	writer->columns = palloc0(writer->ncolumns * sizeof(ArrowColumn));
+	writer->to_utf8 = (GetDatabaseEncoding() != PG_UTF8);
+
+	foreach(cur, attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+		ArrowColumn *col = &writer->columns[i++];
+		char	   *name = NameStr(attr->attname);
+
+		col->attnum = attnum;
+		col->typid = getBaseType(attr->atttypid);
+		col->name = pg_server_to_any(name, strlen(name), PG_UTF8);
+		col->nullable = !attr->attnotnull;
+		col->out_function = &out_functions[attnum - 1];
+
+		switch (col->typid)
+		{
+			case BOOLOID:
+				col->kind = ARROW_COL_BOOL;
+				break;
+			case INT2OID:
+				col->kind = ARROW_COL_FIXED;
+				col->width = sizeof(int16);
+				break;
+			case INT4OID:
+			case OIDOID:
+			case FLOAT4OID:
+			case DATEOID:
+				col->kind = ARROW_COL_FIXED;
+				col->width = sizeof(int32);
+				break;
+			case INT8OID:
+			case FLOAT8OID:
+			case TIMEOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				col->kind = ARROW_COL_FIXED;
+				col->width = sizeof(int64);
+				break;
+			case UUIDOID:
+				col->kind = ARROW_COL_FIXED;
+				col->width = UUID_LEN;
+				break;
+			case BYTEAOID:
+				col->kind = ARROW_COL_BINARY;
+				break;
+			case TEXTOID:
+			case VARCHAROID:
+			case BPCHAROID:
+			case NAMEOID:
+				col->kind = ARROW_COL_DICT;
+				col->dict = arrowdict_create(CurrentMemoryContext, 256, col);
+				break;
+			default:
+				col->kind = ARROW_COL_UTF8;
+				break;
+		}
+
+		initStringInfo(&col->validity);
+		initStringInfo(&col->values);
+		initStringInfo(&col->offsets);
+		initStringInfo(&col->data);
+		arrow_reset_column(col);
+	}
+
+	return writer;
+}
+
+/*
+ * Write the Schema message that starts the stream.
+ */
+void
+ArrowWriterSchema(ArrowWriter *writer, StringInfo out)
+{
+	StringInfoData meta;
+	FbTable		schema = {0};
+	int			ref;
+	int			fields;
+
+	ref = arrow_begin_message(&meta, ARROW_HEADER_SCHEMA, 0);
+
+	fb_scalar(&schema, 0, 2, ARROW_ENDIANNESS);
+	fb_offset(&schema, 1);
+	fb_patch(&meta, ref, fb_table(&meta, &schema));
+
+	fields = fb_offset_vector(&meta, writer->ncolumns);
+	fb_patch(&meta, schema.pos[1], fields);
+	for (int i = 0; i < writer->ncolumns; i++)
+		fb_patch(&meta, fields + 4 + 4 * i,
+				 arrow_write_field(&meta, &writer->columns[i], i));
+
+	arrow_write_message(out, &meta, NULL, 0);
+	pfree(meta.data);
+}
+
+/* Append a bit to a bitmap holding 'n' bits so far */
+static inline void
+arrow_append_bit(StringInfo bitmap, int64 n, bool bit)
+{
+	if (n % 8 == 0)
+		appendStringInfoCharMacro(bitmap, '\0');
+	if (bit)
+		bitmap->data[n / 8] |= 1 << (n % 8);
+}
+
+static void
+arrow_append_fixed(ArrowColumn *col, Datum value, bool isnull)
+{
+	union
+	{
+		int16		i16;
+		int32		i32;
+		int64		i64;
+		float4		f4;
+		float8		f8;
+	}			v;
+	const void *ptr = &v;
+
+	if (isnull)
+	{
+		enlargeStringInfo(&col->values, col->width);
+		memset(col->values.data + col->values.len, 0, col->width);
+		col->values.len += col->width;
+		return;
+	}
+
+	switch (col->typid)
+	{
+		case INT2OID:
+			v.i16 = DatumGetInt16(value);
+			break;
+		case INT4OID:
+			v.i32 = DatumGetInt32(value);
+			break;
+		case OIDOID:
+			v.i32 = (int32) DatumGetObjectId(value);
+			break;
+		case FLOAT4OID:
+			v.f4 = DatumGetFloat4(value);
+			break;
+		case DATEOID:
+			v.i32 = DatumGetDateADT(value);
+			/* Arrow has no infinities, so those are left as is */
+			if (!DATE_NOT_FINITE(v.i32))
+				v.i32 += ARROW_EPOCH_DAYS;
+			break;
+		case INT8OID:
+			v.i64 = DatumGetInt64(value);
+			break;
+		case FLOAT8OID:
+			v.f8 = DatumGetFloat8(value);
+			break;
+		case TIMEOID:
+			v.i64 = DatumGetTimeADT(value);
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			v.i64 = DatumGetTimestamp(value);
+			/* The last few days before the end of the range don't fit */
+			if (!TIMESTAMP_NOT_FINITE(v.i64) &&
+				pg_add_s64_overflow(v.i64, ARROW_EPOCH_USECS, &v.i64))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+						 errmsg("timestamp out of range for Arrow format")));
+			break;
+		case UUIDOID:
+			ptr = DatumGetUUIDP(value)->data;
+			break;
+		default:
+			elog(ERROR, "unexpected type %u for Arrow column", col->typid);
+	}
+
+	appendBinaryStringInfo(&col->values, ptr, col->width);
+}
+
+/*
+ * Get the bytes to write for a string or bytea value, converted to UTF-8
+ * where needed.  Anything palloc'd goes in the caller's per-row context.
+ */
+static const char *
+arrow_string_value(ArrowWriter *writer, ArrowColumn *col, Datum value,
+				   int *len)
+{
+	const char *str;
+
+	switch (col->typid)
+	{
+		case BYTEAOID:
+			{
+				bytea	   *b = DatumGetByteaPP(value);
+
+				*len = VARSIZE_ANY_EXHDR(b);
+				return VARDATA_ANY(b);
+			}
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+			{
+				text	   *t = DatumGetTextPP(value);
+
+				str = VARDATA_ANY(t);
+				*len = VARSIZE_ANY_EXHDR(t);
+				break;
+			}
+		case NAMEOID:
+			str = NameStr(*DatumGetName(value));
+			*len = strlen(str);
+			break;
+		default:
+			str = OutputFunctionCall(col->out_function, value);
+			*len = strlen(str);
+			break;
+	}
+
+	if (writer->to_utf8)
+	{
+		const char *conv = pg_server_to_any(str, *len, PG_UTF8);
+
+		if (conv != str)
+		{
+			str = conv;
+			*len = strlen(str);
+		}
+	}
+
+	return str;
+}
+
+static void
+arrow_append_string(ArrowColumn *col, const char *str, int len)
+{
+	int32		end;
+
+	appendBinaryStringInfo(&col->data, str, len);
+	end = col->data.len;
+	appendBinaryStringInfo(&col->offsets, &end, sizeof(int32));
+}
+
+static void
+arrow_append_dict(ArrowColumn *col, const char *str, int len)
+{
+	ArrowDictEntry *entry;
+	bool		found;
+	int32		index;
+
+	col->probe = str;
+	col->probe_len = len;
+	entry = arrowdict_insert_hash(col->dict, -1,
+								  hash_bytes((const unsigned char *) str, len),
+								  &found);
+	if (!found)
+	{
+		entry->index = col->ndict++;
+		arrow_append_string(col, str, len);
+	}
+	index = entry->index;
+	appendBinaryStringInfo(&col->values, &index, sizeof(int32));
+}
+
+/*
+ * Add a row to the current batch.  Returns true if the batch is full and
+ * should be written out with ArrowWriterFlush().
+ */
+bool
+ArrowWriterAddRow(ArrowWriter *writer, TupleTableSlot *slot)
+{
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+		Datum		value = slot->tts_values[col->attnum - 1];
+		bool		isnull = slot->tts_isnull[col->attnum - 1];
+		const char *str;
+		int			len;
+
+		arrow_append_bit(&col->validity, writer->nrows, !isnull);
+		if (isnull)
+			col->null_count++;
+
+		switch (col->kind)
+		{
+			case ARROW_COL_BOOL:
+				arrow_append_bit(&col->values, writer->nrows,
+								 !isnull && DatumGetBool(value));
+				break;
+			case ARROW_COL_FIXED:
+				arrow_append_fixed(col, value, isnull);
+				writer->nbytes += col->width;
+				break;
+			case ARROW_COL_BINARY:
+			case ARROW_COL_UTF8:
+				if (isnull)
+				{
+					str = "";
+					len = 0;
+				}
+				else
+					str = arrow_string_value(writer, col, value, &len);
+				arrow_append_string(col, str, len);
+				writer->nbytes += len + sizeof(int32);
+				break;
+			case ARROW_COL_DICT:
+				if (isnull)
+				{
+					int32		index = 0;
+
+					appendBinaryStringInfo(&col->values, &index, sizeof(int32));
+				}
+				else
+				{
+					str = arrow_string_value(writer, col, value, &len);
+					arrow_append_dict(col, str, len);
+					writer->nbytes += len;
+				}
+				writer->nbytes += sizeof(int32);
+				break;
+		}
+	}
+
+	writer->nrows++;
+
+	return writer->nrows >= ARROW_BATCH_ROWS ||
+		writer->nbytes >= ARROW_BATCH_BYTES;
+}
+
+/*
+ * Write out the rows added since the last flush, if any, as a record batch
+ * preceded by the dictionaries it uses.
+ */
+void
+ArrowWriterFlush(ArrowWriter *writer, StringInfo out)
+{
+	int64	   *nodes;
+	ArrowBuffer *bufs;
+	int			nbufs = 0;
+
+	if (writer->nrows == 0)
+		return;
+
+	nodes = palloc(2 * writer->ncolumns * sizeof(int64));
+	bufs = palloc(3 * writer->ncolumns * sizeof(ArrowBuffer));
+
+	for (int i = 0; i < writer->ncolumns; i++)
+	{
+		ArrowColumn *col = &writer->columns[i];
+
+		nodes[2 * i] = writer->nrows;
+		nodes[2 * i + 1] = col->null_count;
+
+		/* The validity bitmap may be omitted when there are no nulls */
+		bufs[nbufs].data = col->validity.data;
+		bufs[nbufs++].len = col->null_count > 0 ? col->validity.len : 0;
+
+		switch (col->kind)
+		{
+			case ARROW_COL_BINARY:
+			case ARROW_COL_UTF8:
+				bufs[nbufs].data = col->offsets.data;
+				bufs[nbufs++].len = col->offsets.len;
+				bufs[nbufs].data = col->data.data;
+				bufs[nbufs++].len = col->data.len;
+				break;
+			case ARROW_COL_DICT:
+				{
+					ArrowBuffer dictbufs[3];
+					int64		dictnode[2];
+
+					dictnode[0] = col->ndict;
+					dictnode[1] = 0;
+					dictbufs[0].data = NULL;
+					dictbufs[0].len = 0;
+					dictbufs[1].data = col->offsets.data;
+					dictbufs[1].len = col->offsets.len;
+					dictbufs[2].data = col->data.data;
+					dictbufs[2].len = col->data.len;
+					arrow_write_batch(out, i, col->ndict, 1, dictnode,
+									  3, dictbufs);
+				}
+				/* FALLTHROUGH */
+			case ARROW_COL_BOOL:
+			case ARROW_COL_FIXED:
+				bufs[nbufs].data = col->values.data;
+				bufs[nbufs++].len = col->values.len;
+				break;
+		}
+	}
+
+	arrow_write_batch(out, -1, writer->nrows, writer->ncolumns, nodes,
+					  nbufs, bufs);
+
+	pfree(nodes);
+	pfree(bufs);
+
+	for (int i = 0; i < writer->ncolumns; i++)
+		arrow_reset_column(&writer->columns[i]);
+	writer->nrows = 0;
+	writer->nbytes = 0;
+}
+
+/*
+ * Write out the last batch and the end-of-stream marker.
+ */
+void
+ArrowWriterFinish(ArrowWriter *writer, StringInfo out)
+{
+	ArrowWriterFlush(writer, out);
+
+	fb_append(out, 0xFFFFFFFF, 4);
+	fb_append(out, 0, 4);
+}
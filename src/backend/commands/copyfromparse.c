@@ -42,6 +42,10 @@
  * but 'attribute_buf' is used as a temporary buffer to hold one attribute's
  * data when it's passed the receive function.
  *
+ * Steps 3 and 4 look at the input one byte at a time only around characters
+ * that are special to them.  Runs of ordinary bytes are skipped, or copied,
+ * a SIMD vector at a time; see CopyScanPlainChars().
+ *
  * 'raw_buf' is always 64 kB in size (RAW_BUF_SIZE).  'input_buf' is also
  * 64 kB (INPUT_BUF_SIZE), if encoding conversion is required.  'line_buf'
  * and 'attribute_buf' are expanded on demand, to hold the longest line
@@ -72,7 +76,9 @@
 #include "miscadmin.h"
 #include "nodes/miscnodes.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
 #include "utils/builtins.h"
 #include "utils/rel.h"
 
@@ -149,6 +155,12 @@ static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
 
 /* non-export function prototypes */
+static inline int CopyScanPlainChars(const char *ptr, const char *end,
+									 char c1, char c2, char c3, char c4);
+static inline int CopyScanLineText(CopyFromState cstate, const char *ptr,
+								   const char *end, bool *in_quote,
+								   char quotec, char escapec);
+static bool CopyReadHeaderLine(CopyFromState cstate);
 static bool CopyReadLine(CopyFromState cstate);
 static bool CopyReadLineText(CopyFromState cstate);
 static int	CopyReadAttributesText(CopyFromState cstate);
@@ -740,81 +752,94 @@ CopyReadBinaryData(CopyFromState cstate, char *dest, int nbytes)
 }
 
 /*
- * Read raw fields in the next line for COPY FROM in text or csv mode.
- * Return false if no more lines.
- *
- * An internal temporary buffer is returned via 'fields'. It is valid until
- * the next call of the function. Since the function returns all raw fields
- * in the input file, 'nfields' could be different from the number of columns
- * in the relation.
- *
- * NOTE: force_not_null option are not applied to the returned fields.
+ * Read and check the header line, if one is expected.  Return true if EOF
+ * was reached while reading it.
  */
-bool
-NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+static bool
+CopyReadHeaderLine(CopyFromState cstate)
 {
+	ListCell   *cur;
+	TupleDesc	tupDesc;
 	int			fldct;
 	bool		done;
 
-	/* only available for text or csv input */
-	Assert(!cstate->opts.binary);
+	tupDesc = RelationGetDescr(cstate->rel);
 
-	/* on input check that the header line is correct if needed */
-	if (cstate->cur_lineno == 0 && cstate->opts.header_line)
+	cstate->cur_lineno++;
+	done = CopyReadLine(cstate);
+
+	if (cstate->opts.header_line == COPY_HEADER_MATCH)
 	{
-		ListCell   *cur;
-		TupleDesc	tupDesc;
+		int			fldnum;
 
-		tupDesc = RelationGetDescr(cstate->rel);
+		if (cstate->opts.csv_mode)
+			fldct = CopyReadAttributesCSV(cstate);
+		else
+			fldct = CopyReadAttributesText(cstate);
 
-		cstate->cur_lineno++;
-		done = CopyReadLine(cstate);
+		if (fldct != list_length(cstate->attnumlist))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("wrong number of fields in header line: got %d, expected %d",
+							fldct, list_length(cstate->attnumlist))));
 
-		if (cstate->opts.header_line == COPY_HEADER_MATCH)
+		fldnum = 0;
+		foreach(cur, cstate->attnumlist)
 		{
-			int			fldnum;
+			int			attnum = lfirst_int(cur);
+			char	   *colName;
+			Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
 
-			if (cstate->opts.csv_mode)
-				fldct = CopyReadAttributesCSV(cstate);
-			else
-				fldct = CopyReadAttributesText(cstate);
+			Assert(fldnum < cstate->max_fields);
 
-			if (fldct != list_length(cstate->attnumlist))
+			colName = cstate->raw_fields[fldnum++];
+			if (colName == NULL)
 				ereport(ERROR,
 						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-						 errmsg("wrong number of fields in header line: got %d, expected %d",
-								fldct, list_length(cstate->attnumlist))));
+						 errmsg("column name mismatch in header line field %d: got null value (\"%s\"), expected \"%s\"",
+								fldnum, cstate->opts.null_print, NameStr(attr->attname))));
 
-			fldnum = 0;
-			foreach(cur, cstate->attnumlist)
+			if (namestrcmp(&attr->attname, colName) != 0)
 			{
-				int			attnum = lfirst_int(cur);
-				char	   *colName;
-				Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("column name mismatch in header line field %d: got \"%s\", expected \"%s\"",
+								fldnum, colName, NameStr(attr->attname))));
+			}
+		}
+	}
 
-				Assert(fldnum < cstate->max_fields);
+	return done;
+}
 
-				colName = cstate->raw_fields[fldnum++];
-				if (colName == NULL)
-					ereport(ERROR,
-							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-							 errmsg("column name mismatch in header line field %d: got null value (\"%s\"), expected \"%s\"",
-									fldnum, cstate->opts.null_print, NameStr(attr->attname))));
+/*
+ * Read the next line for COPY FROM in text or csv mode into line_buf,
+ * without splitting it into fields.  Return false if no more lines.
+ *
+ * If prev_lineno isn't NULL, *prev_lineno is set to the number of the input
+ * line before the record's first line.  A CSV record may span several
+ * lines, so that can't be derived from cur_lineno afterwards.
+ *
+ * This is used by the leader of a parallel COPY, which only needs to find
+ * line boundaries and leaves parsing to the workers.
+ */
+bool
+NextCopyFromLine(CopyFromState cstate, uint64 *prev_lineno)
+{
+	bool		done;
 
-				if (namestrcmp(&attr->attname, colName) != 0)
-				{
-					ereport(ERROR,
-							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-							 errmsg("column name mismatch in header line field %d: got \"%s\", expected \"%s\"",
-									fldnum, colName, NameStr(attr->attname))));
-				}
-			}
-		}
+	/* only available for text or csv input */
+	Assert(!cstate->opts.binary);
 
-		if (done)
+	/* on input check that the header line is correct if needed */
+	if (cstate->cur_lineno == 0 && cstate->opts.header_line)
+	{
+		if (CopyReadHeaderLine(cstate))
 			return false;
 	}
 
+	if (prev_lineno)
+		*prev_lineno = cstate->cur_lineno;
 	cstate->cur_lineno++;
 
 	/* Actually read the line into memory here */
@@ -828,6 +853,28 @@ NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
 	if (done && cstate->line_buf.len == 0)
 		return false;
 
+	return true;
+}
+
+/*
+ * Read raw fields in the next line for COPY FROM in text or csv mode.
+ * Return false if no more lines.
+ *
+ * An internal temporary buffer is returned via 'fields'. It is valid until
+ * the next call of the function. Since the function returns all raw fields
+ * in the input file, 'nfields' could be different from the number of columns
+ * in the relation.
+ *
+ * NOTE: force_not_null option are not applied to the returned fields.
+ */
+bool
+NextCopyFromRawFields(CopyFromState cstate, char ***fields, int *nfields)
+{
+	int			fldct;
+
+	if (!NextCopyFromLine(cstate, NULL))
+		return false;
+
 	/* Parse the line into de-escaped field values */
 	if (cstate->opts.csv_mode)
 		fldct = CopyReadAttributesCSV(cstate);
@@ -1088,6 +1135,126 @@ NextCopyFrom(CopyFromState cstate, ExprContext *econtext,
 	return true;
 }
 
+/*
+ * CopyScanPlainChars - count leading bytes that aren't special characters
+ *
+ * Returns the number of bytes from 'ptr' onwards, stopping before 'end',
+ * that are none of c1..c4 (pass duplicates if fewer are needed).  This looks
+ * at a whole vector of bytes at a time, and only at complete vectors, so the
+ * caller must be prepared to examine the remaining bytes one by one.  It
+ * returns 0 if we have no SIMD support.
+ *
+ * As explained in CopyReadLineText(), no byte of a multibyte character can
+ * be mistaken for one of the ASCII characters we look for here.
+ */
+static inline int
+CopyScanPlainChars(const char *ptr, const char *end,
+				   char c1, char c2, char c3, char c4)
+{
+#ifndef USE_NO_SIMD
+	const Vector8 v1 = vector8_broadcast((uint8) c1);
+	const Vector8 v2 = vector8_broadcast((uint8) c2);
+	const Vector8 v3 = vector8_broadcast((uint8) c3);
+	const Vector8 v4 = vector8_broadcast((uint8) c4);
+	const char *p = ptr;
+
+	while (end - p >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+		uint32		mask;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		mask = vector8_highbit_mask(vector8_or(vector8_or(vector8_eq(chunk, v1),
+														  vector8_eq(chunk, v2)),
+											   vector8_or(vector8_eq(chunk, v3),
+														  vector8_eq(chunk, v4))));
+		if (mask != 0)
+			return (p - ptr) + pg_rightmost_one_pos32(mask);
+		p += sizeof(Vector8);
+	}
+	return p - ptr;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * CopyScanLineText - skip over bytes that can't end the current line
+ *
+ * Returns the number of bytes from 'ptr' onwards that CopyReadLineText()
+ * may pass over without examining them, updating *in_quote and cur_lineno
+ * as it would have.  In text mode we stop at newlines and backslashes.  In
+ * CSV mode, when the quote and escape characters are the same (the common
+ * case), quoted newlines and doubled quotes don't need to stop the scan:
+ * the quoting state at each byte of a vector is the running parity of the
+ * quote characters up to it, which a prefix XOR of the quote bitmask gives
+ * us, so only newlines outside quotes remain.  With a separate escape
+ * character we just stop at quotes and escapes too.
+ */
+static inline int
+CopyScanLineText(CopyFromState cstate, const char *ptr, const char *end,
+				 bool *in_quote, char quotec, char escapec)
+{
+#ifndef USE_NO_SIMD
+	const Vector8 vnl = vector8_broadcast('\n');
+	const Vector8 vcr = vector8_broadcast('\r');
+	const Vector8 vquote = vector8_broadcast((uint8) quotec);
+	const char *p = ptr;
+
+	if (!cstate->opts.csv_mode)
+		return CopyScanPlainChars(ptr, end, '\n', '\r', '\\', '\\');
+	if (escapec != '\0')
+		return CopyScanPlainChars(ptr, end, '\n', '\r', quotec, escapec);
+
+	StaticAssertStmt(sizeof(Vector8) <= 16,
+					 "quote bitmask arithmetic assumes at most 16 lanes");
+
+	while (end - p >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+		uint32		quotes;
+		uint32		nl;
+		uint32		cr;
+		uint32		quoted;
+		uint32		stop;
+		uint32		done;
+		int			n;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		quotes = vector8_highbit_mask(vector8_eq(chunk, vquote));
+		nl = vector8_highbit_mask(vector8_eq(chunk, vnl));
+		cr = vector8_highbit_mask(vector8_eq(chunk, vcr));
+
+		/* bit i of 'quoted' is set if byte i is inside quotes */
+		quoted = quotes;
+		quoted ^= quoted << 1;
+		quoted ^= quoted << 2;
+		quoted ^= quoted << 4;
+		quoted ^= quoted << 8;
+		if (*in_quote)
+			quoted = ~quoted;
+
+		/* stop at the first newline outside quotes, if any */
+		stop = (nl | cr) & ~quoted & 0xFFFF;
+		n = stop ? pg_rightmost_one_pos32(stop) : (int) sizeof(Vector8);
+		done = ((uint32) 1 << n) - 1;
+
+		/* same line counting rule as CopyReadLineText() */
+		cstate->cur_lineno +=
+			pg_popcount32((cstate->eol_type == EOL_NL ? nl : cr) & quoted & done);
+		if (pg_popcount32(quotes & done) & 1)
+			*in_quote = !*in_quote;
+
+		p += n;
+		if (stop)
+			break;
+	}
+	return p - ptr;
+#else
+	return 0;
+#endif
+}
+
 /*
  * Read the next input line and stash it in line_buf.
  *
@@ -1261,6 +1428,28 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Pass over bytes that can't end the line in bulk.  In CSV mode, the
+		 * first character of a line must be looked at individually, as it
+		 * might begin an end-of-copy marker.
+		 */
+		if (!cstate->opts.csv_mode || !first_char_in_line)
+		{
+			int			nskip;
+
+			nskip = CopyScanLineText(cstate, copy_input_buf + input_buf_ptr,
+									 copy_input_buf + copy_buf_len,
+									 &in_quote, quotec, escapec);
+			if (nskip > 0)
+			{
+				/* none of the skipped bytes was an escape character */
+				last_was_esc = false;
+				input_buf_ptr += nskip;
+				if (input_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1608,6 +1797,17 @@ CopyReadAttributesText(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			int			nplain;
+
+			/* Copy any run of ordinary characters in bulk */
+			nplain = CopyScanPlainChars(cur_ptr, line_end_ptr,
+										delimc, '\\', delimc, '\\');
+			if (nplain > 0)
+			{
+				memcpy(output_ptr, cur_ptr, nplain);
+				output_ptr += nplain;
+				cur_ptr += nplain;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -1864,6 +2064,18 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				int			nplain;
+
+				/* Copy any run of ordinary characters in bulk */
+				nplain = CopyScanPlainChars(cur_ptr, line_end_ptr,
+											delimc, quotec, delimc, quotec);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -1887,6 +2099,17 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* In quote */
 			for (;;)
 			{
+				int			nplain;
+
+				nplain = CopyScanPlainChars(cur_ptr, line_end_ptr,
+											quotec, escapec, quotec, escapec);
+				if (nplain > 0)
+				{
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
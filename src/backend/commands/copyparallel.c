@@ -0,0 +1,660 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyparallel.c
+ *		Parallel COPY <table> FROM file/program/client
+ *
+ * In a parallel COPY FROM, the leader reads the input and does just enough
+ * parsing to find record boundaries (including CSV quoting and encoding
+ * conversion).  It packs whole records into chunks and hands them to the
+ * parallel workers round-robin over one shm_mq per worker.  Each worker
+ * runs the regular CopyFrom() machinery on the chunks it receives, so
+ * splitting lines into fields, input functions, defaults, constraints and
+ * table_multi_insert() all happen in the workers, each with its own
+ * BulkInsertState.
+ *
+ * Every chunk carries the line number of the record preceding it, so that
+ * errors raised in a worker report the same line number as a serial COPY
+ * would.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/copy.h"
+#include "commands/copyfrom_internal.h"
+#include "commands/progress.h"
+#include "executor/instrument.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/pathnodes.h"
+#include "optimizer/clauses.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "rewrite/rewriteHandler.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/lsyscache.h"
+#include "utils/queryresultcache.h"
+#include "utils/rel.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_COPY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_COPY_STATE			UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_COPY_QUEUES		UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xC000000000000005)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xC000000000000006)
+
+/*
+ * Size of each worker's input queue, and the size at which the leader sends
+ * off a chunk.  A chunk is only ever cut at a record boundary, so a single
+ * very long record can make one larger than this.
+ */
+#define PARALLEL_COPY_QUEUE_SIZE		(1024 * 1024)
+#define PARALLEL_COPY_CHUNK_SIZE		(256 * 1024)
+
+/*
+ * Shared state for a parallel COPY FROM.  The serialized COPY options,
+ * column list, WHERE clause and range table are stored separately under
+ * PARALLEL_KEY_COPY_STATE.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+
+	/* Results, added up by the workers as they finish */
+	pg_atomic_uint64 processed;
+	pg_atomic_uint64 num_errors;
+} ParallelCopyShared;
+
+/* The chunk a parallel worker is currently loading, see ParallelCopyRead */
+static char *ParallelCopyChunkData = NULL;
+static int	ParallelCopyChunkLen = 0;
+
+static bool ParallelCopyIsSafe(Relation rel, Node *whereClause,
+							   CopyFromState cstate);
+static bool ParallelCopySendChunk(shm_mq_handle **mqh, StringInfo parked,
+								  int nqueues, int *next, StringInfo chunk);
+static bool ParallelCopySendParked(shm_mq_handle *mqh, StringInfo parked,
+								   bool wait);
+static int	ParallelCopyRead(void *outbuf, int minread, int maxread);
+
+
+/*
+ * Check whether a COPY FROM into 'rel' can be done by parallel workers.
+ *
+ * Workers can't fire triggers, can't assign new command IDs, and can't see
+ * the leader's temporary tables, so we stick with plain tables without
+ * triggers.  The table must also use the heap access method, since we can't
+ * know whether another table AM's inserts work from several backends of one
+ * transaction at once.  Also, every expression that a worker might evaluate
+ * while loading a row must be parallel safe.
+ */
+static bool
+ParallelCopyIsSafe(Relation rel, Node *whereClause, CopyFromState cstate)
+{
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	PlannerInfo *root;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+	int			i;
+
+	if (!IsUnderPostmaster || IsInParallelMode())
+		return false;
+
+	/* We have no way to check for serializable conflicts in the workers */
+	if (IsolationIsSerializable())
+		return false;
+
+	if (cstate->opts.binary || cstate->opts.freeze)
+		return false;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+		rel->trigdesc != NULL)
+		return false;
+
+	if (rel->rd_tableam != GetHeapamTableAmRoutine())
+		return false;
+
+	/* Set up largely-dummy planner state for is_parallel_safe() */
+	root = makeNode(PlannerInfo);
+	root->glob = makeNode(PlannerGlobal);
+
+	if (!is_parallel_safe(root, whereClause))
+		return false;
+
+	for (i = 0; i < tupDesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, i);
+
+		if (att->attisdropped)
+			continue;
+
+		/* Domain constraints may contain arbitrary expressions */
+		if (get_typtype(att->atttypid) == TYPTYPE_DOMAIN)
+			return false;
+
+		if (func_parallel(cstate->in_functions[i].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+
+		/* This includes identity columns and generation expressions */
+		if (!is_parallel_safe(root, build_column_default(rel, i + 1)))
+			return false;
+	}
+
+	if (tupDesc->constr)
+	{
+		for (i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			Node	   *ccbin = stringToNode(tupDesc->constr->check[i].ccbin);
+
+			if (!is_parallel_safe(root, ccbin))
+				return false;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	index = index_open(lfirst_oid(lc), RowExclusiveLock);
+
+		if (!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
+			!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
+			safe = false;
+
+		index_close(index, NoLock);
+
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+/*
+ * ParallelCopyFrom - try to load the data using parallel workers.
+ *
+ * 'cstate' has been set up by BeginCopyFrom() to read the input.  Returns
+ * false without having read anything if the PARALLEL option wasn't given,
+ * the copy can't safely be done in parallel, or no workers could be
+ * launched; the caller should then do a serial CopyFrom().  Otherwise the
+ * whole input has been loaded and the number of rows is in *processed.
+ */
+bool
+ParallelCopyFrom(ParseState *pstate, Relation rel, Node *whereClause,
+				 const CopyStmt *stmt, CopyFromState cstate,
+				 uint64 *processed)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	List	   *options = NIL;
+	ListCell   *lc;
+	char	   *serialized;
+	Size		serializedlen;
+	char	   *state;
+	char	   *mqspace;
+	shm_mq_handle **mqh;
+	StringInfoData *parked;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	StringInfoData chunk;
+	ErrorContextCallback errcallback;
+	bool		detached = false;
+	int			querylen;
+	int			nworkers;
+	int			nlaunched;
+	int			next = 0;
+	uint64		num_errors;
+	int			i;
+
+	nworkers = Min(cstate->opts.nworkers, max_parallel_maintenance_workers);
+	if (nworkers <= 0 || !ParallelCopyIsSafe(rel, whereClause, cstate))
+		return false;
+
+	/*
+	 * The workers see the input after the leader has converted it to the
+	 * database encoding and stripped the header, so adjust their options to
+	 * match.
+	 */
+	foreach(lc, stmt->options)
+	{
+		DefElem    *defel = lfirst_node(DefElem, lc);
+
+		if (strcmp(defel->defname, "header") == 0 ||
+			strcmp(defel->defname, "encoding") == 0 ||
+			strcmp(defel->defname, "parallel") == 0)
+			continue;
+		options = lappend(options, defel);
+	}
+	options = lappend(options,
+					  makeDefElem("encoding",
+								  (Node *) makeString(pstrdup(GetDatabaseEncodingName())),
+								  -1));
+
+	serialized = nodeToString(list_make5(options, stmt->attlist, whereClause,
+										 pstate->p_rtable,
+										 pstate->p_rteperminfos));
+	serializedlen = strlen(serialized) + 1;
+
+	/*
+	 * The workers insert with our transaction ID and command ID, so make sure
+	 * both have been assigned, and the command ID marked used, before
+	 * entering parallel mode.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	/*
+	 * Likewise, the workers' inserts aren't seen by the query result cache,
+	 * so note the relation as modified ourselves.
+	 */
+	QueryResultCacheNoteRelation(RelationGetRelid(rel));
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain", nworkers);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_chunk(&pcxt->estimator, serializedlen);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	/* Estimate space for WalUsage and BufferUsage, as in nbtsort.c */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial copy) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc,
+													 sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(rel);
+	pg_atomic_init_u64(&shared->processed, 0);
+	pg_atomic_init_u64(&shared->num_errors, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_SHARED, shared);
+
+	state = (char *) shm_toc_allocate(pcxt->toc, serializedlen);
+	memcpy(state, serialized, serializedlen);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_STATE, state);
+
+	/* Create the workers' input queues, with ourselves as the sender */
+	mqspace = (char *) shm_toc_allocate(pcxt->toc,
+										mul_size(PARALLEL_COPY_QUEUE_SIZE,
+												 pcxt->nworkers));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(mqspace + i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COPY_QUEUES, mqspace);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+	nlaunched = pcxt->nworkers_launched;
+
+	/* If no workers were successfully launched, back out (do serial copy) */
+	if (nlaunched == 0)
+	{
+		WaitForParallelWorkersToFinish(pcxt);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	mqh = (shm_mq_handle **) palloc(nlaunched * sizeof(shm_mq_handle *));
+	parked = (StringInfoData *) palloc(nlaunched * sizeof(StringInfoData));
+	for (i = 0; i < nlaunched; i++)
+	{
+		mqh[i] = shm_mq_attach((shm_mq *) (mqspace + i * PARALLEL_COPY_QUEUE_SIZE),
+							   pcxt->seg, pcxt->worker[i].bgwhandle);
+		initStringInfo(&parked[i]);
+	}
+
+	/* Report errors in the input the same way CopyFrom() does */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/*
+	 * Read the input one record at a time, and send the records off in
+	 * chunks.  Each chunk starts with the line number of the record before
+	 * its first one, followed by the records with their end-of-line markers.
+	 * Chunks go to the workers in turn, skipping those whose queue is full;
+	 * see ParallelCopySendChunk().
+	 */
+	initStringInfo(&chunk);
+	while (!detached)
+	{
+		bool		more;
+		uint64		prev_lineno;
+
+		CHECK_FOR_INTERRUPTS();
+
+		more = NextCopyFromLine(cstate, &prev_lineno);
+		if (more)
+		{
+			if (chunk.len == 0)
+				appendBinaryStringInfo(&chunk, &prev_lineno, sizeof(uint64));
+			appendBinaryStringInfo(&chunk, cstate->line_buf.data,
+								   cstate->line_buf.len);
+			switch (cstate->eol_type)
+			{
+				case EOL_CR:
+					appendStringInfoChar(&chunk, '\r');
+					break;
+				case EOL_CRNL:
+					appendBinaryStringInfo(&chunk, "\r\n", 2);
+					break;
+				default:
+					appendStringInfoChar(&chunk, '\n');
+					break;
+			}
+		}
+
+		if (chunk.len >= PARALLEL_COPY_CHUNK_SIZE || (!more && chunk.len > 0))
+		{
+			/*
+			 * If a worker has exited, most likely because of an error, stop
+			 * reading; waiting for the workers below will report what
+			 * happened.
+			 */
+			if (!ParallelCopySendChunk(mqh, parked, nlaunched, &next, &chunk))
+				detached = true;
+		}
+
+		if (!more)
+			break;
+	}
+	pfree(chunk.data);
+
+	/* Wait for the chunks still parked on full queues to go through */
+	for (i = 0; i < nlaunched && !detached; i++)
+	{
+		if (!ParallelCopySendParked(mqh[i], &parked[i], true))
+			detached = true;
+	}
+
+	error_context_stack = errcallback.previous;
+
+	/* Tell the workers there is no more input, and wait for them to finish */
+	for (i = 0; i < nlaunched; i++)
+		shm_mq_detach(mqh[i]);
+	WaitForParallelWorkersToFinish(pcxt);
+
+	if (detached)
+		elog(ERROR, "parallel COPY worker exited unexpectedly");
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < nlaunched; i++)
+		InstrAccumParallelQuery(&bufferusage[i], &walusage[i]);
+
+	*processed = pg_atomic_read_u64(&shared->processed);
+	num_errors = pg_atomic_read_u64(&shared->num_errors);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, *processed);
+
+	if (cstate->opts.on_error != COPY_ON_ERROR_STOP && num_errors > 0)
+		ereport(NOTICE,
+				errmsg_plural("%llu row was skipped due to data type incompatibility",
+							  "%llu rows were skipped due to data type incompatibility",
+							  (unsigned long long) num_errors,
+							  (unsigned long long) num_errors));
+
+	return true;
+}
+
+/*
+ * Hand a complete chunk over to one of the workers, and reset 'chunk' for
+ * the next one.  Returns false if a worker has detached from its queue.
+ *
+ * The chunk goes to the next worker in turn that has no chunk parked on its
+ * queue.  We only offer as much of it as fits in the queue at the moment;
+ * shm_mq then requires us to send the rest of that same message to that
+ * queue before anything else, so the chunk stays parked there (in
+ * parked[i]) until it has been sent in full, while the following chunks go
+ * to other workers.  Only when every queue has a chunk parked do we wait
+ * for one of them to drain.
+ */
+static bool
+ParallelCopySendChunk(shm_mq_handle **mqh, StringInfo parked,
+					  int nqueues, int *next, StringInfo chunk)
+{
+	StringInfoData tmp;
+	int			target = -1;
+
+	/* Push on with the parked chunks first, which may unpark some */
+	for (int i = 0; i < nqueues; i++)
+	{
+		if (!ParallelCopySendParked(mqh[i], &parked[i], false))
+			return false;
+	}
+
+	for (int n = 0; n < nqueues; n++)
+	{
+		int			i = (*next + n) % nqueues;
+
+		if (parked[i].len == 0)
+		{
+			target = i;
+			break;
+		}
+	}
+
+	if (target < 0)
+	{
+		/* Every queue is full; wait for the next one in turn */
+		target = *next;
+		if (!ParallelCopySendParked(mqh[target], &parked[target], true))
+			return false;
+	}
+
+	/* Park the chunk on the target queue, reusing its empty buffer */
+	tmp = parked[target];
+	parked[target] = *chunk;
+	*chunk = tmp;
+	*next = (target + 1) % nqueues;
+
+	return ParallelCopySendParked(mqh[target], &parked[target], false);
+}
+
+/*
+ * Send the rest of the chunk parked on a queue, if any.  Without 'wait',
+ * send only what fits in the queue right now.  Returns false if the worker
+ * has detached.
+ */
+static bool
+ParallelCopySendParked(shm_mq_handle *mqh, StringInfo parked, bool wait)
+{
+	shm_mq_result result;
+
+	if (parked->len == 0)
+		return true;
+
+	result = shm_mq_send(mqh, parked->len, parked->data, !wait, true);
+	if (result == SHM_MQ_DETACHED)
+		return false;
+	if (result == SHM_MQ_SUCCESS)
+		resetStringInfo(parked);
+
+	return true;
+}
+
+/*
+ * Data source callback for a parallel worker: hand out the current chunk,
+ * and report EOF once it has been consumed.
+ */
+static int
+ParallelCopyRead(void *outbuf, int minread, int maxread)
+{
+	int			nbytes = Min(maxread, ParallelCopyChunkLen);
+
+	memcpy(outbuf, ParallelCopyChunkData, nbytes);
+	ParallelCopyChunkData += nbytes;
+	ParallelCopyChunkLen -= nbytes;
+
+	return nbytes;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	char	   *sharedquery;
+	List	   *state;
+	ParseState *pstate;
+	Relation	rel;
+	CopyFromState cstate;
+	char	   *mqspace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	uint64		processed = 0;
+
+	/* We're here to insert the rows the leader sends us */
+	AllowParallelWorkerInserts();
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	shared = shm_toc_lookup(toc, PARALLEL_KEY_COPY_SHARED, false);
+	state = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_KEY_COPY_STATE,
+												 false));
+
+	/* Attach to our input queue */
+	mqspace = shm_toc_lookup(toc, PARALLEL_KEY_COPY_QUEUES, false);
+	mq = (shm_mq *) (mqspace + ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Same lock mode as the leader's */
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = debug_query_string;
+	pstate->p_rtable = (List *) list_nth(state, 3);
+	pstate->p_rteperminfos = (List *) list_nth(state, 4);
+
+	cstate = BeginCopyFrom(pstate, rel, (Node *) list_nth(state, 2),
+						   NULL, false, ParallelCopyRead,
+						   (List *) list_nth(state, 1),
+						   (List *) list_nth(state, 0));
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/*
+	 * Load each chunk with a separate CopyFrom() call, starting over at the
+	 * line number the leader stored in the chunk.  The input buffers are
+	 * empty at this point, as CopyFrom() only returns at EOF.
+	 */
+	for (;;)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			break;				/* no more input */
+		Assert(res == SHM_MQ_SUCCESS);
+		Assert(nbytes > sizeof(uint64));
+
+		memcpy(&cstate->cur_lineno, data, sizeof(uint64));
+		ParallelCopyChunkData = (char *) data + sizeof(uint64);
+		ParallelCopyChunkLen = nbytes - sizeof(uint64);
+
+		cstate->raw_buf_index = cstate->raw_buf_len = 0;
+		cstate->raw_reached_eof = false;
+		cstate->input_buf_index = cstate->input_buf_len = 0;
+		cstate->input_reached_eof = false;
+		cstate->input_reached_error = false;
+
+		processed += CopyFrom(cstate);
+	}
+
+	pg_atomic_add_fetch_u64(&shared->processed, processed);
+	pg_atomic_add_fetch_u64(&shared->num_errors, cstate->num_errors);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	EndCopyFrom(cstate);
+	table_close(rel, RowExclusiveLock);
+}
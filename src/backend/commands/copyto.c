@@ -20,6 +20,7 @@
 
 #include "access/tableam.h"
 #include "commands/copy.h"
+#include "commands/copyarrow.h"
 #include "commands/progress.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
@@ -91,6 +92,7 @@ typedef struct CopyToStateData
 
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
 	MemoryContext rowcontext;	/* per-row evaluation context */
+	ArrowWriter *arrow;			/* column buffers, for FORMAT arrow */
 	uint64		bytes_processed;	/* number of bytes processed so far */
 } CopyToStateData;
 
@@ -775,7 +777,8 @@ DoCopyTo(CopyToState cstate)
 		bool		isvarlena;
 		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
 
-		if (cstate->opts.binary)
+		/* Arrow falls back to text output for types it has no match for */
+		if (cstate->opts.binary && !cstate->opts.arrow)
 			getTypeBinaryOutputInfo(attr->atttypid,
 									&out_func_oid,
 									&isvarlena);
@@ -796,7 +799,15 @@ DoCopyTo(CopyToState cstate)
 											   "COPY TO",
 											   ALLOCSET_DEFAULT_SIZES);
 
-	if (cstate->opts.binary)
+	if (cstate->opts.arrow)
+	{
+		/* An Arrow stream starts with its schema */
+		cstate->arrow = ArrowWriterBegin(tupDesc, cstate->attnumlist,
+										 cstate->out_functions);
+		ArrowWriterSchema(cstate->arrow, cstate->fe_msgbuf);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate header for a binary copy */
 		int32		tmp;
@@ -884,7 +895,13 @@ DoCopyTo(CopyToState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->opts.binary)
+	if (cstate->opts.arrow)
+	{
+		/* Send the last batch and the end-of-stream marker */
+		ArrowWriterFinish(cstate->arrow, cstate->fe_msgbuf);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -915,6 +932,19 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 	MemoryContextReset(cstate->rowcontext);
 	oldcontext = MemoryContextSwitchTo(cstate->rowcontext);
 
+	if (cstate->opts.arrow)
+	{
+		/* Buffer the row, and send the batch once it is full */
+		slot_getallattrs(slot);
+		if (ArrowWriterAddRow(cstate->arrow, slot))
+		{
+			ArrowWriterFlush(cstate->arrow, cstate->fe_msgbuf);
+			CopySendEndOfRow(cstate);
+		}
+		MemoryContextSwitchTo(oldcontext);
+		return;
+	}
+
 	if (cstate->opts.binary)
 	{
 		/* Binary per-tuple header */
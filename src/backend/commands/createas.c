@@ -28,9 +28,11 @@
 #include "access/reloptions.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/namespace.h"
 #include "catalog/toasting.h"
 #include "commands/createas.h"
+#include "commands/incrmatview.h"
 #include "commands/matview.h"
 #include "commands/prepare.h"
 #include "commands/tablecmds.h"
@@ -38,6 +40,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cost.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -50,6 +53,8 @@ typedef struct
 {
 	DestReceiver pub;			/* publicly-known function pointers */
 	IntoClause *into;			/* target relation specification */
+	EState	   *estate;			/* set if parallel workers may insert too */
+	Oid			relid;			/* target of a parallel worker's receiver */
 	/* These fields are filled by intorel_startup: */
 	Relation	rel;			/* relation to write to */
 	ObjectAddress reladdr;		/* address of rel, for ExecCreateTableAs */
@@ -64,6 +69,8 @@ static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
 
 /* DestReceiver routines for collecting data */
 static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
+static void intorel_worker_startup(DestReceiver *self, int operation,
+								   TupleDesc typeinfo);
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void intorel_shutdown(DestReceiver *self);
 static void intorel_destroy(DestReceiver *self);
@@ -268,6 +275,17 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 	{
 		do_refresh = !into->skipData;
 		into->skipData = true;
+
+		/*
+		 * An incrementally maintained view gets some hidden columns, which
+		 * must be part of both the relation and its stored query.
+		 */
+		if (into->incremental)
+		{
+			CheckIncrementalMatViewQuery(query, into->colNames);
+			query = AddIncrementalMatViewColumns(query);
+			into->viewQuery = (Node *) copyObject(query);
+		}
 	}
 
 	if (into->skipData)
@@ -279,6 +297,9 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		 * from running the planner before all dependencies are set up.
 		 */
 		address = create_ctas_nodata(query->targetList, into);
+
+		if (is_matview && into->incremental)
+			CreateIncrementalMatViewLogs(address.objectId, query);
 	}
 	else
 	{
@@ -320,6 +341,22 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		/* call ExecutorStart to prepare the plan for execution */
 		ExecutorStart(queryDesc, GetIntoRelEFlags(into));
 
+		/*
+		 * If the plan is just a Gather passing its workers' rows through
+		 * unchanged, let the workers insert those rows themselves.  The new
+		 * table must be visible to them, so not temporary, and we insist on
+		 * WAL being written for it, since only the leader knows that the
+		 * relation was created in this transaction.
+		 */
+		if (enable_parallel_insert &&
+			IsA(plan->planTree, Gather) &&
+			queryDesc->planstate->ps_ProjInfo == NULL &&
+			ExecCleanTargetListLength(plan->planTree->targetlist) ==
+			list_length(plan->planTree->targetlist) &&
+			into->rel->relpersistence != RELPERSISTENCE_TEMP &&
+			XLogIsNeeded())
+			((DR_intorel *) dest)->estate = queryDesc->estate;
+
 		/* run the plan to completion */
 		ExecutorRun(queryDesc, ForwardScanDirection, 0, true);
 
@@ -445,6 +482,26 @@ CreateIntoRelDestReceiver(IntoClause *intoClause)
 	return (DestReceiver *) self;
 }
 
+/*
+ * CreateParallelIntoRelDestReceiver -- create a DestReceiver for a worker
+ *
+ * A parallel worker running the plan below the Gather of a CREATE TABLE AS
+ * uses this to insert its rows into the leader's new table directly, with a
+ * bulk insert state of its own.
+ */
+DestReceiver *
+CreateParallelIntoRelDestReceiver(Oid relid, int ti_options)
+{
+	DR_intorel *self;
+
+	self = (DR_intorel *) CreateIntoRelDestReceiver(makeNode(IntoClause));
+	self->pub.rStartup = intorel_worker_startup;
+	self->relid = relid;
+	self->ti_options = ti_options;
+
+	return (DestReceiver *) self;
+}
+
 /*
  * intorel_startup --- executor startup
  */
@@ -553,6 +610,14 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	myState->output_cid = GetCurrentCommandId(true);
 	myState->ti_options = TABLE_INSERT_SKIP_FSM;
 
+	/* Tell the parallel executor, if workers are to insert too */
+	if (myState->estate != NULL && !into->skipData &&
+		intoRelationDesc->rd_tableam == GetHeapamTableAmRoutine())
+	{
+		myState->estate->es_parallel_into_relid = intoRelationAddr.objectId;
+		myState->estate->es_parallel_into_options = myState->ti_options;
+	}
+
 	/*
 	 * If WITH NO DATA is specified, there is no need to set up the state for
 	 * bulk inserts as there are no tuples to insert.
@@ -569,6 +634,22 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	Assert(RelationGetTargetBlock(intoRelationDesc) == InvalidBlockNumber);
 }
 
+/*
+ * intorel_worker_startup --- executor startup in a parallel worker
+ *
+ * The leader has created the relation and holds AccessExclusiveLock on it;
+ * thanks to group locking, that doesn't keep us from opening it.
+ */
+static void
+intorel_worker_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_intorel *myState = (DR_intorel *) self;
+
+	myState->rel = table_open(myState->relid, RowExclusiveLock);
+	myState->output_cid = GetCurrentCommandId(true);
+	myState->bistate = GetBulkInsertState();
+}
+
 /*
  * intorel_receive --- receive one tuple
  */
@@ -126,6 +126,9 @@ static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_nestloop_info(NestLoopState *nlstate, ExplainState *es);
+static void show_memoize_admission_text(MemoizeInstrumentation *stats,
+										ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
 static void show_hashagg_info(AggState *aggstate, ExplainState *es);
@@ -556,6 +559,15 @@ ExplainOneUtility(Node *utilityStmt, IntoClause *into, ExplainState *es,
 			return;
 		}
 
+		/*
+		 * Running the query would create the view without setting up its
+		 * incremental maintenance.
+		 */
+		if (ctas->into->incremental && es->analyze)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("EXPLAIN ANALYZE is not supported for incrementally maintained materialized views")));
+
 		rewritten = QueryRewrite(castNode(Query, copyObject(ctas->query)));
 		Assert(list_length(rewritten) == 1);
 		ExplainOneQuery(linitial_node(Query, rewritten),
@@ -1976,6 +1988,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((IndexScan *) plan)->indexskip)
+				ExplainPropertyBool("Skip Distinct", true, es);
 			break;
 		case T_IndexOnlyScan:
 			show_scan_qual(((IndexOnlyScan *) plan)->indexqual,
@@ -1989,6 +2003,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (((IndexOnlyScan *) plan)->indexskip)
+				ExplainPropertyBool("Skip Distinct", true, es);
 			if (es->analyze)
 				ExplainPropertyFloat("Heap Fetches", NULL,
 									 planstate->instrument->ntuples2, 0, es);
@@ -2170,6 +2186,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			if (es->analyze)
+				show_nestloop_info(castNode(NestLoopState, planstate), es);
 			break;
 		case T_MergeJoin:
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
@@ -3229,6 +3247,17 @@ show_incremental_sort_info(IncrementalSortState *incrsortstate,
 	}
 }
 
+/*
+ * Show whether a nestloop switched to hashing its inner side, and when.
+ */
+static void
+show_nestloop_info(NestLoopState *nlstate, ExplainState *es)
+{
+	if (nlstate->nl_HashedAfter > 0)
+		ExplainPropertyFloat("Inner Hashed After", "rows",
+							 nlstate->nl_HashedAfter, 0, es);
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -3393,17 +3422,21 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 			ExplainPropertyInteger("Cache Misses", NULL, mstate->stats.cache_misses, es);
 			ExplainPropertyInteger("Cache Evictions", NULL, mstate->stats.cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL, mstate->stats.cache_overflows, es);
+			ExplainPropertyInteger("Cache Rejections", NULL, mstate->stats.cache_rejections, es);
+			ExplainPropertyInteger("Cache Bypasses", NULL, mstate->stats.cache_bypasses, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
 		}
 		else
 		{
 			ExplainIndentText(es);
 			appendStringInfo(es->str,
-							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT,
 							 mstate->stats.cache_hits,
 							 mstate->stats.cache_misses,
 							 mstate->stats.cache_evictions,
-							 mstate->stats.cache_overflows,
+							 mstate->stats.cache_overflows);
+			show_memoize_admission_text(&mstate->stats, es);
+			appendStringInfo(es->str, "  Memory Usage: " INT64_FORMAT "kB\n",
 							 memPeakKb);
 		}
 	}
@@ -3440,9 +3473,11 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 		{
 			ExplainIndentText(es);
 			appendStringInfo(es->str,
-							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+							 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT,
 							 si->cache_hits, si->cache_misses,
-							 si->cache_evictions, si->cache_overflows,
+							 si->cache_evictions, si->cache_overflows);
+			show_memoize_admission_text(si, es);
+			appendStringInfo(es->str, "  Memory Usage: " INT64_FORMAT "kB\n",
 							 memPeakKb);
 		}
 		else
@@ -3455,6 +3490,10 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 								   si->cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL,
 								   si->cache_overflows, es);
+			ExplainPropertyInteger("Cache Rejections", NULL,
+								   si->cache_rejections, es);
+			ExplainPropertyInteger("Cache Bypasses", NULL,
+								   si->cache_bypasses, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb,
 								   es);
 		}
@@ -3464,6 +3503,20 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 	}
 }
 
+/*
+ * Show the Memoize admission policy counters in text format, when nonzero.
+ */
+static void
+show_memoize_admission_text(MemoizeInstrumentation *stats, ExplainState *es)
+{
+	if (stats->cache_rejections > 0)
+		appendStringInfo(es->str, "  Rejections: " UINT64_FORMAT,
+						 stats->cache_rejections);
+	if (stats->cache_bypasses > 0)
+		appendStringInfo(es->str, "  Bypasses: " UINT64_FORMAT,
+						 stats->cache_bypasses);
+}
+
 /*
  * Show information on hash aggregate memory usage and batches.
  */
@@ -3495,6 +3548,9 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
 			ExplainPropertyInteger("Disk Usage", "kB",
 								   aggstate->hash_disk_used, es);
+			if (aggstate->hash_bypass_tuples > 0)
+				ExplainPropertyUInteger("Rows Passed Through", NULL,
+										aggstate->hash_bypass_tuples, es);
 		}
 	}
 	else
@@ -3531,6 +3587,11 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 				appendStringInfo(es->str, "  Disk Usage: " UINT64_FORMAT "kB",
 								 aggstate->hash_disk_used);
 			}
+
+			/* Only display passed-through rows if we stopped grouping */
+			if (aggstate->hash_bypass_tuples > 0)
+				appendStringInfo(es->str, "  Rows Passed Through: " UINT64_FORMAT,
+								 aggstate->hash_bypass_tuples);
 		}
 
 		if (gotone)
@@ -3545,6 +3606,7 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 			AggregateInstrumentation *sinstrument;
 			uint64		hash_disk_used;
 			int			hash_batches_used;
+			uint64		hash_bypass_tuples;
 
 			sinstrument = &aggstate->shared_info->sinstrument[n];
 			/* Skip workers that didn't do anything */
@@ -3552,6 +3614,7 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 				continue;
 			hash_disk_used = sinstrument->hash_disk_used;
 			hash_batches_used = sinstrument->hash_batches_used;
+			hash_bypass_tuples = sinstrument->hash_bypass_tuples;
 			memPeakKb = BYTES_TO_KILOBYTES(sinstrument->hash_mem_peak);
 
 			if (es->workers_state)
@@ -3568,6 +3631,9 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 				if (hash_batches_used > 1)
 					appendStringInfo(es->str, "  Disk Usage: " UINT64_FORMAT "kB",
 									 hash_disk_used);
+				if (hash_bypass_tuples > 0)
+					appendStringInfo(es->str, "  Rows Passed Through: " UINT64_FORMAT,
+									 hash_bypass_tuples);
 				appendStringInfoChar(es->str, '\n');
 			}
 			else
@@ -3577,6 +3643,9 @@ show_hashagg_info(AggState *aggstate, ExplainState *es)
 				ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb,
 									   es);
 				ExplainPropertyInteger("Disk Usage", "kB", hash_disk_used, es);
+				if (hash_bypass_tuples > 0)
+					ExplainPropertyUInteger("Rows Passed Through", NULL,
+											hash_bypass_tuples, es);
 			}
 
 			if (es->workers_state)
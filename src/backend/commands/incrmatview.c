@@ -0,0 +1,2236 @@
+/*-------------------------------------------------------------------------
+ *
+ * incrmatview.c
+ *	  incremental maintenance of materialized views
+ *
+ * A materialized view created with INCREMENTAL is brought up to date by
+ * applying the changes made to the tables its query reads, rather than by
+ * running the whole query again.  Internal AFTER ... FOR EACH STATEMENT
+ * triggers on each base table copy the statement's transition tables into a
+ * change log kept for that table: one row per inserted row with sign +1 and
+ * one per deleted row with sign -1, holding just the columns the view's
+ * query references.  An UPDATE is logged as a deletion plus an insertion,
+ * except for rows whose referenced columns did not change.
+ *
+ * REFRESH MATERIALIZED VIEW consumes the log rows visible to its snapshot.
+ * Writing R for the current contents of a base table and dR for the changes
+ * logged for it, the change in an inner join of R1 .. Rn is the sum, over
+ * every nonempty set S of changed tables, of the join with dRi substituted
+ * for Ri for each i in S, with sign (-1)^(|S|+1).  Each term is obtained by
+ * deparsing the view's query with temporary tables holding the consumed
+ * changes swapped in for the tables of S.  The signed rows of all terms are
+ * then grouped by the view's grouping columns (all its columns, if it has no
+ * aggregates) into a "diff" table, which is applied to the materialized
+ * view with ordinary DML.
+ *
+ * count, sum and avg are maintained arithmetically, using hidden count and
+ * sum columns that are added to the view when it is created; min and max
+ * take the inserted values into account directly and are recomputed from
+ * the base tables for groups that lost a row.  After a TRUNCATE of a base
+ * table, or when too many base tables changed at once, the refresh falls
+ * back to recomputing the whole query.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/incrmatview.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/catalog.h"
+#include "catalog/dependency.h"
+#include "catalog/heap.h"
+#include "catalog/index.h"
+#include "catalog/indexing.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_authid.h"
+#include "catalog/pg_depend.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_namespace.h"
+#include "catalog/pg_trigger.h"
+#include "catalog/pg_type.h"
+#include "catalog/toasting.h"
+#include "commands/defrem.h"
+#include "commands/incrmatview.h"
+#include "commands/matview.h"
+#include "commands/trigger.h"
+#include "executor/executor.h"
+#include "executor/spi.h"
+#include "executor/tuptable.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_func.h"
+#include "parser/parser.h"
+#include "parser/parsetree.h"
+#include "port/pg_bitutils.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/regproc.h"
+#include "utils/rel.h"
+#include "utils/ruleutils.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+#include "utils/tuplestore.h"
+#include "utils/typcache.h"
+
+
+/* Names of the hidden columns of aggregating views start with this */
+#define IVM_PREFIX				"__ivm_"
+
+/* Hidden count(*) column, present in every aggregating view */
+#define IVM_COUNT_COLNAME		IVM_PREFIX "count__"
+
+/* Sign column of the temporary tables holding consumed changes */
+#define IVM_SIGN_COLNAME		IVM_PREFIX "sign__"
+
+/*
+ * Fall back to a full refresh if more base tables than this have changed,
+ * since the number of terms to compute doubles with each one.
+ */
+#define IVM_MAX_CHANGED_TABLES	8
+
+/* State of a change log, as seen by a refresh */
+typedef enum IvmLogState
+{
+	IVM_LOG_EMPTY,
+	IVM_LOG_CHANGED,
+	IVM_LOG_TRUNCATED,
+} IvmLogState;
+
+/* How a column of the materialized view is maintained */
+typedef enum IvmColumnKind
+{
+	IVM_KEY,					/* grouping column, or any column of a view
+								 * without aggregates */
+	IVM_COUNT_STAR,
+	IVM_COUNT,
+	IVM_SUM,
+	IVM_AVG,
+	IVM_MIN,
+	IVM_MAX,
+} IvmColumnKind;
+
+typedef struct IvmColumn
+{
+	IvmColumnKind kind;
+	char	   *name;			/* quoted name of the matview column */
+	Oid			type;			/* its type, typmod and collation */
+	int32		typmod;
+	Oid			collation;
+	int			keyno;			/* for keys: position among the keys */
+	Oid			eqop;			/* for keys: equality operator */
+	AttrNumber	countcol;		/* for sum and avg: count of the argument */
+	AttrNumber	sumcol;			/* for avg: sum of the argument */
+} IvmColumn;
+
+typedef struct IvmBase
+{
+	Index		rti;			/* range table index in the view's query */
+	Oid			relid;			/* the base table */
+	Oid			logoid;			/* its change log */
+	AttrNumber	signattno;		/* sign column in the delta table */
+	char	   *deltarelname;	/* delta table holding consumed changes */
+	char	   *deltaname;		/* ... and its qualified name */
+	Oid			deltaoid;
+} IvmBase;
+
+typedef struct IvmState
+{
+	Relation	matviewRel;
+	char	   *matviewname;	/* qualified name of the matview */
+	Query	   *query;			/* the view's query */
+	bool		grouped;		/* does it aggregate? */
+	int			ncolumns;
+	IvmColumn  *columns;		/* indexed by attribute number - 1 */
+	int			nkeys;
+	AttrNumber	countcol;		/* hidden count(*) column, if grouped */
+	List	   *bases;			/* IvmBase for each base table */
+	char	   *diffname;		/* qualified name of the diff table */
+} IvmState;
+
+/* Per-call state of incremental_matview_log */
+typedef struct IvmLogWriter
+{
+	Relation	logrel;
+	TupleTableSlot *logslot;
+	TupleTableSlot *oldslot;	/* base table rows, from transition tables */
+	TupleTableSlot *newslot;
+	int			ncolumns;		/* number of logged columns */
+	AttrNumber *attnos;			/* their attribute numbers in the base */
+	AttrNumber	maxattno;
+	CommandId	cid;
+	BulkInsertState bistate;
+} IvmLogWriter;
+
+typedef struct ivm_vars_context
+{
+	Query	   *query;
+	Bitmapset **attnos;			/* referenced columns, by range table index */
+} ivm_vars_context;
+
+static void ivm_unsupported(const char *what);
+static bool ivm_vars_walker(Node *node, ivm_vars_context *context);
+static Bitmapset **ivm_referenced_columns(Query *query);
+static bool ivm_aggregate_kind(Aggref *aggref, IvmColumnKind *kind);
+static void ivm_check_key_type(Oid type);
+static Expr *ivm_make_aggregate(ParseState *pstate, char *aggname, Expr *arg);
+static Oid	ivm_create_log(Relation matviewRel, Oid baseoid, Bitmapset *attnos);
+static void ivm_create_trigger(Oid baseoid, Oid matviewOid, Oid logoid,
+							   int16 events);
+static void ivm_create_index(Relation matviewRel, Query *query);
+static Oid	ivm_trigger_log(Trigger *trigger, Oid baseoid);
+static void ivm_log_begin(IvmLogWriter *writer, Relation logrel,
+						  Relation baserel);
+static void ivm_log_row(IvmLogWriter *writer, TupleTableSlot *slot, int sign);
+static void ivm_rewind(Tuplestorestate *table);
+static void ivm_log_table(IvmLogWriter *writer, Tuplestorestate *table,
+						  int sign);
+static void ivm_log_update(IvmLogWriter *writer, Tuplestorestate *oldtable,
+						   Tuplestorestate *newtable);
+static void ivm_log_end(IvmLogWriter *writer);
+static Oid	ivm_find_log(Oid baseoid, Oid matviewOid);
+static bool ivm_init_state(IvmState *state, Relation matviewRel, Query *query,
+						   Oid relowner);
+static AttrNumber ivm_find_column(Query *query, const char *name);
+static IvmLogState ivm_check_log(Oid logoid, Snapshot snapshot);
+static void ivm_consume_log(IvmBase *base, Snapshot snapshot);
+static void ivm_create_delta_table(IvmBase *base);
+static void ivm_create_diff_table(IvmState *state);
+static void ivm_append_column_def(StringInfo buf, bool first,
+								  const char *colname, Oid type, int32 typmod,
+								  Oid collation);
+static char *ivm_subquery(IvmState *state, List *changed, uint32 subset);
+static char *ivm_delta_query(IvmState *state, List *changed);
+static void ivm_append_key_match(StringInfo buf, IvmState *state,
+								 const char *mvalias, const char *dalias);
+static char *ivm_new_count(IvmState *state, AttrNumber countcol);
+static char *ivm_new_sum(IvmState *state, AttrNumber sumcol);
+static char *ivm_new_value(IvmState *state, AttrNumber attno,
+						   const char *fullquery);
+static uint64 ivm_apply_aggregates(IvmState *state, Snapshot snapshot);
+static uint64 ivm_apply_rows(IvmState *state, Snapshot snapshot);
+static uint64 ivm_execute(const char *sql, Snapshot snapshot, int expected);
+
+
+/*
+ * Report a feature of a view's query that prevents incremental maintenance.
+ */
+static void
+ivm_unsupported(const char *what)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("incrementally maintained materialized views do not support %s",
+					what)));
+}
+
+/*
+ * Collect the columns of base tables referenced by Vars, looking through
+ * Vars that refer to join output columns, and reject system columns and
+ * whole-row references.
+ */
+static bool
+ivm_vars_walker(Node *node, ivm_vars_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+		RangeTblEntry *rte;
+
+		if (var->varlevelsup != 0)
+			return false;
+		if (var->varattno <= 0)
+			ivm_unsupported("system columns or whole-row references");
+
+		rte = rt_fetch(var->varno, context->query->rtable);
+		if (rte->rtekind == RTE_JOIN)
+			return ivm_vars_walker(list_nth(rte->joinaliasvars,
+											var->varattno - 1),
+								   context);
+
+		context->attnos[var->varno] =
+			bms_add_member(context->attnos[var->varno], var->varattno);
+		return false;
+	}
+	return expression_tree_walker(node, ivm_vars_walker, context);
+}
+
+/*
+ * Return an array, indexed by range table index, of the sets of base table
+ * columns referenced by the query.
+ */
+static Bitmapset **
+ivm_referenced_columns(Query *query)
+{
+	ivm_vars_context context;
+
+	context.query = query;
+	context.attnos = palloc0_array(Bitmapset *,
+								   list_length(query->rtable) + 1);
+	(void) query_tree_walker(query, ivm_vars_walker, &context,
+							 QTW_IGNORE_JOINALIASES);
+	return context.attnos;
+}
+
+/*
+ * Determine how the value of an aggregate call can be maintained, or return
+ * false if it can't be.
+ */
+static bool
+ivm_aggregate_kind(Aggref *aggref, IvmColumnKind *kind)
+{
+	char	   *aggname;
+	Oid			argtype;
+
+	if (aggref->aggkind != AGGKIND_NORMAL || aggref->agglevelsup != 0 ||
+		aggref->aggdistinct != NIL || aggref->aggorder != NIL ||
+		aggref->aggfilter != NULL || aggref->aggdirectargs != NIL ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return false;
+
+	aggname = get_func_name(aggref->aggfnoid);
+	if (aggref->aggstar)
+	{
+		if (strcmp(aggname, "count") != 0)
+			return false;
+		*kind = IVM_COUNT_STAR;
+		return true;
+	}
+	if (list_length(aggref->args) != 1)
+		return false;
+	argtype = exprType((Node *) linitial_node(TargetEntry, aggref->args)->expr);
+
+	if (strcmp(aggname, "count") == 0)
+		*kind = IVM_COUNT;
+	else if (strcmp(aggname, "sum") == 0 || strcmp(aggname, "avg") == 0)
+	{
+		/* we need to be able to add, subtract and divide the sums */
+		switch (argtype)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case NUMERICOID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+			case INTERVALOID:
+				break;
+			case CASHOID:
+				if (strcmp(aggname, "sum") == 0)
+					break;
+				return false;
+			default:
+				return false;
+		}
+		*kind = (aggname[0] == 's') ? IVM_SUM : IVM_AVG;
+	}
+	else if (strcmp(aggname, "min") == 0 || strcmp(aggname, "max") == 0)
+	{
+		/* LEAST and GREATEST need a btree comparison for the type */
+		TypeCacheEntry *typentry;
+
+		typentry = lookup_type_cache(aggref->aggtype, TYPECACHE_CMP_PROC);
+		if (!OidIsValid(typentry->cmp_proc))
+			return false;
+		*kind = (aggname[1] == 'i') ? IVM_MIN : IVM_MAX;
+	}
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Check that the values of a column can be grouped and matched up.
+ */
+static void
+ivm_check_key_type(Oid type)
+{
+	TypeCacheEntry *typentry;
+
+	typentry = lookup_type_cache(type, TYPECACHE_EQ_OPR |
+								 TYPECACHE_LT_OPR | TYPECACHE_HASH_PROC);
+	if (!OidIsValid(typentry->eq_opr) ||
+		(!OidIsValid(typentry->lt_opr) && !OidIsValid(typentry->hash_proc)))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FUNCTION),
+				 errmsg("could not identify an equality operator for type %s",
+						format_type_be(type)),
+				 errdetail("Columns of incrementally maintained materialized views must be groupable.")));
+}
+
+/*
+ * CheckIncrementalMatViewQuery
+ *		Complain if a materialized view's query can't be maintained
+ *		incrementally.
+ *
+ * colNames is the list of column names given in the command, if any.
+ */
+void
+CheckIncrementalMatViewQuery(Query *query, List *colNames)
+{
+	List	   *relids = NIL;
+	bool		grouped;
+	ListCell   *lc;
+	int			colno;
+
+	Assert(query->commandType == CMD_SELECT);
+
+	if (query->setOperations != NULL)
+		ivm_unsupported("UNION, INTERSECT or EXCEPT");
+	if (query->cteList != NIL)
+		ivm_unsupported("WITH");
+	if (query->hasSubLinks)
+		ivm_unsupported("subqueries");
+	if (query->distinctClause != NIL)
+		ivm_unsupported("DISTINCT");
+	if (query->groupingSets != NIL)
+		ivm_unsupported("GROUPING SETS");
+	if (query->havingQual != NULL)
+		ivm_unsupported("HAVING");
+	if (query->sortClause != NIL)
+		ivm_unsupported("ORDER BY");
+	if (query->limitCount != NULL || query->limitOffset != NULL)
+		ivm_unsupported("LIMIT or OFFSET");
+	if (query->rowMarks != NIL)
+		ivm_unsupported("FOR UPDATE or FOR SHARE");
+	if (query->hasWindowFuncs)
+		ivm_unsupported("window functions");
+	if (query->hasTargetSRFs)
+		ivm_unsupported("set-returning functions");
+	if (query->targetList == NIL)
+		ivm_unsupported("an empty select list");
+	if (contain_volatile_functions((Node *) query))
+		ivm_unsupported("volatile functions");
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		switch (rte->rtekind)
+		{
+			case RTE_RELATION:
+				if (rte->relkind != RELKIND_RELATION)
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("relation \"%s\" cannot be used in an incrementally maintained materialized view",
+									get_rel_name(rte->relid)),
+							 errdetail_relkind_not_supported(rte->relkind)));
+				if (IsCatalogRelationOid(rte->relid) ||
+					IsCatalogNamespace(get_rel_namespace(rte->relid)))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("relation \"%s\" cannot be used in an incrementally maintained materialized view",
+									get_rel_name(rte->relid)),
+							 errdetail("System catalogs cannot be maintained incrementally.")));
+				if (has_subclass(rte->relid) || has_superclass(rte->relid))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("relation \"%s\" cannot be used in an incrementally maintained materialized view",
+									get_rel_name(rte->relid)),
+							 errdetail("Tables with inheritance children or parents cannot be maintained incrementally.")));
+				if (rte->tablesample != NULL)
+					ivm_unsupported("TABLESAMPLE");
+				if (list_member_oid(relids, rte->relid))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("relation \"%s\" is used more than once in the query",
+									get_rel_name(rte->relid)),
+							 errdetail("Incrementally maintained materialized views can read each table only once.")));
+				relids = lappend_oid(relids, rte->relid);
+				break;
+			case RTE_JOIN:
+				if (rte->jointype != JOIN_INNER)
+					ivm_unsupported("outer joins");
+				break;
+			default:
+				ivm_unsupported("FROM items other than tables");
+				break;
+		}
+	}
+	if (relids == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("the query of an incrementally maintained materialized view must read at least one table")));
+
+	/* Checks the Vars */
+	(void) ivm_referenced_columns(query);
+
+	/*
+	 * When aggregating, each output column must be a grouping expression or
+	 * an aggregate call we know how to maintain; otherwise, each column is
+	 * matched up when removing rows.
+	 */
+	grouped = (query->hasAggs || query->groupClause != NIL);
+	colno = 0;
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		char	   *colname;
+		IvmColumnKind kind;
+
+		if (tle->resjunk)
+			ivm_unsupported("grouping expressions missing from the select list");
+
+		if (colno < list_length(colNames))
+			colname = strVal(list_nth(colNames, colno));
+		else
+			colname = tle->resname;
+		colno++;
+
+		if (strncmp(colname, IVM_PREFIX, strlen(IVM_PREFIX)) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_RESERVED_NAME),
+					 errmsg("column name \"%s\" is reserved", colname),
+					 errdetail("Column names starting with \"%s\" are reserved for incrementally maintained materialized views.",
+							   IVM_PREFIX)));
+
+		if (!grouped)
+			ivm_check_key_type(exprType((Node *) tle->expr));
+		else if (IsA(tle->expr, Aggref))
+		{
+			Aggref	   *aggref = (Aggref *) tle->expr;
+
+			if (!ivm_aggregate_kind(aggref, &kind))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("aggregate function %s is not supported in incrementally maintained materialized views",
+								format_procedure(aggref->aggfnoid)),
+						 errdetail("Only count, sum, avg, min and max without DISTINCT, ORDER BY or FILTER are supported.")));
+		}
+		else if (tle->ressortgroupref == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("column \"%s\" of an incrementally maintained materialized view must be a grouping expression or an aggregate call",
+							colname)));
+		else
+			ivm_check_key_type(exprType((Node *) tle->expr));
+	}
+
+	if (list_length(colNames) > colno)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("too many column names were specified")));
+}
+
+/*
+ * Build an aggregate call of the given pg_catalog aggregate on arg, or on *
+ * if arg is NULL.
+ */
+static Expr *
+ivm_make_aggregate(ParseState *pstate, char *aggname, Expr *arg)
+{
+	FuncCall   *fn;
+	Node	   *result;
+
+	fn = makeFuncCall(SystemFuncName(aggname),
+					  arg ? list_make1(copyObject(arg)) : NIL,
+					  COERCE_EXPLICIT_CALL, -1);
+	fn->agg_star = (arg == NULL);
+
+	result = ParseFuncOrColumn(pstate, fn->funcname, fn->args, NULL, fn,
+							   false, -1);
+	assign_expr_collations(pstate, result);
+
+	return (Expr *) result;
+}
+
+/*
+ * AddIncrementalMatViewColumns
+ *		Add the hidden columns needed to maintain an aggregating view.
+ *
+ * Every such view gets a count(*) column, which tells when a group becomes
+ * empty; sum and avg columns also get a count of their non-null arguments,
+ * and avg columns the sum of them.  Returns a modified copy of the query.
+ */
+Query *
+AddIncrementalMatViewColumns(Query *query)
+{
+	ParseState *pstate;
+	List	   *hidden = NIL;
+	AttrNumber	resno;
+	ListCell   *lc;
+
+	if (!query->hasAggs && query->groupClause == NIL)
+		return query;
+
+	query = copyObject(query);
+	pstate = make_parsestate(NULL);
+	pstate->p_rtable = query->rtable;
+	pstate->p_expr_kind = EXPR_KIND_SELECT_TARGET;
+
+	resno = list_length(query->targetList) + 1;
+	hidden = lappend(hidden,
+					 makeTargetEntry(ivm_make_aggregate(pstate, "count", NULL),
+									 resno++, pstrdup(IVM_COUNT_COLNAME),
+									 false));
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		IvmColumnKind kind;
+		Expr	   *arg;
+
+		if (!IsA(tle->expr, Aggref) ||
+			!ivm_aggregate_kind((Aggref *) tle->expr, &kind) ||
+			(kind != IVM_SUM && kind != IVM_AVG))
+			continue;
+
+		arg = linitial_node(TargetEntry, ((Aggref *) tle->expr)->args)->expr;
+		hidden = lappend(hidden,
+						 makeTargetEntry(ivm_make_aggregate(pstate, "count", arg),
+										 resno++,
+										 psprintf(IVM_PREFIX "count_%d__",
+												  tle->resno),
+										 false));
+		if (kind == IVM_AVG)
+			hidden = lappend(hidden,
+							 makeTargetEntry(ivm_make_aggregate(pstate, "sum", arg),
+											 resno++,
+											 psprintf(IVM_PREFIX "sum_%d__",
+													  tle->resno),
+											 false));
+	}
+
+	query->targetList = list_concat(query->targetList, hidden);
+	query->hasAggs = true;
+
+	free_parsestate(pstate);
+
+	return query;
+}
+
+/*
+ * CreateIncrementalMatViewLogs
+ *		Set up incremental maintenance of a newly created materialized view.
+ *
+ * This creates a change log and the triggers filling it for each base table,
+ * an index on the grouping columns if there are any, and marks the view as
+ * incrementally maintained.
+ */
+void
+CreateIncrementalMatViewLogs(Oid matviewOid, Query *query)
+{
+	Relation	matviewRel;
+	Relation	pgrel;
+	HeapTuple	tuple;
+	Bitmapset **attnos;
+	Index		rti;
+	ListCell   *lc;
+
+	matviewRel = table_open(matviewOid, NoLock);
+
+	attnos = ivm_referenced_columns(query);
+	rti = 0;
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+		Oid			logoid;
+
+		rti++;
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		logoid = ivm_create_log(matviewRel, rte->relid, attnos[rti]);
+		ivm_create_trigger(rte->relid, matviewOid, logoid,
+						   TRIGGER_TYPE_INSERT);
+		ivm_create_trigger(rte->relid, matviewOid, logoid,
+						   TRIGGER_TYPE_DELETE);
+		ivm_create_trigger(rte->relid, matviewOid, logoid,
+						   TRIGGER_TYPE_UPDATE);
+		ivm_create_trigger(rte->relid, matviewOid, logoid,
+						   TRIGGER_TYPE_TRUNCATE);
+	}
+
+	if (query->groupClause != NIL)
+		ivm_create_index(matviewRel, query);
+
+	/* Mark the view; cf. SetMatViewPopulatedState */
+	pgrel = table_open(RelationRelationId, RowExclusiveLock);
+	tuple = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(matviewOid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u", matviewOid);
+
+	((Form_pg_class) GETSTRUCT(tuple))->relisivm = true;
+
+	CatalogTupleUpdate(pgrel, &tuple->t_self, tuple);
+
+	heap_freetuple(tuple);
+	table_close(pgrel, RowExclusiveLock);
+	table_close(matviewRel, NoLock);
+
+	CommandCounterIncrement();
+}
+
+/*
+ * Create the change log of a base table for a materialized view.
+ *
+ * The log has a sign column followed by one column named c<attnum> for each
+ * referenced column of the base table.  It lives in pg_catalog, so that it
+ * is neither dumped nor published, and belongs to the bootstrap superuser,
+ * so that it doesn't follow the view's ownership; it is dropped along with
+ * the view.
+ */
+static Oid
+ivm_create_log(Relation matviewRel, Oid baseoid, Bitmapset *attnos)
+{
+	Relation	baserel;
+	TupleDesc	basedesc;
+	TupleDesc	tupdesc;
+	char		logname[NAMEDATALEN];
+	Oid			logoid;
+	ObjectAddress logaddr;
+	ObjectAddress mvaddr;
+	AttrNumber	natts = 1;
+	int			attno = -1;
+
+	/* Take the lock that creating the triggers needs up front */
+	baserel = table_open(baseoid, ShareRowExclusiveLock);
+	basedesc = RelationGetDescr(baserel);
+
+	tupdesc = CreateTemplateTupleDesc(1 + bms_num_members(attnos));
+	TupleDescInitEntry(tupdesc, natts, "sign", INT4OID, -1, 0);
+	while ((attno = bms_next_member(attnos, attno)) >= 0)
+	{
+		Form_pg_attribute attr = TupleDescAttr(basedesc, attno - 1);
+		char		colname[NAMEDATALEN];
+
+		natts++;
+		snprintf(colname, sizeof(colname), "c%d", attno);
+		TupleDescInitEntry(tupdesc, natts, colname, attr->atttypid,
+						   attr->atttypmod, attr->attndims);
+		TupleDescInitEntryCollation(tupdesc, natts, attr->attcollation);
+	}
+
+	snprintf(logname, sizeof(logname), "pg_ivm_log_%u_%u",
+			 RelationGetRelid(matviewRel), baseoid);
+
+	logoid = heap_create_with_catalog(logname,
+									  PG_CATALOG_NAMESPACE,
+									  matviewRel->rd_rel->reltablespace,
+									  InvalidOid,
+									  InvalidOid,
+									  InvalidOid,
+									  BOOTSTRAP_SUPERUSERID,
+									  HEAP_TABLE_AM_OID,
+									  tupdesc,
+									  NIL,
+									  RELKIND_RELATION,
+									  matviewRel->rd_rel->relpersistence,
+									  false,
+									  false,
+									  ONCOMMIT_NOOP,
+									  (Datum) 0,
+									  false,
+									  true,
+									  true,
+									  InvalidOid,
+									  NULL);
+	CommandCounterIncrement();
+
+	/* Logged values may be wide */
+	NewRelationCreateToastTable(logoid, (Datum) 0);
+
+	ObjectAddressSet(logaddr, RelationRelationId, logoid);
+	ObjectAddressSet(mvaddr, RelationRelationId, RelationGetRelid(matviewRel));
+	recordDependencyOn(&logaddr, &mvaddr, DEPENDENCY_INTERNAL);
+
+	table_close(baserel, NoLock);
+
+	return logoid;
+}
+
+/*
+ * Create an internal trigger on a base table that records changes made by
+ * the given kind of statement in the change log.
+ */
+static void
+ivm_create_trigger(Oid baseoid, Oid matviewOid, Oid logoid, int16 events)
+{
+	CreateTrigStmt *trigger;
+	ObjectAddress trigaddr;
+	ObjectAddress mvaddr;
+
+	trigger = makeNode(CreateTrigStmt);
+	trigger->replace = false;
+	trigger->isconstraint = false;
+	trigger->trigname = "pg_ivm_trigger";
+	trigger->relation = NULL;
+	trigger->funcname = SystemFuncName("incremental_matview_log");
+	trigger->args = list_make2(makeString(psprintf("%u", matviewOid)),
+							   makeString(psprintf("%u", logoid)));
+	trigger->row = false;
+	trigger->timing = TRIGGER_TYPE_AFTER;
+	trigger->events = events;
+	trigger->columns = NIL;
+	trigger->whenClause = NULL;
+	trigger->transitionRels = NIL;
+	if (events == TRIGGER_TYPE_DELETE || events == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *old = makeNode(TriggerTransition);
+
+		old->name = "pg_ivm_old";
+		old->isNew = false;
+		old->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, old);
+	}
+	if (events == TRIGGER_TYPE_INSERT || events == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *new = makeNode(TriggerTransition);
+
+		new->name = "pg_ivm_new";
+		new->isNew = true;
+		new->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, new);
+	}
+	trigger->deferrable = false;
+	trigger->initdeferred = false;
+	trigger->constrrel = NULL;
+
+	trigaddr = CreateTrigger(trigger, NULL, baseoid, InvalidOid,
+							 InvalidOid, InvalidOid, F_INCREMENTAL_MATVIEW_LOG,
+							 InvalidOid, NULL, true, false);
+
+	ObjectAddressSet(mvaddr, RelationRelationId, matviewOid);
+	recordDependencyOn(&trigaddr, &mvaddr, DEPENDENCY_INTERNAL);
+
+	/* Make changes-so-far visible */
+	CommandCounterIncrement();
+}
+
+/*
+ * Create an index on the grouping columns of an aggregating view, which the
+ * refresh uses to find the groups to update.  Give up quietly if some column
+ * can't be indexed with btree.
+ */
+static void
+ivm_create_index(Relation matviewRel, Query *query)
+{
+	IndexStmt  *index;
+	List	   *params = NIL;
+	ListCell   *lc;
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		IndexElem  *elem;
+
+		if (tle->ressortgroupref == 0 || IsA(tle->expr, Aggref))
+			continue;
+		if (!OidIsValid(GetDefaultOpClass(exprType((Node *) tle->expr),
+										  BTREE_AM_OID)) ||
+			list_length(params) >= INDEX_MAX_KEYS)
+			return;
+
+		elem = makeNode(IndexElem);
+		elem->name = pstrdup(NameStr(TupleDescAttr(RelationGetDescr(matviewRel),
+												   tle->resno - 1)->attname));
+		elem->expr = NULL;
+		elem->indexcolname = NULL;
+		elem->collation = NIL;
+		elem->opclass = NIL;
+		elem->opclassopts = NIL;
+		elem->ordering = SORTBY_DEFAULT;
+		elem->nulls_ordering = SORTBY_NULLS_DEFAULT;
+		params = lappend(params, elem);
+	}
+
+	index = makeNode(IndexStmt);
+	index->idxname = NULL;
+	index->relation = NULL;
+	index->accessMethod = DEFAULT_INDEX_TYPE;
+	index->tableSpace = NULL;
+	index->indexParams = params;
+	index->indexIncludingParams = NIL;
+	index->options = NIL;
+	index->whereClause = NULL;
+	index->excludeOpNames = NIL;
+	index->idxcomment = NULL;
+	index->indexOid = InvalidOid;
+	index->oldNumber = InvalidRelFileNumber;
+	index->oldCreateSubid = InvalidSubTransactionId;
+	index->oldFirstRelfilelocatorSubid = InvalidSubTransactionId;
+	index->unique = false;
+	index->nulls_not_distinct = false;
+	index->primary = false;
+	index->isconstraint = false;
+	index->deferrable = false;
+	index->initdeferred = false;
+	index->transformed = true;
+	index->concurrent = false;
+	index->if_not_exists = false;
+	index->reset_default_tblspc = false;
+
+	DefineIndex(RelationGetRelid(matviewRel), index, InvalidOid, InvalidOid,
+				InvalidOid, -1, false, false, false, false, true);
+}
+
+/*
+ * incremental_matview_log
+ *		Trigger function recording the changes made by a statement to a base
+ *		table of an incrementally maintained materialized view.
+ *
+ * The trigger's arguments are the OIDs of the view and of the change log.
+ */
+Datum
+incremental_matview_log(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Trigger    *trigger;
+	Relation	logrel;
+	IvmLogWriter writer;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" was not called by trigger manager",
+						"incremental_matview_log")));
+
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) ||
+		!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" must be fired AFTER STATEMENT",
+						"incremental_matview_log")));
+
+	trigger = trigdata->tg_trigger;
+	if (!trigger->tgisinternal)
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" may only be used by internal triggers",
+						"incremental_matview_log")));
+
+	logrel = table_open(ivm_trigger_log(trigger,
+										RelationGetRelid(trigdata->tg_relation)),
+						RowExclusiveLock);
+	ivm_log_begin(&writer, logrel, trigdata->tg_relation);
+
+	if (TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event))
+		ivm_log_row(&writer, NULL, 0);
+	else if (TRIGGER_FIRED_BY_INSERT(trigdata->tg_event))
+		ivm_log_table(&writer, trigdata->tg_newtable, 1);
+	else if (TRIGGER_FIRED_BY_DELETE(trigdata->tg_event))
+		ivm_log_table(&writer, trigdata->tg_oldtable, -1);
+	else if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
+		ivm_log_update(&writer, trigdata->tg_oldtable,
+					   trigdata->tg_newtable);
+
+	ivm_log_end(&writer);
+	table_close(logrel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
+
+/*
+ * Return the change log named by the arguments of a logging trigger on the
+ * given base table, after checking that it really is the log of that table
+ * for the view named in the arguments.  We insert into it without any
+ * permission checks, so we mustn't trust the arguments blindly.
+ */
+static Oid
+ivm_trigger_log(Trigger *trigger, Oid baseoid)
+{
+	Oid			matviewOid;
+	Oid			logoid;
+	char		logname[NAMEDATALEN];
+	char	   *relname;
+	bool		owned = false;
+	Relation	depRel;
+	ScanKeyData key[3];
+	SysScanDesc scan;
+	HeapTuple	tup;
+
+	if (trigger->tgnargs != 2)
+		elog(ERROR, "wrong number of arguments for function \"%s\"",
+			 "incremental_matview_log");
+	matviewOid = atooid(trigger->tgargs[0]);
+	logoid = atooid(trigger->tgargs[1]);
+
+	snprintf(logname, sizeof(logname), "pg_ivm_log_%u_%u",
+			 matviewOid, baseoid);
+	relname = get_rel_name(logoid);
+	if (relname == NULL || strcmp(relname, logname) != 0 ||
+		get_rel_namespace(logoid) != PG_CATALOG_NAMESPACE)
+		elog(ERROR, "relation %u is not the change log of relation %u for materialized view %u",
+			 logoid, baseoid, matviewOid);
+
+	/* The log must be owned by the view, as set up by ivm_create_log */
+	depRel = table_open(DependRelationId, AccessShareLock);
+	ScanKeyInit(&key[0],
+				Anum_pg_depend_classid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationRelationId));
+	ScanKeyInit(&key[1],
+				Anum_pg_depend_objid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(logoid));
+	ScanKeyInit(&key[2],
+				Anum_pg_depend_objsubid,
+				BTEqualStrategyNumber, F_INT4EQ,
+				Int32GetDatum(0));
+	scan = systable_beginscan(depRel, DependDependerIndexId, true,
+							  NULL, 3, key);
+	while (HeapTupleIsValid(tup = systable_getnext(scan)))
+	{
+		Form_pg_depend depform = (Form_pg_depend) GETSTRUCT(tup);
+
+		if (depform->refclassid == RelationRelationId &&
+			depform->refobjid == matviewOid &&
+			depform->deptype == DEPENDENCY_INTERNAL)
+		{
+			owned = true;
+			break;
+		}
+	}
+	systable_endscan(scan);
+	table_close(depRel, AccessShareLock);
+
+	if (!owned)
+		elog(ERROR, "relation %u is not the change log of relation %u for materialized view %u",
+			 logoid, baseoid, matviewOid);
+
+	return logoid;
+}
+
+static void
+ivm_log_begin(IvmLogWriter *writer, Relation logrel, Relation baserel)
+{
+	TupleDesc	logdesc = RelationGetDescr(logrel);
+	TupleDesc	basedesc = RelationGetDescr(baserel);
+	int			i;
+
+	writer->logrel = logrel;
+	writer->logslot = table_slot_create(logrel, NULL);
+	writer->oldslot = MakeSingleTupleTableSlot(RelationGetDescr(baserel),
+											   &TTSOpsMinimalTuple);
+	writer->newslot = MakeSingleTupleTableSlot(RelationGetDescr(baserel),
+											   &TTSOpsMinimalTuple);
+
+	/* The log's columns after the sign are named c<attnum> */
+	writer->ncolumns = logdesc->natts - 1;
+	writer->attnos = palloc_array(AttrNumber, writer->ncolumns);
+	writer->maxattno = 0;
+	for (i = 0; i < writer->ncolumns; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(logdesc, i + 1);
+		const char *attname = NameStr(attr->attname);
+		char	   *endptr;
+		long		attno;
+
+		errno = 0;
+		attno = (attname[0] == 'c' && isdigit((unsigned char) attname[1])) ?
+			strtol(attname + 1, &endptr, 10) : 0;
+		if (attno < 1 || attno > basedesc->natts || errno != 0 ||
+			*endptr != '\0' ||
+			TupleDescAttr(basedesc, attno - 1)->attisdropped)
+			elog(ERROR, "unexpected column \"%s\" in change log \"%s\"",
+				 attname, RelationGetRelationName(logrel));
+
+		writer->attnos[i] = (AttrNumber) attno;
+		writer->maxattno = Max(writer->maxattno, writer->attnos[i]);
+	}
+
+	writer->cid = GetCurrentCommandId(true);
+	writer->bistate = GetBulkInsertState();
+}
+
+/*
+ * Log a row of the base table with the given sign; a NULL slot makes the
+ * all-null row with sign 0 that marks a TRUNCATE.
+ */
+static void
+ivm_log_row(IvmLogWriter *writer, TupleTableSlot *slot, int sign)
+{
+	TupleTableSlot *logslot = writer->logslot;
+	int			i;
+
+	ExecClearTuple(logslot);
+	logslot->tts_values[0] = Int32GetDatum(sign);
+	logslot->tts_isnull[0] = false;
+	if (slot != NULL)
+		slot_getsomeattrs(slot, writer->maxattno);
+	for (i = 0; i < writer->ncolumns; i++)
+	{
+		if (slot != NULL)
+		{
+			int			off = writer->attnos[i] - 1;
+
+			logslot->tts_values[i + 1] = slot->tts_values[off];
+			logslot->tts_isnull[i + 1] = slot->tts_isnull[off];
+		}
+		else
+		{
+			logslot->tts_values[i + 1] = (Datum) 0;
+			logslot->tts_isnull[i + 1] = true;
+		}
+	}
+	ExecStoreVirtualTuple(logslot);
+
+	table_tuple_insert(writer->logrel, logslot, writer->cid, 0,
+					   writer->bistate);
+}
+
+/*
+ * Start reading a transition table from the beginning.  Other triggers may
+ * read the same table, so use a read pointer of our own.
+ */
+static void
+ivm_rewind(Tuplestorestate *table)
+{
+	int			ptr;
+
+	ptr = tuplestore_alloc_read_pointer(table, EXEC_FLAG_REWIND);
+	tuplestore_select_read_pointer(table, ptr);
+	tuplestore_rescan(table);
+}
+
+/*
+ * Log all rows of a transition table with the given sign.
+ */
+static void
+ivm_log_table(IvmLogWriter *writer, Tuplestorestate *table, int sign)
+{
+	if (table == NULL)
+		elog(ERROR, "transition table is missing");
+
+	ivm_rewind(table);
+
+	while (tuplestore_gettupleslot(table, true, false, writer->newslot))
+	{
+		CHECK_FOR_INTERRUPTS();
+		ivm_log_row(writer, writer->newslot, sign);
+	}
+}
+
+/*
+ * Log the rows changed by an UPDATE.  The old and new transition tables hold
+ * the two versions of each updated row in the same order; pairs that agree
+ * on all the logged columns cancel out and aren't logged at all.
+ */
+static void
+ivm_log_update(IvmLogWriter *writer, Tuplestorestate *oldtable,
+			   Tuplestorestate *newtable)
+{
+	TupleDesc	basedesc = writer->oldslot->tts_tupleDescriptor;
+
+	if (oldtable == NULL || newtable == NULL)
+		elog(ERROR, "transition table is missing");
+
+	ivm_rewind(oldtable);
+	ivm_rewind(newtable);
+
+	for (;;)
+	{
+		bool		hasold;
+		bool		hasnew;
+
+		CHECK_FOR_INTERRUPTS();
+
+		hasold = tuplestore_gettupleslot(oldtable, true, false,
+										 writer->oldslot);
+		hasnew = tuplestore_gettupleslot(newtable, true, false,
+										 writer->newslot);
+		if (!hasold && !hasnew)
+			break;
+
+		if (hasold && hasnew)
+		{
+			bool		same = true;
+			int			i;
+
+			slot_getsomeattrs(writer->oldslot, writer->maxattno);
+			slot_getsomeattrs(writer->newslot, writer->maxattno);
+			for (i = 0; i < writer->ncolumns && same; i++)
+			{
+				int			off = writer->attnos[i] - 1;
+				Form_pg_attribute attr = TupleDescAttr(basedesc, off);
+
+				if (writer->oldslot->tts_isnull[off] ||
+					writer->newslot->tts_isnull[off])
+					same = (writer->oldslot->tts_isnull[off] &&
+							writer->newslot->tts_isnull[off]);
+				else
+					same = datum_image_eq(writer->oldslot->tts_values[off],
+										  writer->newslot->tts_values[off],
+										  attr->attbyval, attr->attlen);
+			}
+			if (same)
+				continue;
+		}
+
+		if (hasold)
+			ivm_log_row(writer, writer->oldslot, -1);
+		if (hasnew)
+			ivm_log_row(writer, writer->newslot, 1);
+	}
+}
+
+static void
+ivm_log_end(IvmLogWriter *writer)
+{
+	FreeBulkInsertState(writer->bistate);
+	table_finish_bulk_insert(writer->logrel, 0);
+	ExecDropSingleTupleTableSlot(writer->logslot);
+	ExecDropSingleTupleTableSlot(writer->oldslot);
+	ExecDropSingleTupleTableSlot(writer->newslot);
+}
+
+/*
+ * Find the change log of a base table for a materialized view, from the
+ * arguments of the logging triggers.
+ */
+static Oid
+ivm_find_log(Oid baseoid, Oid matviewOid)
+{
+	Relation	baserel;
+	TriggerDesc *trigdesc;
+	Oid			logoid = InvalidOid;
+
+	baserel = table_open(baseoid, AccessShareLock);
+	trigdesc = baserel->trigdesc;
+	for (int i = 0; trigdesc != NULL && i < trigdesc->numtriggers; i++)
+	{
+		Trigger    *trigger = &trigdesc->triggers[i];
+
+		if (trigger->tgfoid == F_INCREMENTAL_MATVIEW_LOG &&
+			trigger->tgisinternal &&
+			trigger->tgnargs == 2 &&
+			atooid(trigger->tgargs[0]) == matviewOid)
+		{
+			logoid = atooid(trigger->tgargs[1]);
+			break;
+		}
+	}
+	if (!OidIsValid(logoid))
+		elog(ERROR, "could not find change log of table \"%s\" for materialized view %u",
+			 RelationGetRelationName(baserel), matviewOid);
+	table_close(baserel, NoLock);
+
+	return logoid;
+}
+
+/*
+ * Work out how to maintain each column of the view, and find the base
+ * tables and their logs.
+ *
+ * Returns false if the view can't be refreshed incrementally right now:
+ * the delta tables we use bypass row security and privileges of the base
+ * tables, so leave views over tables with row security, or which the owner
+ * can no longer read, to a full refresh.
+ */
+static bool
+ivm_init_state(IvmState *state, Relation matviewRel, Query *query,
+			   Oid relowner)
+{
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	Index		rti;
+	ListCell   *lc;
+
+	state->matviewRel = matviewRel;
+	state->matviewname =
+		quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+								   RelationGetRelationName(matviewRel));
+	state->query = query;
+	state->grouped = (query->hasAggs || query->groupClause != NIL);
+	state->ncolumns = list_length(query->targetList);
+	if (state->ncolumns != tupdesc->natts)
+		elog(ERROR, "materialized view \"%s\" does not match its query",
+			 RelationGetRelationName(matviewRel));
+	state->columns = palloc0_array(IvmColumn, state->ncolumns);
+	state->nkeys = 0;
+	state->countcol = InvalidAttrNumber;
+	state->bases = NIL;
+	state->diffname =
+		quote_qualified_identifier("pg_temp",
+								   psprintf("pg_ivm_diff_%u",
+											RelationGetRelid(matviewRel)));
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		IvmColumn  *col = &state->columns[tle->resno - 1];
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, tle->resno - 1);
+
+		col->name = pstrdup(quote_identifier(NameStr(attr->attname)));
+		col->type = attr->atttypid;
+		col->typmod = attr->atttypmod;
+		col->collation = attr->attcollation;
+
+		if (!state->grouped || !IsA(tle->expr, Aggref))
+		{
+			col->kind = IVM_KEY;
+			col->keyno = ++state->nkeys;
+			col->eqop = lookup_type_cache(col->type, TYPECACHE_EQ_OPR)->eq_opr;
+			if (!OidIsValid(col->eqop))
+				elog(ERROR, "could not identify an equality operator for type %s",
+					 format_type_be(col->type));
+		}
+		else if (!ivm_aggregate_kind((Aggref *) tle->expr, &col->kind))
+			elog(ERROR, "unexpected aggregate in incrementally maintained materialized view");
+
+		if (col->kind == IVM_SUM || col->kind == IVM_AVG)
+		{
+			int			n = tle->resno;
+
+			/* a hidden sum goes with the count of the avg it belongs to */
+			if (sscanf(tle->resname, IVM_PREFIX "sum_%d__", &n) != 1)
+				n = tle->resno;
+			col->countcol = ivm_find_column(query,
+											psprintf(IVM_PREFIX "count_%d__", n));
+			if (col->kind == IVM_AVG)
+				col->sumcol = ivm_find_column(query,
+											  psprintf(IVM_PREFIX "sum_%d__", n));
+		}
+	}
+	if (state->grouped)
+		state->countcol = ivm_find_column(query, IVM_COUNT_COLNAME);
+
+	rti = 0;
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+		IvmBase    *base;
+		Relation	baserel;
+		bool		usable;
+
+		rti++;
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		baserel = table_open(rte->relid, AccessShareLock);
+		usable = (!baserel->rd_rel->relrowsecurity &&
+				  pg_class_aclcheck(rte->relid, relowner,
+									ACL_SELECT) == ACLCHECK_OK);
+
+		base = palloc0_object(IvmBase);
+		base->rti = rti;
+		base->relid = rte->relid;
+		base->logoid = ivm_find_log(rte->relid,
+									RelationGetRelid(matviewRel));
+		base->signattno = RelationGetNumberOfAttributes(baserel) + 1;
+		base->deltarelname = psprintf("pg_ivm_delta_%u_%u",
+									  RelationGetRelid(matviewRel), rti);
+		base->deltaname = quote_qualified_identifier("pg_temp",
+													 base->deltarelname);
+		state->bases = lappend(state->bases, base);
+
+		table_close(baserel, NoLock);
+
+		if (!usable)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Find a column of the view's query by its original name.
+ */
+static AttrNumber
+ivm_find_column(Query *query, const char *name)
+{
+	ListCell   *lc;
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (tle->resname != NULL && strcmp(tle->resname, name) == 0)
+			return tle->resno;
+	}
+	elog(ERROR, "could not find column \"%s\" of incrementally maintained materialized view",
+		 name);
+	return InvalidAttrNumber;	/* keep compiler quiet */
+}
+
+/*
+ * Look at the log rows visible to the snapshot.
+ */
+static IvmLogState
+ivm_check_log(Oid logoid, Snapshot snapshot)
+{
+	Relation	logrel;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	IvmLogState result = IVM_LOG_EMPTY;
+
+	logrel = table_open(logoid, RowExclusiveLock);
+	slot = table_slot_create(logrel, NULL);
+	scan = table_beginscan(logrel, snapshot, 0, NULL);
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		bool		isnull;
+
+		result = IVM_LOG_CHANGED;
+		if (DatumGetInt32(slot_getattr(slot, 1, &isnull)) == 0)
+		{
+			result = IVM_LOG_TRUNCATED;
+			break;
+		}
+	}
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	table_close(logrel, NoLock);
+
+	return result;
+}
+
+/*
+ * Move the log rows visible to the snapshot into the base's delta table,
+ * which has the same columns as the base table plus the sign at the end.
+ */
+static void
+ivm_consume_log(IvmBase *base, Snapshot snapshot)
+{
+	Relation	logrel;
+	Relation	deltarel;
+	TupleDesc	logdesc;
+	TableScanDesc scan;
+	TupleTableSlot *logslot;
+	TupleTableSlot *deltaslot;
+	AttrNumber *attnos;
+	CommandId	cid = GetCurrentCommandId(true);
+	BulkInsertState bistate = GetBulkInsertState();
+
+	logrel = table_open(base->logoid, RowExclusiveLock);
+	deltarel = table_open(base->deltaoid, RowExclusiveLock);
+	logdesc = RelationGetDescr(logrel);
+
+	attnos = palloc_array(AttrNumber, logdesc->natts);
+	attnos[0] = base->signattno;
+	for (int i = 1; i < logdesc->natts; i++)
+		attnos[i] = (AttrNumber)
+			atoi(NameStr(TupleDescAttr(logdesc, i)->attname) + 1);
+
+	logslot = table_slot_create(logrel, NULL);
+	deltaslot = table_slot_create(deltarel, NULL);
+	scan = table_beginscan(logrel, snapshot, 0, NULL);
+	while (table_scan_getnextslot(scan, ForwardScanDirection, logslot))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		slot_getallattrs(logslot);
+		ExecClearTuple(deltaslot);
+		memset(deltaslot->tts_isnull, true,
+			   deltaslot->tts_tupleDescriptor->natts * sizeof(bool));
+		for (int i = 0; i < logdesc->natts; i++)
+		{
+			deltaslot->tts_values[attnos[i] - 1] = logslot->tts_values[i];
+			deltaslot->tts_isnull[attnos[i] - 1] = logslot->tts_isnull[i];
+		}
+		ExecStoreVirtualTuple(deltaslot);
+
+		table_tuple_insert(deltarel, deltaslot, cid, 0, bistate);
+		simple_table_tuple_delete(logrel, &logslot->tts_tid, snapshot);
+	}
+	table_endscan(scan);
+
+	FreeBulkInsertState(bistate);
+	table_finish_bulk_insert(deltarel, 0);
+	ExecDropSingleTupleTableSlot(logslot);
+	ExecDropSingleTupleTableSlot(deltaslot);
+	table_close(deltarel, NoLock);
+	table_close(logrel, NoLock);
+}
+
+/*
+ * Append an ADD COLUMN clause for ALTER TABLE.
+ */
+static void
+ivm_append_column_def(StringInfo buf, bool first, const char *colname,
+					  Oid type, int32 typmod, Oid collation)
+{
+	appendStringInfo(buf, "%sADD COLUMN %s %s",
+					 first ? "" : ", ",
+					 colname, format_type_with_typemod(type, typmod));
+	if (OidIsValid(collation))
+		appendStringInfo(buf, " COLLATE %s",
+						 generate_collation_name(collation));
+}
+
+/*
+ * Give the (already created, empty) delta table of a base table the base's
+ * columns, at the same attribute numbers so that the view's query can use
+ * it in place of the base table unchanged, followed by the sign column.
+ * Dropped columns of the base are reproduced by adding and dropping a
+ * placeholder.
+ */
+static void
+ivm_create_delta_table(IvmBase *base)
+{
+	StringInfoData querybuf;
+	StringInfoData dropbuf;
+	Relation	baserel;
+	TupleDesc	basedesc;
+
+	initStringInfo(&querybuf);
+	initStringInfo(&dropbuf);
+	baserel = table_open(base->relid, NoLock);
+	basedesc = RelationGetDescr(baserel);
+
+	appendStringInfo(&querybuf, "ALTER TABLE %s ", base->deltaname);
+	for (int i = 0; i < basedesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(basedesc, i);
+
+		if (attr->attisdropped)
+		{
+			char	   *colname = psprintf(IVM_PREFIX "dropped_%d__", i + 1);
+
+			ivm_append_column_def(&querybuf, i == 0, colname,
+								  INT4OID, -1, InvalidOid);
+			appendStringInfo(&dropbuf, "%sDROP COLUMN %s",
+							 dropbuf.len == 0 ? "" : ", ", colname);
+		}
+		else
+			ivm_append_column_def(&querybuf, i == 0,
+								  quote_identifier(NameStr(attr->attname)),
+								  attr->atttypid, attr->atttypmod,
+								  attr->attcollation);
+	}
+	ivm_append_column_def(&querybuf, basedesc->natts == 0, IVM_SIGN_COLNAME,
+						  INT4OID, -1, InvalidOid);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	if (dropbuf.len > 0)
+	{
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf, "ALTER TABLE %s %s",
+						 base->deltaname, dropbuf.data);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	}
+
+	table_close(baserel, NoLock);
+
+	base->deltaoid = RangeVarGetRelid(makeRangeVar("pg_temp",
+												   base->deltarelname, -1),
+									  NoLock, false);
+}
+
+/*
+ * Give the (already created, empty) diff table its columns: one per key,
+ * the net change in the number of rows, and what is needed to maintain each
+ * aggregate column n:
+ *
+ *	count(x):	__ivm_c<n>, net change in the number of non-null x
+ *	sum(x):		__ivm_p<n> and __ivm_m<n>, sums of inserted and deleted x
+ *	min/max(x):	__ivm_p<n>, min/max of inserted x, and __ivm_n<n>, the
+ *				number of deleted non-null x
+ *
+ * avg is maintained from its hidden count and sum columns.
+ */
+static void
+ivm_create_diff_table(IvmState *state)
+{
+	StringInfoData querybuf;
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "ALTER TABLE %s ", state->diffname);
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+
+		if (col->kind == IVM_KEY)
+			ivm_append_column_def(&querybuf, col->keyno == 1,
+								  psprintf(IVM_PREFIX "k%d", col->keyno),
+								  col->type, col->typmod, col->collation);
+	}
+	ivm_append_column_def(&querybuf, state->nkeys == 0, IVM_PREFIX "cnt",
+						  INT8OID, -1, InvalidOid);
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+		int			n = i + 1;
+
+		switch (col->kind)
+		{
+			case IVM_COUNT:
+				ivm_append_column_def(&querybuf, false,
+									  psprintf(IVM_PREFIX "c%d", n),
+									  INT8OID, -1, InvalidOid);
+				break;
+			case IVM_SUM:
+				ivm_append_column_def(&querybuf, false,
+									  psprintf(IVM_PREFIX "p%d", n),
+									  col->type, -1, col->collation);
+				ivm_append_column_def(&querybuf, false,
+									  psprintf(IVM_PREFIX "m%d", n),
+									  col->type, -1, col->collation);
+				break;
+			case IVM_MIN:
+			case IVM_MAX:
+				ivm_append_column_def(&querybuf, false,
+									  psprintf(IVM_PREFIX "p%d", n),
+									  col->type, col->typmod, col->collation);
+				ivm_append_column_def(&querybuf, false,
+									  psprintf(IVM_PREFIX "n%d", n),
+									  INT8OID, -1, InvalidOid);
+				break;
+			default:
+				break;
+		}
+	}
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+}
+
+/*
+ * Deparse the view's query with the delta tables of the changed bases
+ * selected by the subset bitmask in place of the tables themselves.  The
+ * target list is replaced by the keys (__ivm_k<j>), the arguments of the
+ * aggregates (__ivm_a<n>) and the signs of the delta rows (__ivm_s<rti>),
+ * and the aggregation is removed.
+ */
+static char *
+ivm_subquery(IvmState *state, List *changed, uint32 subset)
+{
+	Query	   *query = copyObject(state->query);
+	List	   *tlist = NIL;
+	AttrNumber	resno = 0;
+	ListCell   *lc;
+
+	foreach(lc, changed)
+	{
+		IvmBase    *base = (IvmBase *) lfirst(lc);
+		RangeTblEntry *rte;
+
+		if ((subset & (1U << foreach_current_index(lc))) == 0)
+			continue;
+		rte = rt_fetch(base->rti, query->rtable);
+		rte->relid = base->deltaoid;
+		rte->inh = false;
+		rte->eref->colnames = lappend(rte->eref->colnames,
+									  makeString(IVM_SIGN_COLNAME));
+	}
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		IvmColumn  *col = &state->columns[tle->resno - 1];
+		Expr	   *arg;
+
+		switch (col->kind)
+		{
+			case IVM_KEY:
+				tlist = lappend(tlist,
+								makeTargetEntry(tle->expr, ++resno,
+												psprintf(IVM_PREFIX "k%d",
+														 col->keyno),
+												false));
+				break;
+			case IVM_COUNT:
+			case IVM_SUM:
+			case IVM_MIN:
+			case IVM_MAX:
+				arg = linitial_node(TargetEntry,
+									((Aggref *) tle->expr)->args)->expr;
+				tlist = lappend(tlist,
+								makeTargetEntry(arg, ++resno,
+												psprintf(IVM_PREFIX "a%d",
+														 tle->resno),
+												false));
+				break;
+			default:
+				break;
+		}
+	}
+
+	foreach(lc, changed)
+	{
+		IvmBase    *base = (IvmBase *) lfirst(lc);
+
+		if ((subset & (1U << foreach_current_index(lc))) == 0)
+			continue;
+		tlist = lappend(tlist,
+						makeTargetEntry((Expr *) makeVar(base->rti,
+														 base->signattno,
+														 INT4OID, -1,
+														 InvalidOid, 0),
+										++resno,
+										psprintf(IVM_PREFIX "s%u", base->rti),
+										false));
+	}
+
+	query->targetList = tlist;
+	query->groupClause = NIL;
+	query->hasAggs = false;
+
+	return pg_get_querydef(query, false);
+}
+
+/*
+ * Build the query computing the contents of the diff table.
+ */
+static char *
+ivm_delta_query(IvmState *state, List *changed)
+{
+	StringInfoData querybuf;
+	StringInfoData colsbuf;
+	uint32		nsubsets = (1U << list_length(changed));
+
+	initStringInfo(&querybuf);
+	initStringInfo(&colsbuf);
+
+	/* The columns every term produces, besides the sign */
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+
+		if (col->kind == IVM_KEY)
+			appendStringInfo(&colsbuf, "s." IVM_PREFIX "k%d, ", col->keyno);
+		else if (col->kind != IVM_COUNT_STAR && col->kind != IVM_AVG)
+			appendStringInfo(&colsbuf, "s." IVM_PREFIX "a%d, ", i + 1);
+	}
+
+	appendStringInfoString(&querybuf, "SELECT ");
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+
+		if (col->kind == IVM_KEY)
+			appendStringInfo(&querybuf, "d." IVM_PREFIX "k%d, ", col->keyno);
+	}
+	appendStringInfoString(&querybuf,
+						   "COALESCE(pg_catalog.sum(d." IVM_PREFIX "sign), 0)");
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+		int			n = i + 1;
+
+		switch (col->kind)
+		{
+			case IVM_COUNT:
+				appendStringInfo(&querybuf,
+								 ", COALESCE(pg_catalog.sum(d." IVM_PREFIX "sign) "
+								 "FILTER (WHERE d." IVM_PREFIX "a%d IS NOT NULL), 0)",
+								 n);
+				break;
+			case IVM_SUM:
+				appendStringInfo(&querybuf,
+								 ", pg_catalog.sum(d." IVM_PREFIX "a%d) "
+								 "FILTER (WHERE d." IVM_PREFIX "sign OPERATOR(pg_catalog.>) 0)"
+								 ", pg_catalog.sum(d." IVM_PREFIX "a%d) "
+								 "FILTER (WHERE d." IVM_PREFIX "sign OPERATOR(pg_catalog.<) 0)",
+								 n, n);
+				break;
+			case IVM_MIN:
+			case IVM_MAX:
+				appendStringInfo(&querybuf,
+								 ", pg_catalog.%s(d." IVM_PREFIX "a%d) "
+								 "FILTER (WHERE d." IVM_PREFIX "sign OPERATOR(pg_catalog.>) 0)"
+								 ", pg_catalog.count(d." IVM_PREFIX "a%d) "
+								 "FILTER (WHERE d." IVM_PREFIX "sign OPERATOR(pg_catalog.<) 0)",
+								 col->kind == IVM_MIN ? "min" : "max", n, n);
+				break;
+			default:
+				break;
+		}
+	}
+	appendStringInfoString(&querybuf, " FROM (");
+
+	/* One term per nonempty subset of the changed tables */
+	for (uint32 subset = 1; subset < nsubsets; subset++)
+	{
+		int			nmembers = 0;
+		ListCell   *lc;
+
+		if (subset > 1)
+			appendStringInfoString(&querybuf, " UNION ALL ");
+		appendStringInfo(&querybuf, "SELECT %s", colsbuf.data);
+		if (pg_popcount32(subset) % 2 == 0)
+			appendStringInfoString(&querybuf, "OPERATOR(pg_catalog.-) ");
+		appendStringInfoChar(&querybuf, '(');
+		foreach(lc, changed)
+		{
+			IvmBase    *base = (IvmBase *) lfirst(lc);
+
+			if ((subset & (1U << foreach_current_index(lc))) == 0)
+				continue;
+			if (nmembers++ > 0)
+				appendStringInfoString(&querybuf, " OPERATOR(pg_catalog.*) ");
+			appendStringInfo(&querybuf, "s." IVM_PREFIX "s%u", base->rti);
+		}
+		appendStringInfo(&querybuf, ") AS " IVM_PREFIX "sign FROM (%s) s",
+						 ivm_subquery(state, changed, subset));
+	}
+	appendStringInfoString(&querybuf, ") d");
+
+	if (state->nkeys > 0)
+	{
+		appendStringInfoString(&querybuf, " GROUP BY ");
+		for (int i = 0; i < state->ncolumns; i++)
+		{
+			IvmColumn  *col = &state->columns[i];
+
+			if (col->kind == IVM_KEY)
+				appendStringInfo(&querybuf, "%sd." IVM_PREFIX "k%d",
+								 col->keyno == 1 ? "" : ", ", col->keyno);
+		}
+	}
+
+	/* Rows of a view without aggregates that came and went don't matter */
+	if (!state->grouped)
+		appendStringInfoString(&querybuf,
+							   " HAVING pg_catalog.sum(d." IVM_PREFIX "sign) "
+							   "OPERATOR(pg_catalog.<>) 0");
+
+	return querybuf.data;
+}
+
+/*
+ * Append a condition matching the keys of rows of the matview, aliased
+ * mvalias, with the __ivm_k<j> columns of dalias, treating nulls as equal.
+ */
+static void
+ivm_append_key_match(StringInfo buf, IvmState *state, const char *mvalias,
+					 const char *dalias)
+{
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+		char	   *leftop;
+		char	   *rightop;
+
+		if (col->kind != IVM_KEY)
+			continue;
+
+		leftop = psprintf("%s.%s", mvalias, col->name);
+		rightop = psprintf("%s." IVM_PREFIX "k%d", dalias, col->keyno);
+		if (col->keyno > 1)
+			appendStringInfoString(buf, " AND ");
+		appendStringInfoChar(buf, '(');
+		generate_operator_clause(buf, leftop, col->type, col->eqop,
+								 rightop, col->type);
+		appendStringInfo(buf, " OR (%s IS NULL AND %s IS NULL))",
+						 leftop, rightop);
+	}
+}
+
+/*
+ * Expression for the new value of a count column.
+ */
+static char *
+ivm_new_count(IvmState *state, AttrNumber countcol)
+{
+	IvmColumn  *col = &state->columns[countcol - 1];
+
+	if (col->kind == IVM_COUNT_STAR)
+		return psprintf("(mv.%s OPERATOR(pg_catalog.+) d." IVM_PREFIX "cnt)",
+						col->name);
+	Assert(col->kind == IVM_COUNT);
+	return psprintf("(mv.%s OPERATOR(pg_catalog.+) d." IVM_PREFIX "c%d)",
+					col->name, countcol);
+}
+
+/*
+ * Expression for the new value of a sum column, ignoring the case that no
+ * non-null arguments remain.
+ */
+static char *
+ivm_new_sum(IvmState *state, AttrNumber sumcol)
+{
+	IvmColumn  *col = &state->columns[sumcol - 1];
+	char	   *zero;
+
+	Assert(col->kind == IVM_SUM);
+	zero = psprintf("CAST('0' AS %s)", format_type_be(col->type));
+	return psprintf("COALESCE(mv.%s, %s) "
+					"OPERATOR(pg_catalog.+) COALESCE(d." IVM_PREFIX "p%d, %s) "
+					"OPERATOR(pg_catalog.-) COALESCE(d." IVM_PREFIX "m%d, %s)",
+					col->name, zero, sumcol, zero, sumcol, zero);
+}
+
+/*
+ * Expression for the new value of an aggregate column.  fullquery is the
+ * view's query without aggregation, for recomputing min and max.
+ */
+static char *
+ivm_new_value(IvmState *state, AttrNumber attno, const char *fullquery)
+{
+	IvmColumn  *col = &state->columns[attno - 1];
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	switch (col->kind)
+	{
+		case IVM_COUNT_STAR:
+		case IVM_COUNT:
+			appendStringInfoString(&buf, ivm_new_count(state, attno));
+			break;
+		case IVM_SUM:
+			appendStringInfo(&buf,
+							 "CASE WHEN %s OPERATOR(pg_catalog.=) 0 THEN NULL "
+							 "ELSE %s END",
+							 ivm_new_count(state, col->countcol),
+							 ivm_new_sum(state, attno));
+			break;
+		case IVM_AVG:
+			appendStringInfo(&buf,
+							 "CASE WHEN %s OPERATOR(pg_catalog.=) 0 THEN NULL "
+							 "ELSE CAST(%s AS %s) OPERATOR(pg_catalog./) %s END",
+							 ivm_new_count(state, col->countcol),
+							 ivm_new_sum(state, col->sumcol),
+							 format_type_be(col->type),
+							 ivm_new_count(state, col->countcol));
+			break;
+		case IVM_MIN:
+		case IVM_MAX:
+			appendStringInfo(&buf,
+							 "CASE WHEN d." IVM_PREFIX "n%d OPERATOR(pg_catalog.>) 0 "
+							 "THEN (SELECT pg_catalog.%s(r." IVM_PREFIX "a%d) "
+							 "FROM (%s) r",
+							 attno, col->kind == IVM_MIN ? "min" : "max",
+							 attno, fullquery);
+			if (state->nkeys > 0)
+			{
+				appendStringInfoString(&buf, " WHERE ");
+				ivm_append_key_match(&buf, state, "mv", "r");
+			}
+			appendStringInfo(&buf, ") ELSE %s(mv.%s, d." IVM_PREFIX "p%d) END",
+							 col->kind == IVM_MIN ? "LEAST" : "GREATEST",
+							 col->name, attno);
+			break;
+		case IVM_KEY:
+			elog(ERROR, "unexpected key column");
+			break;
+	}
+
+	return buf.data;
+}
+
+/*
+ * Apply the diff table to an aggregating view: add empty groups for new
+ * keys, update the aggregates of all affected groups, and remove groups
+ * that became empty.  A view without GROUP BY always has exactly one row.
+ */
+static uint64
+ivm_apply_aggregates(IvmState *state, Snapshot snapshot)
+{
+	StringInfoData querybuf;
+	char	   *fullquery;
+	uint64		processed = 0;
+	bool		first;
+
+	initStringInfo(&querybuf);
+	fullquery = ivm_subquery(state, NIL, 0);
+
+	if (state->nkeys > 0)
+	{
+		appendStringInfo(&querybuf, "INSERT INTO %s (", state->matviewname);
+		first = true;
+		for (int i = 0; i < state->ncolumns; i++)
+		{
+			IvmColumn  *col = &state->columns[i];
+
+			if (col->kind == IVM_KEY || col->kind == IVM_COUNT_STAR ||
+				col->kind == IVM_COUNT)
+			{
+				appendStringInfo(&querybuf, "%s%s", first ? "" : ", ",
+								 col->name);
+				first = false;
+			}
+		}
+		appendStringInfoString(&querybuf, ") SELECT ");
+		first = true;
+		for (int i = 0; i < state->ncolumns; i++)
+		{
+			IvmColumn  *col = &state->columns[i];
+
+			if (col->kind == IVM_KEY)
+				appendStringInfo(&querybuf, "%sd." IVM_PREFIX "k%d",
+								 first ? "" : ", ", col->keyno);
+			else if (col->kind == IVM_COUNT_STAR || col->kind == IVM_COUNT)
+				appendStringInfo(&querybuf, "%s0", first ? "" : ", ");
+			else
+				continue;
+			first = false;
+		}
+		appendStringInfo(&querybuf,
+						 " FROM %s d WHERE d." IVM_PREFIX "cnt OPERATOR(pg_catalog.>) 0"
+						 " AND NOT EXISTS (SELECT 1 FROM %s mv WHERE ",
+						 state->diffname, state->matviewname);
+		ivm_append_key_match(&querybuf, state, "mv", "d");
+		appendStringInfoChar(&querybuf, ')');
+		processed += ivm_execute(querybuf.data, snapshot, SPI_OK_INSERT);
+	}
+
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "UPDATE %s mv SET ", state->matviewname);
+	first = true;
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		IvmColumn  *col = &state->columns[i];
+
+		if (col->kind == IVM_KEY)
+			continue;
+		appendStringInfo(&querybuf, "%s%s = %s", first ? "" : ", ",
+						 col->name, ivm_new_value(state, i + 1, fullquery));
+		first = false;
+	}
+	appendStringInfo(&querybuf, " FROM %s d", state->diffname);
+	if (state->nkeys > 0)
+	{
+		appendStringInfoString(&querybuf, " WHERE ");
+		ivm_append_key_match(&querybuf, state, "mv", "d");
+	}
+	processed += ivm_execute(querybuf.data, snapshot, SPI_OK_UPDATE);
+
+	if (state->nkeys > 0)
+	{
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf,
+						 "DELETE FROM %s mv USING %s d WHERE mv.%s OPERATOR(pg_catalog.=) 0 AND ",
+						 state->matviewname, state->diffname,
+						 state->columns[state->countcol - 1].name);
+		ivm_append_key_match(&querybuf, state, "mv", "d");
+		processed += ivm_execute(querybuf.data, snapshot, SPI_OK_DELETE);
+	}
+
+	return processed;
+}
+
+/*
+ * Apply the diff table to a view without aggregates: for each distinct row
+ * whose count went down, delete that many copies; for each whose count went
+ * up, insert that many.
+ */
+static uint64
+ivm_apply_rows(IvmState *state, Snapshot snapshot)
+{
+	StringInfoData querybuf;
+	uint64		processed = 0;
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf,
+					 "DELETE FROM %s WHERE ctid OPERATOR(pg_catalog.=) ANY "
+					 "(SELECT x.tid FROM (SELECT mv.ctid AS tid, "
+					 "pg_catalog.row_number() OVER (PARTITION BY d.ctid) AS rn, "
+					 "OPERATOR(pg_catalog.-) d." IVM_PREFIX "cnt AS ndel "
+					 "FROM %s mv, %s d "
+					 "WHERE d." IVM_PREFIX "cnt OPERATOR(pg_catalog.<) 0 AND ",
+					 state->matviewname, state->matviewname, state->diffname);
+	ivm_append_key_match(&querybuf, state, "mv", "d");
+	appendStringInfoString(&querybuf,
+						   ") x WHERE x.rn OPERATOR(pg_catalog.<=) x.ndel)");
+	processed += ivm_execute(querybuf.data, snapshot, SPI_OK_DELETE);
+
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s SELECT ", state->matviewname);
+	for (int i = 0; i < state->ncolumns; i++)
+		appendStringInfo(&querybuf, "%sd." IVM_PREFIX "k%d",
+						 i == 0 ? "" : ", ", state->columns[i].keyno);
+	appendStringInfo(&querybuf,
+					 " FROM %s d, pg_catalog.generate_series(1, d." IVM_PREFIX "cnt)"
+					 " WHERE d." IVM_PREFIX "cnt OPERATOR(pg_catalog.>) 0",
+					 state->diffname);
+	processed += ivm_execute(querybuf.data, snapshot, SPI_OK_INSERT);
+
+	return processed;
+}
+
+/*
+ * Run a data-modifying statement using the refresh's snapshot, so that it
+ * sees the base tables in the same state as the consumed changes.
+ */
+static uint64
+ivm_execute(const char *sql, Snapshot snapshot, int expected)
+{
+	SPIPlanPtr	plan;
+	uint64		processed;
+
+	plan = SPI_prepare(sql, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare failed: %s", sql);
+	if (SPI_execute_snapshot(plan, NULL, NULL, snapshot, InvalidSnapshot,
+							 false, true, 0) != expected)
+		elog(ERROR, "SPI_execute_snapshot failed: %s", sql);
+	processed = SPI_processed;
+	SPI_freeplan(plan);
+
+	return processed;
+}
+
+/*
+ * IncrementalRefreshMatView
+ *		Bring a populated, incrementally maintained materialized view up to
+ *		date by applying the logged changes visible to the active snapshot.
+ *
+ * This runs as the view's owner within a security-restricted operation; see
+ * RefreshMatViewByOid.  Returns false, without changing anything, if the view
+ * needs a full refresh instead.  Otherwise *processed is set to the number
+ * of rows of the view inserted, updated or deleted.
+ */
+bool
+IncrementalRefreshMatView(Relation matviewRel, Query *query, Oid relowner,
+						  int save_sec_context, uint64 *processed)
+{
+	Snapshot	snapshot = GetActiveSnapshot();
+	IvmState	state;
+	List	   *changed = NIL;
+	StringInfoData querybuf;
+	ListCell   *lc;
+
+	if (!ivm_init_state(&state, matviewRel, query, relowner))
+		return false;
+
+	foreach(lc, state.bases)
+	{
+		IvmBase    *base = (IvmBase *) lfirst(lc);
+
+		switch (ivm_check_log(base->logoid, snapshot))
+		{
+			case IVM_LOG_EMPTY:
+				break;
+			case IVM_LOG_CHANGED:
+				changed = lappend(changed, base);
+				break;
+			case IVM_LOG_TRUNCATED:
+				return false;
+		}
+	}
+	if (list_length(changed) > IVM_MAX_CHANGED_TABLES)
+		return false;
+
+	*processed = 0;
+	if (changed == NIL)
+		return true;
+
+	initStringInfo(&querybuf);
+
+	/* Open SPI context. */
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/*
+	 * Create the temporary tables.  As in refresh_by_match_merge, switch out
+	 * of the SECURITY_RESTRICTED_OPERATION context for that, and add the
+	 * columns only after switching back.
+	 */
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE);
+	foreach(lc, changed)
+	{
+		IvmBase    *base = (IvmBase *) lfirst(lc);
+
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf, "CREATE TEMP TABLE %s ()",
+						 base->deltaname);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	}
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "CREATE TEMP TABLE %s ()", state.diffname);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+
+	/* Move the changes out of the logs, and analyze them */
+	foreach(lc, changed)
+	{
+		IvmBase    *base = (IvmBase *) lfirst(lc);
+
+		ivm_create_delta_table(base);
+		ivm_consume_log(base, snapshot);
+		CommandCounterIncrement();
+
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf, "ANALYZE %s", base->deltaname);
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	}
+
+	/* Compute the net change of each group or row */
+	ivm_create_diff_table(&state);
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s %s", state.diffname,
+					 ivm_delta_query(&state, changed));
+	(void) ivm_execute(querybuf.data, snapshot, SPI_OK_INSERT);
+
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "ANALYZE %s", state.diffname);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/* Apply it */
+	OpenMatViewIncrementalMaintenance();
+	if (state.grouped)
+		*processed = ivm_apply_aggregates(&state, snapshot);
+	else
+		*processed = ivm_apply_rows(&state, snapshot);
+	CloseMatViewIncrementalMaintenance();
+
+	/* Clean up temp tables. */
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "DROP TABLE %s", state.diffname);
+	foreach(lc, changed)
+		appendStringInfo(&querybuf, ", %s",
+						 ((IvmBase *) lfirst(lc))->deltaname);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/* Close SPI context. */
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+
+	return true;
+}
+
+/*
+ * ClearIncrementalMatViewLogs
+ *		Discard the logged changes visible to the snapshot, after the view has
+ *		been recomputed (or emptied) using that snapshot.
+ */
+void
+ClearIncrementalMatViewLogs(Relation matviewRel, Query *query,
+							Snapshot snapshot)
+{
+	ListCell   *lc;
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+		Relation	logrel;
+		TableScanDesc scan;
+		TupleTableSlot *slot;
+
+		if (rte->rtekind != RTE_RELATION)
+			continue;
+
+		logrel = table_open(ivm_find_log(rte->relid,
+										 RelationGetRelid(matviewRel)),
+							RowExclusiveLock);
+		slot = table_slot_create(logrel, NULL);
+		scan = table_beginscan(logrel, snapshot, 0, NULL);
+		while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+		{
+			CHECK_FOR_INTERRUPTS();
+			simple_table_tuple_delete(logrel, &slot->tts_tid, snapshot);
+		}
+		table_endscan(scan);
+		ExecDropSingleTupleTableSlot(slot);
+		table_close(logrel, NoLock);
+	}
+}
@@ -25,6 +25,7 @@
 #include "catalog/pg_am.h"
 #include "catalog/pg_opclass.h"
 #include "commands/cluster.h"
+#include "commands/incrmatview.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
@@ -66,8 +67,6 @@ static void refresh_by_match_merge(Oid matviewOid, Oid tempOid, Oid relowner,
 								   int save_sec_context);
 static void refresh_by_heap_swap(Oid matviewOid, Oid OIDNewHeap, char relpersistence);
 static bool is_usable_unique_index(Relation indexRel);
-static void OpenMatViewIncrementalMaintenance(void);
-static void CloseMatViewIncrementalMaintenance(void);
 
 /*
  * SetMatViewPopulatedState
@@ -176,10 +175,12 @@ RefreshMatViewByOid(Oid matviewOid, bool skipData, bool concurrent,
 	Oid			save_userid;
 	int			save_sec_context;
 	int			save_nestlevel;
+	bool		isivm;
 	ObjectAddress address;
 
 	matviewRel = table_open(matviewOid, NoLock);
 	relowner = matviewRel->rd_rel->relowner;
+	isivm = matviewRel->rd_rel->relisivm;
 
 	/*
 	 * Switch to the owner's userid, so that any functions are run as that
@@ -212,6 +213,21 @@ RefreshMatViewByOid(Oid matviewOid, bool skipData, bool concurrent,
 				 errmsg("%s and %s options cannot be used together",
 						"CONCURRENTLY", "WITH NO DATA")));
 
+	/*
+	 * An incrementally maintained view must see the base tables in the same
+	 * state as the changes it consumes from their logs, and the results of
+	 * any refresh that completed while we waited for our lock; so take a new
+	 * snapshot now, which rules out transaction-level snapshots.
+	 */
+	if (isivm)
+	{
+		if (!skipData && IsolationUsesXactSnapshot())
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("incrementally maintained materialized views cannot be refreshed in a transaction using REPEATABLE READ or SERIALIZABLE isolation")));
+		PushActiveSnapshot(GetTransactionSnapshot());
+	}
+
 	/*
 	 * Check that everything is correct for a refresh. Problems at this point
 	 * are internal errors, so elog is sufficient.
@@ -239,6 +255,55 @@ RefreshMatViewByOid(Oid matviewOid, bool skipData, bool concurrent,
 			 "the rule for materialized view \"%s\" is not a single action",
 			 RelationGetRelationName(matviewRel));
 
+	/*
+	 * The stored query was rewritten at the time of the MV definition, but
+	 * has not been scribbled on by the planner.
+	 */
+	dataQuery = linitial_node(Query, actions);
+
+	/*
+	 * A populated, incrementally maintained view is normally brought up to
+	 * date by applying the logged changes of its base tables.
+	 */
+	if (isivm && !skipData && RelationIsPopulated(matviewRel))
+	{
+		int			old_depth = matview_maintenance_depth;
+		bool		done;
+
+		CheckTableNotInUse(matviewRel, "REFRESH MATERIALIZED VIEW");
+
+		PG_TRY();
+		{
+			done = IncrementalRefreshMatView(matviewRel, dataQuery, relowner,
+											 save_sec_context, &processed);
+		}
+		PG_CATCH();
+		{
+			matview_maintenance_depth = old_depth;
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+		Assert(matview_maintenance_depth == old_depth);
+
+		if (done)
+		{
+			PopActiveSnapshot();
+			table_close(matviewRel, NoLock);
+
+			/* Roll back any GUC changes */
+			AtEOXact_GUC(false, save_nestlevel);
+
+			/* Restore userid and security context */
+			SetUserIdAndSecContext(save_userid, save_sec_context);
+
+			ObjectAddressSet(address, RelationRelationId, matviewOid);
+			if (qc)
+				SetQueryCompletion(qc, CMDTAG_REFRESH_MATERIALIZED_VIEW,
+								   processed);
+			return address;
+		}
+	}
+
 	/*
 	 * Check that there is a unique index with no WHERE clause on one or more
 	 * columns of the materialized view if CONCURRENTLY is specified.
@@ -272,12 +337,6 @@ RefreshMatViewByOid(Oid matviewOid, bool skipData, bool concurrent,
 					 errhint("Create a unique index with no WHERE clause on one or more columns of the materialized view.")));
 	}
 
-	/*
-	 * The stored query was rewritten at the time of the MV definition, but
-	 * has not been scribbled on by the planner.
-	 */
-	dataQuery = linitial_node(Query, actions);
-
 	/*
 	 * Check for active uses of the relation in the current transaction, such
 	 * as open scans.
@@ -353,6 +412,13 @@ RefreshMatViewByOid(Oid matviewOid, bool skipData, bool concurrent,
 			pgstat_count_heap_insert(matviewRel, processed);
 	}
 
+	/* The view now reflects all the changes logged so far */
+	if (isivm)
+	{
+		ClearIncrementalMatViewLogs(matviewRel, dataQuery, GetActiveSnapshot());
+		PopActiveSnapshot();
+	}
+
 	table_close(matviewRel, NoLock);
 
 	/* Roll back any GUC changes */
@@ -954,13 +1020,13 @@ MatViewIncrementalMaintenanceIsEnabled(void)
 	return matview_maintenance_depth > 0;
 }
 
-static void
+void
 OpenMatViewIncrementalMaintenance(void)
 {
 	matview_maintenance_depth++;
 }
 
-static void
+void
 CloseMatViewIncrementalMaintenance(void)
 {
 	matview_maintenance_depth--;
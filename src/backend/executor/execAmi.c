@@ -427,9 +427,11 @@ ExecSupportsMarkRestore(Path *pathnode)
 		case T_IndexOnlyScan:
 
 			/*
-			 * Not all index types support mark/restore.
+			 * Not all index types support mark/restore.  Skipping scans
+			 * don't support it either.
 			 */
-			return castNode(IndexPath, pathnode)->indexinfo->amcanmarkpos;
+			return castNode(IndexPath, pathnode)->indexinfo->amcanmarkpos &&
+				!castNode(IndexPath, pathnode)->indexskip;
 
 		case T_Material:
 		case T_Sort:
@@ -553,9 +555,14 @@ ExecSupportsBackwardScan(Plan *node)
 			return false;
 
 		case T_IndexScan:
+			/* skipping scans can't change direction */
+			if (((IndexScan *) node)->indexskip)
+				return false;
 			return IndexSupportsBackwardScan(((IndexScan *) node)->indexid);
 
 		case T_IndexOnlyScan:
+			if (((IndexOnlyScan *) node)->indexskip)
+				return false;
 			return IndexSupportsBackwardScan(((IndexOnlyScan *) node)->indexid);
 
 		case T_SubqueryScan:
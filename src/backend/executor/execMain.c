@@ -37,6 +37,7 @@
  */
 #include "postgres.h"
 
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
@@ -50,6 +51,7 @@
 #include "foreign/fdwapi.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "optimizer/cardfeedback.h"
 #include "parser/parse_relation.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/utility.h"
@@ -492,6 +494,10 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	 */
 	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
 
+	/* Report scan row counts for cardinality feedback, if enabled */
+	if (cardinality_feedback)
+		CardinalityFeedbackRecord(queryDesc);
+
 	ExecEndPlan(queryDesc->planstate, estate);
 
 	/* do away with our snapshots */
@@ -811,7 +817,12 @@ ExecCheckXactReadOnly(PlannedStmt *plannedstmt)
 		PreventCommandIfReadOnly(CreateCommandName((Node *) plannedstmt));
 	}
 
-	if (plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE)
+	/*
+	 * A parallel worker can only be asked to modify data by a leader whose
+	 * planner found the insertion safe to run in parallel mode.
+	 */
+	if ((plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE) &&
+		!IsParallelWorker())
 		PreventCommandIfParallelMode(CreateCommandName((Node *) plannedstmt));
 }
 
@@ -1633,7 +1644,15 @@ ExecutePlan(QueryDesc *queryDesc,
 
 	estate->es_use_parallel_mode = use_parallel_mode;
 	if (use_parallel_mode)
+	{
+		/*
+		 * Workers inserting rows need a transaction ID, and they can't assign
+		 * one themselves, so make sure we have one to share.
+		 */
+		if (operation != CMD_SELECT)
+			(void) GetCurrentTransactionId();
 		EnterParallelMode();
+	}
 
 	/*
 	 * Loop until we've processed the proper number of tuples from the plan.
@@ -23,6 +23,8 @@
 
 #include "postgres.h"
 
+#include "access/xact.h"
+#include "commands/createas.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -47,6 +49,7 @@
 #include "utils/datum.h"
 #include "utils/dsa.h"
 #include "utils/lsyscache.h"
+#include "utils/queryresultcache.h"
 #include "utils/snapmgr.h"
 
 /*
@@ -76,6 +79,9 @@ typedef struct FixedParallelExecutorState
 	dsa_pointer param_exec;
 	int			eflags;
 	int			jit_flags;
+	Oid			into_relid;		/* CREATE TABLE AS target, or InvalidOid */
+	int			into_options;	/* table_tuple_insert options for into_relid */
+	pg_atomic_uint64 processed; /* rows written by workers */
 } FixedParallelExecutorState;
 
 /*
@@ -172,7 +178,8 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	 * PlannedStmt to start the executor.
 	 */
 	pstmt = makeNode(PlannedStmt);
-	pstmt->commandType = CMD_SELECT;
+	pstmt->commandType = IsA(plan, ModifyTable) ?
+		((ModifyTable *) plan)->operation : CMD_SELECT;
 	pstmt->queryId = pgstat_get_my_query_id();
 	pstmt->hasReturning = false;
 	pstmt->hasModifyingCTE = false;
@@ -183,7 +190,8 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->planTree = plan;
 	pstmt->rtable = estate->es_range_table;
 	pstmt->permInfos = estate->es_rteperminfos;
-	pstmt->resultRelations = NIL;
+	pstmt->resultRelations = IsA(plan, ModifyTable) ?
+		((ModifyTable *) plan)->resultRelations : NIL;
 	pstmt->appendRelations = NIL;
 
 	/*
@@ -744,8 +752,38 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes->param_exec = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+
+	/*
+	 * If this is the Gather at the top of a CREATE TABLE AS plan, and
+	 * createas.c found it acceptable, the workers insert the rows they
+	 * produce themselves rather than sending them to us.
+	 */
+	if (planstate->plan == outerPlan(estate->es_plannedstmt->planTree))
+	{
+		fpes->into_relid = estate->es_parallel_into_relid;
+		fpes->into_options = estate->es_parallel_into_options;
+	}
+	else
+	{
+		fpes->into_relid = InvalidOid;
+		fpes->into_options = 0;
+	}
+	pg_atomic_init_u64(&fpes->processed, 0);
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
+	/*
+	 * Workers that insert rows don't report what they modified to the query
+	 * result cache, which only looks at our own transaction state, so note
+	 * the target relations here.
+	 */
+	if (OidIsValid(fpes->into_relid))
+		QueryResultCacheNoteRelation(fpes->into_relid);
+	if (IsA(planstate->plan, ModifyTable))
+	{
+		foreach_int(rti, ((ModifyTable *) planstate->plan)->resultRelations)
+			QueryResultCacheNoteRelation(exec_rt_fetch(rti, estate)->relid);
+	}
+
 	/* Store query string */
 	query_string = shm_toc_allocate(pcxt->toc, query_len + 1);
 	memcpy(query_string, estate->es_sourceText, query_len + 1);
@@ -924,6 +962,7 @@ ExecParallelReinitialize(PlanState *planstate,
 	pei->finished = false;
 
 	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pg_atomic_write_u64(&fpes->processed, 0);
 
 	/* Free any serialized parameters from the last round. */
 	if (DsaPointerIsValid(fpes->param_exec))
@@ -1125,12 +1164,13 @@ ExecParallelRetrieveJitInstrumentation(PlanState *planstate,
 
 /*
  * Finish parallel execution.  We wait for parallel workers to finish, and
- * accumulate their buffer/WAL usage.
+ * accumulate their buffer/WAL usage and the number of rows they wrote.
  */
 void
 ExecParallelFinish(ParallelExecutorInfo *pei)
 {
 	int			nworkers = pei->pcxt->nworkers_launched;
+	FixedParallelExecutorState *fpes;
 	int			i;
 
 	/* Make this be a no-op if called twice in a row. */
@@ -1171,6 +1211,13 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	for (i = 0; i < nworkers; i++)
 		InstrAccumParallelQuery(&pei->buffer_usage[i], &pei->wal_usage[i]);
 
+	/*
+	 * Rows inserted by the workers themselves never pass through the Gather,
+	 * so count them here to get them into the command tag.
+	 */
+	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pei->planstate->state->es_processed += pg_atomic_read_u64(&fpes->processed);
+
 	pei->finished = true;
 }
 
@@ -1403,6 +1450,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	DestReceiver *receiver;
+	DestReceiver *into_receiver = NULL;
 	QueryDesc  *queryDesc;
 	SharedExecutorInstrumentation *instrumentation;
 	SharedJitInstrumentation *jit_instrumentation;
@@ -1421,7 +1469,26 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 		instrument_options = instrumentation->instrument_options;
 	jit_instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_JIT_INSTRUMENTATION,
 										 true);
-	queryDesc = ExecParallelGetQueryDesc(toc, receiver, instrument_options);
+
+	/*
+	 * For CREATE TABLE AS, insert our rows into the leader's new table
+	 * instead of sending them back.  The tuple queue stays attached until we
+	 * are done, which is how the leader's Gather knows when we are.
+	 */
+	if (OidIsValid(fpes->into_relid))
+		into_receiver = CreateParallelIntoRelDestReceiver(fpes->into_relid,
+														  fpes->into_options);
+	queryDesc = ExecParallelGetQueryDesc(toc,
+										 into_receiver ? into_receiver : receiver,
+										 instrument_options);
+
+	/*
+	 * Only workers running an INSERT or CREATE TABLE AS on behalf of the
+	 * leader may insert tuples; the leader checked that this is safe.
+	 */
+	if (queryDesc->plannedstmt->commandType == CMD_INSERT ||
+		OidIsValid(fpes->into_relid))
+		AllowParallelWorkerInserts();
 
 	/* Setting debug_query_string for individual workers */
 	debug_query_string = queryDesc->sourceText;
@@ -1474,6 +1541,11 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
+	/* Report the rows we wrote, if any, for the leader's command tag */
+	if (into_receiver != NULL || queryDesc->operation != CMD_SELECT)
+		pg_atomic_fetch_add_u64(&fpes->processed,
+								queryDesc->estate->es_processed);
+
 	/* Report buffer/WAL usage during parallel execution. */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
 	wal_usage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
@@ -1499,5 +1571,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Cleanup. */
 	dsa_detach(area);
 	FreeQueryDesc(queryDesc);
+	if (into_receiver != NULL)
+		into_receiver->rDestroy(into_receiver);
 	receiver->rDestroy(receiver);
 }
@@ -1778,6 +1778,12 @@ adjust_partition_colnos_using_map(List *colnos, AttrMap *attrMap)
  *		matching subplans based on performing the initial pruning steps and
  *		then must be called again each time the value of a Param listed in
  *		PartitionPruneState's 'execparamids' changes.
+ *
+ * ExecInitialPruneLeafRelids:
+ *		Performs just the initial pruning steps of a PartitionPruneInfo
+ *		outside of any plan tree and returns the range table indexes of the
+ *		leaf partitions that survive.  This lets callers such as the plan
+ *		cache avoid locking partitions that executor startup will prune.
  *-------------------------------------------------------------------------
  */
 
@@ -1844,6 +1850,86 @@ ExecInitPartitionPruning(PlanState *planstate,
 	return prunestate;
 }
 
+/*
+ * ExecInitialPruneLeafRelids
+ *		Perform initial pruning for 'pruneinfo' and return the RT indexes of
+ *		the leaf partitions whose subplans survive it
+ *
+ * 'estate' must have its range table initialized and its external params
+ * set; the partitioned tables mentioned in 'pruneinfo' must already be
+ * locked, but the leaf partitions need not be.  Leaf partitions whose
+ * subplans don't appear in any PartitionedRelPruneInfo's subplan_map (as
+ * can happen when the planner flattened some levels away) are returned as
+ * surviving whenever their subplan does, which is the safe direction.
+ */
+Bitmapset *
+ExecInitialPruneLeafRelids(EState *estate, PartitionPruneInfo *pruneinfo)
+{
+	PlanState  *planstate;
+	PartitionPruneState *prunestate;
+	Bitmapset  *validsubplans;
+	Bitmapset  *result = NULL;
+	ListCell   *lc;
+
+	/*
+	 * The pruning code wants a parent PlanState to hang its expression
+	 * context off; a bare ResultState serves the purpose.
+	 */
+	planstate = (PlanState *) makeNode(ResultState);
+	planstate->state = estate;
+	ExecAssignExprContext(estate, planstate);
+
+	prunestate = CreatePartitionPruneState(planstate, pruneinfo);
+	if (!prunestate->do_initial_prune)
+	{
+		/* Nothing can be pruned yet, so everything survives */
+		foreach(lc, pruneinfo->prune_infos)
+		{
+			ListCell   *lc2;
+
+			foreach(lc2, lfirst_node(List, lc))
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+
+				for (int i = 0; i < pinfo->nparts; i++)
+				{
+					if (pinfo->leafpart_rti_map[i] > 0)
+						result = bms_add_member(result,
+												pinfo->leafpart_rti_map[i]);
+				}
+			}
+		}
+		return result;
+	}
+
+	validsubplans = ExecFindMatchingSubPlans(prunestate, true);
+
+	/*
+	 * Map the surviving subplan indexes back to leaf partitions using the
+	 * planner's maps, which are what the subplan indexes refer to even if
+	 * the partition descriptors have changed since planning.
+	 */
+	foreach(lc, pruneinfo->prune_infos)
+	{
+		ListCell   *lc2;
+
+		foreach(lc2, lfirst_node(List, lc))
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+
+			for (int i = 0; i < pinfo->nparts; i++)
+			{
+				if (pinfo->leafpart_rti_map[i] > 0 &&
+					bms_is_member(pinfo->subplan_map[i], validsubplans))
+					result = bms_add_member(result,
+											pinfo->leafpart_rti_map[i]);
+			}
+		}
+	}
+
+	return result;
+}
+
 /*
  * CreatePartitionPruneState
  *		Build the data structure required for calling ExecFindMatchingSubPlans
@@ -118,6 +118,7 @@
 #include "executor/nodeWorktablescan.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cardfeedback.h"
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
 static TupleTableSlot *ExecProcNodeInstr(PlanState *node);
@@ -410,6 +411,14 @@ ExecInitNode(Plan *node, EState *estate, int eflags)
 	if (estate->es_instrument)
 		result->instrument = InstrAlloc(1, estate->es_instrument,
 										result->async_capable);
+	else if (cardinality_feedback &&
+			 !(estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY) &&
+			 CardinalityFeedbackScan(node))
+	{
+		/* count the scan's rows for cardinality feedback */
+		result->instrument = InstrAlloc(1, INSTRUMENT_ROWS,
+										result->async_capable);
+	}
 
 	return result;
 }
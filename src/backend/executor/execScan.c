@@ -176,8 +176,13 @@ ExecScan(ScanState *node,
 	 */
 	if (!qual && !projInfo)
 	{
+		TupleTableSlot *slot;
+
 		ResetExprContext(econtext);
-		return ExecScanFetch(node, accessMtd, recheckMtd);
+		slot = ExecScanFetch(node, accessMtd, recheckMtd);
+		if (TupIsNull(slot))
+			node->ss_ScanDone = true;
+		return slot;
 	}
 
 	/*
@@ -204,6 +209,7 @@ ExecScan(ScanState *node,
 		 */
 		if (TupIsNull(slot))
 		{
+			node->ss_ScanDone = true;
 			if (projInfo)
 				return ExecClearTuple(projInfo->pi_state.resultslot);
 			else
@@ -303,6 +309,7 @@ ExecScanReScan(ScanState *node)
 	 * can tell that this plan node is not positioned on a tuple.
 	 */
 	ExecClearTuple(node->ss_ScanTupleSlot);
+	node->ss_ScanDone = false;
 
 	/*
 	 * Rescan EvalPlanQual tuple(s) if we're inside an EvalPlanQual recheck.
@@ -158,6 +158,8 @@ CreateExecutorState(void)
 	estate->es_sourceText = NULL;
 
 	estate->es_use_parallel_mode = false;
+	estate->es_parallel_into_relid = InvalidOid;
+	estate->es_parallel_into_options = 0;
 
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
@@ -781,10 +783,18 @@ ExecGetRangeTableRelation(EState *estate, Index rti)
 			 * Assert inside table_open that insists on holding some lock, it
 			 * seems sufficient to check this only when rellockmode is higher
 			 * than the minimum.
+			 *
+			 * The plan cache leaves the leaf partitions that initial pruning
+			 * removes unlocked, but it only does that when our own initial
+			 * pruning is bound to remove them too, so we never get here for
+			 * one of those.  Check that for any lock mode.
 			 */
 			rel = table_open(rte->relid, NoLock);
 			Assert(rte->rellockmode == AccessShareLock ||
 				   CheckRelationLockedByMe(rel, rte->rellockmode, false));
+			Assert(estate->es_plannedstmt == NULL ||
+				   !bms_is_member(rti, estate->es_plannedstmt->prunableRelids) ||
+				   CheckRelationLockedByMe(rel, rte->rellockmode, true));
 		}
 		else
 		{
@@ -226,6 +226,19 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Partial Aggregation Bypass
+ *
+ *	  A partial aggregation step (for instance, in each worker of a parallel
+ *	  aggregate) exists only to reduce the number of rows that the finalizing
+ *	  step has to combine; it's fine for it to emit several partial states for
+ *	  the same group.  So when the hash table of an initial-phase partial
+ *	  aggregation reaches its memory limit before having achieved much
+ *	  reduction of its input, we don't spill.  Instead we emit the groups
+ *	  collected so far and pass each remaining input tuple through as a
+ *	  partial state of its own, since spilling the input of a grouping that
+ *	  has nearly as many groups as rows would mostly buy disk I/O (see
+ *	  hash_agg_bypass_useful()).
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -319,6 +332,13 @@
  */
 #define CHUNKHDRSZ 16
 
+/*
+ * A partial aggregation whose hash table fills up while holding at least this
+ * many groups per input tuple read is not worth continuing; see
+ * hash_agg_bypass_useful().
+ */
+#define HASHAGG_BYPASS_GROUP_RATIO 0.5
+
 /*
  * Represents partitioned spill data for a single hashtable. Contains the
  * necessary information to route tuples to the correct partition, and to
@@ -420,7 +440,9 @@ static void agg_fill_hash_table(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_hash_bypass(AggState *aggstate);
 static void hash_agg_check_limits(AggState *aggstate);
+static bool hash_agg_bypass_useful(AggState *aggstate);
 static void hash_agg_enter_spill_mode(AggState *aggstate);
 static void hash_agg_update_metrics(AggState *aggstate, bool from_tape,
 									int npartitions);
@@ -1849,8 +1871,9 @@ hash_agg_set_limits(double hashentrysize, double input_groups, int used_bits,
  * hash_agg_check_limits
  *
  * After adding a new group to the hash table, check whether we need to enter
- * spill mode. Allocations may happen without adding new groups (for instance,
- * if the transition state size grows), so this check is imperfect.
+ * spill mode, or to stop grouping altogether (see hash_agg_bypass_useful()).
+ * Allocations may happen without adding new groups (for instance, if the
+ * transition state size grows), so this check is imperfect.
  */
 static void
 hash_agg_check_limits(AggState *aggstate)
@@ -1869,10 +1892,46 @@ hash_agg_check_limits(AggState *aggstate)
 		(meta_mem + hashkey_mem > aggstate->hash_mem_limit ||
 		 ngroups > aggstate->hash_ngroups_limit))
 	{
-		hash_agg_enter_spill_mode(aggstate);
+		if (hash_agg_bypass_useful(aggstate))
+			aggstate->hash_bypass = true;
+		else
+			hash_agg_enter_spill_mode(aggstate);
 	}
 }
 
+/*
+ * hash_agg_bypass_useful
+ *
+ * Called when the hash table has reached its limits, to decide whether we
+ * should stop grouping the remaining input rather than spilling it.
+ *
+ * That's only allowed when the output goes to a finalizing aggregation step
+ * that combines partial states, and only while reading the outer plan for the
+ * first time with nothing spilled yet.  We also confine ourselves to the
+ * plain single-hash-table case, so that passing a tuple through doesn't need
+ * to consider grouping sets.
+ */
+static bool
+hash_agg_bypass_useful(AggState *aggstate)
+{
+	if (aggstate->aggstrategy != AGG_HASHED || aggstate->num_hashes != 1)
+		return false;
+	if (!DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit) ||
+		DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		return false;
+	if (aggstate->table_filled || aggstate->hash_ever_spilled)
+		return false;
+
+	/*
+	 * If most input tuples so far have started a group of their own, the
+	 * rest of the input likely will too, and spilling it would just move
+	 * about the same number of rows through a temp file before emitting
+	 * them.
+	 */
+	return aggstate->hash_ngroups_current >=
+		aggstate->hash_input_tuples * HASHAGG_BYPASS_GROUP_RATIO;
+}
+
 /*
  * Enter "spill mode", meaning that no new groups are added to any of the hash
  * tables. Tuples that would create a new group are instead spilled, and
@@ -2554,6 +2613,7 @@ agg_fill_hash_table(AggState *aggstate)
 
 		/* set up for lookup_hash_entries and advance_aggregates */
 		tmpcontext->ecxt_outertuple = outerslot;
+		aggstate->hash_input_tuples++;
 
 		/* Find or build hashtable entries */
 		lookup_hash_entries(aggstate);
@@ -2566,6 +2626,13 @@ agg_fill_hash_table(AggState *aggstate)
 		 * hash lookups do this too
 		 */
 		ResetExprContext(aggstate->tmpcontext);
+
+		/*
+		 * If we decided to stop grouping, emit what we have so far; the rest
+		 * of the input is passed through by agg_retrieve_hash_bypass().
+		 */
+		if (aggstate->hash_bypass)
+			break;
 	}
 
 	/* finalize spills, if any */
@@ -2749,9 +2816,29 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 	while (result == NULL)
 	{
+		if (aggstate->hash_bypass && aggstate->hash_ngroups_current == 0)
+		{
+			result = agg_retrieve_hash_bypass(aggstate);
+			if (result == NULL)
+				aggstate->agg_done = true;
+			break;
+		}
+
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
+			if (aggstate->hash_bypass)
+			{
+				/*
+				 * All groups collected before we stopped grouping have been
+				 * emitted, so the hash table can go; its memory is reused for
+				 * the transition states of the passed-through tuples.
+				 */
+				ResetTupleHashTable(aggstate->perhash[0].hashtable);
+				aggstate->hash_ngroups_current = 0;
+				continue;
+			}
+
 			if (!agg_refill_hash_table(aggstate))
 			{
 				aggstate->agg_done = true;
@@ -2884,6 +2971,73 @@ agg_retrieve_hash_table_in_memory(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * Pass the remaining input tuples through as partial aggregation results of
+ * their own, after we have given up on grouping them.
+ *
+ * Each tuple gets freshly initialized transition states, which are advanced
+ * once and then finalized (that is, serialized if needed) just like a group
+ * from the hash table would be.  The transition values live in hashcontext,
+ * which is reset for every tuple, so the result is only valid until the next
+ * call.
+ */
+static TupleTableSlot *
+agg_retrieve_hash_bypass(AggState *aggstate)
+{
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	AggStatePerGroup pergroup;
+	TupleTableSlot *outerslot;
+	TupleTableSlot *result;
+
+	Assert(aggstate->num_hashes == 1);
+
+	if (aggstate->hash_bypass_pergroup == NULL && aggstate->numtrans > 0)
+		aggstate->hash_bypass_pergroup = (AggStatePerGroup)
+			MemoryContextAlloc(aggstate->ss.ps.state->es_query_cxt,
+							   sizeof(AggStatePerGroupData) * aggstate->numtrans);
+	pergroup = aggstate->hash_bypass_pergroup;
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		outerslot = fetch_input_tuple(aggstate);
+		if (TupIsNull(outerslot))
+			return NULL;
+
+		/* Release the previous tuple's output and transition values */
+		ResetExprContext(econtext);
+		ReScanExprContext(aggstate->hashcontext);
+
+		select_current_set(aggstate, 0, true);
+		for (int transno = 0; transno < aggstate->numtrans; transno++)
+			initialize_aggregate(aggstate, &aggstate->pertrans[transno],
+								 &pergroup[transno]);
+		aggstate->hash_pergroup[0] = pergroup;
+
+		tmpcontext->ecxt_outertuple = outerslot;
+		advance_aggregates(aggstate);
+		ResetExprContext(tmpcontext);
+
+		aggstate->hash_bypass_tuples++;
+
+		/*
+		 * With a single hash table, the input tuple has every grouping column
+		 * we need, so it can serve as the representative tuple directly.
+		 */
+		econtext->ecxt_outertuple = outerslot;
+
+		prepare_projection_slot(aggstate, outerslot, 0);
+
+		finalize_aggregates(aggstate, aggstate->peragg, pergroup);
+
+		result = project_aggregates(aggstate);
+		if (result)
+			return result;
+	}
+}
+
 /*
  * hashagg_spill_init
  *
@@ -4322,6 +4476,7 @@ ExecEndAgg(AggState *node)
 		si->hash_batches_used = node->hash_batches_used;
 		si->hash_disk_used = node->hash_disk_used;
 		si->hash_mem_peak = node->hash_mem_peak;
+		si->hash_bypass_tuples = node->hash_bypass_tuples;
 	}
 
 	/* Make sure we have closed any open tuplesorts */
@@ -4391,6 +4546,7 @@ ExecReScanAgg(AggState *node)
 		 * again.
 		 */
 		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+			!node->hash_bypass &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4452,6 +4608,8 @@ ExecReScanAgg(AggState *node)
 		node->hash_ever_spilled = false;
 		node->hash_spill_mode = false;
 		node->hash_ngroups_current = 0;
+		node->hash_input_tuples = 0;
+		node->hash_bypass = false;
 
 		ReScanExprContext(node->hashcontext);
 		/* Rebuild an empty hash table */
@@ -35,11 +35,13 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
 #include "utils/dynahash.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/datum.h"
 #include "utils/syscache.h"
 #include "utils/wait_event.h"
 
@@ -79,6 +81,12 @@ static bool ExecParallelHashTuplePrealloc(HashJoinTable hashtable,
 										  size_t size);
 static void ExecParallelHashMergeCounters(HashJoinTable hashtable);
 static void ExecParallelHashCloseBatchAccessors(HashJoinTable hashtable);
+static void ExecHashResetKeyRange(HashState *node);
+static void ExecHashAccumKeyRange(HashState *node, ExprContext *econtext);
+static void ExecHashSetKeyRangeValue(HashState *node, Datum *dest,
+									 Datum value);
+static void ExecParallelHashMergeKeyRange(HashState *node);
+static void ExecHashPublishKeyRange(HashState *node);
 
 
 /* ----------------------------------------------------------------
@@ -108,11 +116,17 @@ MultiExecHash(HashState *node)
 	if (node->ps.instrument)
 		InstrStartNode(node->ps.instrument);
 
+	if (node->prunekey != NULL)
+		ExecHashResetKeyRange(node);
+
 	if (node->parallel_state != NULL)
 		MultiExecParallelHash(node);
 	else
 		MultiExecPrivateHash(node);
 
+	if (node->prunekey != NULL)
+		ExecHashPublishKeyRange(node);
+
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
 		InstrStopNode(node->ps.instrument, node->hashtable->partialTuples);
@@ -187,6 +201,9 @@ MultiExecPrivateHash(HashState *node)
 				ExecHashTableInsert(hashtable, slot, hashvalue);
 			}
 			hashtable->totalTuples += 1;
+
+			if (node->prunekey != NULL)
+				ExecHashAccumKeyRange(node, econtext);
 		}
 	}
 
@@ -286,7 +303,11 @@ MultiExecParallelHash(HashState *node)
 				if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
 										 false, hashtable->keepNulls,
 										 &hashvalue))
+				{
 					ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+					if (node->prunekey != NULL)
+						ExecHashAccumKeyRange(node, econtext);
+				}
 				hashtable->partialTuples++;
 			}
 
@@ -302,6 +323,8 @@ MultiExecParallelHash(HashState *node)
 			 * to control the empty table optimization.
 			 */
 			ExecParallelHashMergeCounters(hashtable);
+			if (node->prunekey != NULL)
+				ExecParallelHashMergeKeyRange(node);
 
 			BarrierDetach(&pstate->grow_buckets_barrier);
 			BarrierDetach(&pstate->grow_batches_barrier);
@@ -333,6 +356,14 @@ MultiExecParallelHash(HashState *node)
 	hashtable->log2_nbuckets = my_log2(hashtable->nbuckets);
 	hashtable->totalTuples = pstate->total_tuples;
 
+	/* Likewise, we all use the join key range found by everyone. */
+	if (node->prunekey != NULL)
+	{
+		node->prunehaverange = pstate->keyrange_valid;
+		node->prunemin = pstate->keyrange_min;
+		node->prunemax = pstate->keyrange_max;
+	}
+
 	/*
 	 * Unless we're completely done and the batch state has been freed, make
 	 * sure we have accessors.
@@ -400,6 +431,32 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->hashkeys =
 		ExecInitExprList(node->hashkeys, (PlanState *) hashstate);
 
+	/*
+	 * If the planner asked us to publish the range of a join key, prepare to
+	 * track it.
+	 */
+	if (node->pruneKey != NULL)
+	{
+		SortSupport sortkey;
+
+		hashstate->prunekey = ExecInitExpr(node->pruneKey,
+										   (PlanState *) hashstate);
+
+		sortkey = (SortSupport) palloc0(sizeof(SortSupportData));
+		sortkey->ssup_cxt = CurrentMemoryContext;
+		sortkey->ssup_collation = node->pruneCollation;
+		sortkey->ssup_nulls_first = false;
+		PrepareSortSupportFromOrderingOp(node->pruneSortOp, sortkey);
+		hashstate->prunesortkey = sortkey;
+
+		get_typlenbyval(exprType((Node *) node->pruneKey),
+						&hashstate->prunetyplen, &hashstate->prunetypbyval);
+		hashstate->prunehaverange = false;
+		hashstate->pruneparams = bms_make_singleton(node->pruneParamMin);
+		hashstate->pruneparams = bms_add_member(hashstate->pruneparams,
+												node->pruneParamMax);
+	}
+
 	return hashstate;
 }
 
@@ -617,6 +674,7 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 			pstate->nbatch = nbatch;
 			pstate->space_allowed = space_allowed;
 			pstate->growth = PHJ_GROWTH_OK;
+			pstate->keyrange_valid = false;
 
 			/* Set up the shared state for coordinating batches. */
 			ExecParallelHashJoinSetUpBatches(hashtable, nbatch);
@@ -1460,6 +1518,129 @@ ExecParallelHashMergeCounters(HashJoinTable hashtable)
 	LWLockRelease(&pstate->lock);
 }
 
+/*
+ * ExecHashResetKeyRange
+ *		Forget the join key range of a previous build of the hash table.
+ */
+static void
+ExecHashResetKeyRange(HashState *node)
+{
+	if (node->prunehaverange && !node->prunetypbyval)
+	{
+		pfree(DatumGetPointer(node->prunemin));
+		pfree(DatumGetPointer(node->prunemax));
+	}
+	node->prunehaverange = false;
+}
+
+/*
+ * ExecHashAccumKeyRange
+ *		Widen the join key range to include the key of the inner tuple that
+ *		was just inserted into the hash table.
+ *
+ * The tuple is in econtext's outer tuple slot.  Null keys are ignored, since
+ * they can't match any outer tuple.
+ */
+static void
+ExecHashAccumKeyRange(HashState *node, ExprContext *econtext)
+{
+	Datum		value;
+	bool		isnull;
+
+	value = ExecEvalExprSwitchContext(node->prunekey, econtext, &isnull);
+	if (isnull)
+		return;
+
+	if (!node->prunehaverange ||
+		ApplySortComparator(value, false,
+							node->prunemin, false,
+							node->prunesortkey) < 0)
+		ExecHashSetKeyRangeValue(node, &node->prunemin, value);
+	if (!node->prunehaverange ||
+		ApplySortComparator(value, false,
+							node->prunemax, false,
+							node->prunesortkey) > 0)
+		ExecHashSetKeyRangeValue(node, &node->prunemax, value);
+	node->prunehaverange = true;
+}
+
+/*
+ * ExecHashSetKeyRangeValue
+ *		Replace one end of the join key range with a copy of 'value'.
+ */
+static void
+ExecHashSetKeyRangeValue(HashState *node, Datum *dest, Datum value)
+{
+	if (!node->prunetypbyval)
+	{
+		MemoryContext oldcxt;
+
+		if (node->prunehaverange)
+			pfree(DatumGetPointer(*dest));
+		oldcxt = MemoryContextSwitchTo(node->ps.state->es_query_cxt);
+		value = datumCopy(value, false, node->prunetyplen);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	*dest = value;
+}
+
+/*
+ * ExecParallelHashMergeKeyRange
+ *		Fold the join key range this participant saw into the shared range.
+ *
+ * The planner only asks a Parallel Hash for the range of pass-by-value keys,
+ * so the values can be stored directly in shared memory.
+ */
+static void
+ExecParallelHashMergeKeyRange(HashState *node)
+{
+	ParallelHashJoinState *pstate = node->hashtable->parallel_state;
+
+	Assert(node->prunetypbyval);
+
+	if (!node->prunehaverange)
+		return;
+
+	LWLockAcquire(&pstate->lock, LW_EXCLUSIVE);
+	if (!pstate->keyrange_valid ||
+		ApplySortComparator(node->prunemin, false,
+							pstate->keyrange_min, false,
+							node->prunesortkey) < 0)
+		pstate->keyrange_min = node->prunemin;
+	if (!pstate->keyrange_valid ||
+		ApplySortComparator(node->prunemax, false,
+							pstate->keyrange_max, false,
+							node->prunesortkey) > 0)
+		pstate->keyrange_max = node->prunemax;
+	pstate->keyrange_valid = true;
+	LWLockRelease(&pstate->lock);
+}
+
+/*
+ * ExecHashPublishKeyRange
+ *		Store the join key range in the params the planner set aside for it.
+ *
+ * The outer plan of our HashJoin prunes its partitions with the quals
+ * "key >= $min AND key <= $max".  If no non-null key was seen no outer tuple
+ * can find a match, so we set the params to NULL, which prunes all of them.
+ */
+static void
+ExecHashPublishKeyRange(HashState *node)
+{
+	Hash	   *plan = (Hash *) node->ps.plan;
+	ParamExecData *prm;
+
+	prm = &node->ps.state->es_param_exec_vals[plan->pruneParamMin];
+	prm->execPlan = NULL;
+	prm->value = node->prunehaverange ? node->prunemin : (Datum) 0;
+	prm->isnull = !node->prunehaverange;
+
+	prm = &node->ps.state->es_param_exec_vals[plan->pruneParamMax];
+	prm->execPlan = NULL;
+	prm->value = node->prunehaverange ? node->prunemax : (Datum) 0;
+	prm->isnull = !node->prunehaverange;
+}
+
 /*
  * ExecHashIncreaseNumBuckets
  *		increase the original number of buckets in order to reduce
@@ -292,6 +292,10 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				 * The only way to make the check is to try to fetch a tuple
 				 * from the outer plan node.  If we succeed, we have to stash
 				 * it away for later consumption by ExecHashJoinOuterGetTuple.
+				 *
+				 * Nor do we try it if the Hash node publishes its join key
+				 * range for pruning the outer plan's partitions, since the
+				 * outer plan must not start before the range is known.
 				 */
 				if (HJ_FILL_INNER(node))
 				{
@@ -312,7 +316,8 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
-						  !node->hj_OuterNotEmpty))
+						  !node->hj_OuterNotEmpty &&
+						  hashNode->pruneparams == NULL))
 				{
 					node->hj_FirstOuterTupleSlot = ExecProcNode(outerNode);
 					if (TupIsNull(node->hj_FirstOuterTupleSlot))
@@ -345,6 +350,21 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
 
+				/*
+				 * If the Hash node published a join key range and the outer
+				 * plan may already have pruned its partitions using the range
+				 * from an earlier scan, make it prune again before we fetch
+				 * from it.
+				 */
+				if (hashNode->pruneparams != NULL)
+				{
+					if (node->hj_KeyRangePublished)
+						outerNode->chgParam =
+							bms_add_members(outerNode->chgParam,
+											hashNode->pruneparams);
+					node->hj_KeyRangePublished = true;
+				}
+
 				/*
 				 * If the inner relation is completely empty, and we're not
 				 * doing a left outer join, we can quit without scanning the
@@ -845,6 +865,7 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_JoinState = HJ_BUILD_HASHTABLE;
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
+	hjstate->hj_KeyRangePublished = false;
 
 	return hjstate;
 }
@@ -1585,6 +1606,7 @@ ExecHashJoinInitializeDSM(HashJoinState *state, ParallelContext *pcxt)
 	pg_atomic_init_u32(&pstate->distributor, 0);
 	pstate->nparticipants = pcxt->nworkers + 1;
 	pstate->total_tuples = 0;
+	pstate->keyrange_valid = false;
 	LWLockInitialize(&pstate->lock,
 					 LWTRANCHE_PARALLEL_HASH_JOIN);
 	BarrierInit(&pstate->build_barrier, 0);
@@ -100,6 +100,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
+		node->ioss_ScanDesc->xs_want_skip =
+			((IndexOnlyScan *) node->ss.ps.plan)->indexskip;
 		node->ioss_VMBuffer = InvalidBuffer;
 
 		/*
@@ -114,6 +116,16 @@ IndexOnlyNext(IndexOnlyScanState *node)
 						 node->ioss_NumOrderByKeys);
 	}
 
+	/*
+	 * When skipping, the caller only wants the tuple we returned last time
+	 * out of its group, so move on to the next value of the leading column.
+	 */
+	if (node->ioss_SkipPending)
+	{
+		node->ioss_SkipPending = false;
+		index_skip(scandesc, direction);
+	}
+
 	/*
 	 * OK, now that we have what we need, fetch the next tuple.
 	 */
@@ -247,6 +259,10 @@ IndexOnlyNext(IndexOnlyScanState *node)
 							  ItemPointerGetBlockNumber(tid),
 							  estate->es_snapshot);
 
+		/* Skipping plans have no quals, so this tuple will be returned */
+		if (((IndexOnlyScan *) node->ss.ps.plan)->indexskip)
+			node->ioss_SkipPending = true;
+
 		return slot;
 	}
 
@@ -385,6 +401,7 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 		index_rescan(node->ioss_ScanDesc,
 					 node->ioss_ScanKeys, node->ioss_NumScanKeys,
 					 node->ioss_OrderByKeys, node->ioss_NumOrderByKeys);
+	node->ioss_SkipPending = false;
 
 	ExecScanReScan(&node->ss);
 }
@@ -113,6 +113,7 @@ IndexNext(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		scandesc->xs_want_skip = ((IndexScan *) node->ss.ps.plan)->indexskip;
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -124,6 +125,16 @@ IndexNext(IndexScanState *node)
 						 node->iss_OrderByKeys, node->iss_NumOrderByKeys);
 	}
 
+	/*
+	 * When skipping, the caller only wants the tuple we returned last time
+	 * out of its group, so move on to the next value of the leading column.
+	 */
+	if (node->iss_SkipPending)
+	{
+		node->iss_SkipPending = false;
+		index_skip(scandesc, direction);
+	}
+
 	/*
 	 * ok, now that we have what we need, fetch the next tuple.
 	 */
@@ -146,6 +157,10 @@ IndexNext(IndexScanState *node)
 			}
 		}
 
+		/* Skipping plans have no quals, so this tuple will be returned */
+		if (((IndexScan *) node->ss.ps.plan)->indexskip)
+			node->iss_SkipPending = true;
+
 		return slot;
 	}
 
@@ -586,6 +601,7 @@ ExecReScanIndexScan(IndexScanState *node)
 					 node->iss_ScanKeys, node->iss_NumScanKeys,
 					 node->iss_OrderByKeys, node->iss_NumOrderByKeys);
 	node->iss_ReachedEnd = false;
+	node->iss_SkipPending = false;
 
 	ExecScanReScan(&node->ss);
 }
@@ -50,6 +50,27 @@
  * demanding, then that may allow us to start putting useful entries back into
  * the cache again.
  *
+ * Plain LRU eviction performs poorly when the parameter values are skewed: a
+ * stream of values that are seen only once keeps pushing the few frequently
+ * seen values out of the cache.  To protect against this, we keep a small
+ * count-min sketch of how often each cache key has been looked up, with the
+ * counters periodically halved so that old history fades away.  Once the
+ * cache is full, a new entry is only admitted if its key has been seen at
+ * least as often as the key of the entry that would be evicted to make room
+ * for it (this is the TinyLFU admission policy).  Scans whose key was not
+ * admitted run in MEMO_CACHE_BYPASS_MODE.  As ties are admitted, when there
+ * is no frequency information to go on we still behave like an LRU cache.
+ * The sketch comes out of the cache's memory budget, and is made narrower
+ * rather than take more than a small part of it.
+ *
+ * Even so, when almost no lookups find anything in the cache we're just
+ * wasting effort maintaining it.  We therefore track the hit ratio over
+ * windows of MEMO_HIT_RATIO_WINDOW lookups, and when it falls below
+ * MEMO_BYPASS_HIT_RATIO we perform the next MEMO_BYPASS_RESCANS rescans in
+ * bypass mode without consulting the cache at all.  Afterwards we start
+ * looking up the cache again, in case the parameter values have become more
+ * repetitive.  The cache's contents are kept meanwhile.
+ *
  *
  * INTERFACE ROUTINES
  *		ExecMemoize			- lookup cache, exec subplan when not found
@@ -82,6 +103,20 @@
 										 * subplan without caching anything */
 #define MEMO_END_OF_SCAN			5	/* Ready for rescan */
 
+/* Frequency sketch parameters for cache admission */
+#define MEMO_SKETCH_DEPTH			4	/* number of counter rows */
+#define MEMO_SKETCH_MIN_WIDTH		256 /* min counters per row */
+#define MEMO_SKETCH_MAX_WIDTH		65536	/* max counters per row */
+#define MEMO_SKETCH_MAX_COUNT		15	/* counters saturate at this value */
+#define MEMO_SKETCH_SAMPLE_FACTOR	10	/* halve counters after this many
+										 * increments per counter per row */
+#define MEMO_SKETCH_MEM_FRACTION	16	/* use at most 1/16 of mem_limit */
+
+/* Hit ratio tracking for bypassing an ineffective cache */
+#define MEMO_HIT_RATIO_WINDOW		1024	/* lookups per window */
+#define MEMO_BYPASS_HIT_RATIO		0.01	/* bypass when below this */
+#define MEMO_BYPASS_RESCANS			(MEMO_HIT_RATIO_WINDOW * 8)
+
 
 /* Helper macros for memory accounting */
 #define EMPTY_ENTRY_MEMORY_BYTES(e)		(sizeof(MemoizeEntry) + \
@@ -106,6 +141,7 @@ typedef struct MemoizeKey
 {
 	MinimalTuple params;
 	dlist_node	lru_node;		/* Pointer to next/prev key in LRU list */
+	uint32		hash;			/* Hash value, for the frequency sketch */
 } MemoizeKey;
 
 /*
@@ -292,6 +328,129 @@ build_hash_table(MemoizeState *mstate, uint32 size)
 	mstate->hashtable = memoize_create(mstate->tableContext, size, mstate);
 }
 
+/*
+ * freq_sketch_create
+ *		Allocate a zeroed frequency sketch for a cache expected to hold
+ *		'est_entries' entries, and take its size off mstate->mem_limit.
+ */
+static void
+freq_sketch_create(MemoizeState *mstate, uint32 est_entries)
+{
+	uint32		width;
+	Size		size;
+
+	if (est_entries == 0)
+		est_entries = 1024;
+
+	width = Max(est_entries, MEMO_SKETCH_MIN_WIDTH);
+	width = Min(width, MEMO_SKETCH_MAX_WIDTH);
+	width = pg_nextpower2_32(width);
+
+	/* Don't let the sketch crowd out the cache entries */
+	while (width > MEMO_SKETCH_MIN_WIDTH &&
+		   (Size) width * MEMO_SKETCH_DEPTH >
+		   mstate->mem_limit / MEMO_SKETCH_MEM_FRACTION)
+		width /= 2;
+
+	size = sizeof(uint8) * width * MEMO_SKETCH_DEPTH;
+	mstate->freq_sketch = (uint8 *) palloc0(size);
+	mstate->mem_limit -= size;
+	mstate->freq_sketch_mask = width - 1;
+	mstate->freq_sketch_additions = 0;
+}
+
+/*
+ * freq_sketch_counter
+ *		Return the counter for 'hash' in the given row of the sketch.
+ *
+ * The counter positions for each row are derived from the hash value by
+ * double hashing.
+ */
+static inline uint8 *
+freq_sketch_counter(MemoizeState *mstate, uint32 hash, int row)
+{
+	uint32		h2 = pg_rotate_right32(hash, 16) | 1;
+	uint32		col = (hash + row * h2) & mstate->freq_sketch_mask;
+
+	return &mstate->freq_sketch[row * (mstate->freq_sketch_mask + 1) + col];
+}
+
+/*
+ * freq_sketch_estimate
+ *		Estimate how many times a key with the given hash value was seen.
+ */
+static uint8
+freq_sketch_estimate(MemoizeState *mstate, uint32 hash)
+{
+	uint8		count = MEMO_SKETCH_MAX_COUNT;
+
+	for (int row = 0; row < MEMO_SKETCH_DEPTH; row++)
+		count = Min(count, *freq_sketch_counter(mstate, hash, row));
+
+	return count;
+}
+
+/*
+ * freq_sketch_increment
+ *		Record another lookup of a key with the given hash value.
+ *
+ * Once enough lookups have been recorded, all counters are halved so that
+ * the sketch favors recent history.
+ */
+static void
+freq_sketch_increment(MemoizeState *mstate, uint32 hash)
+{
+	uint64		width = (uint64) mstate->freq_sketch_mask + 1;
+	uint8		count = freq_sketch_estimate(mstate, hash);
+
+	/* Only bump the counters that hold the minimum ("conservative update") */
+	if (count < MEMO_SKETCH_MAX_COUNT)
+	{
+		for (int row = 0; row < MEMO_SKETCH_DEPTH; row++)
+		{
+			uint8	   *counter = freq_sketch_counter(mstate, hash, row);
+
+			if (*counter == count)
+				(*counter)++;
+		}
+	}
+
+	if (++mstate->freq_sketch_additions >= width * MEMO_SKETCH_SAMPLE_FACTOR)
+	{
+		for (uint64 i = 0; i < width * MEMO_SKETCH_DEPTH; i++)
+			mstate->freq_sketch[i] >>= 1;
+		mstate->freq_sketch_additions /= 2;
+	}
+}
+
+/*
+ * cache_admit
+ *		Decide if a new entry for a key with the given hash value should be
+ *		added to the cache.
+ *
+ * While there's room in the cache, we always admit new entries.  Otherwise,
+ * the new entry would displace at least the least recently used entry, so we
+ * only admit it if its key has been seen at least as often.
+ */
+static bool
+cache_admit(MemoizeState *mstate, uint32 hash)
+{
+	MemoizeKey *victim;
+	uint64		avg_entry_mem;
+
+	/* No need for admission control unless the cache is close to full */
+	if (mstate->hashtable->members == 0)
+		return true;
+	avg_entry_mem = mstate->mem_used / mstate->hashtable->members;
+	if (mstate->mem_used + avg_entry_mem <= mstate->mem_limit)
+		return true;
+
+	victim = dlist_head_element(MemoizeKey, lru_node, &mstate->lru_list);
+
+	return freq_sketch_estimate(mstate, hash) >=
+		freq_sketch_estimate(mstate, victim->hash);
+}
+
 /*
  * prepare_probe_slot
  *		Populate mstate's probeslot with the values from the tuple stored
@@ -517,15 +676,17 @@ cache_reduce_memory(MemoizeState *mstate, MemoizeKey *specialkey)
  *		Perform a lookup to see if we've already cached tuples based on the
  *		scan's current parameters.  If we find an existing entry we move it to
  *		the end of the LRU list, set *found to true then return it.  If we
- *		don't find an entry then we create a new one and add it to the end of
- *		the LRU list.  We also update cache memory accounting and remove older
- *		entries if we go over the memory budget.  If we managed to free enough
- *		memory we return the new entry, else we return NULL.
+ *		don't find an entry then, if the admission policy allows it, we
+ *		create a new one and add it to the end of the LRU list.  We also
+ *		update cache memory accounting and remove older entries if we go over
+ *		the memory budget.  If we managed to free enough memory we return the
+ *		new entry, else we return NULL.  If the new entry was not admitted, we
+ *		return NULL and set *admitted to false.
  *
  * Callers can assume we'll never return NULL when *found is true.
  */
 static MemoizeEntry *
-cache_lookup(MemoizeState *mstate, bool *found)
+cache_lookup(MemoizeState *mstate, bool *found, bool *admitted)
 {
 	MemoizeKey *key;
 	MemoizeEntry *entry;
@@ -540,6 +701,9 @@ cache_lookup(MemoizeState *mstate, bool *found)
 	 */
 	entry = memoize_insert(mstate->hashtable, NULL, found);
 
+	freq_sketch_increment(mstate, entry->hash);
+	*admitted = true;
+
 	if (*found)
 	{
 		/*
@@ -551,11 +715,23 @@ cache_lookup(MemoizeState *mstate, bool *found)
 		return entry;
 	}
 
+	if (!cache_admit(mstate, entry->hash))
+	{
+		/*
+		 * Remove the entry we've just inserted.  Its key was not set yet, but
+		 * that's fine as deleting an item only looks at its hash value.
+		 */
+		memoize_delete_item(mstate->hashtable, entry);
+		*admitted = false;
+		return NULL;
+	}
+
 	oldcontext = MemoryContextSwitchTo(mstate->tableContext);
 
 	/* Allocate a new key */
 	entry->key = key = (MemoizeKey *) palloc(sizeof(MemoizeKey));
 	key->params = ExecCopySlotMinimalTuple(mstate->probeslot);
+	key->hash = entry->hash;
 
 	/* Update the total cache memory utilization */
 	mstate->mem_used += EMPTY_ENTRY_MEMORY_BYTES(entry);
@@ -693,6 +869,28 @@ cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * cache_track_hit_ratio
+ *		Account for a cache hit or miss in the current hit ratio window, and
+ *		start bypassing the cache if the window's hit ratio was too low.
+ */
+static inline void
+cache_track_hit_ratio(MemoizeState *mstate, bool hit)
+{
+	mstate->window_lookups++;
+	if (hit)
+		mstate->window_hits++;
+
+	if (mstate->window_lookups < MEMO_HIT_RATIO_WINDOW)
+		return;
+
+	if (mstate->window_hits < mstate->window_lookups * MEMO_BYPASS_HIT_RATIO)
+		mstate->bypass_rescans = MEMO_BYPASS_RESCANS;
+
+	mstate->window_lookups = 0;
+	mstate->window_hits = 0;
+}
+
 static TupleTableSlot *
 ExecMemoize(PlanState *pstate)
 {
@@ -716,6 +914,7 @@ ExecMemoize(PlanState *pstate)
 				MemoizeEntry *entry;
 				TupleTableSlot *outerslot;
 				bool		found;
+				bool		admitted;
 
 				Assert(node->entry == NULL);
 
@@ -737,7 +936,9 @@ ExecMemoize(PlanState *pstate)
 				 */
 
 				/* see if we've got anything cached for the current parameters */
-				entry = cache_lookup(node, &found);
+				entry = cache_lookup(node, &found, &admitted);
+
+				cache_track_hit_ratio(node, found && entry->complete);
 
 				if (found && entry->complete)
 				{
@@ -805,12 +1006,23 @@ ExecMemoize(PlanState *pstate)
 
 				node->entry = entry;
 
+				/*
+				 * If the admission policy didn't let us create an entry, then
+				 * just read the rest of this scan in bypass mode.
+				 */
+				if (!admitted)
+				{
+					node->stats.cache_rejections += 1;	/* stats update */
+
+					node->mstatus = MEMO_CACHE_BYPASS_MODE;
+				}
+
 				/*
 				 * If we failed to create the entry or failed to store the
 				 * tuple in the entry, then go into bypass mode.
 				 */
-				if (unlikely(entry == NULL ||
-							 !cache_store_tuple(node, outerslot)))
+				else if (unlikely(entry == NULL ||
+								  !cache_store_tuple(node, outerslot)))
 				{
 					node->stats.cache_overflows += 1;	/* stats update */
 
@@ -1067,6 +1279,13 @@ ExecInitMemoize(Memoize *node, EState *estate, int eflags)
 	/* Zero the statistics counters */
 	memset(&mstate->stats, 0, sizeof(MemoizeInstrumentation));
 
+	/* Set up the admission policy's frequency sketch; needs mem_limit */
+	freq_sketch_create(mstate, node->est_entries);
+
+	mstate->window_lookups = 0;
+	mstate->window_hits = 0;
+	mstate->bypass_rescans = 0;
+
 	/*
 	 * Because it may require a large allocation, we delay building of the
 	 * hash table until executor run.
@@ -1141,8 +1360,19 @@ ExecReScanMemoize(MemoizeState *node)
 {
 	PlanState  *outerPlan = outerPlanState(node);
 
-	/* Mark that we must lookup the cache for a new set of parameters */
-	node->mstatus = MEMO_CACHE_LOOKUP;
+	/*
+	 * Mark that we must lookup the cache for a new set of parameters, unless
+	 * we recently found the cache to be ineffective, in which case we bypass
+	 * it for this scan.
+	 */
+	if (node->bypass_rescans > 0)
+	{
+		node->bypass_rescans--;
+		node->stats.cache_bypasses += 1;	/* stats update */
+		node->mstatus = MEMO_CACHE_BYPASS_MODE;
+	}
+	else
+		node->mstatus = MEMO_CACHE_LOOKUP;
 
 	/* nullify pointers used for the last scan */
 	node->entry = NULL;
@@ -71,6 +71,9 @@
 #include "utils/snapmgr.h"
 
 
+/* Maximum number of rows handed to table_multi_delete() at once */
+#define MT_DELETE_BATCH_SIZE	256
+
 typedef struct MTTargetRelLookup
 {
 	Oid			relationOid;	/* hash key, must be first */
@@ -132,6 +135,11 @@ static void ExecBatchInsert(ModifyTableState *mtstate,
 							EState *estate,
 							bool canSetTag);
 static void ExecPendingInserts(EState *estate);
+static bool ExecDeleteBatchable(ResultRelInfo *resultRelInfo);
+static void ExecQueueDelete(ModifyTableContext *context,
+							ResultRelInfo *resultRelInfo,
+							ItemPointer tupleid);
+static void ExecFlushDeletes(ModifyTableContext *context);
 static void ExecCrossPartitionUpdateForeignKey(ModifyTableContext *context,
 											   ResultRelInfo *sourcePartInfo,
 											   ResultRelInfo *destPartInfo,
@@ -1718,6 +1726,94 @@ ldelete:
 	return NULL;
 }
 
+/*
+ * ExecDeleteBatchable -- can rows of this relation be deleted in batches?
+ *
+ * Batching hands the table AM a block's worth of TIDs at once, so nothing
+ * may need to look at the rows one at a time as they are deleted.  The
+ * node-level conditions are checked in ExecInitModifyTable.
+ */
+static bool
+ExecDeleteBatchable(ResultRelInfo *resultRelInfo)
+{
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	TriggerDesc *trigdesc = resultRelInfo->ri_TrigDesc;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		rel->rd_tableam->multi_delete == NULL ||
+		resultRelInfo->ri_FdwRoutine != NULL)
+		return false;
+
+	if (trigdesc &&
+		(trigdesc->trig_delete_before_row ||
+		 trigdesc->trig_delete_after_row ||
+		 trigdesc->trig_delete_instead_row))
+		return false;
+
+	return true;
+}
+
+/*
+ * ExecQueueDelete -- remember a row to be deleted by ExecFlushDeletes
+ *
+ * A batch holds rows of a single block of a single relation; queueing a row
+ * from elsewhere sends the current batch off first.
+ */
+static void
+ExecQueueDelete(ModifyTableContext *context, ResultRelInfo *resultRelInfo,
+				ItemPointer tupleid)
+{
+	ModifyTableState *mtstate = context->mtstate;
+
+	if (mtstate->mt_delete_ntids > 0 &&
+		(mtstate->mt_delete_rel != resultRelInfo ||
+		 mtstate->mt_delete_ntids >= MT_DELETE_BATCH_SIZE ||
+		 ItemPointerGetBlockNumber(tupleid) !=
+		 ItemPointerGetBlockNumber(&mtstate->mt_delete_tids[0])))
+		ExecFlushDeletes(context);
+
+	mtstate->mt_delete_rel = resultRelInfo;
+	mtstate->mt_delete_tids[mtstate->mt_delete_ntids++] = *tupleid;
+}
+
+/*
+ * ExecFlushDeletes -- delete the rows queued by ExecQueueDelete
+ *
+ * The table AM deletes what it can in one go.  Whatever it leaves behind --
+ * rows that are locked, concurrently updated, or otherwise need a closer
+ * look -- goes through ExecDelete one at a time, exactly as if batching had
+ * never been attempted.
+ */
+static void
+ExecFlushDeletes(ModifyTableContext *context)
+{
+	ModifyTableState *mtstate = context->mtstate;
+	EState	   *estate = context->estate;
+	ResultRelInfo *resultRelInfo = mtstate->mt_delete_rel;
+	int			ntids = mtstate->mt_delete_ntids;
+	bool		deleted[MT_DELETE_BATCH_SIZE];
+	int			ndeleted;
+
+	if (ntids == 0)
+		return;
+	mtstate->mt_delete_ntids = 0;
+
+	ndeleted = table_multi_delete(resultRelInfo->ri_RelationDesc,
+								  mtstate->mt_delete_tids, ntids,
+								  estate->es_output_cid, deleted);
+
+	if (mtstate->canSetTag)
+		estate->es_processed += ndeleted;
+
+	for (int i = 0; i < ntids; i++)
+	{
+		if (deleted[i])
+			continue;
+		ExecDelete(context, resultRelInfo, &mtstate->mt_delete_tids[i], NULL,
+				   true, false, mtstate->canSetTag, NULL, NULL, NULL);
+	}
+}
+
 /*
  * ExecCrossPartitionUpdate --- Move an updated tuple to another partition.
  *
@@ -4176,6 +4272,13 @@ ExecModifyTable(PlanState *pstate)
 				break;
 
 			case CMD_DELETE:
+				if (tupleid != NULL && node->mt_delete_tids != NULL &&
+					ExecDeleteBatchable(resultRelInfo))
+				{
+					ExecQueueDelete(&context, resultRelInfo, tupleid);
+					slot = NULL;
+					break;
+				}
 				slot = ExecDelete(&context, resultRelInfo, tupleid, oldtuple,
 								  true, false, node->canSetTag, NULL, NULL, NULL);
 				break;
@@ -4198,6 +4301,12 @@ ExecModifyTable(PlanState *pstate)
 			return slot;
 	}
 
+	/*
+	 * Delete remaining rows for batch delete.
+	 */
+	if (node->mt_delete_ntids > 0)
+		ExecFlushDeletes(&context);
+
 	/*
 	 * Insert remaining tuples for batch insert.
 	 */
@@ -4708,6 +4817,24 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	else
 		mtstate->mt_resultOidHash = NULL;
 
+	/*
+	 * A plain DELETE may delete its rows a block at a time, provided nothing
+	 * has to see them one by one: no RETURNING, no transition tables, and no
+	 * other relations whose rows EvalPlanQual would have to refetch from the
+	 * plan's output if a row turns out to have been concurrently updated.
+	 * Per-relation conditions are checked by ExecDeleteBatchable.
+	 */
+	mtstate->mt_delete_rel = NULL;
+	mtstate->mt_delete_tids = NULL;
+	mtstate->mt_delete_ntids = 0;
+	if (operation == CMD_DELETE &&
+		node->returningLists == NIL &&
+		mtstate->mt_transition_capture == NULL &&
+		mtstate->mt_epqstate.arowMarks == NIL &&
+		estate->es_crosscheck_snapshot == InvalidSnapshot)
+		mtstate->mt_delete_tids = (ItemPointerData *)
+			palloc(MT_DELETE_BATCH_SIZE * sizeof(ItemPointerData));
+
 	/*
 	 * Determine if the FDW supports batch insert and determine the batch size
 	 * (a FDW may support batching, but it may be disabled for the
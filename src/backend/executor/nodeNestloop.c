@@ -22,8 +22,32 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/executor.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/*
+ * If the planner gave us hashclauses, the inner side returns the same tuples
+ * on every rescan, and we may stop rescanning it once the outer side has
+ * returned many more tuples than the planner expected.  We then read the
+ * inner side one last time into a hash table, keyed on the inner sides of
+ * the hashclauses, and from then on take the candidate inner tuples for
+ * each outer tuple from there.  Everything else, including evaluating the
+ * complete join quals, proceeds as before, so the join returns the same
+ * tuples in the same order.  If the inner tuples do not fit in hash_mem,
+ * we give up and keep rescanning.
+ */
+#define NL_HASH_MIN_OUTER_TUPLES	1000
+#define NL_HASH_ESTIMATE_FACTOR		10
+
+static void ExecInitNestLoopHash(NestLoopState *nlstate, NestLoop *node,
+								 EState *estate);
+static void ExecNestLoopBuildHash(NestLoopState *node);
+static void ExecNestLoopProbeHash(NestLoopState *node);
 
 
 /* ----------------------------------------------------------------
@@ -121,6 +145,16 @@ ExecNestLoop(PlanState *pstate)
 			node->nl_NeedNewOuter = false;
 			node->nl_MatchedOuter = false;
 
+			/*
+			 * If the outer side is running far past its estimate, try
+			 * hashing the inner side rather than rescanning it again.
+			 */
+			node->nl_OuterTuples += 1;
+			if (node->nl_HashTable == NULL &&
+				node->nl_HashThreshold > 0 &&
+				node->nl_OuterTuples > node->nl_HashThreshold)
+				ExecNestLoopBuildHash(node);
+
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
 			 * inner scan, and store them in the appropriate PARAM_EXEC slots.
@@ -145,10 +179,19 @@ ExecNestLoop(PlanState *pstate)
 			}
 
 			/*
-			 * now rescan the inner plan
+			 * now rescan the inner plan, or look up the outer tuple's
+			 * matches if we've hashed it
 			 */
-			ENL1_printf("rescanning inner plan");
-			ExecReScan(innerPlan);
+			if (node->nl_HashTable != NULL)
+			{
+				ENL1_printf("probing inner hash table");
+				ExecNestLoopProbeHash(node);
+			}
+			else
+			{
+				ENL1_printf("rescanning inner plan");
+				ExecReScan(innerPlan);
+			}
 		}
 
 		/*
@@ -156,7 +199,19 @@ ExecNestLoop(PlanState *pstate)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_HashTable != NULL)
+		{
+			if (node->nl_HashMatchIdx < list_length(node->nl_HashMatches))
+				innerTupleSlot =
+					ExecStoreMinimalTuple(list_nth(node->nl_HashMatches,
+												   node->nl_HashMatchIdx++),
+										  node->nl_HashInnerSlot,
+										  false);
+			else
+				innerTupleSlot = NULL;
+		}
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -339,6 +394,10 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 				 (int) node->join.jointype);
 	}
 
+	/* set up for hashing the inner side, if the plan allows it */
+	if (node->hashclauses != NIL)
+		ExecInitNestLoopHash(nlstate, node, estate);
+
 	/*
 	 * finally, wipe the current outer tuple clean.
 	 */
@@ -393,8 +452,239 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * innerPlan is re-scanned for each new outer tuple and MUST NOT be
 	 * re-scanned from here or you'll get troubles from inner index scans when
 	 * outer Vars are used as run-time keys...
+	 *
+	 * A hash table of the inner tuples stays good unless the inner plan
+	 * depends on parameters that have changed.
 	 */
+	if (node->nl_HashTable != NULL && innerPlanState(node)->chgParam != NULL)
+	{
+		MemoryContextReset(node->nl_HashTableCxt);
+		node->nl_HashTable = NULL;
+		node->nl_HashMatches = NIL;
+	}
+	node->nl_OuterTuples = 0;
 
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
+
+/*
+ * Set up the hashing machinery for the NestLoop's hashclauses.  This is much
+ * like what nodeSubplan.c does for hashed subplans: the outer and inner
+ * sides of the clauses are projected into slots of their own, the inner
+ * ones are hashed with the inner type's hash functions and compared with
+ * its equality operator, and the outer ones are looked up using the outer
+ * type's hash functions and the (possibly cross-type) clause operators.
+ */
+static void
+ExecInitNestLoopHash(NestLoopState *nlstate, NestLoop *node, EState *estate)
+{
+	int			nkeys = list_length(node->hashclauses);
+	List	   *outertlist = NIL;
+	List	   *innertlist = NIL;
+	Oid		   *cross_eq_funcoids;
+	TupleDesc	outerdesc;
+	TupleDesc	innerdesc;
+	TupleTableSlot *slot;
+	ListCell   *lc;
+	int			i;
+
+	nlstate->nl_NumHashKeys = nkeys;
+	nlstate->nl_HashKeyColIdx = (AttrNumber *) palloc(nkeys * sizeof(AttrNumber));
+	nlstate->nl_HashEqFuncOids = (Oid *) palloc(nkeys * sizeof(Oid));
+	nlstate->nl_HashCollations = (Oid *) palloc(nkeys * sizeof(Oid));
+	nlstate->nl_InnerHashFunctions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	nlstate->nl_OuterHashFunctions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	cross_eq_funcoids = (Oid *) palloc(nkeys * sizeof(Oid));
+
+	i = 0;
+	foreach(lc, node->hashclauses)
+	{
+		OpExpr	   *opexpr = lfirst_node(OpExpr, lc);
+		Oid			inner_eq_oper;
+		Oid			outer_hashfn;
+		Oid			inner_hashfn;
+
+		Assert(list_length(opexpr->args) == 2);
+
+		outertlist = lappend(outertlist,
+							 makeTargetEntry(linitial(opexpr->args),
+											 i + 1, NULL, false));
+		innertlist = lappend(innertlist,
+							 makeTargetEntry(lsecond(opexpr->args),
+											 i + 1, NULL, false));
+
+		cross_eq_funcoids[i] = get_opcode(opexpr->opno);
+
+		if (!get_compatible_hash_operators(opexpr->opno,
+										   NULL, &inner_eq_oper))
+			elog(ERROR, "could not find compatible hash operator for operator %u",
+				 opexpr->opno);
+		nlstate->nl_HashEqFuncOids[i] = get_opcode(inner_eq_oper);
+
+		if (!get_op_hash_functions(opexpr->opno,
+								   &outer_hashfn, &inner_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 opexpr->opno);
+		fmgr_info(outer_hashfn, &nlstate->nl_OuterHashFunctions[i]);
+		fmgr_info(inner_hashfn, &nlstate->nl_InnerHashFunctions[i]);
+
+		nlstate->nl_HashCollations[i] = opexpr->inputcollid;
+		nlstate->nl_HashKeyColIdx[i] = i + 1;
+		i++;
+	}
+
+	outerdesc = ExecTypeFromTL(outertlist);
+	slot = ExecInitExtraTupleSlot(estate, outerdesc, &TTSOpsVirtual);
+	nlstate->nl_OuterHashKeys =
+		ExecBuildProjectionInfo(outertlist, nlstate->js.ps.ps_ExprContext,
+								slot, &nlstate->js.ps, NULL);
+
+	innerdesc = ExecTypeFromTL(innertlist);
+	slot = ExecInitExtraTupleSlot(estate, innerdesc, &TTSOpsVirtual);
+	nlstate->nl_InnerHashKeys =
+		ExecBuildProjectionInfo(innertlist, nlstate->js.ps.ps_ExprContext,
+								slot, &nlstate->js.ps, NULL);
+
+	nlstate->nl_HashCrossEq =
+		ExecBuildGroupingEqual(outerdesc, innerdesc,
+							   &TTSOpsVirtual, &TTSOpsMinimalTuple,
+							   nkeys,
+							   nlstate->nl_HashKeyColIdx,
+							   cross_eq_funcoids,
+							   nlstate->nl_HashCollations,
+							   &nlstate->js.ps);
+
+	nlstate->nl_HashInnerSlot =
+		ExecInitExtraTupleSlot(estate,
+							   ExecGetResultType(innerPlanState(nlstate)),
+							   &TTSOpsMinimalTuple);
+
+	nlstate->nl_HashTableCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Context",
+							  ALLOCSET_DEFAULT_SIZES);
+	nlstate->nl_HashTempCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Temp Context",
+							  ALLOCSET_SMALL_SIZES);
+
+	nlstate->nl_HashThreshold =
+		Max(outerPlan(node)->plan_rows * NL_HASH_ESTIMATE_FACTOR,
+			NL_HASH_MIN_OUTER_TUPLES);
+}
+
+/*
+ * Are all the projected hash keys in the slot non-null?  The hashclause
+ * operators are strict, so a null key cannot match anything.
+ */
+static inline bool
+nl_hash_keys_not_null(TupleTableSlot *slot, int nkeys)
+{
+	slot_getsomeattrs(slot, nkeys);
+	for (int i = 0; i < nkeys; i++)
+	{
+		if (slot->tts_isnull[i])
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Read the whole inner side into a hash table.  On return, nl_HashTable is
+ * set if that worked; if the inner tuples took too much memory it is left
+ * NULL, and we won't try again.
+ */
+static void
+ExecNestLoopBuildHash(NestLoopState *node)
+{
+	PlanState  *innerPlan = innerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	TupleDesc	keydesc;
+	Size		hash_mem_limit = get_hash_memory_limit();
+	long		nbuckets;
+
+	nbuckets = clamp_cardinality_to_long(innerPlan->plan->plan_rows);
+	if (nbuckets < 1)
+		nbuckets = 1;
+
+	keydesc = node->nl_InnerHashKeys->pi_state.resultslot->tts_tupleDescriptor;
+	MemoryContextReset(node->nl_HashTableCxt);
+	node->nl_HashTable = BuildTupleHashTableExt(&node->js.ps,
+												keydesc,
+												node->nl_NumHashKeys,
+												node->nl_HashKeyColIdx,
+												node->nl_HashEqFuncOids,
+												node->nl_InnerHashFunctions,
+												node->nl_HashCollations,
+												nbuckets,
+												0,
+												node->nl_HashTableCxt,
+												node->nl_HashTableCxt,
+												node->nl_HashTempCxt,
+												false);
+
+	ExecReScan(innerPlan);
+	for (;;)
+	{
+		TupleTableSlot *innerslot = ExecProcNode(innerPlan);
+		TupleTableSlot *keyslot;
+		TupleHashEntry entry;
+		MemoryContext oldcxt;
+		bool		isnew;
+
+		if (TupIsNull(innerslot))
+			break;
+
+		ResetExprContext(econtext);
+		econtext->ecxt_innertuple = innerslot;
+		keyslot = ExecProject(node->nl_InnerHashKeys);
+		if (!nl_hash_keys_not_null(keyslot, node->nl_NumHashKeys))
+			continue;
+
+		entry = LookupTupleHashEntry(node->nl_HashTable, keyslot,
+									 &isnew, NULL);
+		MemoryContextReset(node->nl_HashTempCxt);
+		oldcxt = MemoryContextSwitchTo(node->nl_HashTableCxt);
+		entry->additional = lappend((List *) entry->additional,
+									ExecCopySlotMinimalTuple(innerslot));
+		MemoryContextSwitchTo(oldcxt);
+
+		if (MemoryContextMemAllocated(node->nl_HashTableCxt, true) >
+			hash_mem_limit)
+		{
+			MemoryContextReset(node->nl_HashTableCxt);
+			node->nl_HashTable = NULL;
+			node->nl_HashThreshold = 0;
+			break;
+		}
+	}
+	ResetExprContext(econtext);
+
+	if (node->nl_HashTable != NULL)
+		node->nl_HashedAfter = node->nl_OuterTuples;
+}
+
+/*
+ * Look up the inner tuples matching the current outer tuple's keys.
+ */
+static void
+ExecNestLoopProbeHash(NestLoopState *node)
+{
+	TupleTableSlot *keyslot;
+	TupleHashEntry entry;
+
+	node->nl_HashMatches = NIL;
+	node->nl_HashMatchIdx = 0;
+
+	keyslot = ExecProject(node->nl_OuterHashKeys);
+	if (!nl_hash_keys_not_null(keyslot, node->nl_NumHashKeys))
+		return;
+
+	entry = FindTupleHashEntry(node->nl_HashTable, keyslot,
+							   node->nl_HashCrossEq,
+							   node->nl_OuterHashFunctions);
+	MemoryContextReset(node->nl_HashTempCxt);
+	if (entry != NULL)
+		node->nl_HashMatches = (List *) entry->additional;
+}
@@ -155,6 +155,20 @@ typedef struct WindowStatePerAggData
 
 	int64		transValueCount;	/* number of currently-aggregated rows */
 
+	/*
+	 * Sliding-frame evaluation using the combine function, see
+	 * eval_windowaggregates().  transValue then only covers the rows from
+	 * frontend up to aggregatedupto, while frontValues[i] holds the combined
+	 * transition value of rows frontbase + i up to frontend.
+	 */
+	bool		sliding;		/* use sliding-frame evaluation? */
+	FmgrInfo	combinefn;		/* only valid if sliding */
+	MemoryContext frontcontext; /* holds frontValues, if sliding */
+	Datum	   *frontValues;
+	bool	   *frontValuesIsNull;
+	int64		frontbase;		/* partition row of frontValues[0] */
+	int64		frontend;		/* first row not covered by frontValues */
+
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
 } WindowStatePerAggData;
@@ -171,7 +185,16 @@ static bool advance_windowaggregate_base(WindowAggState *winstate,
 static void finalize_windowaggregate(WindowAggState *winstate,
 									 WindowStatePerFunc perfuncstate,
 									 WindowStatePerAgg peraggstate,
+									 Datum transValue, bool transValueIsNull,
 									 Datum *result, bool *isnull);
+static Datum combine_windowaggregate(WindowAggState *winstate,
+									 WindowStatePerFunc perfuncstate,
+									 WindowStatePerAgg peraggstate,
+									 Datum value1, bool isnull1,
+									 Datum value2, bool isnull2,
+									 bool *isnull);
+static void rebuild_windowaggregate_fronts(WindowAggState *winstate,
+										   int64 frontbase, int64 frontend);
 
 static void eval_windowaggregates(WindowAggState *winstate);
 static void eval_windowfunction(WindowAggState *winstate,
@@ -582,6 +605,7 @@ static void
 finalize_windowaggregate(WindowAggState *winstate,
 						 WindowStatePerFunc perfuncstate,
 						 WindowStatePerAgg peraggstate,
+						 Datum transValue, bool transValueIsNull,
 						 Datum *result, bool *isnull)
 {
 	MemoryContext oldContext;
@@ -603,11 +627,11 @@ finalize_windowaggregate(WindowAggState *winstate,
 								 perfuncstate->winCollation,
 								 (void *) winstate, NULL);
 		fcinfo->args[0].value =
-			MakeExpandedObjectReadOnly(peraggstate->transValue,
-									   peraggstate->transValueIsNull,
+			MakeExpandedObjectReadOnly(transValue,
+									   transValueIsNull,
 									   peraggstate->transtypeLen);
-		fcinfo->args[0].isnull = peraggstate->transValueIsNull;
-		anynull = peraggstate->transValueIsNull;
+		fcinfo->args[0].isnull = transValueIsNull;
+		anynull = transValueIsNull;
 
 		/* Fill any remaining argument positions with nulls */
 		for (i = 1; i < numFinalArgs; i++)
@@ -639,15 +663,202 @@ finalize_windowaggregate(WindowAggState *winstate,
 	else
 	{
 		*result =
-			MakeExpandedObjectReadOnly(peraggstate->transValue,
-									   peraggstate->transValueIsNull,
+			MakeExpandedObjectReadOnly(transValue,
+									   transValueIsNull,
 									   peraggstate->transtypeLen);
-		*isnull = peraggstate->transValueIsNull;
+		*isnull = transValueIsNull;
 	}
 
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * combine_windowaggregate
+ * parallel to the combine step of advance_aggregates in nodeAgg.c
+ *
+ * Combine two transition values using the aggregate's combine function, and
+ * return the result allocated in the caller's memory context.  Neither input
+ * is modified.
+ */
+static Datum
+combine_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate,
+						Datum value1, bool isnull1,
+						Datum value2, bool isnull2,
+						bool *isnull)
+{
+	LOCAL_FCINFO(fcinfo, 2);
+	MemoryContext oldContext;
+	Datum		result;
+
+	if (peraggstate->combinefn.fn_strict && (isnull1 || isnull2))
+	{
+		/*
+		 * Don't call a strict function with NULL inputs.  A NULL transition
+		 * value means that no rows have been aggregated yet, so the result is
+		 * simply the other value, as in nodeAgg.c.
+		 */
+		if (isnull1)
+		{
+			value1 = value2;
+			isnull1 = isnull2;
+		}
+		*isnull = isnull1;
+		if (isnull1)
+			return (Datum) 0;
+		return datumCopy(value1, peraggstate->transtypeByVal,
+						 peraggstate->transtypeLen);
+	}
+
+	/*
+	 * The combine function is allowed to modify its first input in place
+	 * when called in aggregate context, so give it a copy, and do all the
+	 * work in the per-input-tuple context.
+	 */
+	oldContext = MemoryContextSwitchTo(winstate->tmpcontext->ecxt_per_tuple_memory);
+
+	InitFunctionCallInfoData(*fcinfo, &(peraggstate->combinefn), 2,
+							 perfuncstate->winCollation,
+							 (void *) winstate, NULL);
+	fcinfo->args[0].value = isnull1 ? (Datum) 0 :
+		datumCopy(value1, peraggstate->transtypeByVal,
+				  peraggstate->transtypeLen);
+	fcinfo->args[0].isnull = isnull1;
+	fcinfo->args[1].value = value2;
+	fcinfo->args[1].isnull = isnull2;
+	winstate->curaggcontext = CurrentMemoryContext;
+	result = FunctionCallInvoke(fcinfo);
+	winstate->curaggcontext = NULL;
+	*isnull = fcinfo->isnull;
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (*isnull)
+		return (Datum) 0;
+	return datumCopy(result, peraggstate->transtypeByVal,
+					 peraggstate->transtypeLen);
+}
+
+/*
+ * rebuild_windowaggregate_fronts
+ * Compute the front transition values of all sliding aggregates that are
+ * not being restarted, for rows frontbase up to (but not including)
+ * frontend.
+ *
+ * We walk the rows backwards, aggregating each one on its own and combining
+ * the result with the value computed for the rows following it.  The
+ * transition values of the sliding aggregates are re-initialized
+ * afterwards, since they'll only need to cover rows from frontend onwards.
+ */
+static void
+rebuild_windowaggregate_fronts(WindowAggState *winstate,
+							   int64 frontbase, int64 frontend)
+{
+	WindowObject agg_winobj = winstate->agg_winobj;
+	TupleTableSlot *temp_slot = winstate->temp_slot_1;
+	int64		nrows = frontend - frontbase;
+	int64		pos;
+	int			i;
+
+	Assert(nrows > 0);
+
+	for (i = 0; i < winstate->numaggs; i++)
+	{
+		WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+		if (!peraggstate->sliding || peraggstate->restart)
+			continue;
+
+		MemoryContextReset(peraggstate->frontcontext);
+		peraggstate->frontValues = (Datum *)
+			MemoryContextAlloc(peraggstate->frontcontext, nrows * sizeof(Datum));
+		peraggstate->frontValuesIsNull = (bool *)
+			MemoryContextAlloc(peraggstate->frontcontext, nrows * sizeof(bool));
+		peraggstate->frontbase = frontbase;
+		peraggstate->frontend = frontend;
+	}
+
+	for (pos = frontend - 1; pos >= frontbase; pos--)
+	{
+		if (!window_gettupleslot(agg_winobj, pos, temp_slot))
+			elog(ERROR, "could not re-fetch previously fetched frame row");
+
+		/* Set tuple context for evaluation of aggregate arguments */
+		winstate->tmpcontext->ecxt_outertuple = temp_slot;
+
+		for (i = 0; i < winstate->numaggs; i++)
+		{
+			WindowStatePerAgg peraggstate = &winstate->peragg[i];
+			WindowStatePerFunc perfuncstate;
+			MemoryContext aggcontext = peraggstate->aggcontext;
+			int64		off = pos - frontbase;
+			Datum		rowValue;
+			bool		rowValueIsNull;
+			MemoryContext oldContext;
+
+			if (!peraggstate->sliding || peraggstate->restart)
+				continue;
+			perfuncstate = &winstate->perfunc[peraggstate->wfuncno];
+
+			/*
+			 * Aggregate just this row, by temporarily pointing the transition
+			 * value and aggcontext at the per-input-tuple context.
+			 */
+			peraggstate->aggcontext = winstate->tmpcontext->ecxt_per_tuple_memory;
+			if (peraggstate->initValueIsNull)
+				peraggstate->transValue = peraggstate->initValue;
+			else
+			{
+				oldContext = MemoryContextSwitchTo(peraggstate->aggcontext);
+				peraggstate->transValue = datumCopy(peraggstate->initValue,
+													peraggstate->transtypeByVal,
+													peraggstate->transtypeLen);
+				MemoryContextSwitchTo(oldContext);
+			}
+			peraggstate->transValueIsNull = peraggstate->initValueIsNull;
+			peraggstate->transValueCount = 0;
+			advance_windowaggregate(winstate, perfuncstate, peraggstate);
+			rowValue = peraggstate->transValue;
+			rowValueIsNull = peraggstate->transValueIsNull;
+			peraggstate->aggcontext = aggcontext;
+
+			oldContext = MemoryContextSwitchTo(peraggstate->frontcontext);
+			if (pos == frontend - 1)
+			{
+				peraggstate->frontValuesIsNull[off] = rowValueIsNull;
+				peraggstate->frontValues[off] = rowValueIsNull ? (Datum) 0 :
+					datumCopy(rowValue, peraggstate->transtypeByVal,
+							  peraggstate->transtypeLen);
+			}
+			else
+				peraggstate->frontValues[off] =
+					combine_windowaggregate(winstate, perfuncstate, peraggstate,
+											rowValue, rowValueIsNull,
+											peraggstate->frontValues[off + 1],
+											peraggstate->frontValuesIsNull[off + 1],
+											&peraggstate->frontValuesIsNull[off]);
+			MemoryContextSwitchTo(oldContext);
+		}
+
+		/* Reset per-input-tuple context after each tuple */
+		ResetExprContext(winstate->tmpcontext);
+		ExecClearTuple(temp_slot);
+	}
+
+	for (i = 0; i < winstate->numaggs; i++)
+	{
+		WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+		if (!peraggstate->sliding || peraggstate->restart)
+			continue;
+
+		initialize_windowaggregate(winstate,
+								   &winstate->perfunc[peraggstate->wfuncno],
+								   peraggstate);
+	}
+}
+
 /*
  * eval_windowaggregates
  * evaluate plain aggregates being used as window functions
@@ -666,6 +877,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	int			wfuncno,
 				numaggs,
 				numaggs_restart,
+				numaggs_sliding,
 				i;
 	int64		aggregatedupto_nonrestarted;
 	MemoryContext oldContext;
@@ -710,6 +922,20 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * must perform the aggregation all over again for all tuples within the
 	 * new frame boundaries.
 	 *
+	 * Restarting makes each row cost time proportional to the frame size,
+	 * which hurts for aggregates like max() over large sliding frames.  So
+	 * aggregates without an inverse transition function but with a combine
+	 * function can instead use the "two stacks" sliding window technique,
+	 * which only needs a constant number of transition and combine function
+	 * calls per row, amortized.  For such aggregates, transValue only holds
+	 * the rows from some position 'frontend' onwards, and for each row
+	 * between the frame head and frontend we remember the combination of
+	 * that row and all following rows up to frontend.  The aggregate for a
+	 * frame is then obtained by combining one of those values with
+	 * transValue.  When the frame head passes frontend, we rebuild the
+	 * remembered values for all the rows aggregated so far, and start over
+	 * with an empty transValue.  See rebuild_windowaggregate_fronts().
+	 *
 	 * If there's any exclusion clause, then we may have to aggregate over a
 	 * non-contiguous set of rows, so we punt and recalculate for every row.
 	 * (For some frame end choices, it might be that the frame is always
@@ -781,12 +1007,14 @@ eval_windowaggregates(WindowAggState *winstate)
 	 *----------
 	 */
 	numaggs_restart = 0;
+	numaggs_sliding = 0;
 	for (i = 0; i < numaggs; i++)
 	{
 		peraggstate = &winstate->peragg[i];
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->sliding) ||
 			(winstate->frameOptions & FRAMEOPTION_EXCLUSION) ||
 			winstate->aggregatedupto <= winstate->frameheadpos)
 		{
@@ -794,7 +1022,11 @@ eval_windowaggregates(WindowAggState *winstate)
 			numaggs_restart++;
 		}
 		else
+		{
 			peraggstate->restart = false;
+			if (peraggstate->sliding)
+				numaggs_sliding++;
+		}
 	}
 
 	/*
@@ -802,9 +1034,10 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * aggregatedbase to match the frame's head by removing input rows that
 	 * fell off the top of the frame from the aggregations.  This can fail,
 	 * i.e. advance_windowaggregate_base() can return false, in which case
-	 * we'll restart that aggregate below.
+	 * we'll restart that aggregate below.  Sliding aggregates don't need to
+	 * do anything for each removed row.
 	 */
-	while (numaggs_restart < numaggs &&
+	while (numaggs_restart + numaggs_sliding < numaggs &&
 		   winstate->aggregatedbase < winstate->frameheadpos)
 	{
 		/*
@@ -827,7 +1060,7 @@ eval_windowaggregates(WindowAggState *winstate)
 			bool		ok;
 
 			peraggstate = &winstate->peragg[i];
-			if (peraggstate->restart)
+			if (peraggstate->restart || peraggstate->sliding)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
@@ -864,6 +1097,26 @@ eval_windowaggregates(WindowAggState *winstate)
 	if (agg_winobj->markptr >= 0)
 		WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
 
+	/*
+	 * If the frame head has moved past frontend, the sliding aggregates'
+	 * transValue includes rows that are no longer in the frame, so rebuild
+	 * their front values for all the rows aggregated so far.  All sliding
+	 * aggregates restart at the same time, so they all share the same
+	 * frontend.
+	 */
+	for (i = 0; i < numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		if (peraggstate->sliding && !peraggstate->restart)
+		{
+			if (winstate->frameheadpos > peraggstate->frontend)
+				rebuild_windowaggregate_fronts(winstate,
+											   winstate->frameheadpos,
+											   winstate->aggregatedupto);
+			break;
+		}
+	}
+
 	/*
 	 * Now restart the aggregates that require it.
 	 *
@@ -891,6 +1144,16 @@ eval_windowaggregates(WindowAggState *winstate)
 			initialize_windowaggregate(winstate,
 									   &winstate->perfunc[wfuncno],
 									   peraggstate);
+
+			/* A restarted sliding aggregate has no front values either */
+			if (peraggstate->sliding)
+			{
+				MemoryContextReset(peraggstate->frontcontext);
+				peraggstate->frontValues = NULL;
+				peraggstate->frontValuesIsNull = NULL;
+				peraggstate->frontbase = winstate->frameheadpos;
+				peraggstate->frontend = winstate->frameheadpos;
+			}
 		}
 		else if (!peraggstate->resultValueIsNull)
 		{
@@ -986,14 +1249,40 @@ next_tuple:
 	{
 		Datum	   *result;
 		bool	   *isnull;
+		Datum		transValue;
+		bool		transValueIsNull;
 
 		peraggstate = &winstate->peragg[i];
 		wfuncno = peraggstate->wfuncno;
 		result = &econtext->ecxt_aggvalues[wfuncno];
 		isnull = &econtext->ecxt_aggnulls[wfuncno];
+
+		transValue = peraggstate->transValue;
+		transValueIsNull = peraggstate->transValueIsNull;
+
+		/* Add in the front value for the frame head, for sliding aggs */
+		if (peraggstate->sliding &&
+			winstate->frameheadpos < peraggstate->frontend)
+		{
+			int64		off = winstate->frameheadpos - peraggstate->frontbase;
+
+			oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+			transValue = combine_windowaggregate(winstate,
+												 &winstate->perfunc[wfuncno],
+												 peraggstate,
+												 peraggstate->frontValues[off],
+												 peraggstate->frontValuesIsNull[off],
+												 transValue,
+												 transValueIsNull,
+												 &transValueIsNull);
+			MemoryContextSwitchTo(oldContext);
+			ResetExprContext(winstate->tmpcontext);
+		}
+
 		finalize_windowaggregate(winstate,
 								 &winstate->perfunc[wfuncno],
 								 peraggstate,
+								 transValue, transValueIsNull,
 								 result, isnull);
 
 		/*
@@ -1355,8 +1644,18 @@ release_partition(WindowAggState *winstate)
 	MemoryContextReset(winstate->aggcontext);
 	for (i = 0; i < winstate->numaggs; i++)
 	{
-		if (winstate->peragg[i].aggcontext != winstate->aggcontext)
-			MemoryContextReset(winstate->peragg[i].aggcontext);
+		WindowStatePerAgg peraggstate = &winstate->peragg[i];
+
+		if (peraggstate->aggcontext != winstate->aggcontext)
+			MemoryContextReset(peraggstate->aggcontext);
+		if (peraggstate->frontcontext)
+		{
+			MemoryContextReset(peraggstate->frontcontext);
+			peraggstate->frontValues = NULL;
+			peraggstate->frontValuesIsNull = NULL;
+			peraggstate->frontbase = 0;
+			peraggstate->frontend = 0;
+		}
 	}
 
 	if (winstate->buffer)
@@ -2689,6 +2988,8 @@ ExecEndWindowAgg(WindowAggState *node)
 	{
 		if (node->peragg[i].aggcontext != node->aggcontext)
 			MemoryContextDelete(node->peragg[i].aggcontext);
+		if (node->peragg[i].frontcontext)
+			MemoryContextDelete(node->peragg[i].frontcontext);
 	}
 	MemoryContextDelete(node->partcontext);
 	MemoryContextDelete(node->aggcontext);
@@ -2758,12 +3059,14 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	bool		use_ma_code;
 	Oid			transfn_oid,
 				invtransfn_oid,
-				finalfn_oid;
+				finalfn_oid,
+				combinefn_oid;
 	bool		finalextra;
 	char		finalmodify;
 	Expr	   *transfnexpr,
 			   *invtransfnexpr,
-			   *finalfnexpr;
+			   *finalfnexpr,
+			   *combinefnexpr;
 	Datum		textInitVal;
 	int			i;
 	ListCell   *lc;
@@ -2834,6 +3137,26 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		initvalAttNo = Anum_pg_aggregate_agginitval;
 	}
 
+	/*
+	 * If we can't use the moving-aggregate implementation, but the frame
+	 * head can move, consider evaluating the aggregate over sliding frames
+	 * using its combine function.  This is unsafe for the same reasons as
+	 * moving aggregates are when the arguments might be volatile.  It also
+	 * needs to be able to copy the transition values, so internal transition
+	 * types are out.  Finally, as the rows get combined in a different order
+	 * than when aggregating them one by one, we stay away from floating-point
+	 * transition types to avoid the results depending on the evaluation
+	 * strategy through rounding differences.
+	 */
+	combinefn_oid = InvalidOid;
+	if (!use_ma_code &&
+		OidIsValid(aggform->aggcombinefn) &&
+		!(winstate->frameOptions & (FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+									FRAMEOPTION_EXCLUSION)) &&
+		!contain_volatile_functions((Node *) wfunc) &&
+		!contain_subplans((Node *) wfunc))
+		combinefn_oid = aggform->aggcombinefn;
+
 	/*
 	 * ExecInitWindowAgg already checked permission to call aggregate function
 	 * ... but we still need to check the component functions
@@ -2878,6 +3201,14 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 							   get_func_name(finalfn_oid));
 			InvokeFunctionExecuteHook(finalfn_oid);
 		}
+
+		/* Don't fail for lack of permission on an optional combinefn */
+		if (OidIsValid(combinefn_oid) &&
+			object_aclcheck(ProcedureRelationId, combinefn_oid, aggOwner,
+							ACL_EXECUTE) != ACLCHECK_OK)
+			combinefn_oid = InvalidOid;
+		if (OidIsValid(combinefn_oid))
+			InvokeFunctionExecuteHook(combinefn_oid);
 	}
 
 	/*
@@ -2946,6 +3277,30 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 					&peraggstate->transtypeLen,
 					&peraggstate->transtypeByVal);
 
+	/* set up sliding-frame evaluation, if usable; see above */
+	if (OidIsValid(combinefn_oid) &&
+		aggtranstype != INTERNALOID &&
+		aggtranstype != FLOAT4OID && aggtranstype != FLOAT8OID &&
+		aggtranstype != FLOAT4ARRAYOID && aggtranstype != FLOAT8ARRAYOID)
+	{
+		/* the combinefn's single "input" is a transition value, too */
+		build_aggregate_transfn_expr(&aggtranstype,
+									 1,
+									 0,
+									 false,
+									 aggtranstype,
+									 wfunc->inputcollid,
+									 combinefn_oid,
+									 InvalidOid,
+									 &combinefnexpr,
+									 NULL);
+		fmgr_info(combinefn_oid, &peraggstate->combinefn);
+		fmgr_info_set_expr((Node *) combinefnexpr, &peraggstate->combinefn);
+		peraggstate->sliding = true;
+	}
+	else
+		peraggstate->sliding = false;
+
 	/*
 	 * initval is potentially null, so don't try to access it as a struct
 	 * field. Must do it the hard way with SysCacheGetAttr.
@@ -3004,7 +3359,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * they have historically been for plain aggregates, but that seems grotty
 	 * and likely to lead to memory leaks.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || peraggstate->sliding)
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
@@ -3012,6 +3367,22 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	else
 		peraggstate->aggcontext = winstate->aggcontext;
 
+	/*
+	 * Sliding aggregates also keep their front values in a context of their
+	 * own, since they're rebuilt at different times than the transValue.
+	 */
+	if (peraggstate->sliding)
+		peraggstate->frontcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "WindowAgg Sliding Frame",
+								  ALLOCSET_DEFAULT_SIZES);
+	else
+		peraggstate->frontcontext = NULL;
+	peraggstate->frontValues = NULL;
+	peraggstate->frontValuesIsNull = NULL;
+	peraggstate->frontbase = 0;
+	peraggstate->frontend = 0;
+
 	ReleaseSysCache(aggTuple);
 
 	return peraggstate;
@@ -8,6 +8,19 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * To avoid paying the shm_mq per-message overhead for every tuple, the
+ * sender packs tuples into batches, each of which is sent as one message.
+ * A batch is simply a series of MinimalTuples, each starting at a MAXALIGN'd
+ * offset; since a MinimalTuple begins with its length, the reader can walk
+ * the batch and hand out pointers to the tuples without copying them.  The
+ * batch size starts at a single tuple and grows as tuples keep coming, so
+ * that the first tuples still reach the leader without delay.  A batch that
+ * isn't full is not held back for long either: when a tuple is left waiting
+ * in it, a timeout is armed, and once it expires the next
+ * CHECK_FOR_INTERRUPTS() sends the batch without waiting for the queue to
+ * have room.  That covers a worker that keeps scanning, or blocks, long after
+ * producing its last few tuples.
+ *
  * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -21,6 +34,15 @@
 
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
+#include "miscadmin.h"
+#include "storage/latch.h"
+#include "utils/timeout.h"
+
+/* Maximum size of a batch of tuples sent as one message */
+#define TQUEUE_BATCH_SIZE		8192
+
+/* Maximum time in ms a tuple waits in a batch before the batch is sent */
+#define TQUEUE_BATCH_DELAY		10
 
 /*
  * DestReceiver object's private contents
@@ -31,8 +53,22 @@ typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* tuples not sent yet */
+	Size		batch_used;		/* bytes used in batch */
+	Size		batch_limit;	/* send batch once it holds this much */
+	bool		batch_partial;	/* batch partly sent without waiting */
+	bool		sending;		/* in a blocking send to the queue */
 } TQueueDestReceiver;
 
+/* Set by the timeout handler; see ProcessTupleQueueFlush() */
+volatile sig_atomic_t TupleQueueFlushPending = false;
+
+/* Receiver whose batch the timeout is armed for, if any */
+static TQueueDestReceiver *flush_receiver = NULL;
+
+static bool flush_timeout_registered = false;
+static TimeoutId flush_timeout;
+
 /*
  * TupleQueueReader object's private contents
  *
@@ -43,27 +79,28 @@ typedef struct TQueueDestReceiver
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *batch;			/* current batch, or NULL if none */
+	Size		batch_size;		/* total size of current batch */
+	Size		batch_offset;	/* offset of next tuple in current batch */
 };
 
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Send data to the designated shm_mq.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
 static bool
-tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+tqueueSend(TQueueDestReceiver *tqueue, Size nbytes, const void *data)
 {
-	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
-
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
 
-	if (should_free)
-		pfree(tuple);
+	/*
+	 * A batch is sent as soon as it's complete, so make it visible to the
+	 * reader right away.
+	 */
+	tqueue->sending = true;
+	result = shm_mq_send(tqueue->queue, nbytes, data, false, true);
+	tqueue->sending = false;
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -76,6 +113,84 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	return true;
 }
 
+/*
+ * Send the current batch of tuples, if any, and allow the next batch to be
+ * larger.  This also finishes sending a batch that ProcessTupleQueueFlush()
+ * could only send part of.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueFlushBatch(TQueueDestReceiver *tqueue)
+{
+	Size		nbytes = tqueue->batch_used;
+
+	if (nbytes == 0)
+		return true;
+
+	tqueue->batch_used = 0;
+	tqueue->batch_partial = false;
+	tqueue->batch_limit = Min(Max(tqueue->batch_limit * 2, nbytes),
+							  TQUEUE_BATCH_SIZE);
+
+	return tqueueSend(tqueue, nbytes, tqueue->batch);
+}
+
+/*
+ * Receive a tuple from a query, and add it to the batch of tuples to send to
+ * the designated shm_mq.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+	MinimalTuple tuple;
+	Size		len;
+	bool		should_free;
+	bool		result = true;
+
+	/* The shm_mq must get the rest of a partly sent batch first. */
+	if (tqueue->batch_partial && !tqueueFlushBatch(tqueue))
+		return false;
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+	len = MAXALIGN(tuple->t_len);
+
+	/* Make room for the tuple, if needed. */
+	if (tqueue->batch_used + len > TQUEUE_BATCH_SIZE &&
+		!tqueueFlushBatch(tqueue))
+		result = false;
+	else if (len > TQUEUE_BATCH_SIZE)
+	{
+		/* Send a tuple too large to be batched as a batch of its own. */
+		result = tqueueSend(tqueue, tuple->t_len, tuple);
+	}
+	else
+	{
+		/* Add it to the batch, and send the batch if it's full enough. */
+		memcpy(tqueue->batch + tqueue->batch_used, tuple, tuple->t_len);
+		/* Zero the alignment padding, so no garbage goes into the queue. */
+		memset(tqueue->batch + tqueue->batch_used + tuple->t_len, 0,
+			   len - tuple->t_len);
+		tqueue->batch_used += len;
+		if (tqueue->batch_used >= tqueue->batch_limit)
+			result = tqueueFlushBatch(tqueue);
+		else if (!get_timeout_active(flush_timeout))
+		{
+			/* Don't let the tuple wait for long. */
+			flush_receiver = tqueue;
+			enable_timeout_after(flush_timeout, TQUEUE_BATCH_DELAY);
+		}
+	}
+
+	if (should_free)
+		pfree(tuple);
+
+	return result;
+}
+
 /*
  * Prepare to receive tuples from executor.
  */
@@ -94,8 +209,18 @@ tqueueShutdownReceiver(DestReceiver *self)
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
 	if (tqueue->queue != NULL)
+	{
+		/* Send any remaining tuples; the reader may be gone already. */
+		(void) tqueueFlushBatch(tqueue);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
+
+	if (flush_receiver == tqueue)
+	{
+		disable_timeout(flush_timeout, false);
+		flush_receiver = NULL;
+	}
 }
 
 /*
@@ -109,9 +234,62 @@ tqueueDestroyReceiver(DestReceiver *self)
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	if (flush_receiver == tqueue)
+	{
+		disable_timeout(flush_timeout, false);
+		flush_receiver = NULL;
+	}
+	pfree(tqueue->batch);
 	pfree(self);
 }
 
+/*
+ * Timeout handler: a tuple has waited in a batch for TQUEUE_BATCH_DELAY ms.
+ */
+static void
+TupleQueueFlushTimeoutHandler(void)
+{
+	InterruptPending = true;
+	TupleQueueFlushPending = true;
+	SetLatch(MyLatch);
+}
+
+/*
+ * Send the batch of tuples the timeout was armed for.  Called from
+ * ProcessInterrupts().
+ *
+ * We might be called while the batch is being assembled, or from within a
+ * blocking send of it, so this only sends a batch that's not already being
+ * sent, and doesn't wait for the queue to have room.  If only part of the
+ * batch fits, the batch can't change until the rest of it has been sent;
+ * tqueueReceiveSlot() and tqueueShutdownReceiver() take care of that.
+ */
+void
+ProcessTupleQueueFlush(void)
+{
+	TQueueDestReceiver *tqueue = flush_receiver;
+	shm_mq_result result;
+
+	TupleQueueFlushPending = false;
+
+	if (tqueue == NULL || tqueue->queue == NULL || tqueue->sending ||
+		tqueue->batch_used == 0)
+		return;
+
+	HOLD_INTERRUPTS();
+	result = shm_mq_send(tqueue->queue, tqueue->batch_used, tqueue->batch,
+						 true, true);
+	RESUME_INTERRUPTS();
+
+	/*
+	 * On SHM_MQ_DETACHED, keep the batch too; the next attempt to send it
+	 * reports that the reader is gone.
+	 */
+	if (result == SHM_MQ_SUCCESS)
+		tqueue->batch_used = 0;
+	tqueue->batch_partial = (result != SHM_MQ_SUCCESS);
+}
+
 /*
  * Create a DestReceiver that writes tuples to a tuple queue.
  */
@@ -120,6 +298,13 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 {
 	TQueueDestReceiver *self;
 
+	if (!flush_timeout_registered)
+	{
+		flush_timeout = RegisterTimeout(USER_TIMEOUT,
+										TupleQueueFlushTimeoutHandler);
+		flush_timeout_registered = true;
+	}
+
 	self = (TQueueDestReceiver *) palloc0(sizeof(TQueueDestReceiver));
 
 	self->pub.receiveSlot = tqueueReceiveSlot;
@@ -128,6 +313,9 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	self->batch = palloc(TQUEUE_BATCH_SIZE);
+	self->batch_used = 0;
+	self->batch_limit = 0;		/* send the first tuple right away */
 
 	return (DestReceiver *) self;
 }
@@ -183,6 +371,17 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/* Return the next tuple from the current batch, if any. */
+	if (reader->batch != NULL)
+	{
+		tuple = (MinimalTuple) (reader->batch + reader->batch_offset);
+		reader->batch_offset += MAXALIGN(tuple->t_len);
+		Assert(reader->batch_offset <= MAXALIGN(reader->batch_size));
+		if (reader->batch_offset >= reader->batch_size)
+			reader->batch = NULL;
+		return tuple;
+	}
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -201,10 +400,18 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 
 	/*
 	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * sufficiently aligned).  The queue memory stays valid until we receive
+	 * the next message, so the rest of the batch can be returned from there
+	 * too.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+	Assert(tuple->t_len <= nbytes);
+	if (MAXALIGN(tuple->t_len) < nbytes)
+	{
+		reader->batch = (char *) data;
+		reader->batch_size = nbytes;
+		reader->batch_offset = MAXALIGN(tuple->t_len);
+	}
 
 	return tuple;
 }
@@ -3362,7 +3362,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, the join graph search, GEQO, or the regular join
+		 * search code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -3371,6 +3372,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (enable_graph_join_search && levels_needed >= geqo_threshold)
+			return graph_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
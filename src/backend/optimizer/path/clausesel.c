@@ -154,6 +154,17 @@ clauselist_selectivity_ext(PlannerInfo *root,
 											jointype, sjinfo, rel,
 											&estimatedclauses, false);
 	}
+	else if (use_extended_stats && rel == NULL && varRelid == 0 &&
+			 list_length(clauses) > 1)
+	{
+		/*
+		 * Otherwise, these may be join clauses.  Equijoin clauses between
+		 * the same two relations are best estimated together, if extended
+		 * statistics on the join columns allow that.
+		 */
+		s1 = statext_join_clauselist_selectivity(root, clauses, jointype,
+												 sjinfo, &estimatedclauses);
+	}
 
 	/*
 	 * Apply normal selectivity estimates for remaining clauses. We'll be
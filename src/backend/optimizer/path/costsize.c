@@ -84,6 +84,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cardfeedback.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
@@ -147,11 +148,14 @@ bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_eager_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_insert = true;
 bool		enable_partition_pruning = true;
 bool		enable_presorted_aggregate = true;
 bool		enable_async_append = true;
+bool		enable_adaptive_join = true;
 
 typedef struct
 {
@@ -820,6 +824,44 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 	path->path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_index_skip
+ *	  Adjusts the cost of an indexscan that skips over duplicate values of
+ *	  the index's leading column, returning only the first tuple of each.
+ *
+ * 'path' is a copy of an IndexPath already costed by cost_index(); we
+ * rescale it to 'ngroups' output rows.  Each group costs one fresh descent
+ * of the index, which we charge as a random page fetch plus the same
+ * per-level CPU cost that btcostestimate() charges for an initial descent,
+ * plus the per-tuple run cost the full scan would have charged for the
+ * returned tuple.
+ */
+void
+cost_index_skip(IndexPath *path, PlannerInfo *root, double ngroups)
+{
+	IndexOptInfo *index = path->indexinfo;
+	double		spc_random_page_cost;
+	double		tuple_run_cost;
+	Cost		descent_cost;
+
+	ngroups = clamp_row_est(Min(ngroups, path->path.rows));
+
+	get_tablespace_page_costs(index->reltablespace,
+							  &spc_random_page_cost, NULL);
+
+	tuple_run_cost = (path->path.total_cost - path->path.startup_cost) /
+		clamp_row_est(path->path.rows);
+
+	descent_cost = spc_random_page_cost;
+	if (index->tuples > 1)
+		descent_cost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+	descent_cost += (Max(index->tree_height, 0) + 1) * 50.0 * cpu_operator_cost;
+
+	path->path.rows = ngroups;
+	path->path.total_cost = path->path.startup_cost +
+		ngroups * (tuple_run_cost + descent_cost);
+}
+
 /*
  * extract_nonindex_conditions
  *
@@ -5253,6 +5295,10 @@ set_baserel_size_estimates(PlannerInfo *root, RelOptInfo *rel)
 							   JOIN_INNER,
 							   NULL);
 
+	/* Correct the estimate by what earlier executions showed, if enabled */
+	if (cardinality_feedback)
+		nrows = CardinalityFeedbackAdjust(root, rel, nrows);
+
 	rel->rows = clamp_row_est(nrows);
 
 	cost_qual_eval(&rel->baserestrictcost, rel->baserestrictinfo, root);
@@ -0,0 +1,603 @@
+/*-------------------------------------------------------------------------
+ *
+ * joingraph.c
+ *	  Join order search for large join problems, driven by the join graph.
+ *
+ * Once the number of jointree items reaches geqo_threshold, the exhaustive
+ * search of standard_join_search() becomes too expensive.  Rather than
+ * sampling join orders at random as GEQO does, we build the join graph of
+ * the problem --- an edge between two items whenever some join clause or
+ * join order restriction relates them --- and run dynamic programming over
+ * its connected subgraphs only.  Each pair of a connected subgraph and a
+ * connected complement is enumerated exactly once, following the DPccp
+ * algorithm of Moerkotte and Neumann (the simple-graph case of DPhyp).
+ * For the chain- and cycle-shaped queries that make up most large joins, the
+ * number of such pairs grows only polynomially with the number of items.
+ *
+ * The pairs are counted before any paths are built.  If there are more than
+ * graph_join_search_limit of them, or the graph is not connected, we instead
+ * build a single join tree greedily, repeatedly joining the two clumps whose
+ * join is estimated to produce the fewest rows ("greedy operator ordering").
+ * Unlike GEQO, both methods are deterministic.
+ *
+ * Join clauses mentioning more than two items (hyperedges, in DPhyp terms)
+ * are treated as connecting every pair of the items they mention; this only
+ * widens the search, since make_join_rel() still decides whether any given
+ * pair of rels can legally be joined.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/path/joingraph.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "optimizer/joininfo.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "port/pg_bitutils.h"
+#include "utils/hsearch.h"
+
+
+/* GUC parameters */
+bool		enable_graph_join_search = true;
+int			graph_join_search_limit = 10000;
+
+/* The enumerator represents sets of jointree items as 64-bit masks */
+#define JOINGRAPH_MAX_ITEMS		64
+
+/* mask of items 0 .. i */
+#define JOINGRAPH_UPTO(i) \
+	((i) >= 63 ? ~UINT64CONST(0) : (UINT64CONST(1) << ((i) + 1)) - 1)
+
+/* A connected subgraph and a connected complement, to be joined */
+typedef struct JoinGraphPair
+{
+	uint64		left;
+	uint64		right;
+	int			level;			/* number of items in left + right */
+} JoinGraphPair;
+
+/* Hash entry mapping a set of items to the joinrel built for it */
+typedef struct JoinGraphRel
+{
+	uint64		items;			/* hash key --- must be first */
+	RelOptInfo *rel;
+} JoinGraphRel;
+
+typedef struct JoinGraph
+{
+	PlannerInfo *root;
+	List	   *initial_rels;
+	int			nitems;
+	RelOptInfo **items;
+	uint64	   *neighbors;		/* neighbors[i] = items adjacent to item i */
+	JoinGraphPair *pairs;		/* csg-cmp pairs found by the enumerator */
+	int			npairs;
+	int			maxpairs;
+	bool		overflow;		/* gave up after graph_join_search_limit */
+} JoinGraph;
+
+/* A "clump" of already-joined items in the greedy search */
+typedef struct JoinGraphClump
+{
+	int			id;				/* identifies the clump in the pair cache */
+	RelOptInfo *rel;
+} JoinGraphClump;
+
+/* Hash entry remembering the result of joining two clumps */
+typedef struct JoinGraphClumpPair
+{
+	int			ids[2];			/* hash key --- must be first */
+	RelOptInfo *rel;			/* NULL if the join was not legal */
+} JoinGraphClumpPair;
+
+static bool joingraph_rels_related(PlannerInfo *root,
+								   RelOptInfo *rel1, RelOptInfo *rel2);
+static bool joingraph_is_connected(JoinGraph *graph);
+static void joingraph_enumerate(JoinGraph *graph);
+static void joingraph_enumerate_csg_rec(JoinGraph *graph, uint64 csg,
+										uint64 excluded);
+static void joingraph_enumerate_cmp(JoinGraph *graph, uint64 csg);
+static void joingraph_enumerate_cmp_rec(JoinGraph *graph, uint64 csg,
+										uint64 cmp, uint64 excluded);
+static void joingraph_add_pair(JoinGraph *graph, uint64 left, uint64 right);
+static RelOptInfo *joingraph_dp_search(JoinGraph *graph);
+static RelOptInfo *joingraph_greedy_search(JoinGraph *graph);
+static void joingraph_finish_rel(PlannerInfo *root, RelOptInfo *rel);
+
+
+/*
+ * graph_join_search
+ *	  Find a join order for 'initial_rels' using the join graph, as described
+ *	  at the head of this file.  The API is the same as that of
+ *	  standard_join_search().
+ */
+RelOptInfo *
+graph_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	JoinGraph  *graph;
+	RelOptInfo *rel = NULL;
+	ListCell   *lc;
+	int			i;
+
+	Assert(levels_needed == list_length(initial_rels));
+
+	graph = (JoinGraph *) palloc0(sizeof(JoinGraph));
+	graph->root = root;
+	graph->initial_rels = initial_rels;
+	graph->nitems = levels_needed;
+	graph->items = (RelOptInfo **) palloc(levels_needed * sizeof(RelOptInfo *));
+	i = 0;
+	foreach(lc, initial_rels)
+		graph->items[i++] = (RelOptInfo *) lfirst(lc);
+
+	if (levels_needed <= JOINGRAPH_MAX_ITEMS)
+	{
+		int			j;
+
+		graph->neighbors = (uint64 *) palloc0(levels_needed * sizeof(uint64));
+		for (i = 0; i < levels_needed; i++)
+		{
+			for (j = i + 1; j < levels_needed; j++)
+			{
+				if (joingraph_rels_related(root, graph->items[i],
+										   graph->items[j]))
+				{
+					graph->neighbors[i] |= UINT64CONST(1) << j;
+					graph->neighbors[j] |= UINT64CONST(1) << i;
+				}
+			}
+		}
+
+		if (joingraph_is_connected(graph))
+		{
+			joingraph_enumerate(graph);
+			if (!graph->overflow)
+				rel = joingraph_dp_search(graph);
+		}
+	}
+
+	if (rel == NULL)
+		rel = joingraph_greedy_search(graph);
+
+	return rel;
+}
+
+/*
+ * joingraph_rels_related
+ *	  Should there be an edge in the join graph between these rels?
+ *
+ * This is deliberately more liberal than have_join_order_restriction(): any
+ * outer join or placeholder that involves both rels connects them, since
+ * without an edge the enumerator would never consider joining them at all.
+ */
+static bool
+joingraph_rels_related(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
+{
+	ListCell   *lc;
+
+	if (have_relevant_joinclause(root, rel1, rel2))
+		return true;
+
+	if (bms_overlap(rel1->relids, rel2->direct_lateral_relids) ||
+		bms_overlap(rel2->relids, rel1->direct_lateral_relids))
+		return true;
+
+	foreach(lc, root->placeholder_list)
+	{
+		PlaceHolderInfo *phinfo = (PlaceHolderInfo *) lfirst(lc);
+
+		if (bms_overlap(rel1->relids, phinfo->ph_eval_at) &&
+			bms_overlap(rel2->relids, phinfo->ph_eval_at))
+			return true;
+	}
+
+	foreach(lc, root->join_info_list)
+	{
+		SpecialJoinInfo *sjinfo = (SpecialJoinInfo *) lfirst(lc);
+
+		if ((bms_overlap(rel1->relids, sjinfo->min_lefthand) ||
+			 bms_overlap(rel1->relids, sjinfo->min_righthand)) &&
+			(bms_overlap(rel2->relids, sjinfo->min_lefthand) ||
+			 bms_overlap(rel2->relids, sjinfo->min_righthand)))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * joingraph_is_connected
+ *	  Is every item reachable from item 0?
+ */
+static bool
+joingraph_is_connected(JoinGraph *graph)
+{
+	uint64		all = JOINGRAPH_UPTO(graph->nitems - 1);
+	uint64		reached = UINT64CONST(1);
+	uint64		frontier = reached;
+
+	while (frontier != 0)
+	{
+		uint64		next = 0;
+		int			i;
+
+		while (frontier != 0)
+		{
+			i = pg_rightmost_one_pos64(frontier);
+			frontier &= frontier - 1;
+			next |= graph->neighbors[i];
+		}
+		frontier = next & ~reached;
+		reached |= next;
+	}
+
+	return reached == all;
+}
+
+/*
+ * Neighborhood of a set of items, less the 'excluded' ones.
+ */
+static inline uint64
+joingraph_neighborhood(JoinGraph *graph, uint64 set, uint64 excluded)
+{
+	uint64		result = 0;
+	uint64		rest = set;
+
+	while (rest != 0)
+	{
+		int			i = pg_rightmost_one_pos64(rest);
+
+		rest &= rest - 1;
+		result |= graph->neighbors[i];
+	}
+
+	return result & ~(set | excluded);
+}
+
+/*
+ * joingraph_enumerate
+ *	  Collect every pair of a connected subgraph and a connected complement
+ *	  of the join graph into graph->pairs, or set graph->overflow if there
+ *	  are more than graph_join_search_limit of them.
+ *
+ * Connected subgraphs are grown from each item in turn, in decreasing item
+ * order, never adding items numbered below the starting one; that ensures
+ * each subgraph is produced once.  Complements are grown the same way from
+ * the neighbors of the subgraph.
+ */
+static void
+joingraph_enumerate(JoinGraph *graph)
+{
+	int			i;
+
+	graph->maxpairs = Min(Max(graph_join_search_limit, 1), 1024);
+	graph->pairs = (JoinGraphPair *)
+		palloc(graph->maxpairs * sizeof(JoinGraphPair));
+
+	for (i = graph->nitems - 1; i >= 0 && !graph->overflow; i--)
+	{
+		uint64		start = UINT64CONST(1) << i;
+
+		joingraph_enumerate_cmp(graph, start);
+		joingraph_enumerate_csg_rec(graph, start, JOINGRAPH_UPTO(i));
+	}
+}
+
+static void
+joingraph_enumerate_csg_rec(JoinGraph *graph, uint64 csg, uint64 excluded)
+{
+	uint64		nbrs = joingraph_neighborhood(graph, csg, excluded);
+	uint64		sub;
+
+	/* Protect against stack overflow and allow the search to be canceled */
+	check_stack_depth();
+	CHECK_FOR_INTERRUPTS();
+
+	if (nbrs == 0 || graph->overflow)
+		return;
+
+	/* Emit every extension of csg by a nonempty subset of its neighbors ... */
+	sub = 0;
+	while ((sub = (sub - nbrs) & nbrs) != 0 && !graph->overflow)
+		joingraph_enumerate_cmp(graph, csg | sub);
+
+	/* ... then extend each of those further */
+	sub = 0;
+	while ((sub = (sub - nbrs) & nbrs) != 0 && !graph->overflow)
+		joingraph_enumerate_csg_rec(graph, csg | sub, excluded | nbrs);
+}
+
+static void
+joingraph_enumerate_cmp(JoinGraph *graph, uint64 csg)
+{
+	int			first = pg_rightmost_one_pos64(csg);
+	uint64		excluded = JOINGRAPH_UPTO(first) | csg;
+	uint64		nbrs = joingraph_neighborhood(graph, csg, excluded);
+	int			i;
+
+	for (i = graph->nitems - 1; i >= 0 && !graph->overflow; i--)
+	{
+		uint64		start = UINT64CONST(1) << i;
+
+		if ((nbrs & start) == 0)
+			continue;
+
+		joingraph_add_pair(graph, csg, start);
+		joingraph_enumerate_cmp_rec(graph, csg, start,
+									excluded | (JOINGRAPH_UPTO(i) & nbrs));
+	}
+}
+
+static void
+joingraph_enumerate_cmp_rec(JoinGraph *graph, uint64 csg, uint64 cmp,
+							uint64 excluded)
+{
+	uint64		nbrs = joingraph_neighborhood(graph, cmp, excluded);
+	uint64		sub;
+
+	check_stack_depth();
+
+	if (nbrs == 0 || graph->overflow)
+		return;
+
+	sub = 0;
+	while ((sub = (sub - nbrs) & nbrs) != 0 && !graph->overflow)
+		joingraph_add_pair(graph, csg, cmp | sub);
+
+	sub = 0;
+	while ((sub = (sub - nbrs) & nbrs) != 0 && !graph->overflow)
+		joingraph_enumerate_cmp_rec(graph, csg, cmp | sub, excluded | nbrs);
+}
+
+static void
+joingraph_add_pair(JoinGraph *graph, uint64 left, uint64 right)
+{
+	JoinGraphPair *pair;
+
+	if (graph->npairs >= graph_join_search_limit)
+	{
+		graph->overflow = true;
+		return;
+	}
+
+	if (graph->npairs >= graph->maxpairs)
+	{
+		graph->maxpairs = Min(graph->maxpairs * 2, graph_join_search_limit);
+		graph->pairs = (JoinGraphPair *)
+			repalloc(graph->pairs, graph->maxpairs * sizeof(JoinGraphPair));
+	}
+
+	pair = &graph->pairs[graph->npairs++];
+	pair->left = left;
+	pair->right = right;
+	pair->level = pg_popcount64(left | right);
+}
+
+/*
+ * joingraph_dp_search
+ *	  Build paths for every pair collected by joingraph_enumerate().
+ *
+ * The pairs are processed level by level, just as in standard_join_search(),
+ * so that a joinrel is complete before it's used as the input of a larger
+ * join.  Returns NULL if the enumerated pairs did not allow all the items to
+ * be joined, in which case any joinrels we built have been discarded.
+ */
+static RelOptInfo *
+joingraph_dp_search(JoinGraph *graph)
+{
+	PlannerInfo *root = graph->root;
+	uint64		all = JOINGRAPH_UPTO(graph->nitems - 1);
+	int			savelength;
+	struct HTAB *savehash;
+	HASHCTL		hashctl;
+	HTAB	   *rels;
+	JoinGraphRel *entry;
+	RelOptInfo *result;
+	int			lev;
+	int			i;
+
+	Assert(root->join_rel_level == NULL);
+
+	/*
+	 * Remember the state of the join rel list, so that we can fall back to
+	 * the greedy search with a clean slate if need be.  As in geqo_eval(),
+	 * make sure the join_rel_hash is rebuilt from scratch.
+	 */
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	hashctl.keysize = sizeof(uint64);
+	hashctl.entrysize = sizeof(JoinGraphRel);
+	hashctl.hcxt = CurrentMemoryContext;
+	rels = hash_create("join graph rels", 256, &hashctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (i = 0; i < graph->nitems; i++)
+	{
+		uint64		item = UINT64CONST(1) << i;
+
+		entry = (JoinGraphRel *) hash_search(rels, &item, HASH_ENTER, NULL);
+		entry->rel = graph->items[i];
+	}
+
+	root->join_rel_level = (List **)
+		palloc0((graph->nitems + 1) * sizeof(List *));
+	root->join_rel_level[1] = graph->initial_rels;
+
+	for (lev = 2; lev <= graph->nitems; lev++)
+	{
+		ListCell   *lc;
+
+		root->join_cur_level = lev;
+
+		for (i = 0; i < graph->npairs; i++)
+		{
+			JoinGraphPair *pair = &graph->pairs[i];
+			JoinGraphRel *left;
+			JoinGraphRel *right;
+			RelOptInfo *joinrel;
+			uint64		items;
+
+			if (pair->level != lev)
+				continue;
+
+			/* Either input may be missing if no legal way to build it */
+			left = (JoinGraphRel *) hash_search(rels, &pair->left,
+												HASH_FIND, NULL);
+			right = (JoinGraphRel *) hash_search(rels, &pair->right,
+												 HASH_FIND, NULL);
+			if (left == NULL || right == NULL)
+				continue;
+
+			joinrel = make_join_rel(root, left->rel, right->rel);
+			if (joinrel == NULL)
+				continue;
+
+			items = pair->left | pair->right;
+			entry = (JoinGraphRel *) hash_search(rels, &items,
+												 HASH_ENTER, NULL);
+			entry->rel = joinrel;
+		}
+
+		foreach(lc, root->join_rel_level[lev])
+			joingraph_finish_rel(root, (RelOptInfo *) lfirst(lc));
+	}
+
+	root->join_rel_level = NULL;
+
+	entry = (JoinGraphRel *) hash_search(rels, &all, HASH_FIND, NULL);
+	result = entry ? entry->rel : NULL;
+
+	hash_destroy(rels);
+
+	if (result == NULL)
+	{
+		root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+		root->join_rel_hash = savehash;
+	}
+
+	return result;
+}
+
+/*
+ * joingraph_greedy_search
+ *	  Build a single join tree by repeatedly joining the two clumps whose
+ *	  join is estimated to produce the fewest rows.
+ *
+ * As in GEQO's gimme_tree(), pairs of clumps that are related by a join
+ * clause or join order restriction are preferred; clauseless joins are
+ * considered only if no such pair can be joined.
+ */
+static RelOptInfo *
+joingraph_greedy_search(JoinGraph *graph)
+{
+	PlannerInfo *root = graph->root;
+	JoinGraphClump *clumps;
+	int			nclumps = graph->nitems;
+	int			nextid = graph->nitems;
+	HASHCTL		hashctl;
+	HTAB	   *joins;
+	int			i;
+
+	clumps = (JoinGraphClump *) palloc(nclumps * sizeof(JoinGraphClump));
+	for (i = 0; i < nclumps; i++)
+	{
+		clumps[i].id = i;
+		clumps[i].rel = graph->items[i];
+	}
+
+	/* Joins of unchanged clumps are remembered across rounds */
+	hashctl.keysize = 2 * sizeof(int);
+	hashctl.entrysize = sizeof(JoinGraphClumpPair);
+	hashctl.hcxt = CurrentMemoryContext;
+	joins = hash_create("join graph clump pairs", 256, &hashctl,
+						HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	while (nclumps > 1)
+	{
+		RelOptInfo *bestrel = NULL;
+		int			besti = -1;
+		int			bestj = -1;
+		int			pass;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (pass = 0; pass < 2 && bestrel == NULL; pass++)
+		{
+			for (i = 0; i < nclumps; i++)
+			{
+				int			j;
+
+				for (j = i + 1; j < nclumps; j++)
+				{
+					JoinGraphClumpPair *pairent;
+					int			ids[2];
+					bool		found;
+
+					if (pass == 0 &&
+						!joingraph_rels_related(root, clumps[i].rel,
+												clumps[j].rel))
+						continue;
+
+					ids[0] = clumps[i].id;
+					ids[1] = clumps[j].id;
+					pairent = (JoinGraphClumpPair *)
+						hash_search(joins, ids, HASH_ENTER, &found);
+					if (!found)
+						pairent->rel = make_join_rel(root, clumps[i].rel,
+													 clumps[j].rel);
+
+					if (pairent->rel == NULL)
+						continue;
+
+					if (bestrel == NULL || pairent->rel->rows < bestrel->rows)
+					{
+						bestrel = pairent->rel;
+						besti = i;
+						bestj = j;
+					}
+				}
+			}
+		}
+
+		if (bestrel == NULL)
+			elog(ERROR, "failed to join all relations together");
+
+		joingraph_finish_rel(root, bestrel);
+
+		clumps[besti].id = nextid++;
+		clumps[besti].rel = bestrel;
+		memmove(&clumps[bestj], &clumps[bestj + 1],
+				(nclumps - bestj - 1) * sizeof(JoinGraphClump));
+		nclumps--;
+	}
+
+	hash_destroy(joins);
+
+	return clumps[0].rel;
+}
+
+/*
+ * joingraph_finish_rel
+ *	  Add the paths that can only be built once all ways of producing the
+ *	  joinrel have been considered, then pick its cheapest paths.  This is
+ *	  the same work standard_join_search() does at the end of each level.
+ */
+static void
+joingraph_finish_rel(PlannerInfo *root, RelOptInfo *rel)
+{
+	generate_partitionwise_join_paths(root, rel);
+
+	if (!bms_equal(rel->relids, root->all_query_rels))
+		generate_useful_gather_paths(root, rel, false);
+
+	set_cheapest(rel);
+}
@@ -18,6 +18,7 @@
 
 #include <math.h>
 
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
 #include "foreign/fdwapi.h"
@@ -161,8 +162,14 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 										  CustomPath *best_path,
 										  List *tlist, List *scan_clauses);
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
+static bool nestloop_inner_is_stable(Path *inner_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static List *get_append_prune_quals(PlannerInfo *root, RelOptInfo *rel,
+									Path *best_path);
+static void make_hashjoin_outer_pruning(PlannerInfo *root, HashPath *best_path,
+										Plan *outer_plan, Hash *hash_plan,
+										List *hashclauses);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -186,13 +193,14 @@ static IndexScan *make_indexscan(List *qptlist, List *qpqual, Index scanrelid,
 								 Oid indexid, List *indexqual, List *indexqualorig,
 								 List *indexorderby, List *indexorderbyorig,
 								 List *indexorderbyops,
-								 ScanDirection indexscandir);
+								 ScanDirection indexscandir, bool indexskip);
 static IndexOnlyScan *make_indexonlyscan(List *qptlist, List *qpqual,
 										 Index scanrelid, Oid indexid,
 										 List *indexqual, List *recheckqual,
 										 List *indexorderby,
 										 List *indextlist,
-										 ScanDirection indexscandir);
+										 ScanDirection indexscandir,
+										 bool indexskip);
 static BitmapIndexScan *make_bitmap_indexscan(Index scanrelid, Oid indexid,
 											  List *indexqual,
 											  List *indexqualorig);
@@ -231,6 +239,7 @@ static BitmapAnd *make_bitmap_and(List *bitmapplans);
 static BitmapOr *make_bitmap_or(List *bitmapplans);
 static NestLoop *make_nestloop(List *tlist,
 							   List *joinclauses, List *otherclauses, List *nestParams,
+							   List *hashclauses,
 							   Plan *lefttree, Plan *righttree,
 							   JoinType jointype, bool inner_unique);
 static HashJoin *make_hashjoin(List *tlist,
@@ -805,6 +814,34 @@ create_scan_plan(PlannerInfo *root, Path *best_path, int flags)
 			break;
 	}
 
+	/*
+	 * Tell the executor to report the scan's row count for cardinality
+	 * feedback, if the planner looked up a correction for the rel.  Only
+	 * scans whose output is an estimate of rel->rows qualify: not
+	 * parameterized or parallel-aware scans, nor skipping index scans.
+	 */
+	if (rel->feedback_key != 0 && best_path->param_info == NULL &&
+		!best_path->parallel_aware &&
+		!((best_path->pathtype == T_IndexScan ||
+		   best_path->pathtype == T_IndexOnlyScan) &&
+		  ((IndexPath *) best_path)->indexskip))
+	{
+		switch (best_path->pathtype)
+		{
+			case T_SeqScan:
+			case T_IndexScan:
+			case T_IndexOnlyScan:
+			case T_BitmapHeapScan:
+			case T_TidScan:
+			case T_TidRangeScan:
+				((Scan *) plan)->feedback_key = rel->feedback_key;
+				((Scan *) plan)->feedback_rows = rel->feedback_rows;
+				break;
+			default:
+				break;
+		}
+	}
+
 	/*
 	 * If there are any pseudoconstant clauses attached to this node, insert a
 	 * gating Result node that evaluates the pseudoconstants as one-time
@@ -1385,18 +1422,7 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 	{
 		List	   *prunequal;
 
-		prunequal = extract_actual_clauses(rel->baserestrictinfo, false);
-
-		if (best_path->path.param_info)
-		{
-			List	   *prmquals = best_path->path.param_info->ppi_clauses;
-
-			prmquals = extract_actual_clauses(prmquals, false);
-			prmquals = (List *) replace_nestloop_params(root,
-														(Node *) prmquals);
-
-			prunequal = list_concat(prunequal, prmquals);
-		}
+		prunequal = get_append_prune_quals(root, rel, &best_path->path);
 
 		if (prunequal != NIL)
 			partpruneinfo =
@@ -3020,6 +3046,7 @@ create_indexscan_plan(PlannerInfo *root,
 	List	   *fixed_indexquals;
 	List	   *fixed_indexorderbys;
 	List	   *indexorderbyops = NIL;
+	bool		indexskip;
 	ListCell   *l;
 
 	/* it should be a base rel... */
@@ -3165,6 +3192,14 @@ create_indexscan_plan(PlannerInfo *root,
 		}
 	}
 
+	/*
+	 * A skipping scan moves on to the next group as soon as it has returned
+	 * a tuple, so it must not have any quals of its own to reject tuples
+	 * with.  The planner checks for that when building the path; should the
+	 * quals turn out otherwise, just don't skip, which is always correct.
+	 */
+	indexskip = best_path->indexskip && qpqual == NIL;
+
 	/* Finally ready to build the plan node */
 	if (indexonly)
 		scan_plan = (Scan *) make_indexonlyscan(tlist,
@@ -3175,7 +3210,8 @@ create_indexscan_plan(PlannerInfo *root,
 												stripped_indexquals,
 												fixed_indexorderbys,
 												indexinfo->indextlist,
-												best_path->indexscandir);
+												best_path->indexscandir,
+												indexskip);
 	else
 		scan_plan = (Scan *) make_indexscan(tlist,
 											qpqual,
@@ -3186,7 +3222,8 @@ create_indexscan_plan(PlannerInfo *root,
 											fixed_indexorderbys,
 											indexorderbys,
 											indexorderbyops,
-											best_path->indexscandir);
+											best_path->indexscandir,
+											indexskip);
 
 	copy_generic_path_info(&scan_plan->plan, &best_path->path);
 
@@ -4357,6 +4394,7 @@ create_nestloop_plan(PlannerInfo *root,
 	List	   *otherclauses;
 	Relids		outerrelids;
 	List	   *nestParams;
+	List	   *hashclauses;
 	Relids		saveOuterRels = root->curOuterRels;
 
 	/*
@@ -4422,10 +4460,53 @@ create_nestloop_plan(PlannerInfo *root,
 	outerrelids = best_path->jpath.outerjoinpath->parent->relids;
 	nestParams = identify_current_nestloop_params(root, outerrelids);
 
+	/*
+	 * If the inner side is rescanned without parameters and is sure to
+	 * return the same rows each time, the executor may replace the rescans
+	 * with probes into a hash table of the inner rows, should the outer side
+	 * turn out much larger than estimated.  That needs hashable join clauses
+	 * of the form "outer = inner", with the outer side on the left.
+	 */
+	hashclauses = NIL;
+	if (enable_adaptive_join && nestParams == NIL &&
+		best_path->jpath.path.param_info == NULL &&
+		nestloop_inner_is_stable(best_path->jpath.innerjoinpath))
+	{
+		JoinType	jointype = best_path->jpath.jointype;
+		Relids		joinrelids = best_path->jpath.path.parent->relids;
+		Relids		innerrelids = best_path->jpath.innerjoinpath->parent->relids;
+		List	   *hashrinfos = NIL;
+		ListCell   *lc;
+
+		if (jointype == JOIN_INNER || jointype == JOIN_LEFT ||
+			jointype == JOIN_SEMI || jointype == JOIN_ANTI)
+		{
+			foreach(lc, best_path->jpath.joinrestrictinfo)
+			{
+				RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+				if (IS_OUTER_JOIN(jointype) &&
+					RINFO_IS_PUSHED_DOWN(rinfo, joinrelids))
+					continue;
+				if (!rinfo->can_join ||
+					!OidIsValid(rinfo->hashjoinoperator))
+					continue;
+				if (!((bms_is_subset(rinfo->left_relids, outerrelids) &&
+					   bms_is_subset(rinfo->right_relids, innerrelids)) ||
+					  (bms_is_subset(rinfo->left_relids, innerrelids) &&
+					   bms_is_subset(rinfo->right_relids, outerrelids))))
+					continue;
+				hashrinfos = lappend(hashrinfos, rinfo);
+			}
+		}
+		hashclauses = get_switched_clauses(hashrinfos, outerrelids);
+	}
+
 	join_plan = make_nestloop(tlist,
 							  joinclauses,
 							  otherclauses,
 							  nestParams,
+							  hashclauses,
 							  outer_plan,
 							  inner_plan,
 							  best_path->jpath.jointype,
@@ -4436,6 +4517,39 @@ create_nestloop_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+/*
+ * nestloop_inner_is_stable
+ *	  Does the given unparameterized nestloop inner path return the same
+ *	  rows every time it is rescanned?
+ *
+ * A Material node does, since it replays what it stored.  So does a plain
+ * scan of a table, as long as it evaluates no volatile functions.
+ */
+static bool
+nestloop_inner_is_stable(Path *inner_path)
+{
+	RelOptInfo *rel = inner_path->parent;
+
+	if (IsA(inner_path, MaterialPath))
+		return true;
+
+	if (rel->reloptkind != RELOPT_BASEREL || rel->rtekind != RTE_RELATION)
+		return false;
+	switch (inner_path->pathtype)
+	{
+		case T_SeqScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+			break;
+		default:
+			return false;
+	}
+
+	return !contain_volatile_functions((Node *) rel->baserestrictinfo) &&
+		!contain_volatile_functions((Node *) rel->reltarget->exprs);
+}
+
 static MergeJoin *
 create_mergejoin_plan(PlannerInfo *root,
 					  MergePath *best_path)
@@ -4888,6 +5002,14 @@ create_hashjoin_plan(PlannerInfo *root,
 	copy_plan_costsize(&hash_plan->plan, inner_plan);
 	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
 
+	/*
+	 * If the outer side scans a partitioned table, the range of the inner
+	 * join keys may allow it to skip partitions at run time.
+	 */
+	if (enable_partition_pruning)
+		make_hashjoin_outer_pruning(root, best_path, outer_plan, hash_plan,
+									hashclauses);
+
 	/*
 	 * If parallel-aware, the executor will also need an estimate of the total
 	 * number of rows expected from all participants so that it can size the
@@ -4916,6 +5038,198 @@ create_hashjoin_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+/*
+ * get_append_prune_quals
+ *	  Collect the quals that may be used for run-time partition pruning by
+ *	  an Append or MergeAppend scanning the partitioned relation 'rel'.
+ */
+static List *
+get_append_prune_quals(PlannerInfo *root, RelOptInfo *rel, Path *best_path)
+{
+	List	   *prunequal;
+
+	prunequal = extract_actual_clauses(rel->baserestrictinfo, false);
+
+	if (best_path->param_info)
+	{
+		List	   *prmquals = best_path->param_info->ppi_clauses;
+
+		prmquals = extract_actual_clauses(prmquals, false);
+		prmquals = (List *) replace_nestloop_params(root,
+													(Node *) prmquals);
+
+		prunequal = list_concat(prunequal, prmquals);
+	}
+
+	return prunequal;
+}
+
+/*
+ * make_hashjoin_outer_pruning
+ *	  Arrange for a hash join to prune the partitions of its outer side
+ *	  using the range of the inner join keys.
+ *
+ * If the outer side is an Append or MergeAppend over a range- or
+ * list-partitioned table and one of the hash clauses compares a partition
+ * key with an inner expression, we make two PARAM_EXEC Params, add the quals
+ * "partkey >= $min AND partkey <= $max" to the Append's run-time pruning
+ * quals, and ask the Hash node to set the Params to the smallest and
+ * largest inner key once the hash table has been built.  Partitions whose
+ * bounds lie outside that range cannot produce a join row, so the Append
+ * never scans them.
+ *
+ * This is only done for join types that don't emit unmatched outer rows.
+ * A Parallel Hash can only share the range of pass-by-value keys among the
+ * participants, so other keys are skipped in that case.
+ */
+static void
+make_hashjoin_outer_pruning(PlannerInfo *root, HashPath *best_path,
+							Plan *outer_plan, Hash *hash_plan,
+							List *hashclauses)
+{
+	Path	   *outer_path = best_path->jpath.outerjoinpath;
+	RelOptInfo *rel = outer_path->parent;
+	PartitionScheme part_scheme = rel->part_scheme;
+	List	   *subpaths;
+	ListCell   *lc;
+
+	switch (best_path->jpath.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_SEMI:
+		case JOIN_RIGHT:
+		case JOIN_RIGHT_ANTI:
+			break;
+		default:
+			return;
+	}
+
+	if (IsA(outer_plan, Append) && IsA(outer_path, AppendPath))
+		subpaths = ((AppendPath *) outer_path)->subpaths;
+	else if (IsA(outer_plan, MergeAppend) && IsA(outer_path, MergeAppendPath))
+		subpaths = ((MergeAppendPath *) outer_path)->subpaths;
+	else
+		return;
+
+	if (rel->reloptkind != RELOPT_BASEREL || part_scheme == NULL ||
+		part_scheme->strategy == PARTITION_STRATEGY_HASH)
+		return;
+
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+		Expr	   *outerkey = (Expr *) linitial(hclause->args);
+		Expr	   *innerkey = (Expr *) lsecond(hclause->args);
+		Expr	   *keyexpr = outerkey;
+		int			i;
+
+		if (IsA(keyexpr, RelabelType))
+			keyexpr = ((RelabelType *) keyexpr)->arg;
+
+		for (i = 0; i < part_scheme->partnatts; i++)
+		{
+			Oid			opfamily = part_scheme->partopfamily[i];
+			Oid			partcoll = part_scheme->partcollation[i];
+			int			strategy;
+			Oid			lefttype;
+			Oid			righttype;
+			Oid			geop;
+			Oid			leop;
+			Oid			sortop;
+			Param	   *minparam;
+			Param	   *maxparam;
+			List	   *prunequal;
+			PartitionPruneInfo *pruneinfo;
+			ListCell   *lc2;
+			bool		useful = false;
+
+			if (!list_member(rel->partexprs[i], keyexpr))
+				continue;
+
+			/*
+			 * Equal keys must also compare equal in the partition key's
+			 * ordering, else the range could exclude matching partitions.
+			 */
+			if (!op_in_opfamily(hclause->opno, opfamily))
+				continue;
+			get_op_opfamily_properties(hclause->opno, opfamily, false,
+									   &strategy, &lefttype, &righttype);
+			if (strategy != BTEqualStrategyNumber)
+				continue;
+			if (OidIsValid(partcoll) && hclause->inputcollid != partcoll)
+				continue;
+
+			if (best_path->jpath.path.parallel_aware &&
+				!get_typbyval(righttype))
+				continue;
+
+			geop = get_opfamily_member(opfamily, lefttype, righttype,
+									   BTGreaterEqualStrategyNumber);
+			leop = get_opfamily_member(opfamily, lefttype, righttype,
+									   BTLessEqualStrategyNumber);
+			sortop = get_opfamily_member(opfamily, righttype, righttype,
+										 BTLessStrategyNumber);
+			if (!OidIsValid(geop) || !OidIsValid(leop) || !OidIsValid(sortop))
+				continue;
+
+			minparam = generate_new_exec_param(root, righttype,
+											   exprTypmod((Node *) innerkey),
+											   exprCollation((Node *) innerkey));
+			maxparam = generate_new_exec_param(root, righttype,
+											   exprTypmod((Node *) innerkey),
+											   exprCollation((Node *) innerkey));
+
+			prunequal = get_append_prune_quals(root, rel, outer_path);
+			prunequal = lappend(prunequal,
+								make_opclause(geop, BOOLOID, false,
+											  outerkey, (Expr *) minparam,
+											  InvalidOid,
+											  hclause->inputcollid));
+			prunequal = lappend(prunequal,
+								make_opclause(leop, BOOLOID, false,
+											  outerkey, (Expr *) maxparam,
+											  InvalidOid,
+											  hclause->inputcollid));
+
+			pruneinfo = make_partition_pruneinfo(root, rel, subpaths,
+												 prunequal);
+			if (pruneinfo == NULL)
+				continue;
+
+			/* Make sure the new quals actually produced pruning steps */
+			foreach(lc2, pruneinfo->prune_infos)
+			{
+				ListCell   *lc3;
+
+				foreach(lc3, (List *) lfirst(lc2))
+				{
+					PartitionedRelPruneInfo *pinfo = lfirst(lc3);
+
+					if (bms_is_member(minparam->paramid, pinfo->execparamids) ||
+						bms_is_member(maxparam->paramid, pinfo->execparamids))
+						useful = true;
+				}
+			}
+			if (!useful)
+				continue;
+
+			if (IsA(outer_plan, Append))
+				((Append *) outer_plan)->part_prune_info = pruneinfo;
+			else
+				((MergeAppend *) outer_plan)->part_prune_info = pruneinfo;
+
+			hash_plan->pruneKey = innerkey;
+			hash_plan->pruneSortOp = sortop;
+			hash_plan->pruneCollation = hclause->inputcollid;
+			hash_plan->pruneParamMin = minparam->paramid;
+			hash_plan->pruneParamMax = maxparam->paramid;
+
+			/* One key range is enough */
+			return;
+		}
+	}
+}
+
 
 /*****************************************************************************
  *
@@ -5551,7 +5865,8 @@ make_indexscan(List *qptlist,
 			   List *indexorderby,
 			   List *indexorderbyorig,
 			   List *indexorderbyops,
-			   ScanDirection indexscandir)
+			   ScanDirection indexscandir,
+			   bool indexskip)
 {
 	IndexScan  *node = makeNode(IndexScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5568,6 +5883,7 @@ make_indexscan(List *qptlist,
 	node->indexorderbyorig = indexorderbyorig;
 	node->indexorderbyops = indexorderbyops;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5581,7 +5897,8 @@ make_indexonlyscan(List *qptlist,
 				   List *recheckqual,
 				   List *indexorderby,
 				   List *indextlist,
-				   ScanDirection indexscandir)
+				   ScanDirection indexscandir,
+				   bool indexskip)
 {
 	IndexOnlyScan *node = makeNode(IndexOnlyScan);
 	Plan	   *plan = &node->scan.plan;
@@ -5597,6 +5914,7 @@ make_indexonlyscan(List *qptlist,
 	node->indexorderby = indexorderby;
 	node->indextlist = indextlist;
 	node->indexorderdir = indexscandir;
+	node->indexskip = indexskip;
 
 	return node;
 }
@@ -5950,6 +6268,7 @@ make_nestloop(List *tlist,
 			  List *joinclauses,
 			  List *otherclauses,
 			  List *nestParams,
+			  List *hashclauses,
 			  Plan *lefttree,
 			  Plan *righttree,
 			  JoinType jointype,
@@ -5966,6 +6285,7 @@ make_nestloop(List *tlist,
 	node->join.inner_unique = inner_unique;
 	node->join.joinqual = joinclauses;
 	node->nestParams = nestParams;
+	node->hashclauses = hashclauses;
 
 	return node;
 }
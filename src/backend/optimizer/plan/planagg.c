@@ -471,6 +471,67 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	return true;
 }
 
+/*
+ * get_common_minmax_agg
+ *		Check whether every aggregate in the query is a MIN or MAX of one
+ *		common argument expression, using one common sort operator.
+ *
+ * If so, return true and pass back the argument, the sort operator and the
+ * input collation.  In that case each aggregate's result for a group is the
+ * first non-null argument value of the group in the sort operator's order,
+ * which is what lets the planner satisfy grouped MIN/MAX aggregates by
+ * skipping through a suitably ordered index.  The checks here mirror those
+ * in can_minmax_aggs().
+ */
+bool
+get_common_minmax_agg(PlannerInfo *root, Expr **target, Oid *sortop,
+					  Oid *inputcollid)
+{
+	ListCell   *lc;
+
+	*target = NULL;
+	*sortop = InvalidOid;
+	*inputcollid = InvalidOid;
+
+	if (root->agginfos == NIL)
+		return false;
+
+	foreach(lc, root->agginfos)
+	{
+		AggInfo    *agginfo = lfirst_node(AggInfo, lc);
+		Aggref	   *aggref = linitial_node(Aggref, agginfo->aggrefs);
+		TargetEntry *curTarget;
+		Oid			aggsortop;
+
+		Assert(aggref->agglevelsup == 0);
+		if (list_length(aggref->args) != 1)
+			return false;		/* it couldn't be MIN/MAX */
+
+		/* see can_minmax_aggs() about ORDER BY and FILTER */
+		if (aggref->aggorder != NIL || aggref->aggfilter != NULL)
+			return false;
+
+		aggsortop = fetch_agg_sort_op(aggref->aggfnoid);
+		if (!OidIsValid(aggsortop))
+			return false;		/* not a MIN/MAX aggregate */
+
+		curTarget = (TargetEntry *) linitial(aggref->args);
+
+		if (*target == NULL)
+		{
+			*target = curTarget->expr;
+			*sortop = aggsortop;
+			*inputcollid = aggref->inputcollid;
+		}
+		else if (aggsortop != *sortop ||
+				 aggref->inputcollid != *inputcollid ||
+				 !equal(curTarget->expr, *target))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Compute query_pathkeys and other pathkeys during query_planner()
  */
@@ -19,7 +19,9 @@
 #include <math.h>
 
 #include "access/genam.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/pg_aggregate.h"
@@ -55,12 +57,16 @@
 #include "parser/analyze.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_clause.h"
+#include "parser/parse_coerce.h"
+#include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #include "partitioning/partdesc.h"
 #include "utils/lsyscache.h"
+#include "utils/queryresultcache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/typcache.h"
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
@@ -89,6 +95,12 @@ create_upper_paths_hook_type create_upper_paths_hook = NULL;
 #define EXPRKIND_TABLEFUNC			11
 #define EXPRKIND_TABLEFUNC_LATERAL	12
 
+/*
+ * Eager aggregation is only considered if partially aggregating a relation
+ * is expected to leave at most this fraction of its rows.
+ */
+#define EAGER_AGG_MAX_GROUP_FRACTION	0.5
+
 /*
  * Data specific to grouping sets
  */
@@ -196,6 +208,8 @@ static void create_partial_distinct_paths(PlannerInfo *root,
 static RelOptInfo *create_final_distinct_paths(PlannerInfo *root,
 											   RelOptInfo *input_rel,
 											   RelOptInfo *distinct_rel);
+static Path *make_index_skip_path(PlannerInfo *root, RelOptInfo *input_rel,
+								  Path *path, double ngroups, bool minmax);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
 										RelOptInfo *input_rel,
 										PathTarget *target,
@@ -233,6 +247,16 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 grouping_sets_data *gd,
 												 GroupPathExtraData *extra,
 												 bool force_rel_creation);
+static void add_eager_aggregation_paths(PlannerInfo *root,
+										RelOptInfo *input_rel,
+										RelOptInfo *grouped_rel,
+										double dNumGroups,
+										GroupPathExtraData *extra);
+static bool eager_agg_key_is_equalimage(Var *var);
+static RelOptInfo *make_eager_grouped_rel(PlannerInfo *root, RelOptInfo *rel,
+										  RelOptInfo *otherrel,
+										  PathTarget *partial_target,
+										  GroupPathExtraData *extra);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
@@ -294,9 +318,21 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	RelOptInfo *final_rel;
 	Path	   *best_path;
 	Plan	   *top_plan;
+	bool		result_cacheable;
 	ListCell   *lp,
 			   *lr;
 
+	/*
+	 * Decide whether the query result cache may keep the result, as far as
+	 * the query itself goes.  This has to look at the Query tree before
+	 * planning turns its sublinks into subplans.
+	 */
+	result_cacheable = (query_result_cache_size > 0 &&
+						parse->commandType == CMD_SELECT &&
+						parse->utilityStmt == NULL &&
+						!parse->hasModifyingCTE &&
+						!contain_mutable_functions((Node *) parse));
+
 	/*
 	 * Set up global state for this planner invocation.  This data is needed
 	 * across all levels of sub-Query that might exist in the given command,
@@ -315,6 +351,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	glob->finalrowmarks = NIL;
 	glob->resultRelations = NIL;
 	glob->appendRelations = NIL;
+	glob->partPruneInfos = NIL;
+	glob->prunableRelids = NULL;
 	glob->relationOids = NIL;
 	glob->invalItems = NIL;
 	glob->paramExecTypes = NIL;
@@ -332,13 +370,13 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 * functions are present in the query tree.
 	 *
 	 * (Note that we do allow CREATE TABLE AS, SELECT INTO, and CREATE
-	 * MATERIALIZED VIEW to use parallel plans, but this is safe only because
-	 * the command is writing into a completely new table which workers won't
-	 * be able to see.  If the workers could see the table, the fact that
-	 * group locking would cause them to ignore the leader's heavyweight GIN
-	 * page locks would make this unsafe.  We'll have to fix that somehow if
-	 * we want to allow parallel inserts in general; updates and deletes have
-	 * additional problems especially around combo CIDs.)
+	 * MATERIALIZED VIEW to use parallel plans, since the command is writing
+	 * into a completely new table.  INSERT ... SELECT is allowed too, if
+	 * is_parallel_insert_safe() finds nothing attached to the target that
+	 * would have to run in the leader; relation extension and page locks
+	 * conflict even among members of a lock group, so participants can
+	 * safely write the same table.  Updates and deletes have additional
+	 * problems especially around combo CIDs.)
 	 *
 	 * For now, we don't try to use parallel mode if we're running inside a
 	 * parallel worker.  We might eventually be able to relax this
@@ -347,10 +385,13 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 */
 	if ((cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
 		IsUnderPostmaster &&
-		parse->commandType == CMD_SELECT &&
+		(parse->commandType == CMD_SELECT ||
+		 parse->commandType == CMD_INSERT) &&
 		!parse->hasModifyingCTE &&
 		max_parallel_workers_per_gather > 0 &&
-		!IsParallelWorker())
+		!IsParallelWorker() &&
+		(parse->commandType == CMD_SELECT ||
+		 is_parallel_insert_safe(parse)))
 	{
 		/* all the cheap tests pass, so scan the query tree */
 		glob->maxParallelHazard = max_parallel_hazard(parse);
@@ -522,6 +563,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	Assert(glob->finalrowmarks == NIL);
 	Assert(glob->resultRelations == NIL);
 	Assert(glob->appendRelations == NIL);
+	Assert(glob->partPruneInfos == NIL);
+	Assert(glob->prunableRelids == NULL);
 	top_plan = set_plan_references(root, top_plan);
 	/* ... and the subplans (both regular subplans and initplans) */
 	Assert(list_length(glob->subplans) == list_length(glob->subroots));
@@ -533,6 +576,18 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
 
+	/* A sampled scan needn't return the same rows twice */
+	if (result_cacheable)
+	{
+		foreach(lp, glob->finalrtable)
+		{
+			RangeTblEntry *rte = lfirst_node(RangeTblEntry, lp);
+
+			if (rte->tablesample != NULL)
+				result_cacheable = false;
+		}
+	}
+
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
 
@@ -544,6 +599,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->transientPlan = glob->transientPlan;
 	result->dependsOnRole = glob->dependsOnRole;
 	result->parallelModeNeeded = glob->parallelModeNeeded;
+	result->resultCacheable = result_cacheable && !glob->dependsOnRole &&
+		glob->finalrowmarks == NIL;
 	result->planTree = top_plan;
 	result->rtable = glob->finalrtable;
 	result->permInfos = glob->finalrteperminfos;
@@ -552,6 +609,29 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->subplans = glob->subplans;
 	result->rewindPlanIDs = glob->rewindPlanIDs;
 	result->rowMarks = glob->finalrowmarks;
+
+	/*
+	 * Partitions that are result relations or carry row marks get opened by
+	 * the executor whether or not they survive pruning, so those don't count
+	 * as prunable for locking purposes.
+	 */
+	result->partPruneInfos = glob->partPruneInfos;
+	result->prunableRelids = glob->prunableRelids;
+	if (result->prunableRelids != NULL)
+	{
+		foreach(lp, glob->resultRelations)
+			result->prunableRelids = bms_del_member(result->prunableRelids,
+													lfirst_int(lp));
+		foreach(lp, glob->finalrowmarks)
+		{
+			PlanRowMark *rc = lfirst_node(PlanRowMark, lp);
+
+			result->prunableRelids = bms_del_member(result->prunableRelids,
+													rc->rti);
+		}
+		if (bms_is_empty(result->prunableRelids))
+			result->partPruneInfos = NIL;
+	}
 	result->relationOids = glob->relationOids;
 	result->invalItems = glob->invalItems;
 	result->paramExecTypes = glob->paramExecTypes;
@@ -1995,6 +2075,52 @@ grouping_planner(PlannerInfo *root, double tuple_fraction,
 		add_path(final_rel, path);
 	}
 
+	/*
+	 * If the rows of an INSERT can be written by parallel workers, also
+	 * consider running the ModifyTable in every participant, atop the
+	 * cheapest partial path, so that only row counts need to come back
+	 * through the Gather.  standard_planner has already checked the target
+	 * with is_parallel_insert_safe(), and the partial paths survive
+	 * apply_scanjoin_target_to_paths() only if the inserted values can be
+	 * computed in workers.
+	 */
+	if (parse->commandType == CMD_INSERT &&
+		root->glob->parallelModeOK && root->query_level == 1 &&
+		current_rel->partial_pathlist != NIL)
+	{
+		Path	   *partial_path = (Path *) linitial(current_rel->partial_pathlist);
+		Path	   *path;
+
+		Assert(parse->onConflict == NULL && parse->returningList == NIL &&
+			   parse->withCheckOptions == NIL && parse->rowMarks == NIL);
+
+		path = (Path *)
+			create_modifytable_path(root, final_rel,
+									partial_path,
+									parse->commandType,
+									parse->canSetTag,
+									parse->resultRelation,
+									0,
+									false,
+									list_make1_int(parse->resultRelation),
+									NIL,
+									NIL,
+									NIL,
+									NIL,
+									NULL,
+									NIL,
+									NIL,
+									assign_special_exec_param(root));
+		path->parallel_safe = true;
+		path->parallel_workers = partial_path->parallel_workers;
+
+		/* The Gather returns no columns, just waits for the participants */
+		path = (Path *)
+			create_gather_path(root, final_rel, path,
+							   create_empty_pathtarget(), NULL, NULL);
+		add_path(final_rel, path);
+	}
+
 	/*
 	 * Generate partial paths for final_rel, too, if outer query levels might
 	 * be able to make use of them.
@@ -4101,6 +4227,13 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 							  partially_grouped_rel, agg_costs, gd,
 							  dNumGroups, extra);
 
+	/* Consider partially aggregating one input of the join, if enabled */
+	if (enable_eager_aggregate &&
+		(extra->flags & GROUPING_CAN_PARTIAL_AGG) != 0 &&
+		!IS_OTHER_REL(input_rel))
+		add_eager_aggregation_paths(root, input_rel, grouped_rel,
+									dNumGroups, extra);
+
 	/* Give a helpful error if we failed to find any implementation */
 	if (grouped_rel->pathlist == NIL)
 		ereport(ERROR,
@@ -5168,6 +5301,25 @@ create_final_distinct_paths(PlannerInfo *root, RelOptInfo *input_rel,
 												  list_length(root->distinct_pathkeys),
 												  numDistinctRows));
 			}
+
+			/*
+			 * If the input is an index scan whose leading column is the only
+			 * DISTINCT key, it can skip straight to the next distinct value
+			 * after each row it returns.  We still need the Unique node, as
+			 * the index AM is free to decline to skip.
+			 */
+			if (is_sorted && list_length(root->distinct_pathkeys) == 1)
+			{
+				Path	   *skip_path;
+
+				skip_path = make_index_skip_path(root, input_rel, input_path,
+												 numDistinctRows, false);
+				if (skip_path != NULL)
+					add_path(distinct_rel, (Path *)
+							 create_upper_unique_path(root, distinct_rel,
+													  skip_path, 1,
+													  numDistinctRows));
+			}
 		}
 	}
 
@@ -5209,6 +5361,168 @@ create_final_distinct_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	return distinct_rel;
 }
 
+/*
+ * make_index_skip_path
+ *		Try to build a variant of 'path' that skips over duplicate values of
+ *		its leading sort key, returning only the first row of each group.
+ *
+ * This works only if 'path' is a plain index scan on a single base relation
+ * (possibly under a projection), its leading pathkey is the index's first
+ * column, and every restriction clause is checked by the index itself, so
+ * that the first row the index returns for a value is also the first row of
+ * the group.  The index AM's own conditions for skipping must hold too.  If
+ * 'minmax' is true, the caller will be computing MIN or MAX aggregates over
+ * each group, so we additionally insist that the index's second column, as
+ * scanned, orders the common aggregate argument the way the aggregates want,
+ * with NULLs last; then the first row of each group is also the one holding
+ * the aggregates' result.
+ *
+ * Returns NULL if the path can't be made to skip.
+ */
+static Path *
+make_index_skip_path(PlannerInfo *root, RelOptInfo *input_rel, Path *path,
+					 double ngroups, bool minmax)
+{
+	ProjectionPath *ppath = NULL;
+	IndexPath  *ipath;
+	IndexOptInfo *index;
+	PathKey    *pathkey;
+	TargetEntry *tle;
+	Oid			storetype;
+	ListCell   *lc;
+
+	if (input_rel->reloptkind != RELOPT_BASEREL)
+		return NULL;
+
+	if (IsA(path, ProjectionPath))
+	{
+		ppath = (ProjectionPath *) path;
+		path = ppath->subpath;
+	}
+	if (!IsA(path, IndexPath))
+		return NULL;
+	ipath = (IndexPath *) path;
+	index = ipath->indexinfo;
+
+	if (!index->amcanskip || index->sortopfamily == NULL ||
+		path->param_info != NULL || path->parallel_aware ||
+		path->pathkeys == NIL)
+		return NULL;
+
+	/* The leading pathkey must be the index's first column */
+	pathkey = linitial_node(PathKey, path->pathkeys);
+	tle = linitial_node(TargetEntry, index->indextlist);
+	if (pathkey->pk_opfamily != index->sortopfamily[0] ||
+		find_ec_member_matching_expr(pathkey->pk_eclass, tle->expr,
+									 index->rel->relids) == NULL)
+		return NULL;
+
+	/*
+	 * Each restriction clause must be an exact index qual; a row removed by
+	 * a filter above the scan could otherwise hide the rest of its group.
+	 */
+	foreach(lc, index->indrestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		bool		found = false;
+		ListCell   *lc2;
+
+		if (rinfo->pseudoconstant)
+			continue;
+
+		foreach(lc2, ipath->indexclauses)
+		{
+			IndexClause *iclause = lfirst_node(IndexClause, lc2);
+
+			if (iclause->rinfo == rinfo && !iclause->lossy)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return NULL;
+	}
+
+	/*
+	 * If _bt_skip_setup refused to skip at execution time, the scan would
+	 * read every row, at a cost far beyond what we'd estimate for it.  So
+	 * check the same things it does: no array keys, a leading column stored
+	 * as the opclass's input type, and a full set of comparison operators
+	 * for that type.
+	 */
+	foreach(lc, ipath->indexclauses)
+	{
+		IndexClause *iclause = lfirst_node(IndexClause, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, iclause->indexquals)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+			if (IsA(rinfo->clause, ScalarArrayOpExpr))
+				return NULL;
+		}
+	}
+
+	storetype = get_atttype(index->indexoid, 1);
+	if (storetype != index->opcintype[0] &&
+		!IsBinaryCoercible(storetype, index->opcintype[0]))
+		return NULL;
+
+	for (int strat = 1; strat <= BTMaxStrategyNumber; strat++)
+	{
+		if (!OidIsValid(get_opfamily_member(index->opfamily[0],
+											index->opcintype[0],
+											index->opcintype[0],
+											strat)))
+			return NULL;
+	}
+
+	if (minmax)
+	{
+		Expr	   *target;
+		Oid			sortop;
+		Oid			inputcollid;
+
+		bool		descending;
+		bool		nulls_first;
+
+		if (!get_common_minmax_agg(root, &target, &sortop, &inputcollid))
+			return NULL;
+		if (index->nkeycolumns < 2)
+			return NULL;
+
+		/*
+		 * The path's pathkeys will usually have been truncated to the
+		 * grouping column, so look at the index's second column directly.
+		 */
+		descending = index->reverse_sort[1];
+		nulls_first = index->nulls_first[1];
+		if (ScanDirectionIsBackward(ipath->indexscandir))
+		{
+			descending = !descending;
+			nulls_first = !nulls_first;
+		}
+
+		tle = lsecond_node(TargetEntry, index->indextlist);
+		if (nulls_first ||
+			index->indexcollations[1] != inputcollid ||
+			get_op_opfamily_strategy(sortop, index->sortopfamily[1]) !=
+			(descending ? BTGreaterStrategyNumber : BTLessStrategyNumber) ||
+			!equal(tle->expr, target))
+			return NULL;
+	}
+
+	path = (Path *) create_index_skip_path(root, ipath, ngroups);
+
+	if (ppath != NULL)
+		path = (Path *) create_projection_path(root, ppath->path.parent,
+											   path, ppath->path.pathtarget);
+
+	return path;
+}
+
 /*
  * create_ordered_paths
  *
@@ -7061,6 +7375,51 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			}
 		}
 
+		/*
+		 * With a single grouping column that leads an index, we can skip
+		 * through the index to the first row of each group, provided any
+		 * aggregates are MIN/MAX whose result that row already holds.  See
+		 * make_index_skip_path().
+		 */
+		if (!parse->groupingSets && root->num_groupby_pathkeys == 1 &&
+			list_length(root->processed_groupClause) == 1)
+		{
+			foreach(lc, input_rel->pathlist)
+			{
+				Path	   *path = (Path *) lfirst(lc);
+
+				if (!pathkeys_contained_in(root->group_pathkeys,
+										   path->pathkeys))
+					continue;
+
+				path = make_index_skip_path(root, input_rel, path,
+											dNumGroups, parse->hasAggs);
+				if (path == NULL)
+					continue;
+
+				if (parse->hasAggs)
+					add_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 path,
+											 grouped_rel->reltarget,
+											 AGG_SORTED,
+											 AGGSPLIT_SIMPLE,
+											 root->processed_groupClause,
+											 havingQual,
+											 agg_costs,
+											 dNumGroups));
+				else
+					add_path(grouped_rel, (Path *)
+							 create_group_path(root,
+											   grouped_rel,
+											   path,
+											   root->processed_groupClause,
+											   havingQual,
+											   dNumGroups));
+			}
+		}
+
 		/*
 		 * Instead of operating directly on the input relation, we can
 		 * consider finalizing a partially aggregated path.
@@ -7485,6 +7844,412 @@ create_partial_grouping_paths(PlannerInfo *root,
 	return partially_grouped_rel;
 }
 
+/*
+ * add_eager_aggregation_paths
+ *
+ * Consider partially aggregating one side of the scan/join relation before
+ * the join, and finalizing the aggregation on top of the join ("eager
+ * aggregation").  When many rows of one input join to each row of the
+ * other, collapsing them first can make the join, and the final grouping
+ * step, far cheaper.
+ *
+ * Aggregates are partially computed below the join, grouped by every Var of
+ * the aggregated side that is needed above it (for the join clauses, the
+ * GROUP BY, or elsewhere outside of aggregates).  Each partial group then
+ * joins to exactly the rows of the other side that each of its member rows
+ * would have, so combining the partial states after the join gives the same
+ * result as aggregating the joined rows directly.
+ *
+ * For now we only handle inner joins of exactly two base relations, all of
+ * whose aggregates' arguments come from one of them.  The resulting paths
+ * are added to grouped_rel to compete with the regular ones.
+ */
+static void
+add_eager_aggregation_paths(PlannerInfo *root, RelOptInfo *input_rel,
+							RelOptInfo *grouped_rel, double dNumGroups,
+							GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	PathTarget *partial_target;
+	RelOptInfo *rels[2];
+	int			relid;
+	int			i;
+
+	if (input_rel->reloptkind != RELOPT_JOINREL ||
+		IS_DUMMY_REL(input_rel) ||
+		bms_num_members(root->all_baserels) != 2 ||
+		root->join_info_list != NIL ||
+		root->placeholder_list != NIL ||
+		root->hasLateralRTEs)
+		return;
+
+	i = 0;
+	relid = -1;
+	while ((relid = bms_next_member(root->all_baserels, relid)) >= 0)
+	{
+		RelOptInfo *rel = root->simple_rel_array[relid];
+
+		if (rel == NULL || rel->reloptkind != RELOPT_BASEREL ||
+			rel->cheapest_total_path == NULL || IS_DUMMY_REL(rel))
+			return;
+		rels[i++] = rel;
+	}
+
+	/* The target list the finalizing Agg expects as its input */
+	partial_target = make_partial_grouping_target(root, grouped_rel->reltarget,
+												  extra->havingQual);
+
+	if (!extra->partial_costs_set)
+	{
+		MemSet(&extra->agg_partial_costs, 0, sizeof(AggClauseCosts));
+		MemSet(&extra->agg_final_costs, 0, sizeof(AggClauseCosts));
+		if (parse->hasAggs)
+		{
+			get_agg_clause_costs(root, AGGSPLIT_INITIAL_SERIAL,
+								 &extra->agg_partial_costs);
+			get_agg_clause_costs(root, AGGSPLIT_FINAL_DESERIAL,
+								 &extra->agg_final_costs);
+		}
+		extra->partial_costs_set = true;
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		RelOptInfo *aggrel = rels[i];
+		RelOptInfo *otherrel = rels[1 - i];
+		RelOptInfo *grouped_aggrel;
+		RelOptInfo *joinrel;
+		SpecialJoinInfo sjinfo;
+		List	   *restrictlist;
+		Path	   *path;
+
+		grouped_aggrel = make_eager_grouped_rel(root, aggrel, otherrel,
+												partial_target, extra);
+		if (grouped_aggrel == NULL)
+			continue;
+
+		/*
+		 * Build a copy of the scan/join rel that emits partially aggregated
+		 * rows, and join the grouped rel to the other input within it.
+		 */
+		joinrel = makeNode(RelOptInfo);
+		memcpy(joinrel, input_rel, sizeof(RelOptInfo));
+		joinrel->reltarget = partial_target;
+		joinrel->pathlist = NIL;
+		joinrel->ppilist = NIL;
+		joinrel->partial_pathlist = NIL;
+		joinrel->cheapest_startup_path = NULL;
+		joinrel->cheapest_total_path = NULL;
+		joinrel->cheapest_unique_path = NULL;
+		joinrel->cheapest_parameterized_paths = NIL;
+		joinrel->consider_parallel = false;
+		joinrel->fdwroutine = NULL;
+		joinrel->part_scheme = NULL;
+		joinrel->nparts = 0;
+
+		init_dummy_sjinfo(&sjinfo, grouped_aggrel->relids, otherrel->relids);
+		(void) build_join_rel(root, input_rel->relids, grouped_aggrel,
+							  otherrel, &sjinfo, NIL, &restrictlist);
+		set_joinrel_size_estimates(root, joinrel, grouped_aggrel, otherrel,
+								   &sjinfo, restrictlist);
+
+		add_paths_to_joinrel(root, joinrel, grouped_aggrel, otherrel,
+							 JOIN_INNER, &sjinfo, restrictlist);
+		add_paths_to_joinrel(root, joinrel, otherrel, grouped_aggrel,
+							 JOIN_INNER, &sjinfo, restrictlist);
+		if (joinrel->pathlist == NIL)
+			continue;
+		set_cheapest(joinrel);
+		path = joinrel->cheapest_total_path;
+
+		/* Finalize the aggregation above the join */
+		if (root->processed_groupClause == NIL)
+		{
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel, path,
+									 grouped_rel->reltarget,
+									 AGG_PLAIN,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 NIL,
+									 (List *) extra->havingQual,
+									 &extra->agg_final_costs,
+									 dNumGroups));
+			continue;
+		}
+
+		if ((extra->flags & GROUPING_CAN_USE_HASH) != 0)
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel, path,
+									 grouped_rel->reltarget,
+									 AGG_HASHED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 root->processed_groupClause,
+									 (List *) extra->havingQual,
+									 &extra->agg_final_costs,
+									 dNumGroups));
+
+		if ((extra->flags & GROUPING_CAN_USE_SORT) != 0)
+		{
+			if (!pathkeys_contained_in(root->group_pathkeys, path->pathkeys))
+				path = (Path *) create_sort_path(root, grouped_rel, path,
+												 root->group_pathkeys, -1.0);
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel, path,
+									 grouped_rel->reltarget,
+									 AGG_SORTED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 root->processed_groupClause,
+									 (List *) extra->havingQual,
+									 &extra->agg_final_costs,
+									 dNumGroups));
+		}
+	}
+}
+
+/*
+ * eager_agg_key_is_equalimage
+ *
+ * Can a Var be a grouping key of a partial aggregation below a join?  Its
+ * type's default btree opfamily must say that equal values are
+ * interchangeable ("equalimage"), as for deduplication in nbtree, and its
+ * collation must be deterministic.
+ */
+static bool
+eager_agg_key_is_equalimage(Var *var)
+{
+	TypeCacheEntry *typentry;
+	Oid			opcintype;
+	Oid			equalimageproc;
+
+	if (OidIsValid(var->varcollid) &&
+		!get_collation_isdeterministic(var->varcollid))
+		return false;
+
+	typentry = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(typentry->btree_opf))
+		return false;
+	opcintype = typentry->btree_opintype;
+
+	equalimageproc = get_opfamily_proc(typentry->btree_opf,
+									   opcintype, opcintype,
+									   BTEQUALIMAGE_PROC);
+	if (!OidIsValid(equalimageproc))
+		return false;
+
+	return DatumGetBool(OidFunctionCall1Coll(equalimageproc, var->varcollid,
+											 ObjectIdGetDatum(opcintype)));
+}
+
+/*
+ * make_eager_grouped_rel
+ *
+ * Build a copy of base relation 'rel' whose single path partially
+ * aggregates its rows, for use by add_eager_aggregation_paths.  The grouping
+ * keys are the Vars of 'rel' that the rest of the query needs outside of
+ * aggregates, including those used to join to 'otherrel'.  'partial_target'
+ * is the target list of the finalizing aggregation's input.
+ *
+ * Returns NULL if this can't be done, or doesn't look worthwhile.
+ */
+static RelOptInfo *
+make_eager_grouped_rel(PlannerInfo *root, RelOptInfo *rel,
+					   RelOptInfo *otherrel, PathTarget *partial_target,
+					   GroupPathExtraData *extra)
+{
+	RelOptInfo *grouped_rel;
+	PathTarget *input_target;
+	PathTarget *grouped_target;
+	List	   *keys = NIL;
+	List	   *aggrefs = NIL;
+	List	   *groupClause = NIL;
+	Index		sortgroupref = 0;
+	Path	   *path;
+	double		dNumGroups;
+	ListCell   *lc;
+
+	foreach(lc, partial_target->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		List	   *vars;
+		ListCell   *lc2;
+
+		if (IsA(expr, Aggref))
+		{
+			/* Every aggregate must be computable from this rel alone */
+			if (!bms_is_subset(pull_varnos(root, (Node *) expr), rel->relids))
+				return NULL;
+			aggrefs = lappend(aggrefs, expr);
+			continue;
+		}
+
+		vars = pull_var_clause((Node *) expr, 0);
+		foreach(lc2, vars)
+		{
+			Var		   *var = (Var *) lfirst(lc2);
+
+			if (bms_is_member(var->varno, rel->relids))
+				keys = list_append_unique(keys, var);
+		}
+	}
+
+	/* Add the Vars used to join to the other rel */
+	foreach(lc, rel->joininfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		List	   *vars = pull_var_clause((Node *) rinfo->clause, 0);
+		ListCell   *lc2;
+
+		foreach(lc2, vars)
+		{
+			Var		   *var = (Var *) lfirst(lc2);
+
+			if (bms_is_member(var->varno, rel->relids))
+				keys = list_append_unique(keys, var);
+		}
+	}
+
+	if (rel->has_eclass_joins)
+	{
+		foreach(lc, root->eq_classes)
+		{
+			EquivalenceClass *ec = (EquivalenceClass *) lfirst(lc);
+			ListCell   *lc2;
+
+			if (ec->ec_has_const ||
+				!bms_overlap(ec->ec_relids, rel->relids) ||
+				!bms_overlap(ec->ec_relids, otherrel->relids))
+				continue;
+
+			foreach(lc2, ec->ec_members)
+			{
+				EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+				List	   *vars;
+				ListCell   *lc3;
+
+				if (em->em_is_child ||
+					!bms_equal(em->em_relids, rel->relids))
+					continue;
+
+				vars = pull_var_clause((Node *) em->em_expr, 0);
+				foreach(lc3, vars)
+					keys = list_append_unique(keys, lfirst(lc3));
+			}
+		}
+	}
+
+	/*
+	 * Without any grouping keys there's nothing to join on; and a plain
+	 * partial aggregate would emit a row even for empty input, which the
+	 * join would then multiply.
+	 */
+	if (keys == NIL)
+		return NULL;
+
+	/*
+	 * Only bother if partial aggregation would collapse the rel's rows by a
+	 * useful amount.
+	 */
+	dNumGroups = estimate_num_groups(root, keys, rel->rows, NULL, NULL);
+	if (dNumGroups > rel->rows * EAGER_AGG_MAX_GROUP_FRACTION)
+		return NULL;
+
+	/*
+	 * Label the keys in a copy of the rel's own target, and make up hashable
+	 * grouping clauses for them.  The sortgrouprefs need only be unique
+	 * within this Agg, but keep them clear of the query's own anyway.
+	 */
+	foreach(lc, root->processed_tlist)
+		sortgroupref = Max(sortgroupref,
+						   ((TargetEntry *) lfirst(lc))->ressortgroupref);
+
+	input_target = copy_pathtarget(rel->reltarget);
+	if (input_target->sortgrouprefs == NULL)
+		input_target->sortgrouprefs = (Index *)
+			palloc0(list_length(input_target->exprs) * sizeof(Index));
+
+	foreach(lc, keys)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		SortGroupClause *grpcl;
+		Oid			eqop;
+		bool		hashable;
+		ListCell   *lc2;
+		int			i = 0;
+
+		foreach(lc2, input_target->exprs)
+		{
+			if (equal(lfirst(lc2), var))
+				break;
+			i++;
+		}
+		if (lc2 == NULL)
+			return NULL;
+
+		get_sort_group_operators(var->vartype, false, false, false,
+								 NULL, &eqop, NULL, &hashable);
+		if (!OidIsValid(eqop) || !hashable)
+			return NULL;
+
+		/*
+		 * The partial group of equal values is represented by one of them
+		 * above the join, so equality must mean the values are
+		 * indistinguishable (not so for numeric 1.0 and 1.00, say, or
+		 * nondeterministic collations).
+		 */
+		if (!eager_agg_key_is_equalimage(var))
+			return NULL;
+
+		grpcl = makeNode(SortGroupClause);
+		grpcl->tleSortGroupRef = ++sortgroupref;
+		grpcl->eqop = eqop;
+		grpcl->sortop = InvalidOid;
+		grpcl->nulls_first = false;
+		grpcl->hashable = true;
+		groupClause = lappend(groupClause, grpcl);
+
+		input_target->sortgrouprefs[i] = sortgroupref;
+	}
+
+	grouped_target = create_empty_pathtarget();
+	foreach(lc, keys)
+		add_column_to_pathtarget(grouped_target, (Expr *) lfirst(lc), 0);
+	foreach(lc, aggrefs)
+		add_column_to_pathtarget(grouped_target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, grouped_target);
+
+	/*
+	 * The grouped rel stands in for 'rel' when building join paths, so start
+	 * from a copy of it, minus its paths.
+	 */
+	grouped_rel = makeNode(RelOptInfo);
+	memcpy(grouped_rel, rel, sizeof(RelOptInfo));
+	grouped_rel->reltarget = grouped_target;
+	grouped_rel->rows = dNumGroups;
+	grouped_rel->pathlist = NIL;
+	grouped_rel->ppilist = NIL;
+	grouped_rel->partial_pathlist = NIL;
+	grouped_rel->cheapest_startup_path = NULL;
+	grouped_rel->cheapest_total_path = NULL;
+	grouped_rel->cheapest_unique_path = NULL;
+	grouped_rel->cheapest_parameterized_paths = NIL;
+	grouped_rel->consider_parallel = false;
+
+	path = (Path *) create_projection_path(root, rel, rel->cheapest_total_path,
+										   input_target);
+	path = (Path *) create_agg_path(root, grouped_rel, path,
+									grouped_target,
+									AGG_HASHED,
+									AGGSPLIT_INITIAL_SERIAL,
+									groupClause,
+									NIL,
+									&extra->agg_partial_costs,
+									dNumGroups);
+	add_path(grouped_rel, path);
+	set_cheapest(grouped_rel);
+
+	return grouped_rel;
+}
+
 /*
  * Generate Gather and Gather Merge paths for a grouping relation or partial
  * grouping relation.
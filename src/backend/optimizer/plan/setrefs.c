@@ -154,6 +154,9 @@ static Plan *set_append_references(PlannerInfo *root,
 static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
+static void set_partpruneinfo_references(PlannerInfo *root,
+										 PartitionPruneInfo *pruneinfo,
+										 int rtoffset);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static Relids offset_relid_set(Relids relids, int rtoffset);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node,
@@ -1783,26 +1786,7 @@ set_append_references(PlannerInfo *root,
 	aplan->apprelids = offset_relid_set(aplan->apprelids, rtoffset);
 
 	if (aplan->part_prune_info)
-	{
-		foreach(l, aplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
-
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
-				pinfo->initial_pruning_steps =
-					fix_scan_list(root, pinfo->initial_pruning_steps,
-								  rtoffset, 1);
-				pinfo->exec_pruning_steps =
-					fix_scan_list(root, pinfo->exec_pruning_steps,
-								  rtoffset, 1);
-			}
-		}
-	}
+		set_partpruneinfo_references(root, aplan->part_prune_info, rtoffset);
 
 	/* We don't need to recurse to lefttree or righttree ... */
 	Assert(aplan->plan.lefttree == NULL);
@@ -1865,32 +1849,88 @@ set_mergeappend_references(PlannerInfo *root,
 	mplan->apprelids = offset_relid_set(mplan->apprelids, rtoffset);
 
 	if (mplan->part_prune_info)
+		set_partpruneinfo_references(root, mplan->part_prune_info, rtoffset);
+
+	/* We don't need to recurse to lefttree or righttree ... */
+	Assert(mplan->plan.lefttree == NULL);
+	Assert(mplan->plan.righttree == NULL);
+
+	return (Plan *) mplan;
+}
+
+/*
+ * set_partpruneinfo_references
+ *		Do set_plan_references processing on the PartitionPruneInfo of an
+ *		Append or MergeAppend
+ *
+ * If the info has initial pruning steps, we also remember it in the
+ * PlannerGlobal along with the leaf partitions it might prune, so that
+ * users of the finished plan can do that pruning before locking those.
+ * That's only done if the steps compare the partition keys with nothing but
+ * constants, parameters and immutable functions: the executor must reach
+ * the same result when it repeats the pruning later, since it won't lock
+ * anything the plan cache skipped.  Stable functions could return something
+ * else by then.
+ */
+static void
+set_partpruneinfo_references(PlannerInfo *root,
+							 PartitionPruneInfo *pruneinfo,
+							 int rtoffset)
+{
+	PlannerGlobal *glob = root->glob;
+	bool		has_initial_steps = false;
+	bool		has_mutable_steps = false;
+	Bitmapset  *leafpart_rtis = NULL;
+	ListCell   *l;
+
+	foreach(l, pruneinfo->prune_infos)
 	{
-		foreach(l, mplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
+		List	   *prune_infos = lfirst(l);
+		ListCell   *l2;
 
-			foreach(l2, prune_infos)
+		foreach(l2, prune_infos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(l2);
+			int			i;
+
+			pinfo->rtindex += rtoffset;
+			pinfo->initial_pruning_steps =
+				fix_scan_list(root, pinfo->initial_pruning_steps,
+							  rtoffset, 1);
+			pinfo->exec_pruning_steps =
+				fix_scan_list(root, pinfo->exec_pruning_steps,
+							  rtoffset, 1);
+
+			for (i = 0; i < pinfo->nparts; i++)
 			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
+				if (pinfo->leafpart_rti_map[i] > 0)
+				{
+					pinfo->leafpart_rti_map[i] += rtoffset;
+					leafpart_rtis = bms_add_member(leafpart_rtis,
+												   pinfo->leafpart_rti_map[i]);
+				}
+			}
 
-				pinfo->rtindex += rtoffset;
-				pinfo->initial_pruning_steps =
-					fix_scan_list(root, pinfo->initial_pruning_steps,
-								  rtoffset, 1);
-				pinfo->exec_pruning_steps =
-					fix_scan_list(root, pinfo->exec_pruning_steps,
-								  rtoffset, 1);
+			foreach_ptr(PartitionPruneStep, step,
+						pinfo->initial_pruning_steps)
+			{
+				has_initial_steps = true;
+				if (IsA(step, PartitionPruneStepOp) &&
+					contain_mutable_functions((Node *)
+											  castNode(PartitionPruneStepOp,
+													   step)->exprs))
+					has_mutable_steps = true;
 			}
 		}
 	}
 
-	/* We don't need to recurse to lefttree or righttree ... */
-	Assert(mplan->plan.lefttree == NULL);
-	Assert(mplan->plan.righttree == NULL);
-
-	return (Plan *) mplan;
+	if (has_initial_steps && !has_mutable_steps)
+	{
+		glob->partPruneInfos = lappend(glob->partPruneInfos, pruneinfo);
+		glob->prunableRelids = bms_add_members(glob->prunableRelids,
+											   leafpart_rtis);
+	}
+	bms_free(leafpart_rtis);
 }
 
 /*
@@ -1918,6 +1958,14 @@ set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset)
 					   rtoffset,
 					   NRM_EQUAL,
 					   NUM_EXEC_QUAL(plan));
+	hplan->pruneKey = (Expr *)
+		fix_upper_expr(root,
+					   (Node *) hplan->pruneKey,
+					   outer_itlist,
+					   OUTER_VAR,
+					   rtoffset,
+					   NRM_EQUAL,
+					   NUM_EXEC_QUAL(plan));
 
 	/* Hash doesn't project */
 	set_dummy_tlist_references(plan, rtoffset);
@@ -2311,6 +2359,15 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 		NestLoop   *nl = (NestLoop *) join;
 		ListCell   *lc;
 
+		nl->hashclauses = fix_join_expr(root,
+										nl->hashclauses,
+										outer_itlist,
+										inner_itlist,
+										(Index) 0,
+										rtoffset,
+										NRM_EQUAL,
+										NUM_EXEC_QUAL((Plan *) join));
+
 		foreach(lc, nl->nestParams)
 		{
 			NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
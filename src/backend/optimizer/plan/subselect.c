@@ -2699,6 +2699,8 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 		case T_Hash:
 			finalize_primnode((Node *) ((Hash *) plan)->hashkeys,
 							  &context);
+			finalize_primnode((Node *) ((Hash *) plan)->pruneKey,
+							  &context);
 			break;
 
 		case T_Limit:
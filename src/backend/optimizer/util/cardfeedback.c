@@ -0,0 +1,612 @@
+/*-------------------------------------------------------------------------
+ *
+ * cardfeedback.c
+ *	  Learned corrections to row estimates of base relation scans.
+ *
+ * When cardinality_feedback is on, the executor counts the rows returned by
+ * each unparameterized scan of a base relation, and at ExecutorEnd compares
+ * the count with the planner's estimate for the scan.  The ratio is kept in
+ * a shared hash table, keyed by database, relation and a fingerprint of the
+ * relation's restriction clauses, and later planning of a relation with the
+ * same restriction clauses multiplies its row estimate by the learned
+ * factor.
+ *
+ * The fingerprint covers the structure of the clauses (node types, columns,
+ * operators and functions) and the values of any constants in them, but not
+ * their order, so the same WHERE clause written in another order, or
+ * appearing in another query, shares a factor.  Parameters are fingerprinted
+ * by number and type only, so all executions of a prepared statement share
+ * one factor.
+ *
+ * Factors are a running average of log(actual / estimated), giving the last
+ * few executions equal weight.  A new entry is only made when an estimate is
+ * off by more than a factor of two, and no entries are made once the table
+ * holds cardinality_feedback_max_entries; pg_cardinality_feedback_reset()
+ * empties it.  Only scans that ran to completion count, since a scan stopped
+ * early by a LIMIT or a merge join says nothing about its selectivity.
+ *
+ * The table is written out to a file at each checkpoint, if it changed, and
+ * read back when shared memory is created.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/cardfeedback.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/parallel.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/cardfeedback.h"
+#include "parser/parsetree.h"
+#include "pgstat.h"
+#include "storage/fd.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+/* Location of the permanent copy of the table, and its format */
+#define CARDFEEDBACK_FILENAME	PGSTAT_STAT_PERMANENT_DIRECTORY "/cardfeedback.stat"
+#define CARDFEEDBACK_TMPFILE	CARDFEEDBACK_FILENAME ".tmp"
+#define CARDFEEDBACK_FORMAT_ID	0x01CF0001
+
+/* Number of recent executions a factor gives equal weight to */
+#define CARDFEEDBACK_MAX_WEIGHT 4
+
+/* Smallest misestimate, as a log ratio, worth a new entry */
+#define CARDFEEDBACK_MIN_LOG_ERROR	0.6931471805599453	/* log(2) */
+
+/* Factors are clamped to [1e-6, 1e6] */
+#define CARDFEEDBACK_MAX_LOG_FACTOR 13.815510557964274	/* log(1e6) */
+
+/* GUC parameters */
+bool		cardinality_feedback = false;
+int			cardinality_feedback_max_entries = 1000;
+
+typedef struct CardFeedbackKey
+{
+	Oid			dbid;			/* database the relation is in */
+	Oid			relid;			/* the relation */
+	uint64		fingerprint;	/* of its restriction clauses */
+} CardFeedbackKey;
+
+typedef struct CardFeedbackEntry
+{
+	CardFeedbackKey key;		/* hash key, must be first */
+	double		logfactor;		/* running average of log(actual/estimate) */
+	int64		samples;		/* number of executions recorded */
+	TimestampTz last_update;	/* when the last one was recorded */
+} CardFeedbackEntry;
+
+typedef struct CardFeedbackControl
+{
+	LWLock		lock;			/* protects the hash table and 'dirty' */
+	bool		dirty;			/* changed since last written out? */
+} CardFeedbackControl;
+
+static CardFeedbackControl *cf_ctl = NULL;
+static HTAB *cf_hash = NULL;
+
+static uint64 cf_fingerprint(List *clauses);
+static bool cf_jumble_walker(Node *node, uint64 *hash);
+static bool cf_record_walker(PlanState *planstate, void *context);
+static void cf_update(CardFeedbackKey *key, double estimated, double actual);
+static void cf_load(void);
+
+
+/*
+ * Size of the shared memory we need
+ */
+Size
+CardinalityFeedbackShmemSize(void)
+{
+	Size		size;
+
+	if (cardinality_feedback_max_entries <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(CardFeedbackControl));
+	size = add_size(size, hash_estimate_size(cardinality_feedback_max_entries,
+											 sizeof(CardFeedbackEntry)));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared memory, loading any saved factors
+ */
+void
+CardinalityFeedbackShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (cardinality_feedback_max_entries <= 0)
+		return;
+
+	cf_ctl = ShmemInitStruct("Cardinality Feedback",
+							 sizeof(CardFeedbackControl), &found);
+	if (!found)
+	{
+		LWLockInitialize(&cf_ctl->lock, LWTRANCHE_CARDINALITY_FEEDBACK);
+		cf_ctl->dirty = false;
+	}
+
+	info.keysize = sizeof(CardFeedbackKey);
+	info.entrysize = sizeof(CardFeedbackEntry);
+	cf_hash = ShmemInitHash("Cardinality Feedback Hash",
+							cardinality_feedback_max_entries,
+							cardinality_feedback_max_entries,
+							&info,
+							HASH_ELEM | HASH_BLOBS);
+
+	if (!found)
+		cf_load();
+}
+
+/*
+ * Compute the fingerprint of a list of restriction clauses
+ *
+ * The clauses are combined by addition so that their order doesn't matter.
+ * Zero is reserved to mean "no fingerprint".
+ */
+static uint64
+cf_fingerprint(List *clauses)
+{
+	uint64		result = 0;
+	ListCell   *lc;
+
+	foreach(lc, clauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		uint64		hash = 0;
+
+		(void) cf_jumble_walker((Node *) rinfo->clause, &hash);
+		result += murmurhash64(hash);
+	}
+
+	return result != 0 ? result : 1;
+}
+
+#define CF_JUMBLE(hash, value) \
+	(*(hash) = hash_combine64(*(hash), murmurhash64((uint64) (value))))
+
+/*
+ * Walker for cf_fingerprint
+ *
+ * Vars are identified by column only: all those at level zero belong to
+ * the relation whose clauses these are.
+ */
+static bool
+cf_jumble_walker(Node *node, uint64 *hash)
+{
+	if (node == NULL)
+		return false;
+
+	CF_JUMBLE(hash, nodeTag(node));
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			{
+				Var		   *var = (Var *) node;
+
+				CF_JUMBLE(hash, var->varattno);
+				CF_JUMBLE(hash, var->varlevelsup);
+			}
+			break;
+		case T_Const:
+			{
+				Const	   *con = (Const *) node;
+
+				CF_JUMBLE(hash, con->consttype);
+				CF_JUMBLE(hash, con->constisnull);
+				if (!con->constisnull)
+					CF_JUMBLE(hash, datum_image_hash(con->constvalue,
+													 con->constbyval,
+													 con->constlen));
+			}
+			break;
+		case T_Param:
+			{
+				Param	   *param = (Param *) node;
+
+				CF_JUMBLE(hash, param->paramkind);
+				CF_JUMBLE(hash, param->paramid);
+				CF_JUMBLE(hash, param->paramtype);
+			}
+			break;
+		case T_OpExpr:
+		case T_DistinctExpr:
+		case T_NullIfExpr:
+			CF_JUMBLE(hash, ((OpExpr *) node)->opno);
+			break;
+		case T_ScalarArrayOpExpr:
+			CF_JUMBLE(hash, ((ScalarArrayOpExpr *) node)->opno);
+			CF_JUMBLE(hash, ((ScalarArrayOpExpr *) node)->useOr);
+			break;
+		case T_FuncExpr:
+			CF_JUMBLE(hash, ((FuncExpr *) node)->funcid);
+			break;
+		case T_BoolExpr:
+			CF_JUMBLE(hash, ((BoolExpr *) node)->boolop);
+			break;
+		case T_NullTest:
+			CF_JUMBLE(hash, ((NullTest *) node)->nulltesttype);
+			break;
+		case T_BooleanTest:
+			CF_JUMBLE(hash, ((BooleanTest *) node)->booltesttype);
+			break;
+		case T_RestrictInfo:
+			return cf_jumble_walker((Node *) ((RestrictInfo *) node)->clause,
+									hash);
+		default:
+			break;
+	}
+
+	return expression_tree_walker(node, cf_jumble_walker, (void *) hash);
+}
+
+/*
+ * CardinalityFeedbackAdjust
+ *		Apply any learned correction to a base relation's row estimate.
+ *
+ * 'nrows' is the estimate from the relation's restriction clauses.  We
+ * remember it and the clauses' fingerprint in the RelOptInfo, for
+ * create_scan_plan to pass on to the executor, and return the corrected
+ * estimate.
+ */
+double
+CardinalityFeedbackAdjust(PlannerInfo *root, RelOptInfo *rel, double nrows)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	CardFeedbackKey key;
+	CardFeedbackEntry *entry;
+	double		logfactor = 0.0;
+
+	if (cf_hash == NULL || rel->baserestrictinfo == NIL ||
+		rte->rtekind != RTE_RELATION || rte->tablesample != NULL)
+		return nrows;
+
+	key.dbid = MyDatabaseId;
+	key.relid = rte->relid;
+	key.fingerprint = cf_fingerprint(rel->baserestrictinfo);
+
+	rel->feedback_key = key.fingerprint;
+	rel->feedback_rows = nrows;
+
+	LWLockAcquire(&cf_ctl->lock, LW_SHARED);
+	entry = (CardFeedbackEntry *) hash_search(cf_hash, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+		logfactor = entry->logfactor;
+	LWLockRelease(&cf_ctl->lock);
+
+	return nrows * exp(logfactor);
+}
+
+/*
+ * CardinalityFeedbackScan
+ *		Does this plan node report its row count to the feedback store?
+ *
+ * create_scan_plan only sets feedback_key on these scan types.
+ */
+bool
+CardinalityFeedbackScan(Plan *plan)
+{
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_TidRangeScan:
+			return ((Scan *) plan)->feedback_key != 0;
+		default:
+			return false;
+	}
+}
+
+/*
+ * CardinalityFeedbackRecord
+ *		Record the row counts of a finished query's scans.
+ *
+ * Called from standard_ExecutorEnd, before the plan state tree is shut
+ * down.  ExecInitNode arranged for the scans to count their rows.
+ */
+void
+CardinalityFeedbackRecord(QueryDesc *queryDesc)
+{
+	if (cf_hash == NULL || !cardinality_feedback || IsParallelWorker() ||
+		queryDesc->planstate == NULL ||
+		(queryDesc->estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		return;
+
+	(void) cf_record_walker(queryDesc->planstate, queryDesc->estate);
+}
+
+static bool
+cf_record_walker(PlanState *planstate, void *context)
+{
+	EState	   *estate = (EState *) context;
+
+	if (planstate->instrument != NULL &&
+		CardinalityFeedbackScan(planstate->plan))
+	{
+		Scan	   *scan = (Scan *) planstate->plan;
+		Instrumentation *instr = planstate->instrument;
+
+		InstrEndLoop(instr);
+		if (instr->nloops > 0 && ((ScanState *) planstate)->ss_ScanDone)
+		{
+			CardFeedbackKey key;
+
+			key.dbid = MyDatabaseId;
+			key.relid = exec_rt_fetch(scan->scanrelid, estate)->relid;
+			key.fingerprint = scan->feedback_key;
+
+			cf_update(&key, scan->feedback_rows,
+					  instr->ntuples / instr->nloops);
+		}
+	}
+
+	return planstate_tree_walker(planstate, cf_record_walker, context);
+}
+
+/*
+ * Fold one execution's row count into the factor for 'key'
+ */
+static void
+cf_update(CardFeedbackKey *key, double estimated, double actual)
+{
+	CardFeedbackEntry *entry;
+	double		logerror;
+
+	logerror = log(Max(actual, 1.0) / Max(estimated, 1.0));
+
+	LWLockAcquire(&cf_ctl->lock, LW_EXCLUSIVE);
+
+	entry = (CardFeedbackEntry *) hash_search(cf_hash, key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bool		found;
+
+		if (fabs(logerror) < CARDFEEDBACK_MIN_LOG_ERROR ||
+			hash_get_num_entries(cf_hash) >= cardinality_feedback_max_entries)
+		{
+			LWLockRelease(&cf_ctl->lock);
+			return;
+		}
+
+		entry = (CardFeedbackEntry *) hash_search(cf_hash, key,
+												  HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+		{
+			LWLockRelease(&cf_ctl->lock);
+			return;
+		}
+		entry->logfactor = 0.0;
+		entry->samples = 0;
+	}
+
+	entry->samples++;
+	entry->logfactor += (logerror - entry->logfactor) /
+		Min(entry->samples, CARDFEEDBACK_MAX_WEIGHT);
+	entry->logfactor = Max(entry->logfactor, -CARDFEEDBACK_MAX_LOG_FACTOR);
+	entry->logfactor = Min(entry->logfactor, CARDFEEDBACK_MAX_LOG_FACTOR);
+	entry->last_update = GetCurrentTimestamp();
+	cf_ctl->dirty = true;
+
+	LWLockRelease(&cf_ctl->lock);
+}
+
+/*
+ * CheckPointCardinalityFeedback
+ *		Write the table out to disk, if it changed since the last time.
+ *
+ * Called at each checkpoint and restartpoint.
+ */
+void
+CheckPointCardinalityFeedback(void)
+{
+	FILE	   *file;
+	HASH_SEQ_STATUS hash_seq;
+	CardFeedbackEntry *entry;
+	int32		format_id = CARDFEEDBACK_FORMAT_ID;
+	int32		num_entries;
+
+	if (cf_hash == NULL)
+		return;
+
+	/*
+	 * Only the checkpointer writes the file, so we need only a shared lock
+	 * while doing so.  Clearing 'dirty' first means an update made while we
+	 * write will be picked up next time.
+	 */
+	LWLockAcquire(&cf_ctl->lock, LW_EXCLUSIVE);
+	if (!cf_ctl->dirty)
+	{
+		LWLockRelease(&cf_ctl->lock);
+		return;
+	}
+	cf_ctl->dirty = false;
+	LWLockRelease(&cf_ctl->lock);
+
+	file = AllocateFile(CARDFEEDBACK_TMPFILE, PG_BINARY_W);
+	if (file == NULL)
+		goto error;
+
+	LWLockAcquire(&cf_ctl->lock, LW_SHARED);
+
+	num_entries = hash_get_num_entries(cf_hash);
+	if (fwrite(&format_id, sizeof(int32), 1, file) != 1 ||
+		fwrite(&num_entries, sizeof(int32), 1, file) != 1)
+	{
+		LWLockRelease(&cf_ctl->lock);
+		goto error;
+	}
+
+	hash_seq_init(&hash_seq, cf_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (fwrite(entry, sizeof(CardFeedbackEntry), 1, file) != 1)
+		{
+			hash_seq_term(&hash_seq);
+			LWLockRelease(&cf_ctl->lock);
+			goto error;
+		}
+	}
+
+	LWLockRelease(&cf_ctl->lock);
+
+	if (FreeFile(file))
+	{
+		file = NULL;
+		goto error;
+	}
+
+	(void) durable_rename(CARDFEEDBACK_TMPFILE, CARDFEEDBACK_FILENAME, LOG);
+	return;
+
+error:
+	ereport(LOG,
+			(errcode_for_file_access(),
+			 errmsg("could not write file \"%s\": %m",
+					CARDFEEDBACK_TMPFILE)));
+	if (file)
+		FreeFile(file);
+	unlink(CARDFEEDBACK_TMPFILE);
+
+	/* try again next time */
+	LWLockAcquire(&cf_ctl->lock, LW_EXCLUSIVE);
+	cf_ctl->dirty = true;
+	LWLockRelease(&cf_ctl->lock);
+}
+
+/*
+ * Load the table saved by the last checkpoint, if any
+ *
+ * A missing or unreadable file just means we start from scratch.
+ */
+static void
+cf_load(void)
+{
+	FILE	   *file;
+	int32		format_id;
+	int32		num_entries;
+
+	file = AllocateFile(CARDFEEDBACK_FILENAME, PG_BINARY_R);
+	if (file == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							CARDFEEDBACK_FILENAME)));
+		return;
+	}
+
+	if (fread(&format_id, sizeof(int32), 1, file) != 1 ||
+		format_id != CARDFEEDBACK_FORMAT_ID ||
+		fread(&num_entries, sizeof(int32), 1, file) != 1)
+		goto done;
+
+	for (int i = 0; i < num_entries; i++)
+	{
+		CardFeedbackEntry temp;
+		CardFeedbackEntry *entry;
+
+		if (fread(&temp, sizeof(CardFeedbackEntry), 1, file) != 1)
+			break;
+
+		if (hash_get_num_entries(cf_hash) >= cardinality_feedback_max_entries)
+			break;
+
+		entry = (CardFeedbackEntry *) hash_search(cf_hash, &temp.key,
+												  HASH_ENTER_NULL, NULL);
+		if (entry == NULL)
+			break;
+		*entry = temp;
+	}
+
+done:
+	FreeFile(file);
+}
+
+/*
+ * SQL-callable function to show the learned factors
+ */
+Datum
+pg_get_cardinality_feedback(PG_FUNCTION_ARGS)
+{
+#define PG_GET_CARDINALITY_FEEDBACK_COLS 6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	HASH_SEQ_STATUS hash_seq;
+	CardFeedbackEntry *entry;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (cf_hash == NULL)
+		return (Datum) 0;
+
+	LWLockAcquire(&cf_ctl->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, cf_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_GET_CARDINALITY_FEEDBACK_COLS];
+		bool		nulls[PG_GET_CARDINALITY_FEEDBACK_COLS] = {0};
+
+		values[0] = ObjectIdGetDatum(entry->key.dbid);
+		values[1] = ObjectIdGetDatum(entry->key.relid);
+		values[2] = Int64GetDatum((int64) entry->key.fingerprint);
+		values[3] = Int64GetDatum(entry->samples);
+		values[4] = Float8GetDatum(exp(entry->logfactor));
+		values[5] = TimestampTzGetDatum(entry->last_update);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	LWLockRelease(&cf_ctl->lock);
+
+	return (Datum) 0;
+}
+
+/*
+ * SQL-callable function to forget all learned factors
+ */
+Datum
+pg_cardinality_feedback_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	CardFeedbackEntry *entry;
+
+	if (cf_hash == NULL)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(&cf_ctl->lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, cf_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(cf_hash, &entry->key, HASH_REMOVE, NULL);
+	cf_ctl->dirty = true;
+
+	LWLockRelease(&cf_ctl->lock);
+
+	PG_RETURN_VOID();
+}
@@ -19,7 +19,10 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/table.h"
+#include "access/tableam.h"
 #include "catalog/pg_language.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
@@ -41,6 +44,7 @@
 #include "parser/analyze.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_func.h"
+#include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
 #include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
@@ -53,6 +57,7 @@
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
@@ -789,6 +794,100 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	return !max_parallel_hazard_walker(node, &context);
 }
 
+/*
+ * is_parallel_insert_safe
+ *		Detect whether the rows of an INSERT ... SELECT could be inserted by
+ *		the participants of a parallel plan
+ *
+ * Besides the query tree, which the caller checks with max_parallel_hazard(),
+ * inserting a row runs whatever the target relation attaches to it.  We
+ * insist that none of that needs the leader: no triggers (which also covers
+ * foreign keys), no ON CONFLICT or RETURNING processing, no WITH CHECK
+ * OPTIONs, no stored generated columns, and only parallel-safe CHECK
+ * constraints, index expressions and index predicates.  Uniqueness checks
+ * need no special care, since all participants share one transaction.  The
+ * target must be a heap table the workers can see, so temporary tables are
+ * out.
+ */
+bool
+is_parallel_insert_safe(Query *parse)
+{
+	max_parallel_hazard_context context;
+	RangeTblRef *rtr;
+	RangeTblEntry *rte;
+	Relation	rel;
+	TupleConstr *constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+
+	Assert(parse->commandType == CMD_INSERT);
+
+	if (!enable_parallel_insert ||
+		parse->onConflict != NULL ||
+		parse->returningList != NIL ||
+		parse->withCheckOptions != NIL)
+		return false;
+
+	/* INSERT ... VALUES has nothing to parallelize */
+	if (list_length(parse->jointree->fromlist) != 1)
+		return false;
+	rtr = linitial_node(RangeTblRef, parse->jointree->fromlist);
+	if (rt_fetch(rtr->rtindex, parse->rtable)->rtekind != RTE_SUBQUERY)
+		return false;
+
+	/* The target relation was locked by the parser or AcquireRewriteLocks */
+	rte = rt_fetch(parse->resultRelation, parse->rtable);
+	rel = table_open(rte->relid, NoLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel) ||
+		rel->rd_tableam != GetHeapamTableAmRoutine() ||
+		rel->trigdesc != NULL)
+		safe = false;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_RESTRICTED;
+	context.safe_param_ids = NIL;
+
+	constr = rel->rd_att->constr;
+	if (safe && constr != NULL)
+	{
+		if (constr->has_generated_stored)
+			safe = false;
+		for (int i = 0; safe && i < constr->num_check; i++)
+		{
+			Node	   *checkexpr = stringToNode(constr->check[i].ccbin);
+
+			if (max_parallel_hazard_walker(checkexpr, &context))
+				safe = false;
+		}
+	}
+
+	indexoidlist = safe ? RelationGetIndexList(rel) : NIL;
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel;
+
+		/* use the same lock mode as the executor will */
+		indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+		if (max_parallel_hazard_walker((Node *) RelationGetIndexExpressions(indexRel),
+									   &context) ||
+			max_parallel_hazard_walker((Node *) RelationGetIndexPredicate(indexRel),
+									   &context))
+			safe = false;
+		index_close(indexRel, NoLock);
+
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	table_close(rel, NoLock);
+
+	return safe;
+}
+
 /* core logic for all parallel-hazard checks */
 static bool
 max_parallel_hazard_test(char proparallel, max_parallel_hazard_context *context)
@@ -1026,6 +1026,34 @@ create_index_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_index_skip_path
+ *	  Creates a copy of an index path that returns only the first tuple for
+ *	  each distinct value of the index's leading column.
+ *
+ * 'subpath' must be an unparameterized, non-parallel IndexPath whose index
+ * supports amskip.  'ngroups' is the estimated number of distinct leading
+ * values among the rows the scan returns.  The caller is responsible for
+ * putting something on top that tolerates the scan not skipping at all, as
+ * the executor only skips when the index AM agrees to.
+ */
+IndexPath *
+create_index_skip_path(PlannerInfo *root, IndexPath *subpath, double ngroups)
+{
+	IndexPath  *pathnode = makeNode(IndexPath);
+
+	Assert(subpath->indexinfo->amcanskip);
+	Assert(subpath->path.param_info == NULL);
+	Assert(!subpath->path.parallel_aware);
+
+	memcpy(pathnode, subpath, sizeof(IndexPath));
+	pathnode->indexskip = true;
+
+	cost_index_skip(pathnode, root, ngroups);
+
+	return pathnode;
+}
+
 /*
  * create_bitmap_heap_path
  *	  Creates a path node for a bitmap scan.
@@ -324,6 +324,7 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 				info->amsearchnulls = amroutine->amsearchnulls;
 				info->amcanparallel = amroutine->amcanparallel;
 				info->amhasgettuple = (amroutine->amgettuple != NULL);
+				info->amcanskip = (amroutine->amskip != NULL);
 				info->amhasgetbitmap = amroutine->amgetbitmap != NULL &&
 					relation->rd_tableam->scan_bitmap_next_block != NULL;
 				info->amcanmarkpos = (amroutine->ammarkpos != NULL &&
@@ -430,6 +431,7 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 				info->amcanparallel = false;
 				info->amhasgettuple = false;
 				info->amhasgetbitmap = false;
+				info->amcanskip = false;
 				info->amcanmarkpos = false;
 				info->amcostestimate = NULL;
 
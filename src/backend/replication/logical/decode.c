@@ -44,6 +44,9 @@
 static void DecodeInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
 static void DecodeUpdate(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
 static void DecodeDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
+static void DecodeMultiDelete(LogicalDecodingContext *ctx,
+							  XLogRecordBuffer *buf,
+							  RelFileLocator *target_locator);
 static void DecodeTruncate(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
 static void DecodeMultiInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
 static void DecodeSpecConfirm(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
@@ -1034,6 +1037,12 @@ DecodeDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	if (xlrec->flags & XLH_DELETE_IS_MULTI)
+	{
+		DecodeMultiDelete(ctx, buf, &target_locator);
+		return;
+	}
+
 	change = ReorderBufferGetChange(ctx->reorder);
 
 	if (xlrec->flags & XLH_DELETE_IS_SUPER)
@@ -1066,6 +1075,100 @@ DecodeDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 							 change, false);
 }
 
+/*
+ * Parse an XLOG_HEAP_DELETE record with XLH_DELETE_IS_MULTI into one change
+ * per deleted tuple.
+ *
+ * The old tuples, if any, follow the offsets in the format of
+ * XLOG_HEAP2_MULTI_INSERT's tuple data.
+ */
+static void
+DecodeMultiDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf,
+				  RelFileLocator *target_locator)
+{
+	XLogReaderState *r = buf->record;
+	xl_heap_delete *xlrec;
+	xl_heap_delete_multi *xlmulti;
+	char	   *data = NULL;
+	char	   *tupledata = NULL;
+	Size		tuplelen = 0;
+
+	xlrec = (xl_heap_delete *) XLogRecGetData(r);
+	xlmulti = (xl_heap_delete_multi *) ((char *) xlrec + SizeOfHeapDelete);
+
+	if (xlrec->flags & XLH_DELETE_CONTAINS_OLD)
+	{
+		Size		offset;
+
+		offset = SizeOfHeapDelete + SizeOfHeapDeleteMulti +
+			xlmulti->ntuples * sizeof(OffsetNumber);
+		Assert(XLogRecGetDataLen(r) > offset);
+
+		tupledata = (char *) xlrec + offset;
+		tuplelen = XLogRecGetDataLen(r) - offset;
+	}
+
+	data = tupledata;
+	for (int i = 0; i < xlmulti->ntuples; i++)
+	{
+		ReorderBufferChange *change;
+
+		change = ReorderBufferGetChange(ctx->reorder);
+		change->action = REORDER_BUFFER_CHANGE_DELETE;
+		change->origin_id = XLogRecGetOrigin(r);
+
+		memcpy(&change->data.tp.rlocator, target_locator,
+			   sizeof(RelFileLocator));
+
+		if (data != NULL)
+		{
+			xl_multi_insert_tuple *xlhdr;
+			int			datalen;
+			HeapTuple	tuple;
+			HeapTupleHeader header;
+
+			xlhdr = (xl_multi_insert_tuple *) SHORTALIGN(data);
+			data = ((char *) xlhdr) + SizeOfMultiInsertTuple;
+			datalen = xlhdr->datalen;
+
+			change->data.tp.oldtuple =
+				ReorderBufferGetTupleBuf(ctx->reorder, datalen);
+
+			tuple = change->data.tp.oldtuple;
+			header = tuple->t_data;
+
+			/* not a disk based tuple */
+			ItemPointerSetInvalid(&tuple->t_self);
+
+			/*
+			 * We can only figure this out after reassembling the
+			 * transactions.
+			 */
+			tuple->t_tableOid = InvalidOid;
+
+			tuple->t_len = datalen + SizeofHeapTupleHeader;
+
+			memset(header, 0, SizeofHeapTupleHeader);
+
+			memcpy((char *) tuple->t_data + SizeofHeapTupleHeader,
+				   data, datalen);
+			header->t_infomask = xlhdr->t_infomask;
+			header->t_infomask2 = xlhdr->t_infomask2;
+			header->t_hoff = xlhdr->t_hoff;
+
+			/* move to the next xl_multi_insert_tuple entry */
+			data += datalen;
+		}
+
+		/* tuples with external attributes are never deleted this way */
+		change->data.tp.clear_toast_afterwards = true;
+
+		ReorderBufferQueueChange(ctx->reorder, XLogRecGetXid(r),
+								 buf->origptr, change, false);
+	}
+	Assert(data == tupledata + tuplelen);
+}
+
 /*
  * Parse XLOG_HEAP_TRUNCATE from wal
  */
@@ -73,6 +73,19 @@ typedef struct StatExtEntry
 } StatExtEntry;
 
 
+/*
+ * An equijoin clause between Vars of two base relations, as seen by
+ * statext_join_clauselist_selectivity.
+ */
+typedef struct JoinClauseData
+{
+	int			idx;			/* position in the clause list */
+	Oid			opno;			/* the equality operator */
+	Oid			collid;			/* collation the operator uses */
+	Var		   *vars[2];		/* vars[0] is from the lower-numbered rel */
+	bool		swapped;		/* is vars[1] the operator's left input? */
+} JoinClauseData;
+
 static List *fetch_statentries_for_relation(Relation pg_statext, Oid relid);
 static VacAttrStats **lookup_var_attr_stats(Relation rel, Bitmapset *attrs, List *exprs,
 											int nvacatts, VacAttrStats **vacatts);
@@ -99,6 +112,14 @@ static AnlExprData *build_expr_data(List *exprs, int stattarget);
 static StatsBuildData *make_build_data(Relation rel, StatExtEntry *stat,
 									   int numrows, HeapTuple *rows,
 									   VacAttrStats **stats, int stattarget);
+static bool statext_is_compatible_join_clause(PlannerInfo *root,
+											  Node *clause,
+											  JoinClauseData *data);
+static bool statext_join_rel_is_usable(PlannerInfo *root, RelOptInfo *rel,
+									   Bitmapset *attnums);
+static Selectivity statext_join_selectivity(PlannerInfo *root,
+											JoinClauseData *data,
+											int nclauses);
 
 
 /*
@@ -2039,6 +2060,439 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * statext_join_clauselist_selectivity
+ *		Estimate equijoin clauses using multi-column statistics on the joined
+ *		relations.
+ *
+ * Looks for groups of two or more equality clauses between Vars of the same
+ * pair of base relations, e.g. "a.x = b.x AND a.y = b.y", and estimates each
+ * such group as a whole, from extended statistics on the join columns of
+ * each side (see statext_join_selectivity).  Clause-by-clause estimates
+ * assume the columns of a composite join key are independent, which badly
+ * underestimates joins on correlated columns.
+ *
+ * 'estimatedclauses' is an input/output parameter.  We set bits for the
+ * 0-based 'clauses' indexes we estimate for and also skip clause items that
+ * already have a bit set.
+ */
+Selectivity
+statext_join_clauselist_selectivity(PlannerInfo *root, List *clauses,
+									JoinType jointype, SpecialJoinInfo *sjinfo,
+									Bitmapset **estimatedclauses)
+{
+	Selectivity sel = 1.0;
+	JoinClauseData *data;
+	JoinClauseData *group;
+	bool	   *done;
+	int			ndata = 0;
+	ListCell   *lc;
+
+	/* Semi- and anti-joins are estimated quite differently; punt on them. */
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_FULL)
+		return sel;
+
+	data = palloc(sizeof(JoinClauseData) * list_length(clauses));
+
+	foreach(lc, clauses)
+	{
+		int			idx = foreach_current_index(lc);
+
+		if (bms_is_member(idx, *estimatedclauses))
+			continue;
+
+		if (statext_is_compatible_join_clause(root, (Node *) lfirst(lc),
+											  &data[ndata]))
+		{
+			data[ndata].idx = idx;
+			ndata++;
+		}
+	}
+
+	if (ndata < 2)
+	{
+		pfree(data);
+		return sel;
+	}
+
+	/* Estimate the clauses between each pair of relations together. */
+	group = palloc(sizeof(JoinClauseData) * ndata);
+	done = palloc0(sizeof(bool) * ndata);
+
+	for (int i = 0; i < ndata; i++)
+	{
+		int			ngroup = 0;
+		Selectivity group_sel;
+
+		if (done[i])
+			continue;
+
+		for (int j = i; j < ndata; j++)
+		{
+			if (data[j].vars[0]->varno == data[i].vars[0]->varno &&
+				data[j].vars[1]->varno == data[i].vars[1]->varno)
+			{
+				group[ngroup++] = data[j];
+				done[j] = true;
+			}
+		}
+
+		if (ngroup < 2)
+			continue;
+
+		group_sel = statext_join_selectivity(root, group, ngroup);
+		if (group_sel < 0)
+			continue;
+
+		sel *= group_sel;
+		for (int j = 0; j < ngroup; j++)
+			*estimatedclauses = bms_add_member(*estimatedclauses,
+											   group[j].idx);
+	}
+
+	pfree(group);
+	pfree(done);
+	pfree(data);
+
+	return sel;
+}
+
+/*
+ * statext_is_compatible_join_clause
+ *		Determines if the clause is an equijoin between plain columns of two
+ *		different base relations, and if so fills *data.
+ */
+static bool
+statext_is_compatible_join_clause(PlannerInfo *root, Node *clause,
+								  JoinClauseData *data)
+{
+	RestrictInfo *rinfo;
+	OpExpr	   *expr;
+	Node	   *leftop,
+			   *rightop;
+	Var		   *leftvar,
+			   *rightvar;
+
+	if (!IsA(clause, RestrictInfo))
+		return false;
+	rinfo = (RestrictInfo *) clause;
+
+	if (rinfo->pseudoconstant)
+		return false;
+
+	if (!is_opclause(rinfo->clause))
+		return false;
+	expr = (OpExpr *) rinfo->clause;
+
+	if (list_length(expr->args) != 2)
+		return false;
+
+	leftop = linitial(expr->args);
+	rightop = lsecond(expr->args);
+
+	/* strip RelabelType from either side of the expression */
+	if (IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+
+	if (IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+
+	if (!IsA(leftop, Var) || !IsA(rightop, Var))
+		return false;
+	leftvar = (Var *) leftop;
+	rightvar = (Var *) rightop;
+
+	/* Only user columns of base relations at this query level */
+	if (leftvar->varlevelsup != 0 || rightvar->varlevelsup != 0 ||
+		leftvar->varattno <= 0 || rightvar->varattno <= 0 ||
+		leftvar->varno == rightvar->varno ||
+		root->simple_rel_array[leftvar->varno] == NULL ||
+		root->simple_rel_array[rightvar->varno] == NULL)
+		return false;
+
+	/* There's nothing to gain unless one side has extended statistics. */
+	if (root->simple_rel_array[leftvar->varno]->statlist == NIL &&
+		root->simple_rel_array[rightvar->varno]->statlist == NIL)
+		return false;
+
+	/* Only operators estimated like equality are of interest. */
+	if (get_oprjoin(expr->opno) != F_EQJOINSEL)
+		return false;
+
+	data->opno = expr->opno;
+	data->collid = expr->inputcollid;
+	data->swapped = (leftvar->varno > rightvar->varno);
+	data->vars[0] = data->swapped ? rightvar : leftvar;
+	data->vars[1] = data->swapped ? leftvar : rightvar;
+
+	return true;
+}
+
+/*
+ * statext_join_rel_is_usable
+ *		Check that the relation's statistics may be used for its join columns.
+ *
+ * As in statext_is_compatible_clause, the user must be able to read the
+ * columns, since matching MCV items runs the join operators on their values.
+ */
+static bool
+statext_join_rel_is_usable(PlannerInfo *root, RelOptInfo *rel,
+						   Bitmapset *attnums)
+{
+	RangeTblEntry *rte = root->simple_rte_array[rel->relid];
+	Oid			userid;
+	int			attnum = -1;
+
+	if (rel->rtekind != RTE_RELATION || rel->statlist == NIL)
+		return false;
+
+	userid = OidIsValid(rel->userid) ? rel->userid : GetUserId();
+
+	/* Table-level SELECT privilege is sufficient for all columns */
+	if (pg_class_aclcheck(rte->relid, userid, ACL_SELECT) == ACLCHECK_OK)
+		return true;
+
+	while ((attnum = bms_next_member(attnums, attnum)) >= 0)
+	{
+		if (pg_attribute_aclcheck(rte->relid, attnum, userid,
+								  ACL_SELECT) != ACLCHECK_OK)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * statext_join_selectivity
+ *		Estimate a group of equijoin clauses between a pair of relations.
+ *
+ * When both relations have an MCV list on exactly their join columns, we
+ * match the two lists item by item, which is the multi-column equivalent of
+ * what eqjoinsel_inner does with per-column MCV lists, including its
+ * treatment of the values not covered by the lists.  Otherwise, if either
+ * side has ndistinct statistics covering its join columns, we fall back to
+ * 1/max(nd1, nd2), with the number of distinct join keys on each side as
+ * estimated by estimate_num_groups (which knows how to use ndistinct
+ * statistics).
+ *
+ * Returns -1 if the statistics aren't able to help.
+ */
+static Selectivity
+statext_join_selectivity(PlannerInfo *root, JoinClauseData *data,
+						 int nclauses)
+{
+	RelOptInfo *rels[2];
+	Bitmapset  *attnums[2] = {NULL, NULL};
+	List	   *exprs[2] = {NIL, NIL};
+	StatisticExtInfo *mcvstat[2] = {NULL, NULL};
+	bool		has_ndistinct = false;
+	double		nullfrac[2];
+	double		nd[2];
+	Selectivity selec;
+
+	for (int side = 0; side < 2; side++)
+	{
+		RangeTblEntry *rte;
+		ListCell   *lc;
+
+		rels[side] = root->simple_rel_array[data[0].vars[side]->varno];
+		rte = root->simple_rte_array[rels[side]->relid];
+
+		for (int i = 0; i < nclauses; i++)
+		{
+			Var		   *var = data[i].vars[side];
+
+			attnums[side] = bms_add_member(attnums[side], var->varattno);
+			exprs[side] = lappend(exprs[side], var);
+		}
+
+		/* each column may appear only once on either side */
+		if (bms_num_members(attnums[side]) != nclauses)
+			return -1.0;
+
+		if (!statext_join_rel_is_usable(root, rels[side], attnums[side]))
+			continue;
+
+		foreach(lc, rels[side]->statlist)
+		{
+			StatisticExtInfo *stat = (StatisticExtInfo *) lfirst(lc);
+
+			if (stat->inherit != rte->inh || stat->exprs != NIL)
+				continue;
+
+			if (stat->kind == STATS_EXT_MCV &&
+				bms_equal(stat->keys, attnums[side]))
+				mcvstat[side] = stat;
+			else if (stat->kind == STATS_EXT_NDISTINCT &&
+					 bms_is_subset(attnums[side], stat->keys))
+				has_ndistinct = true;
+		}
+	}
+
+	if (mcvstat[0] == NULL && mcvstat[1] == NULL && !has_ndistinct)
+		return -1.0;
+
+	for (int side = 0; side < 2; side++)
+	{
+		nd[side] = estimate_num_groups(root, exprs[side], rels[side]->tuples,
+									   NULL, NULL);
+		nd[side] = Max(nd[side], 1.0);
+
+		/* combine the per-column null fractions as if independent */
+		nullfrac[side] = 0.0;
+		for (int i = 0; i < nclauses; i++)
+		{
+			VariableStatData vardata;
+
+			examine_variable(root, (Node *) data[i].vars[side], 0, &vardata);
+			if (HeapTupleIsValid(vardata.statsTuple))
+			{
+				Form_pg_statistic stats;
+
+				stats = (Form_pg_statistic) GETSTRUCT(vardata.statsTuple);
+				nullfrac[side] += (1.0 - nullfrac[side]) * stats->stanullfrac;
+			}
+			ReleaseVariableStats(vardata);
+		}
+	}
+
+	if (mcvstat[0] != NULL && mcvstat[1] != NULL)
+	{
+		MCVList    *mcv[2];
+		int		   *dims[2];
+		bool	   *hasmatch[2];
+		FmgrInfo   *eqprocs;
+		double		matchprodfreq = 0.0;
+		double		unmatchfreq[2] = {0.0, 0.0};
+		double		otherfreq[2];
+		int			nvalues[2] = {0, 0};
+		int			nmatches = 0;
+		double		totalsel[2];
+
+		eqprocs = palloc(sizeof(FmgrInfo) * nclauses);
+		for (int i = 0; i < nclauses; i++)
+			fmgr_info(get_opcode(data[i].opno), &eqprocs[i]);
+
+		for (int side = 0; side < 2; side++)
+		{
+			RangeTblEntry *rte = root->simple_rte_array[rels[side]->relid];
+
+			mcv[side] = statext_mcv_load(mcvstat[side]->statOid, rte->inh);
+			hasmatch[side] = palloc0(sizeof(bool) * mcv[side]->nitems);
+			dims[side] = palloc(sizeof(int) * nclauses);
+			for (int i = 0; i < nclauses; i++)
+				dims[side][i] = bms_member_index(mcvstat[side]->keys,
+												 data[i].vars[side]->varattno);
+		}
+
+		for (int i = 0; i < mcv[0]->nitems; i++)
+		{
+			MCVItem    *item1 = &mcv[0]->items[i];
+
+			for (int j = 0; j < mcv[1]->nitems; j++)
+			{
+				MCVItem    *item2 = &mcv[1]->items[j];
+				bool		match = true;
+
+				/* each side-2 item may match only one side-1 item */
+				if (hasmatch[1][j])
+					continue;
+
+				for (int k = 0; k < nclauses && match; k++)
+				{
+					Datum		v1 = item1->values[dims[0][k]];
+					Datum		v2 = item2->values[dims[1][k]];
+
+					/* the operators are strict, so NULLs never join */
+					if (item1->isnull[dims[0][k]] ||
+						item2->isnull[dims[1][k]])
+						match = false;
+					else if (data[k].swapped)
+						match = DatumGetBool(FunctionCall2Coll(&eqprocs[k],
+															   data[k].collid,
+															   v2, v1));
+					else
+						match = DatumGetBool(FunctionCall2Coll(&eqprocs[k],
+															   data[k].collid,
+															   v1, v2));
+				}
+
+				if (match)
+				{
+					hasmatch[0][i] = hasmatch[1][j] = true;
+					matchprodfreq += item1->frequency * item2->frequency;
+					nmatches++;
+					break;
+				}
+			}
+		}
+
+		/*
+		 * Sum up the matched and unmatched frequencies on each side.  Items
+		 * with NULLs can't match anything, and count towards the null
+		 * fraction rather than the "other" values.
+		 */
+		for (int side = 0; side < 2; side++)
+		{
+			double		sumfreq = 0.0;
+			double		nullfreq = 0.0;
+
+			for (int i = 0; i < mcv[side]->nitems; i++)
+			{
+				MCVItem    *item = &mcv[side]->items[i];
+				bool		isnull = false;
+
+				for (int k = 0; k < nclauses; k++)
+					isnull |= item->isnull[dims[side][k]];
+
+				sumfreq += item->frequency;
+				if (isnull)
+					nullfreq += item->frequency;
+				else
+				{
+					nvalues[side]++;
+					if (!hasmatch[side][i])
+						unmatchfreq[side] += item->frequency;
+				}
+			}
+
+			otherfreq[side] = 1.0 - sumfreq -
+				Max(nullfrac[side] - nullfreq, 0.0);
+			CLAMP_PROBABILITY(otherfreq[side]);
+		}
+
+		/*
+		 * Now combine the matched and unmatched parts as eqjoinsel_inner
+		 * does.  Unmatched MCV items of one side can only join the other
+		 * side's non-MCV values, which are assumed to be spread evenly
+		 * across its remaining distinct values, and so on.
+		 */
+		for (int side = 0; side < 2; side++)
+		{
+			int			other = 1 - side;
+
+			totalsel[side] = matchprodfreq;
+			if (nd[other] > nvalues[other])
+				totalsel[side] += unmatchfreq[side] * otherfreq[other] /
+					(nd[other] - nvalues[other]);
+			if (nd[other] > nmatches)
+				totalsel[side] += otherfreq[side] *
+					(otherfreq[other] + unmatchfreq[other]) /
+					(nd[other] - nmatches);
+		}
+
+		selec = Min(totalsel[0], totalsel[1]);
+	}
+	else
+		selec = (1.0 - nullfrac[0]) * (1.0 - nullfrac[1]) /
+			Max(nd[0], nd[1]);
+
+	CLAMP_PROBABILITY(selec);
+
+	return selec;
+}
+
 /*
  * examine_opclause_args
  *		Split an operator expression's arguments into Expr and Const parts.
@@ -26,6 +26,7 @@
 #include "access/xlogrecovery.h"
 #include "commands/async.h"
 #include "miscadmin.h"
+#include "optimizer/cardfeedback.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
@@ -52,6 +53,8 @@
 #include "storage/spin.h"
 #include "utils/guc.h"
 #include "utils/injection_point.h"
+#include "utils/queryresultcache.h"
+#include "utils/sharedplancache.h"
 
 /* GUCs */
 int			shared_memory_type = DEFAULT_SHARED_MEMORY_TYPE;
@@ -149,6 +152,9 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, SyncScanShmemSize());
 	size = add_size(size, AsyncShmemSize());
 	size = add_size(size, StatsShmemSize());
+	size = add_size(size, SharedPlanCacheShmemSize());
+	size = add_size(size, CardinalityFeedbackShmemSize());
+	size = add_size(size, QueryResultCacheShmemSize());
 	size = add_size(size, WaitEventCustomShmemSize());
 	size = add_size(size, InjectionPointShmemSize());
 	size = add_size(size, SlotSyncShmemSize());
@@ -355,6 +361,9 @@ CreateOrAttachShmemStructs(void)
 	SyncScanShmemInit();
 	AsyncShmemInit();
 	StatsShmemInit();
+	SharedPlanCacheShmemInit();
+	CardinalityFeedbackShmemInit();
+	QueryResultCacheShmemInit();
 	WaitEventCustomShmemInit();
 	InjectionPointShmemInit();
 }
@@ -169,6 +169,11 @@ static const char *const BuiltinTrancheNames[] = {
 	[LWTRANCHE_SUBTRANS_SLRU] = "SubtransSLRU",
 	[LWTRANCHE_XACT_SLRU] = "XactSLRU",
 	[LWTRANCHE_PARALLEL_VACUUM_DSA] = "ParallelVacuumDSA",
+	[LWTRANCHE_SHARED_PLAN_CACHE_DSA] = "SharedPlanCacheDSA",
+	[LWTRANCHE_SHARED_PLAN_CACHE_HASH] = "SharedPlanCacheHash",
+	[LWTRANCHE_CARDINALITY_FEEDBACK] = "CardinalityFeedback",
+	[LWTRANCHE_QUERY_RESULT_CACHE_DSA] = "QueryResultCacheDSA",
+	[LWTRANCHE_QUERY_RESULT_CACHE_HASH] = "QueryResultCacheHash",
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -39,6 +39,7 @@
 #include "commands/event_trigger.h"
 #include "commands/prepare.h"
 #include "common/pg_prng.h"
+#include "executor/tqueue.h"
 #include "jit/jit.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -3492,6 +3493,9 @@ ProcessInterrupts(void)
 	if (ParallelMessagePending)
 		HandleParallelMessages();
 
+	if (TupleQueueFlushPending)
+		ProcessTupleQueueFlush();
+
 	if (LogMemoryContextPending)
 		ProcessLogMemoryContextInterrupt();
 
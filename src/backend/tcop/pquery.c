@@ -25,6 +25,7 @@
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
 #include "utils/memutils.h"
+#include "utils/queryresultcache.h"
 #include "utils/snapmgr.h"
 
 
@@ -473,6 +474,19 @@ PortalStart(Portal portal, ParamListInfo params,
 		{
 			case PORTAL_ONE_SELECT:
 
+				/*
+				 * If the result is in the query result cache, we need not
+				 * start the executor at all.  This must be checked before
+				 * the snapshot is taken.
+				 */
+				if (!snapshot && QueryResultCacheStart(portal))
+				{
+					portal->atStart = true;
+					portal->atEnd = false;	/* allow fetches */
+					portal->portalPos = 0;
+					break;
+				}
+
 				/* Must set snapshot before starting executor. */
 				if (snapshot)
 					PushActiveSnapshot(snapshot);
@@ -880,6 +894,10 @@ PortalRunSelect(Portal portal,
 	/* Caller messed up if we have neither a ready query nor held data. */
 	Assert(queryDesc || portal->holdStore);
 
+	/* Capture the result for the query result cache, if wanted */
+	if (portal->resultCacheProbe)
+		dest = QueryResultCacheCapture(portal, forward, count, dest);
+
 	/*
 	 * Force the queryDesc destination to the right thing.  This supports
 	 * MOVE, for example, which will pass in dest = DestNone.  This is okay to
@@ -925,6 +943,9 @@ PortalRunSelect(Portal portal,
 			PopActiveSnapshot();
 		}
 
+		if (portal->resultCacheProbe)
+			QueryResultCacheFinish(portal);
+
 		if (!ScanDirectionIsNoMovement(direction))
 		{
 			if (nprocessed > 0)
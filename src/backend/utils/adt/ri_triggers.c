@@ -23,11 +23,14 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "commands/trigger.h"
@@ -107,6 +110,7 @@ typedef struct RI_ConstraintInfo
 	uint32		rootHashValue;	/* hash value of constraint_root_id */
 	NameData	conname;		/* name of the FK constraint */
 	Oid			pk_relid;		/* referenced relation */
+	Oid			conindid;		/* index supporting the referenced key */
 	Oid			fk_relid;		/* referencing relation */
 	char		confupdtype;	/* foreign key's ON UPDATE action */
 	char		confdeltype;	/* foreign key's ON DELETE action */
@@ -167,18 +171,46 @@ typedef struct RI_CompareHashEntry
 } RI_CompareHashEntry;
 
 
+/*
+ * RI_LastCheckEntry
+ *
+ * The last referenced key that ri_FastPathCheck() found and locked for a
+ * constraint.  It remains valid as long as the command counter hasn't been
+ * advanced and we're still in the same subtransaction, so that our lock on
+ * the PK row is still held and nothing could have changed the PK table in
+ * the meantime.  The entries, and the memory contexts holding their key
+ * values, are all thrown away at the end of each transaction; see
+ * ri_LastCheckXactCallback().
+ */
+typedef struct RI_LastCheckEntry
+{
+	Oid			constr_id;		/* OID of pg_constraint entry (hash key) */
+	uint32		oidHashValue;	/* hash value of constr_id */
+	uint32		rootHashValue;	/* hash value of its root constraint */
+	SubTransactionId subid;		/* subxact of the check, or Invalid */
+	CommandId	cid;			/* command ID of the check */
+	MemoryContext cxt;			/* holds by-reference key values */
+	Datum		vals[RI_MAX_NUMKEYS];	/* the FK key values */
+} RI_LastCheckEntry;
+
+
 /*
  * Local data
  */
 static HTAB *ri_constraint_cache = NULL;
 static HTAB *ri_query_cache = NULL;
 static HTAB *ri_compare_cache = NULL;
+static HTAB *ri_lastcheck_cache = NULL;
+static MemoryContext ri_lastcheck_cxt = NULL;
 static dclist_head ri_constraint_cache_valid_list;
 
 
 /*
  * Local function prototypes
  */
+static bool ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+							 Relation fk_rel, Relation pk_rel,
+							 TupleTableSlot *newslot);
 static bool ri_Check_Pk_Match(Relation pk_rel, Relation fk_rel,
 							  TupleTableSlot *oldslot,
 							  const RI_ConstraintInfo *riinfo);
@@ -204,6 +236,7 @@ static bool ri_AttributesEqual(Oid eq_opr, Oid typeid,
 
 static void ri_InitHashTables(void);
 static void InvalidateConstraintCacheCallBack(Datum arg, int cacheid, uint32 hashvalue);
+static void ri_LastCheckXactCallback(XactEvent event, void *arg);
 static SPIPlanPtr ri_FetchPreparedPlan(RI_QueryKey *key);
 static void ri_HashPreparedPlan(RI_QueryKey *key, SPIPlanPtr plan);
 static RI_CompareHashEntry *ri_HashCompareOp(Oid eq_opr, Oid typeid);
@@ -340,6 +373,13 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/* Probe the PK index directly, if we can */
+	if (ri_FastPathCheck(riinfo, fk_rel, pk_rel, newslot))
+	{
+		table_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -447,6 +487,312 @@ RI_FKey_check_upd(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * ri_FastPathCheck -
+ *
+ * Check foreign key existence by probing the unique index on the PK table
+ * directly, rather than running
+ *	SELECT 1 FROM ONLY <pktable> x WHERE pkatt1 = $1 [AND ...]
+ *		   FOR KEY SHARE OF x
+ * through SPI, which costs a lot more than the index probe itself for every
+ * checked row.  The row found is locked the same way the query would do it.
+ *
+ * Also, if the key is the same as the one last checked for this constraint,
+ * and nothing could have happened to the PK table since then, we needn't
+ * check it again.  This avoids redundant probes when bulk loading rows that
+ * reference the same key.
+ *
+ * Returns false if the check can't be done this way, in which case the
+ * caller must run the query instead.  Otherwise the check has been done:
+ * a violation is reported, or true is returned.
+ */
+static bool
+ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+				 Relation fk_rel, Relation pk_rel,
+				 TupleTableSlot *newslot)
+{
+	Oid			owner = RelationGetForm(pk_rel)->relowner;
+	TupleDesc	fk_desc = RelationGetDescr(fk_rel);
+	Relation	idxrel;
+	ScanKeyData skey[RI_MAX_NUMKEYS];
+	Datum		vals[RI_MAX_NUMKEYS];
+	char		nulls[RI_MAX_NUMKEYS];
+	RI_LastCheckEntry *lastcheck;
+	bool		found;
+	IndexScanDesc scan;
+	TupleTableSlot *slot;
+	Snapshot	snapshot;
+	int			lockflags;
+	Oid			save_userid;
+	int			save_sec_context;
+
+	/*
+	 * Partitioned PK tables need the query to find the right partition, and
+	 * the query also takes care of permission checks that don't pass at the
+	 * table level, including reporting failures.
+	 */
+	if (pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid) ||
+		pg_class_aclcheck(RelationGetRelid(pk_rel), owner,
+						  ACL_SELECT) != ACLCHECK_OK ||
+		pg_class_aclcheck(RelationGetRelid(pk_rel), owner,
+						  ACL_UPDATE) != ACLCHECK_OK)
+		return false;
+
+	idxrel = index_open(riinfo->conindid, AccessShareLock);
+	if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+		IndexRelationGetNumberOfKeyAttributes(idxrel) != riinfo->nkeys)
+	{
+		index_close(idxrel, AccessShareLock);
+		return false;
+	}
+
+	/*
+	 * Build the scan keys.  The index columns needn't be in the same order as
+	 * the FK columns.  We need the PK = FK operator to be the index's
+	 * equality operator, and the FK value to be usable as its right input
+	 * without conversion.
+	 */
+	ri_ExtractValues(fk_rel, newslot, riinfo, false, vals, nulls);
+	for (int i = 0; i < riinfo->nkeys; i++)
+	{
+		AttrNumber	pkattno = idxrel->rd_index->indkey.values[i];
+		Oid			opfamily = idxrel->rd_opfamily[i];
+		Oid			eq_opr = InvalidOid;
+		Oid			fk_type = InvalidOid;
+		Datum		value = (Datum) 0;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+
+		for (int j = 0; j < riinfo->nkeys; j++)
+		{
+			if (riinfo->pk_attnums[j] == pkattno)
+			{
+				eq_opr = riinfo->pf_eq_oprs[j];
+				fk_type = RIAttType(fk_rel, riinfo->fk_attnums[j]);
+				value = vals[j];
+				Assert(nulls[j] == ' ');
+				break;
+			}
+		}
+
+		if (!OidIsValid(eq_opr) ||
+			!op_in_opfamily(eq_opr, opfamily) ||
+			idxrel->rd_indcollation[i] != RIAttCollation(pk_rel, pkattno))
+		{
+			index_close(idxrel, AccessShareLock);
+			return false;
+		}
+		get_op_opfamily_properties(eq_opr, opfamily, false,
+								   &strategy, &lefttype, &righttype);
+		if (strategy != BTEqualStrategyNumber ||
+			!IsBinaryCoercible(fk_type, righttype))
+		{
+			index_close(idxrel, AccessShareLock);
+			return false;
+		}
+
+		ScanKeyEntryInitialize(&skey[i],
+							   0,
+							   i + 1,
+							   strategy,
+							   righttype,
+							   idxrel->rd_indcollation[i],
+							   get_opcode(eq_opr),
+							   value);
+	}
+
+	/*
+	 * Like SPI does for the query, make sure all our own work is visible.
+	 * Then, if the key was found and locked by the last check for this
+	 * constraint and the command counter didn't move since, it's still
+	 * there.
+	 */
+	CommandCounterIncrement();
+
+	if (ri_lastcheck_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(RI_LastCheckEntry);
+		ctl.hcxt = ri_lastcheck_cxt;
+		ri_lastcheck_cache = hash_create("RI last check cache",
+										 RI_INIT_CONSTRAINTHASHSIZE, &ctl,
+										 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	lastcheck = (RI_LastCheckEntry *) hash_search(ri_lastcheck_cache,
+												  &riinfo->constraint_id,
+												  HASH_ENTER, &found);
+	if (!found)
+	{
+		lastcheck->oidHashValue = riinfo->oidHashValue;
+		lastcheck->rootHashValue = riinfo->rootHashValue;
+		lastcheck->subid = InvalidSubTransactionId;
+		lastcheck->cxt = AllocSetContextCreate(ri_lastcheck_cxt,
+											   "RI last check",
+											   ALLOCSET_SMALL_SIZES);
+	}
+	else if (lastcheck->subid == GetCurrentSubTransactionId() &&
+			 lastcheck->cid == GetCurrentCommandId(false))
+	{
+		bool		same = true;
+
+		for (int i = 0; i < riinfo->nkeys; i++)
+		{
+			Form_pg_attribute att = TupleDescAttr(fk_desc,
+												  riinfo->fk_attnums[i] - 1);
+
+			if (!datum_image_eq(lastcheck->vals[i], vals[i],
+								att->attbyval, att->attlen))
+			{
+				same = false;
+				break;
+			}
+		}
+		if (same)
+		{
+			index_close(idxrel, AccessShareLock);
+			return true;
+		}
+	}
+
+	/* Probe and lock as the PK table's owner, like the query */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(owner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+	UpdateActiveSnapshotCommandId();
+	snapshot = GetActiveSnapshot();
+
+	/* See ExecLockRows() */
+	lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+	if (!IsolationUsesXactSnapshot())
+		lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+	slot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idxrel, snapshot, riinfo->nkeys, 0);
+	index_rescan(scan, skey, riinfo->nkeys, NULL, 0);
+
+	found = false;
+	while (!found && index_getnext_slot(scan, ForwardScanDirection, slot))
+	{
+		TM_FailureData tmfd;
+		TM_Result	test;
+
+		test = table_tuple_lock(pk_rel, &slot->tts_tid, snapshot, slot,
+								GetCurrentCommandId(false),
+								LockTupleKeyShare, LockWaitBlock,
+								lockflags, &tmfd);
+		switch (test)
+		{
+			case TM_Ok:
+				found = true;
+
+				/*
+				 * If we locked a newer version of the row, it might not
+				 * have the key anymore, so recheck it, like EvalPlanQual()
+				 * would.
+				 */
+				if (tmfd.traversed)
+				{
+					for (int i = 0; i < riinfo->nkeys; i++)
+					{
+						Datum		pkval;
+						bool		isnull;
+
+						pkval = slot_getattr(slot,
+											 idxrel->rd_index->indkey.values[i],
+											 &isnull);
+						if (isnull ||
+							!DatumGetBool(FunctionCall2Coll(&skey[i].sk_func,
+															skey[i].sk_collation,
+															pkval,
+															skey[i].sk_argument)))
+						{
+							found = false;
+							break;
+						}
+					}
+				}
+				break;
+
+			case TM_SelfModified:
+
+				/*
+				 * Updated or deleted by ourselves since the snapshot was
+				 * taken; ignore it, like the query would.
+				 */
+				break;
+
+			case TM_Updated:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				elog(ERROR, "unexpected table_tuple_lock status: %u",
+					 test);
+				break;
+
+			case TM_Deleted:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent delete")));
+				/* tuple was deleted so don't return it */
+				break;
+
+			case TM_Invisible:
+				elog(ERROR, "attempted to lock invisible tuple");
+				break;
+
+			default:
+				elog(ERROR, "unrecognized table_tuple_lock status: %u",
+					 test);
+		}
+	}
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	PopActiveSnapshot();
+
+	/* Restore UID and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	index_close(idxrel, NoLock);
+
+	if (!found)
+	{
+		lastcheck->subid = InvalidSubTransactionId;
+		ri_ReportViolation(riinfo,
+						   pk_rel, fk_rel,
+						   newslot,
+						   NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, false);
+	}
+
+	/* Remember the key we've found and locked */
+	MemoryContextReset(lastcheck->cxt);
+	for (int i = 0; i < riinfo->nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(fk_desc,
+											  riinfo->fk_attnums[i] - 1);
+		MemoryContext oldcxt = MemoryContextSwitchTo(lastcheck->cxt);
+
+		lastcheck->vals[i] = datumCopy(vals[i], att->attbyval, att->attlen);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	lastcheck->subid = GetCurrentSubTransactionId();
+	lastcheck->cid = GetCurrentCommandId(false);
+
+	return true;
+}
+
+
 /*
  * ri_Check_Pk_Match
  *
@@ -2158,6 +2504,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 												  ObjectIdGetDatum(riinfo->constraint_root_id));
 	memcpy(&riinfo->conname, &conForm->conname, sizeof(NameData));
 	riinfo->pk_relid = conForm->confrelid;
+	riinfo->conindid = conForm->conindid;
 	riinfo->fk_relid = conForm->conrelid;
 	riinfo->confupdtype = conForm->confupdtype;
 	riinfo->confdeltype = conForm->confdeltype;
@@ -2259,6 +2606,22 @@ InvalidateConstraintCacheCallBack(Datum arg, int cacheid, uint32 hashvalue)
 			dclist_delete_from(&ri_constraint_cache_valid_list, iter.cur);
 		}
 	}
+
+	/* Likewise, don't trust keys checked under the old definition */
+	if (ri_lastcheck_cache != NULL)
+	{
+		HASH_SEQ_STATUS status;
+		RI_LastCheckEntry *lastcheck;
+
+		hash_seq_init(&status, ri_lastcheck_cache);
+		while ((lastcheck = hash_seq_search(&status)) != NULL)
+		{
+			if (hashvalue == 0 ||
+				lastcheck->oidHashValue == hashvalue ||
+				lastcheck->rootHashValue == hashvalue)
+				lastcheck->subid = InvalidSubTransactionId;
+		}
+	}
 }
 
 
@@ -2696,6 +3059,42 @@ ri_InitHashTables(void)
 	ri_compare_cache = hash_create("RI compare cache",
 								   RI_INIT_QUERYHASHSIZE,
 								   &ctl, HASH_ELEM | HASH_BLOBS);
+
+	/*
+	 * The last check cache is only valid within a transaction, so it's
+	 * created on first use in each one, in a context that's reset at the end.
+	 */
+	ri_lastcheck_cxt = AllocSetContextCreate(TopMemoryContext,
+											 "RI last check cache",
+											 ALLOCSET_SMALL_SIZES);
+	RegisterXactCallback(ri_LastCheckXactCallback, NULL);
+}
+
+/*
+ * ri_LastCheckXactCallback -
+ *
+ * At transaction end, forget the keys ri_FastPathCheck() found, along with
+ * the memory holding them.
+ */
+static void
+ri_LastCheckXactCallback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			if (ri_lastcheck_cache != NULL)
+			{
+				MemoryContextReset(ri_lastcheck_cxt);
+				ri_lastcheck_cache = NULL;
+			}
+			break;
+		default:
+			break;
+	}
 }
 
 
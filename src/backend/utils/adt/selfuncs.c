@@ -119,6 +119,7 @@
 #include "optimizer/paths.h"
 #include "optimizer/plancat.h"
 #include "parser/parse_clause.h"
+#include "parser/parse_coerce.h"
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
@@ -214,6 +215,7 @@ static bool get_actual_variable_endpoint(Relation heapRel,
 										 MemoryContext outercontext,
 										 Datum *endpointDatum);
 static RelOptInfo *find_join_input_rel(PlannerInfo *root, Relids relids);
+static double btree_skip_groups(PlannerInfo *root, IndexPath *path);
 
 
 /*
@@ -6809,6 +6811,68 @@ add_predicate_to_index_quals(IndexOptInfo *index, List *indexQuals)
 	return list_concat(predExtraQuals, indexQuals);
 }
 
+/*
+ * btree_skip_groups
+ *		Estimate the number of groups a btree skip scan would visit.
+ *
+ * A btree scan whose first index clause is on the second index column skips
+ * from one distinct value of the leading column to the next, scanning each
+ * group using the remaining quals as boundary quals (see nbtree.h).  Returns
+ * the estimated number of distinct leading values if the scan qualifies and
+ * skipping is expected to pay off, else 0.  The conditions checked here
+ * mirror those checked by _bt_skip_setup at execution time.
+ */
+static double
+btree_skip_groups(PlannerInfo *root, IndexPath *path)
+{
+	IndexOptInfo *index = path->indexinfo;
+	IndexClause *first;
+	TargetEntry *tle;
+	Oid			storetype;
+	double		ngroups;
+	ListCell   *lc;
+
+	if (path->indexclauses == NIL || index->nkeycolumns < 2 ||
+		path->path.parallel_aware)
+		return 0;
+
+	first = linitial_node(IndexClause, path->indexclauses);
+	if (first->indexcol != 1)
+		return 0;
+
+	foreach(lc, path->indexclauses)
+	{
+		IndexClause *iclause = lfirst_node(IndexClause, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, iclause->indexquals)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+			if (IsA(rinfo->clause, ScalarArrayOpExpr))
+				return 0;
+		}
+	}
+
+	storetype = get_atttype(index->indexoid, 1);
+	if (storetype != index->opcintype[0] &&
+		!IsBinaryCoercible(storetype, index->opcintype[0]))
+		return 0;
+
+	tle = linitial_node(TargetEntry, index->indextlist);
+	ngroups = estimate_num_groups(root, list_make1(tle->expr),
+								  index->rel->tuples, NULL, NULL);
+
+	/*
+	 * With more groups than this, consecutive groups tend to share leaf
+	 * pages, and the scan soon gives up skipping at runtime.
+	 */
+	if (ngroups > index->pages * 0.3333333)
+		return 0;
+
+	return ngroups;
+}
+
 
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
@@ -6829,6 +6893,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		skip_groups;
 	ListCell   *lc;
 
 	/*
@@ -6847,6 +6912,11 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform up
 	 * to N index descents (not just one), but the ScalarArrayOpExpr's
 	 * operator can be considered to act the same as it normally does.
+	 *
+	 * If the quals start at the second column, a skip scan treats them as
+	 * boundary quals within each group of the first column's values.  We
+	 * treat that like an '=' qual on the first column with one element per
+	 * group, i.e. one descent per group.
 	 */
 	indexBoundQuals = NIL;
 	indexcol = 0;
@@ -6854,6 +6924,12 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	found_saop = false;
 	found_is_null_op = false;
 	num_sa_scans = 1;
+	skip_groups = btree_skip_groups(root, path);
+	if (skip_groups > 0)
+	{
+		indexcol = 1;
+		num_sa_scans = skip_groups;
+	}
 	foreach(lc, path->indexclauses)
 	{
 		IndexClause *iclause = lfirst_node(IndexClause, lc);
@@ -6941,7 +7017,8 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
-		!found_is_null_op)
+		!found_is_null_op &&
+		skip_groups == 0)
 		numIndexTuples = 1.0;
 	else
 	{
@@ -7024,13 +7101,15 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there are ScalarArrayOpExprs, charge this once per estimated SA
 	 * index descent.  The ones after the first one are not startup cost so
-	 * far as the overall plan goes, so just add them to "total" cost.
+	 * far as the overall plan goes, so just add them to "total" cost.  A skip
+	 * scan also makes an extra descent per group to find the group's leading
+	 * value.
 	 */
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
-		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		costs.indexTotalCost += (costs.num_sa_scans + skip_groups) * descentCost;
 	}
 
 	/*
@@ -7046,7 +7125,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 */
 	descentCost = (index->tree_height + 1) * DEFAULT_PAGE_CPU_MULTIPLIER * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
-	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	costs.indexTotalCost += (costs.num_sa_scans + skip_groups) * descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
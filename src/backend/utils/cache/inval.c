@@ -123,6 +123,8 @@
 #include "utils/inval.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
+#include "utils/queryresultcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
@@ -548,6 +550,8 @@ RegisterCatcacheInvalidation(int cacheId,
 {
 	AddCatcacheInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								   cacheId, hashValue, dbId);
+	QueryResultCacheNoteObject(cacheId, hashValue);
+	SharedPlanCacheNoteObject(cacheId, hashValue);
 }
 
 /*
@@ -560,6 +564,8 @@ RegisterCatalogInvalidation(Oid dbId, Oid catId)
 {
 	AddCatalogInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								  dbId, catId);
+	QueryResultCacheNoteAll();
+	SharedPlanCacheNoteAll();
 }
 
 /*
@@ -573,6 +579,13 @@ RegisterRelcacheInvalidation(Oid dbId, Oid relId)
 	AddRelcacheInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								   dbId, relId);
 
+	/* Cached query results depending on the relation become outdated */
+	if (relId == InvalidOid)
+		QueryResultCacheNoteAll();
+	else
+		QueryResultCacheNoteRelation(relId);
+	SharedPlanCacheNoteRelation(relId);
+
 	/*
 	 * Most of the time, relcache invalidation is associated with system
 	 * catalog updates, but there are a few cases where it isn't.  Quick hack
@@ -58,11 +58,14 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "parser/analyze.h"
+#include "parser/parsetree.h"
+#include "partitioning/partdesc.h"
 #include "storage/lmgr.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
@@ -70,6 +73,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -102,14 +106,19 @@ static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_l
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static void AcquireExecutorLocks(List *stmt_list, bool acquire,
+								 ParamListInfo boundParams,
+								 List **prunedRelids);
+static Bitmapset *PruneExecutorLocks(PlannedStmt *plannedstmt,
+									 ParamListInfo boundParams);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -817,11 +826,14 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  *
  * On a "true" return, we have acquired the locks needed to run the plan.
  * (We must do this for the "true" result to be race-condition-free.)
+ * boundParams are the parameter values the plan is about to be run with;
+ * they're used to skip locking partitions that initial pruning will remove.
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
+	List	   *prunedRelids = NIL;
 
 	/* Assert that caller checked the querytree */
 	Assert(plansource->is_valid);
@@ -853,7 +865,8 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		AcquireExecutorLocks(plan->stmt_list, true, boundParams,
+							 &prunedRelids);
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -875,7 +888,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan->stmt_list, false, NULL, &prunedRelids);
 	}
 
 	/*
@@ -909,6 +922,7 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	CachedPlan *plan;
 	List	   *plist;
 	bool		snapshot_set;
+	bool		share_plan;
 	bool		is_transient;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
@@ -957,10 +971,44 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	}
 
 	/*
-	 * Generate the plan.
+	 * Generate the plan.  For a generic plan, first see whether another
+	 * backend has already made one for the same statement.
 	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+	share_plan = (boundParams == NULL &&
+				  SharedPlanCacheEligible(plansource, queryEnv));
+	plist = NIL;
+	if (share_plan)
+	{
+		SharedPlanVersions *versions;
+
+		plist = SharedPlanCacheLookup(plansource, &versions);
+		if (plist != NIL)
+		{
+			/*
+			 * Lock what the plan touches, as the planner would have, then
+			 * make sure nothing the plan depends on was changed before we
+			 * got the locks.
+			 */
+			AcquireExecutorLocks(plist, true, NULL, NULL);
+			if (!plansource->is_valid ||
+				!SharedPlanCacheIsCurrent(versions))
+			{
+				AcquireExecutorLocks(plist, false, NULL, NULL);
+				plist = NIL;
+			}
+		}
+	}
+	if (plist == NIL)
+	{
+		uint64		counter = 0;
+
+		if (share_plan)
+			counter = SharedPlanCacheBeginPlanning();
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
+		if (share_plan && plansource->is_valid)
+			SharedPlanCacheStore(plansource, plist, counter);
+	}
 
 	/* Release snapshot if we got one */
 	if (snapshot_set)
@@ -1187,7 +1235,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1767,15 +1815,27 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * If prunedRelids isn't NULL when acquiring, we try to leave unlocked the
+ * leaf partitions that the executor's initial pruning is going to remove,
+ * by doing that pruning ourselves with the given boundParams, and set
+ * *prunedRelids to a list (parallel to stmt_list) of the sets of RT indexes
+ * left unlocked.  When releasing, pass back that same list so that exactly
+ * the locks we took get released.
  */
 static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+AcquireExecutorLocks(List *stmt_list, bool acquire,
+					 ParamListInfo boundParams, List **prunedRelids)
 {
 	ListCell   *lc1;
+	int			stmtno = 0;
 
 	foreach(lc1, stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *skip_rtis = NULL;
+		Bitmapset  *prunable_rtis = NULL;
+		Index		rti;
 		ListCell   *lc2;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
@@ -1791,16 +1851,38 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 
 			if (query)
 				ScanQueryForLocks(query, acquire);
+			if (acquire && prunedRelids)
+				*prunedRelids = lappend(*prunedRelids, NULL);
+			stmtno++;
 			continue;
 		}
 
+		/*
+		 * When acquiring with pruning allowed, put off locking the prunable
+		 * partitions until we know which of them survive; otherwise skip
+		 * whatever the acquiring call skipped.
+		 */
+		if (prunedRelids)
+		{
+			if (acquire)
+				prunable_rtis = plannedstmt->prunableRelids;
+			else
+				skip_rtis = (Bitmapset *) list_nth(*prunedRelids, stmtno);
+		}
+
+		rti = 1;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
 			if (!(rte->rtekind == RTE_RELATION ||
-				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))))
+				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))) ||
+				bms_is_member(rti, prunable_rtis) ||
+				bms_is_member(rti, skip_rtis))
+			{
+				rti++;
 				continue;
+			}
 
 			/*
 			 * Acquire the appropriate type of lock on each relation OID. Note
@@ -1812,10 +1894,99 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 				LockRelationOid(rte->relid, rte->rellockmode);
 			else
 				UnlockRelationOid(rte->relid, rte->rellockmode);
+			rti++;
+		}
+
+		/*
+		 * Now that the partitioned tables are locked, find the prunable
+		 * partitions that survive initial pruning and lock just those.
+		 */
+		if (prunable_rtis != NULL)
+		{
+			Bitmapset  *survivors = PruneExecutorLocks(plannedstmt,
+													   boundParams);
+			int			i = -1;
+
+			skip_rtis = bms_difference(prunable_rtis, survivors);
+			while ((i = bms_next_member(prunable_rtis, i)) >= 0)
+			{
+				RangeTblEntry *rte;
+
+				if (bms_is_member(i, skip_rtis))
+					continue;
+				rte = rt_fetch(i, plannedstmt->rtable);
+				LockRelationOid(rte->relid, rte->rellockmode);
+			}
 		}
+
+		if (acquire && prunedRelids)
+			*prunedRelids = lappend(*prunedRelids, skip_rtis);
+		stmtno++;
 	}
 }
 
+/*
+ * PruneExecutorLocks: perform the initial partition pruning that executor
+ * startup will do for plannedstmt, and return the RT indexes of its
+ * prunable partitions that survive.
+ *
+ * The caller must already hold the locks on everything else in the plan,
+ * in particular the partitioned tables the pruning looks at.  If pruning
+ * can't be done here, all the prunable partitions are returned.
+ *
+ * The executor doesn't lock anything we leave out, so it must not scan any
+ * of those partitions.  It won't: the pruning steps of prunable partitions
+ * depend only on the bound parameter values, which the executor will be
+ * given too (see set_partpruneinfo_references), and the partitions' bounds
+ * can't change while we hold the lock on their parent.  Partitions attached
+ * meanwhile aren't in the plan, and partitions detached meanwhile can only
+ * be pruned by the executor.
+ */
+static Bitmapset *
+PruneExecutorLocks(PlannedStmt *plannedstmt, ParamListInfo boundParams)
+{
+	EState	   *estate;
+	MemoryContext oldcxt;
+	Bitmapset  *survivors = NULL;
+	Bitmapset  *result;
+	ListCell   *lc;
+
+	/*
+	 * Without the parameter values, there's nothing to prune with.
+	 * Evaluating pruning expressions may also call functions that need a
+	 * snapshot; if there's none, don't try.
+	 */
+	if (plannedstmt->partPruneInfos == NIL || boundParams == NULL ||
+		!ActiveSnapshotSet())
+		return plannedstmt->prunableRelids;
+
+	estate = CreateExecutorState();
+	estate->es_param_list_info = boundParams;
+	ExecInitRangeTable(estate, plannedstmt->rtable, plannedstmt->permInfos);
+
+	/* Keep the pruning machinery's allocations in the EState */
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	foreach(lc, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
+
+		survivors = bms_add_members(survivors,
+									ExecInitialPruneLeafRelids(estate,
+															   pruneinfo));
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	/* Only the prunable ones are of interest to the caller */
+	result = bms_intersect(survivors, plannedstmt->prunableRelids);
+
+	ExecCloseRangeTableRelations(estate);
+	if (estate->es_partition_directory)
+		DestroyPartitionDirectory(estate->es_partition_directory);
+	FreeExecutorState(estate);
+
+	return result;
+}
+
 /*
  * AcquirePlannerLocks: acquire locks needed for planning of a querytree list;
  * or release them if acquire is false.
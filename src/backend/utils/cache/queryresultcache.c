@@ -0,0 +1,1286 @@
+/*-------------------------------------------------------------------------
+ *
+ * queryresultcache.c
+ *	  Cross-backend cache of query results.
+ *
+ * When query_result_cache_size is set and a session turns on
+ * query_result_cache, the complete result of a read-only SELECT run through
+ * a portal is kept, as a series of MinimalTuples, in a dshash table that
+ * lives in a fixed-size DSA area carved out of the main shared memory
+ * segment.  A later execution of the same statement with the same parameter
+ * values, by any session of the same user, loads the stored tuples into the
+ * portal's holdStore instead of starting the executor.
+ *
+ * A result is identified by its database, the current user, the text of the
+ * statement, the serialized parameter values, the search_path, a
+ * fingerprint of the settings that change how literals are read or values
+ * are converted to text (TimeZone, DateStyle, bytea_output and the like;
+ * see GetConfigFingerprint()), and the relations and other objects
+ * (PlanInvalItems) its plan depends on.  The hash key only covers database,
+ * user and a hash of the rest; the full values are kept with the entry and
+ * compared on lookup, along with the result column types.  Only statements
+ * whose result depends on nothing else are cached: the planner marks a
+ * PlannedStmt resultCacheable if it is a plain SELECT without mutable
+ * functions, row locks or TABLESAMPLE, and at run time all of its relations
+ * must be ordinary heap tables, materialized views, partitioned tables or
+ * views that are neither temporary, nor system catalogs, nor subject to row
+ * security.
+ *
+ * Staleness is detected with modification counters rather than by removing
+ * entries.  Each relation OID and each syscache hash value maps to one of a
+ * fixed number of counter slots in shared memory.  heapam.c and inval.c
+ * note every relation and catalog entry the current transaction changes,
+ * and at commit the slots noted are bumped twice: "started" just before the
+ * commit becomes visible to other snapshots, and "finished" just after.
+ * Before a portal takes its snapshot, we read the "started" value of the
+ * slots for every relation and object of the plan; a stored result carries
+ * the values read before its own snapshot was taken, and is only used if
+ * they are all unchanged.  A result is only stored if no commit was in
+ * progress on any of its slots ("started" equal to "finished") when the
+ * values were read; then every change that is visible to the result's
+ * snapshot but not counted in its versions must have started committing
+ * after the read, and so shows up as a mismatch to any later reader that
+ * could see it.  Prepared transactions don't know at COMMIT PREPARED which
+ * relations they changed, so that bumps a counter common to all entries.
+ *
+ * Because a hit returns the state of the database as of some instant after
+ * the statement began rather than as of a snapshot taken by it, results are
+ * only used and stored in READ COMMITTED transactions that have not
+ * modified anything; and not during recovery, since the counters are not
+ * maintained by WAL replay.
+ *
+ * When the area fills up, the least recently used entries are evicted in a
+ * batch.  Results larger than a sixteenth of the area are never stored.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/queryresultcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/detoast.h"
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "common/int.h"
+#include "executor/executor.h"
+#include "funcapi.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/dsa.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/queryresultcache.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+
+
+/* GUC parameters */
+int			query_result_cache_size = 0;	/* in megabytes */
+bool		query_result_cache = false;
+
+/* Number of modification counter slots; must be a power of 2 */
+#define QRC_NUM_SLOTS	4096
+
+/*
+ * Hash key of a cached result.  hash covers everything else that identifies
+ * the statement; see qrc_make_probe().
+ */
+typedef struct QueryResultKey
+{
+	Oid			dbid;
+	Oid			roleid;
+	uint32		hash;
+} QueryResultKey;
+
+typedef struct QueryResultEntry
+{
+	QueryResultKey key;			/* hash key, must be first */
+	dsa_pointer data;			/* QueryResultData */
+	Size		size;			/* allocated size of data */
+	pg_atomic_uint64 last_used; /* value of clock when last stored or hit */
+} QueryResultEntry;
+
+/* A dependency on a syscache entry, as in PlanInvalItem */
+typedef struct QueryResultInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} QueryResultInvalItem;
+
+/*
+ * Everything stored for a cached result, in one DSA allocation.  The arrays,
+ * strings and tuples follow the struct, at the given offsets from its start.
+ */
+typedef struct QueryResultData
+{
+	uint64		all_version;	/* version of all_slot */
+	uint64		guc_fingerprint;	/* see GetConfigFingerprint() */
+	bool		addCatalog;
+	int			num_schemas;
+	int			num_relations;
+	int			num_items;
+	int			natts;
+	Size		params_len;
+	uint64		ntuples;
+	Size		off_versions;	/* uint64[num_relations + num_items] */
+	Size		off_relations;	/* Oid[num_relations] */
+	Size		off_items;		/* QueryResultInvalItem[num_items] */
+	Size		off_types;		/* Oid[natts] */
+	Size		off_typmods;	/* int32[natts] */
+	Size		off_schemas;	/* Oid[num_schemas] */
+	Size		off_params;		/* SerializeParamList() output */
+	Size		off_query;		/* statement text */
+	Size		off_tuples;		/* MinimalTuples, each MAXALIGN'd */
+} QueryResultData;
+
+#define QRD_ARRAY(data, type, off)	((type *) ((char *) (data) + (data)->off))
+
+/*
+ * A modification counter slot.  started is bumped before, and finished
+ * after, a commit that changed something mapping to the slot becomes
+ * visible; started is the slot's version.
+ */
+typedef struct QueryResultSlot
+{
+	pg_atomic_uint64 started;
+	pg_atomic_uint64 finished;
+} QueryResultSlot;
+
+typedef struct QueryResultCacheControl
+{
+	void	   *raw_dsa_area;
+	dshash_table_handle hash_handle;
+	pg_atomic_uint64 clock;		/* source of QueryResultEntry.last_used */
+	pg_atomic_uint64 bytes_used;	/* sum of QueryResultEntry.size */
+	pg_atomic_uint32 nentries;
+
+	/* statistics, see pg_stat_get_query_result_cache() */
+	pg_atomic_uint64 hits;
+	pg_atomic_uint64 misses;
+	pg_atomic_uint64 invalidations;
+	pg_atomic_uint64 stores;
+	pg_atomic_uint64 evictions;
+	pg_atomic_uint64 stats_reset;	/* TimestampTz */
+
+	QueryResultSlot all_slot;	/* bumped for changes to anything */
+	QueryResultSlot slots[QRC_NUM_SLOTS];
+} QueryResultCacheControl;
+
+/*
+ * Backend-local state of an eligible portal, from QueryResultCacheStart()
+ * until its result has been stored or found not worth storing.
+ */
+typedef struct QueryResultCacheProbe
+{
+	QueryResultKey key;
+	MemoryContext cxt;			/* the portal's context */
+	TupleDesc	tupdesc;		/* result descriptor derived from the plan */
+	char	   *query;			/* statement text */
+	Size		query_len;		/* including the terminating NUL */
+	char	   *params;			/* serialized parameter values */
+	Size		params_len;
+	List	   *schemas;		/* search_path */
+	bool		addCatalog;
+	uint64		guc_fingerprint;	/* see GetConfigFingerprint() */
+	List	   *relations;		/* relation OIDs of the plan */
+	List	   *items;			/* PlanInvalItems of the plan */
+	uint64		all_version;	/* version of all_slot */
+	uint64	   *versions;		/* slot versions of relations, then items */
+	bool		stable;			/* no commit was in progress on the slots */
+
+	/* result tuples being captured by PortalRunSelect */
+	bool		capturing;
+	StringInfoData tuples;
+	uint64		ntuples;
+} QueryResultCacheProbe;
+
+/* DestReceiver passing tuples on to another while capturing them */
+typedef struct QueryResultCaptureReceiver
+{
+	DestReceiver pub;
+	DestReceiver *target;
+	QueryResultCacheProbe *probe;
+} QueryResultCaptureReceiver;
+
+/* Sort item for qrc_evict() */
+typedef struct QueryResultAge
+{
+	uint64		last_used;
+	Size		size;
+} QueryResultAge;
+
+static const dshash_parameters qrc_hash_params = {
+	sizeof(QueryResultKey),
+	sizeof(QueryResultEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_QUERY_RESULT_CACHE_HASH
+};
+
+static QueryResultCacheControl *qrc_ctl = NULL;
+static dsa_area *qrc_area = NULL;
+static dshash_table *qrc_hash = NULL;
+
+/* slots changed by the current transaction */
+static uint64 qrc_pending[QRC_NUM_SLOTS / 64];
+static bool qrc_pending_any = false;
+static bool qrc_pending_all = false;
+static bool qrc_committing = false;
+
+
+/*
+ * Size of the DSA area holding the cache
+ */
+static Size
+qrc_area_size(void)
+{
+	return Max((Size) query_result_cache_size * 1024 * 1024,
+			   dsa_minimum_size());
+}
+
+/*
+ * Largest result we are willing to store
+ */
+static Size
+qrc_max_entry_size(void)
+{
+	return Min(qrc_area_size() / 16, MaxAllocSize / 2);
+}
+
+/*
+ * Report shared-memory space needed by QueryResultCacheShmemInit
+ */
+Size
+QueryResultCacheShmemSize(void)
+{
+	Size		size;
+
+	if (query_result_cache_size == 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(QueryResultCacheControl));
+	size = add_size(size, qrc_area_size());
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the query result cache, if enabled
+ */
+void
+QueryResultCacheShmemInit(void)
+{
+	bool		found;
+
+	if (query_result_cache_size == 0)
+		return;
+
+	qrc_ctl = (QueryResultCacheControl *)
+		ShmemInitStruct("Query Result Cache", QueryResultCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *dsh;
+
+		Assert(!found);
+
+		qrc_ctl->raw_dsa_area =
+			(char *) qrc_ctl + MAXALIGN(sizeof(QueryResultCacheControl));
+		dsa = dsa_create_in_place(qrc_ctl->raw_dsa_area, qrc_area_size(),
+								  LWTRANCHE_QUERY_RESULT_CACHE_DSA, 0);
+		dsa_pin(dsa);
+
+		/* the cache never grows beyond the space reserved for it here */
+		dsa_set_size_limit(dsa, qrc_area_size());
+
+		dsh = dshash_create(dsa, &qrc_hash_params, NULL);
+		qrc_ctl->hash_handle = dshash_get_hash_table_handle(dsh);
+
+		dshash_detach(dsh);
+		dsa_detach(dsa);
+
+		pg_atomic_init_u64(&qrc_ctl->clock, 1);
+		pg_atomic_init_u64(&qrc_ctl->bytes_used, 0);
+		pg_atomic_init_u32(&qrc_ctl->nentries, 0);
+		pg_atomic_init_u64(&qrc_ctl->hits, 0);
+		pg_atomic_init_u64(&qrc_ctl->misses, 0);
+		pg_atomic_init_u64(&qrc_ctl->invalidations, 0);
+		pg_atomic_init_u64(&qrc_ctl->stores, 0);
+		pg_atomic_init_u64(&qrc_ctl->evictions, 0);
+		pg_atomic_init_u64(&qrc_ctl->stats_reset, GetCurrentTimestamp());
+		pg_atomic_init_u64(&qrc_ctl->all_slot.started, 0);
+		pg_atomic_init_u64(&qrc_ctl->all_slot.finished, 0);
+		for (int i = 0; i < QRC_NUM_SLOTS; i++)
+		{
+			pg_atomic_init_u64(&qrc_ctl->slots[i].started, 0);
+			pg_atomic_init_u64(&qrc_ctl->slots[i].finished, 0);
+		}
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the cache's DSA area and hash table, if not done already
+ */
+static void
+qrc_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (qrc_hash != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	qrc_area = dsa_attach_in_place(qrc_ctl->raw_dsa_area, NULL);
+	dsa_pin_mapping(qrc_area);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(qrc_ctl->raw_dsa_area));
+
+	qrc_hash = dshash_attach(qrc_area, &qrc_hash_params,
+							 qrc_ctl->hash_handle, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Counter slot of a relation of the current database
+ */
+static inline int
+qrc_relation_slot(Oid relid)
+{
+	return hash_combine(hash_bytes_uint32(MyDatabaseId),
+						hash_bytes_uint32(relid)) & (QRC_NUM_SLOTS - 1);
+}
+
+/*
+ * Counter slot of a syscache entry
+ */
+static inline int
+qrc_object_slot(int cacheId, uint32 hashValue)
+{
+	return hash_combine(hash_bytes_uint32((uint32) cacheId),
+						hashValue) & (QRC_NUM_SLOTS - 1);
+}
+
+/*
+ * Read a slot's version, and report whether no commit was in progress on it
+ */
+static bool
+qrc_read_slot(QueryResultSlot *slot, uint64 *version)
+{
+	uint64		finished;
+
+	/* read finished first, so that a commit starting meanwhile is seen */
+	finished = pg_atomic_read_u64(&slot->finished);
+	pg_read_barrier();
+	*version = pg_atomic_read_u64(&slot->started);
+
+	return *version == finished;
+}
+
+/*
+ * Are all the relations in a plan ones whose contents we can track?
+ */
+static bool
+qrc_relations_eligible(List *relationOids)
+{
+	ListCell   *lc;
+
+	/* Not worth caching the result of an expression */
+	if (relationOids == NIL)
+		return false;
+
+	foreach(lc, relationOids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		HeapTuple	tp;
+		Form_pg_class reltup;
+		bool		ok;
+
+		/* System catalogs are modified without going through heapam.c */
+		if (relid < FirstNormalObjectId)
+			return false;
+
+		tp = SearchSysCache1(RELOID, ObjectIdGetDatum(relid));
+		if (!HeapTupleIsValid(tp))
+			return false;
+		reltup = (Form_pg_class) GETSTRUCT(tp);
+
+		switch (reltup->relkind)
+		{
+			case RELKIND_RELATION:
+			case RELKIND_MATVIEW:
+				ok = (reltup->relam == HEAP_TABLE_AM_OID);
+				break;
+			case RELKIND_VIEW:
+			case RELKIND_PARTITIONED_TABLE:
+				ok = true;
+				break;
+			default:
+				ok = false;
+				break;
+		}
+		if (reltup->relpersistence == RELPERSISTENCE_TEMP ||
+			reltup->relrowsecurity)
+			ok = false;
+
+		ReleaseSysCache(tp);
+
+		if (!ok)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Set up the probe for a portal's statement, and read the versions of the
+ * slots it depends on
+ */
+static QueryResultCacheProbe *
+qrc_make_probe(Portal portal, PlannedStmt *stmt)
+{
+	QueryResultCacheProbe *probe;
+	SearchPathMatcher *path;
+	const char *source = portal->sourceText;
+	int			location = stmt->stmt_location;
+	int			len = stmt->stmt_len;
+	uint32		hash;
+	int			n;
+	ListCell   *lc;
+
+	probe = palloc0(sizeof(QueryResultCacheProbe));
+	probe->cxt = CurrentMemoryContext;
+	probe->tupdesc = ExecCleanTypeFromTL(stmt->planTree->targetlist);
+
+	/* Only this statement's part of a multi-statement string matters */
+	if (location < 0)
+	{
+		location = 0;
+		len = 0;
+	}
+	if (len == 0)
+		len = strlen(source + location);
+	probe->query = pnstrdup(source + location, len);
+	probe->query_len = len + 1;
+
+	if (portal->portalParams != NULL)
+	{
+		char	   *start;
+
+		probe->params_len = EstimateParamListSpace(portal->portalParams);
+		probe->params = palloc(probe->params_len);
+		start = probe->params;
+		SerializeParamList(portal->portalParams, &start);
+	}
+
+	path = GetSearchPathMatcher(CurrentMemoryContext);
+	probe->schemas = path->schemas;
+	probe->addCatalog = path->addCatalog;
+	probe->guc_fingerprint = GetConfigFingerprint(GUC_FINGERPRINT_SEMANTICS);
+	probe->relations = stmt->relationOids;
+	probe->items = stmt->invalItems;
+
+	probe->key.dbid = MyDatabaseId;
+	probe->key.roleid = GetUserId();
+	hash = hash_bytes((const unsigned char *) probe->query, len);
+	if (probe->params_len > 0)
+		hash = hash_combine(hash,
+							hash_bytes((const unsigned char *) probe->params,
+									   probe->params_len));
+	foreach(lc, probe->schemas)
+		hash = hash_combine(hash, hash_bytes_uint32(lfirst_oid(lc)));
+	hash = hash_combine(hash, hash_bytes_uint32(probe->addCatalog));
+	hash = hash_combine(hash, (uint32) probe->guc_fingerprint);
+	foreach(lc, probe->relations)
+		hash = hash_combine(hash, hash_bytes_uint32(lfirst_oid(lc)));
+	probe->key.hash = hash;
+
+	/*
+	 * Read the versions.  This must happen before the portal's snapshot is
+	 * taken; see the file header comments.
+	 */
+	probe->versions = palloc(sizeof(uint64) *
+							 (list_length(probe->relations) +
+							  list_length(probe->items)));
+	probe->stable = qrc_read_slot(&qrc_ctl->all_slot, &probe->all_version);
+	n = 0;
+	foreach(lc, probe->relations)
+	{
+		int			slot = qrc_relation_slot(lfirst_oid(lc));
+
+		if (!qrc_read_slot(&qrc_ctl->slots[slot], &probe->versions[n++]))
+			probe->stable = false;
+	}
+	foreach(lc, probe->items)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+		int			slot = qrc_object_slot(item->cacheId, item->hashValue);
+
+		if (!qrc_read_slot(&qrc_ctl->slots[slot], &probe->versions[n++]))
+			probe->stable = false;
+	}
+	pg_memory_barrier();
+
+	return probe;
+}
+
+/*
+ * Is a stored result one of the probe's statement?
+ */
+static bool
+qrc_matches(QueryResultData *data, QueryResultCacheProbe *probe)
+{
+	Oid		   *oids;
+	QueryResultInvalItem *items;
+	int			i;
+	ListCell   *lc;
+
+	if (data->addCatalog != probe->addCatalog ||
+		data->guc_fingerprint != probe->guc_fingerprint ||
+		data->num_schemas != list_length(probe->schemas) ||
+		data->num_relations != list_length(probe->relations) ||
+		data->num_items != list_length(probe->items) ||
+		data->natts != probe->tupdesc->natts ||
+		data->params_len != probe->params_len)
+		return false;
+
+	oids = QRD_ARRAY(data, Oid, off_schemas);
+	i = 0;
+	foreach(lc, probe->schemas)
+	{
+		if (oids[i++] != lfirst_oid(lc))
+			return false;
+	}
+
+	oids = QRD_ARRAY(data, Oid, off_relations);
+	i = 0;
+	foreach(lc, probe->relations)
+	{
+		if (oids[i++] != lfirst_oid(lc))
+			return false;
+	}
+
+	items = QRD_ARRAY(data, QueryResultInvalItem, off_items);
+	i = 0;
+	foreach(lc, probe->items)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		if (items[i].cacheId != item->cacheId ||
+			items[i].hashValue != item->hashValue)
+			return false;
+		i++;
+	}
+
+	for (i = 0; i < data->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(probe->tupdesc, i);
+
+		if (QRD_ARRAY(data, Oid, off_types)[i] != attr->atttypid ||
+			QRD_ARRAY(data, int32, off_typmods)[i] != attr->atttypmod)
+			return false;
+	}
+
+	if (data->params_len > 0 &&
+		memcmp(QRD_ARRAY(data, char, off_params), probe->params,
+			   data->params_len) != 0)
+		return false;
+
+	return strcmp(QRD_ARRAY(data, char, off_query), probe->query) == 0;
+}
+
+/*
+ * Was a stored result computed with the versions the probe has read?
+ */
+static bool
+qrc_is_current(QueryResultData *data, QueryResultCacheProbe *probe)
+{
+	int			nversions = data->num_relations + data->num_items;
+
+	return data->all_version == probe->all_version &&
+		memcmp(QRD_ARRAY(data, uint64, off_versions), probe->versions,
+			   nversions * sizeof(uint64)) == 0;
+}
+
+/*
+ * Load the tuples of a stored result into the portal's holdStore
+ */
+static void
+qrc_fill_portal(Portal portal, QueryResultData *data)
+{
+	TupleTableSlot *slot;
+	MemoryContext oldcontext;
+	char	   *ptr;
+
+	PortalCreateHoldStore(portal);
+	slot = MakeSingleTupleTableSlot(portal->tupDesc, &TTSOpsMinimalTuple);
+
+	oldcontext = MemoryContextSwitchTo(portal->holdContext);
+
+	ptr = QRD_ARRAY(data, char, off_tuples);
+	for (uint64 i = 0; i < data->ntuples; i++)
+	{
+		MinimalTuple tuple = (MinimalTuple) ptr;
+
+		ExecStoreMinimalTuple(tuple, slot, false);
+		tuplestore_puttupleslot(portal->holdStore, slot);
+		ExecClearTuple(slot);
+		ptr += MAXALIGN(tuple->t_len);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * QueryResultCacheStart: try to answer a PORTAL_ONE_SELECT portal's query
+ * from the cache
+ *
+ * Called by PortalStart in the portal's context, before the portal's
+ * snapshot is taken.  If a current result is found, the portal's holdStore
+ * is loaded with it and its tupDesc is set, and true is returned; the
+ * executor need not be started at all.  Otherwise, if the result could be
+ * cached, portal->resultCacheProbe is set up for PortalRunSelect to capture
+ * it.
+ */
+bool
+QueryResultCacheStart(Portal portal)
+{
+	PlannedStmt *stmt = linitial_node(PlannedStmt, portal->stmts);
+	QueryResultCacheProbe *probe;
+	QueryResultEntry *entry;
+	QueryResultData *data;
+	bool		current;
+	char	   *copy;
+
+	if (qrc_ctl == NULL || !query_result_cache)
+		return false;
+
+	/*
+	 * The result must not depend on this transaction's own changes or on
+	 * its snapshot having been taken at its start.
+	 */
+	if (!stmt->resultCacheable ||
+		portal->queryEnv != NULL ||
+		RecoveryInProgress() ||
+		IsolationUsesXactSnapshot() ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()) ||
+		qrc_pending_any || qrc_pending_all)
+		return false;
+
+	if (!qrc_relations_eligible(stmt->relationOids))
+		return false;
+
+	probe = qrc_make_probe(portal, stmt);
+
+	qrc_attach();
+
+	entry = dshash_find(qrc_hash, &probe->key, false);
+	if (entry == NULL)
+	{
+		pg_atomic_fetch_add_u64(&qrc_ctl->misses, 1);
+		portal->resultCacheProbe = probe;
+		return false;
+	}
+
+	data = dsa_get_address(qrc_area, entry->data);
+	if (!qrc_matches(data, probe))
+		current = false;
+	else if (!qrc_is_current(data, probe))
+	{
+		pg_atomic_fetch_add_u64(&qrc_ctl->invalidations, 1);
+		current = false;
+	}
+	else
+		current = true;
+	if (!current)
+	{
+		dshash_release_lock(qrc_hash, entry);
+		pg_atomic_fetch_add_u64(&qrc_ctl->misses, 1);
+		portal->resultCacheProbe = probe;
+		return false;
+	}
+
+	copy = palloc(entry->size);
+	memcpy(copy, data, entry->size);
+	pg_atomic_write_u64(&entry->last_used,
+						pg_atomic_fetch_add_u64(&qrc_ctl->clock, 1));
+	dshash_release_lock(qrc_hash, entry);
+
+	/* The user must still be allowed to run the query */
+	ExecCheckPermissions(stmt->rtable, stmt->permInfos, true);
+
+	portal->tupDesc = probe->tupdesc;
+	qrc_fill_portal(portal, (QueryResultData *) copy);
+	pfree(copy);
+
+	pg_atomic_fetch_add_u64(&qrc_ctl->hits, 1);
+
+	return true;
+}
+
+/*
+ * Add a result tuple to the ones being captured
+ */
+static void
+qrc_capture_tuple(QueryResultCacheProbe *probe, TupleTableSlot *slot)
+{
+	TupleDesc	typeinfo = slot->tts_tupleDescriptor;
+	int			natts = typeinfo->natts;
+	Datum	   *values = palloc(natts * sizeof(Datum));
+	bool	   *nulls = palloc(natts * sizeof(bool));
+	bool	   *detoasted = palloc0(natts * sizeof(bool));
+	MemoryContext oldcontext;
+	MinimalTuple tuple;
+
+	/* A cached tuple must not point into a table, so detoast everything */
+	slot_getallattrs(slot);
+	for (int i = 0; i < natts; i++)
+	{
+		Datum		val = slot->tts_values[i];
+
+		values[i] = val;
+		nulls[i] = slot->tts_isnull[i];
+		if (!nulls[i] && TupleDescAttr(typeinfo, i)->attlen == -1 &&
+			VARATT_IS_EXTERNAL(DatumGetPointer(val)))
+		{
+			struct varlena *attr = (struct varlena *) DatumGetPointer(val);
+
+			values[i] = PointerGetDatum(detoast_external_attr(attr));
+			detoasted[i] = true;
+		}
+	}
+
+	tuple = heap_form_minimal_tuple(typeinfo, values, nulls);
+
+	if (probe->tuples.len + MAXALIGN(tuple->t_len) > qrc_max_entry_size())
+	{
+		/* too large to keep, stop capturing */
+		probe->capturing = false;
+		pfree(probe->tuples.data);
+		probe->tuples.data = NULL;
+	}
+	else
+	{
+		oldcontext = MemoryContextSwitchTo(probe->cxt);
+		appendBinaryStringInfo(&probe->tuples, tuple, tuple->t_len);
+		while (probe->tuples.len % MAXIMUM_ALIGNOF != 0)
+			appendStringInfoChar(&probe->tuples, '\0');
+		MemoryContextSwitchTo(oldcontext);
+		probe->ntuples++;
+	}
+
+	pfree(tuple);
+	for (int i = 0; i < natts; i++)
+	{
+		if (detoasted[i])
+			pfree(DatumGetPointer(values[i]));
+	}
+	pfree(values);
+	pfree(nulls);
+	pfree(detoasted);
+}
+
+/*
+ * Receive a tuple from the executor, pass it on and capture it
+ */
+static bool
+qrc_receive_slot(TupleTableSlot *slot, DestReceiver *self)
+{
+	QueryResultCaptureReceiver *myState = (QueryResultCaptureReceiver *) self;
+	QueryResultCacheProbe *probe = myState->probe;
+
+	if (!myState->target->receiveSlot(slot, myState->target))
+	{
+		/* the result is incomplete if the destination gives up */
+		probe->capturing = false;
+		return false;
+	}
+
+	if (probe->capturing)
+		qrc_capture_tuple(probe, slot);
+
+	return true;
+}
+
+static void
+qrc_startup_receiver(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	QueryResultCaptureReceiver *myState = (QueryResultCaptureReceiver *) self;
+
+	myState->target->rStartup(myState->target, operation, typeinfo);
+}
+
+static void
+qrc_shutdown_receiver(DestReceiver *self)
+{
+	QueryResultCaptureReceiver *myState = (QueryResultCaptureReceiver *) self;
+
+	myState->target->rShutdown(myState->target);
+}
+
+static void
+qrc_destroy_receiver(DestReceiver *self)
+{
+	pfree(self);
+}
+
+/*
+ * QueryResultCacheCapture: set up to capture the result of a portal run
+ *
+ * Called by PortalRunSelect, in the portal's context, when the portal has a
+ * resultCacheProbe.  The result is only captured if this run fetches all
+ * rows from the start; then a DestReceiver that captures them and passes
+ * them on to dest is returned.  Otherwise the probe is given up, and dest
+ * itself is returned.
+ */
+DestReceiver *
+QueryResultCacheCapture(Portal portal, bool forward, long count,
+						DestReceiver *dest)
+{
+	QueryResultCacheProbe *probe = portal->resultCacheProbe;
+	QueryResultCaptureReceiver *receiver;
+	MemoryContext oldcontext;
+
+	if (!forward || count != FETCH_ALL || !portal->atStart ||
+		portal->atEnd || portal->queryDesc == NULL || !probe->stable)
+	{
+		portal->resultCacheProbe = NULL;
+		return dest;
+	}
+
+	oldcontext = MemoryContextSwitchTo(probe->cxt);
+
+	probe->capturing = true;
+	initStringInfo(&probe->tuples);
+	probe->ntuples = 0;
+
+	receiver = palloc0(sizeof(QueryResultCaptureReceiver));
+	receiver->pub.receiveSlot = qrc_receive_slot;
+	receiver->pub.rStartup = qrc_startup_receiver;
+	receiver->pub.rShutdown = qrc_shutdown_receiver;
+	receiver->pub.rDestroy = qrc_destroy_receiver;
+	receiver->pub.mydest = dest->mydest;
+	receiver->target = dest;
+	receiver->probe = probe;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return (DestReceiver *) receiver;
+}
+
+/*
+ * qsort comparator for qrc_evict()
+ */
+static int
+qrc_age_cmp(const void *a, const void *b)
+{
+	const QueryResultAge *aa = (const QueryResultAge *) a;
+	const QueryResultAge *bb = (const QueryResultAge *) b;
+
+	return pg_cmp_u64(aa->last_used, bb->last_used);
+}
+
+/*
+ * Free the least recently used entries until at least "needed" bytes have
+ * been released
+ */
+static void
+qrc_evict(Size needed)
+{
+	dshash_seq_status status;
+	QueryResultEntry *entry;
+	QueryResultAge *ages;
+	int			maxages;
+	int			nages = 0;
+	uint64		cutoff = 0;
+	Size		freed = 0;
+
+	maxages = pg_atomic_read_u32(&qrc_ctl->nentries) + 16;
+	ages = palloc(maxages * sizeof(QueryResultAge));
+
+	dshash_seq_init(&status, qrc_hash, false);
+	while ((entry = dshash_seq_next(&status)) != NULL && nages < maxages)
+	{
+		ages[nages].last_used = pg_atomic_read_u64(&entry->last_used);
+		ages[nages].size = entry->size;
+		nages++;
+	}
+	dshash_seq_term(&status);
+
+	qsort(ages, nages, sizeof(QueryResultAge), qrc_age_cmp);
+	for (int i = 0; i < nages && freed < needed; i++)
+	{
+		cutoff = ages[i].last_used;
+		freed += ages[i].size;
+	}
+	pfree(ages);
+
+	if (nages == 0)
+		return;
+
+	dshash_seq_init(&status, qrc_hash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (pg_atomic_read_u64(&entry->last_used) > cutoff)
+			continue;
+
+		dsa_free(qrc_area, entry->data);
+		pg_atomic_sub_fetch_u64(&qrc_ctl->bytes_used, entry->size);
+		pg_atomic_sub_fetch_u32(&qrc_ctl->nentries, 1);
+		pg_atomic_fetch_add_u64(&qrc_ctl->evictions, 1);
+		dshash_delete_current(&status);
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * Store the result captured for the probe
+ */
+static void
+qrc_store(QueryResultCacheProbe *probe)
+{
+	int			nversions = list_length(probe->relations) +
+		list_length(probe->items);
+	Size		size;
+	Size		budget;
+	QueryResultData *data;
+	QueryResultEntry *entry;
+	dsa_pointer dp;
+	bool		found;
+	int			i;
+	ListCell   *lc;
+
+	size = MAXALIGN(sizeof(QueryResultData));
+	size += nversions * sizeof(uint64);
+	size += list_length(probe->relations) * sizeof(Oid);
+	size += list_length(probe->items) * sizeof(QueryResultInvalItem);
+	size += probe->tupdesc->natts * (sizeof(Oid) + sizeof(int32));
+	size += list_length(probe->schemas) * sizeof(Oid);
+	size += probe->params_len + probe->query_len;
+	size = MAXALIGN(size) + probe->tuples.len;
+
+	if (size > qrc_max_entry_size())
+		return;
+
+	data = (QueryResultData *) palloc(size);
+	data->all_version = probe->all_version;
+	data->addCatalog = probe->addCatalog;
+	data->guc_fingerprint = probe->guc_fingerprint;
+	data->num_schemas = list_length(probe->schemas);
+	data->num_relations = list_length(probe->relations);
+	data->num_items = list_length(probe->items);
+	data->natts = probe->tupdesc->natts;
+	data->params_len = probe->params_len;
+	data->ntuples = probe->ntuples;
+	data->off_versions = MAXALIGN(sizeof(QueryResultData));
+	data->off_relations = data->off_versions + nversions * sizeof(uint64);
+	data->off_items = data->off_relations + data->num_relations * sizeof(Oid);
+	data->off_types = data->off_items +
+		data->num_items * sizeof(QueryResultInvalItem);
+	data->off_typmods = data->off_types + data->natts * sizeof(Oid);
+	data->off_schemas = data->off_typmods + data->natts * sizeof(int32);
+	data->off_params = data->off_schemas + data->num_schemas * sizeof(Oid);
+	data->off_query = data->off_params + data->params_len;
+	data->off_tuples = MAXALIGN(data->off_query + probe->query_len);
+	Assert(data->off_tuples + probe->tuples.len == size);
+
+	memcpy(QRD_ARRAY(data, uint64, off_versions), probe->versions,
+		   nversions * sizeof(uint64));
+	i = 0;
+	foreach(lc, probe->relations)
+		QRD_ARRAY(data, Oid, off_relations)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, probe->items)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+		QueryResultInvalItem *sitem = &QRD_ARRAY(data, QueryResultInvalItem,
+												 off_items)[i++];
+
+		sitem->cacheId = item->cacheId;
+		sitem->hashValue = item->hashValue;
+	}
+	for (i = 0; i < data->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(probe->tupdesc, i);
+
+		QRD_ARRAY(data, Oid, off_types)[i] = attr->atttypid;
+		QRD_ARRAY(data, int32, off_typmods)[i] = attr->atttypmod;
+	}
+	i = 0;
+	foreach(lc, probe->schemas)
+		QRD_ARRAY(data, Oid, off_schemas)[i++] = lfirst_oid(lc);
+	if (probe->params_len > 0)
+		memcpy(QRD_ARRAY(data, char, off_params), probe->params,
+			   probe->params_len);
+	memcpy(QRD_ARRAY(data, char, off_query), probe->query, probe->query_len);
+	memset(QRD_ARRAY(data, char, off_query) + probe->query_len, 0,
+		   data->off_tuples - data->off_query - probe->query_len);
+	memcpy(QRD_ARRAY(data, char, off_tuples), probe->tuples.data,
+		   probe->tuples.len);
+
+	qrc_attach();
+
+	/* leave a quarter of the area for the hash table itself */
+	budget = qrc_area_size() / 4 * 3;
+	if (pg_atomic_read_u64(&qrc_ctl->bytes_used) + size > budget)
+		qrc_evict(size + budget / 8);
+
+	dp = dsa_allocate_extended(qrc_area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		/* the area is fragmented; make more room and try once more */
+		qrc_evict(size + budget / 8);
+		dp = dsa_allocate_extended(qrc_area, size, DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp))
+		{
+			pfree(data);
+			return;
+		}
+	}
+	memcpy(dsa_get_address(qrc_area, dp), data, size);
+	pfree(data);
+
+	entry = dshash_find_or_insert(qrc_hash, &probe->key, &found);
+	if (found)
+	{
+		/* replace whatever is there, it's most likely outdated */
+		dsa_free(qrc_area, entry->data);
+		pg_atomic_sub_fetch_u64(&qrc_ctl->bytes_used, entry->size);
+	}
+	else
+	{
+		pg_atomic_init_u64(&entry->last_used, 0);
+		pg_atomic_add_fetch_u32(&qrc_ctl->nentries, 1);
+	}
+	entry->data = dp;
+	entry->size = size;
+	pg_atomic_write_u64(&entry->last_used,
+						pg_atomic_fetch_add_u64(&qrc_ctl->clock, 1));
+	pg_atomic_add_fetch_u64(&qrc_ctl->bytes_used, size);
+	dshash_release_lock(qrc_hash, entry);
+
+	pg_atomic_fetch_add_u64(&qrc_ctl->stores, 1);
+}
+
+/*
+ * QueryResultCacheFinish: store the result captured by a portal run
+ *
+ * Called by PortalRunSelect after the executor has returned.
+ */
+void
+QueryResultCacheFinish(Portal portal)
+{
+	QueryResultCacheProbe *probe = portal->resultCacheProbe;
+
+	portal->resultCacheProbe = NULL;
+
+	if (probe->capturing)
+	{
+		probe->capturing = false;
+		qrc_store(probe);
+	}
+	if (probe->tuples.data != NULL)
+	{
+		pfree(probe->tuples.data);
+		probe->tuples.data = NULL;
+	}
+}
+
+/*
+ * Remember that the current transaction changed something mapping to a slot
+ */
+static inline void
+qrc_note_slot(int slot)
+{
+	qrc_pending[slot / 64] |= UINT64CONST(1) << (slot % 64);
+	qrc_pending_any = true;
+}
+
+/*
+ * QueryResultCacheNoteRelation
+ *		Note that the current transaction modified a relation's contents or
+ *		definition.
+ */
+void
+QueryResultCacheNoteRelation(Oid relid)
+{
+	if (qrc_ctl == NULL || relid < FirstNormalObjectId)
+		return;
+
+	qrc_note_slot(qrc_relation_slot(relid));
+}
+
+/*
+ * QueryResultCacheNoteObject
+ *		Note that the current transaction modified a syscache entry.
+ */
+void
+QueryResultCacheNoteObject(int cacheId, uint32 hashValue)
+{
+	if (qrc_ctl == NULL)
+		return;
+
+	qrc_note_slot(qrc_object_slot(cacheId, hashValue));
+}
+
+/*
+ * QueryResultCacheNoteAll
+ *		Note that the current transaction may have changed anything.
+ */
+void
+QueryResultCacheNoteAll(void)
+{
+	if (qrc_ctl == NULL)
+		return;
+
+	qrc_pending_all = true;
+}
+
+/*
+ * Bump one counter of each slot noted by the current transaction
+ */
+static void
+qrc_bump_pending(bool finished)
+{
+	if (qrc_pending_all)
+	{
+		QueryResultSlot *slot = &qrc_ctl->all_slot;
+
+		pg_atomic_fetch_add_u64(finished ? &slot->finished : &slot->started,
+								1);
+	}
+
+	for (int i = 0; i < lengthof(qrc_pending); i++)
+	{
+		uint64		word = qrc_pending[i];
+
+		while (word != 0)
+		{
+			int			bit = pg_rightmost_one_pos64(word);
+			QueryResultSlot *slot = &qrc_ctl->slots[i * 64 + bit];
+
+			pg_atomic_fetch_add_u64(finished ? &slot->finished :
+									&slot->started, 1);
+			word &= ~(UINT64CONST(1) << bit);
+		}
+	}
+}
+
+/*
+ * PreCommit_QueryResultCache
+ *		Announce that the current transaction's changes are about to become
+ *		visible.
+ *
+ * Called just before the commit record is written.  Cached results that
+ * depend on what the transaction changed stop being used from here on, and
+ * no new ones are stored until AtEOXact_QueryResultCache() is called.
+ */
+void
+PreCommit_QueryResultCache(void)
+{
+	if (!qrc_pending_any && !qrc_pending_all)
+		return;
+
+	qrc_bump_pending(false);
+	qrc_committing = true;
+}
+
+/*
+ * AtEOXact_QueryResultCache
+ *		Transaction end processing; for commit, called once the transaction's
+ *		changes are visible.
+ */
+void
+AtEOXact_QueryResultCache(bool isCommit)
+{
+	/* on abort after PreCommit, we still have to balance the counters */
+	if (qrc_committing)
+		qrc_bump_pending(true);
+
+	memset(qrc_pending, 0, sizeof(qrc_pending));
+	qrc_pending_any = false;
+	qrc_pending_all = false;
+	qrc_committing = false;
+}
+
+/*
+ * SQL-callable function to show the cache's statistics
+ */
+Datum
+pg_stat_get_query_result_cache(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_QUERY_RESULT_CACHE_COLS 8
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_QUERY_RESULT_CACHE_COLS] = {0};
+	bool		nulls[PG_STAT_GET_QUERY_RESULT_CACHE_COLS] = {0};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (qrc_ctl == NULL)
+	{
+		for (int i = 0; i < PG_STAT_GET_QUERY_RESULT_CACHE_COLS - 1; i++)
+			values[i] = Int64GetDatum(0);
+		nulls[PG_STAT_GET_QUERY_RESULT_CACHE_COLS - 1] = true;
+	}
+	else
+	{
+		values[0] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->hits));
+		values[1] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->misses));
+		values[2] =
+			Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->invalidations));
+		values[3] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->stores));
+		values[4] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->evictions));
+		values[5] = Int64GetDatum(pg_atomic_read_u32(&qrc_ctl->nentries));
+		values[6] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->bytes_used));
+		values[7] = Int64GetDatum(pg_atomic_read_u64(&qrc_ctl->stats_reset));
+	}
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * SQL-callable function to reset the cache's statistics
+ */
+Datum
+pg_stat_reset_query_result_cache(PG_FUNCTION_ARGS)
+{
+	if (qrc_ctl == NULL)
+		PG_RETURN_VOID();
+
+	pg_atomic_write_u64(&qrc_ctl->hits, 0);
+	pg_atomic_write_u64(&qrc_ctl->misses, 0);
+	pg_atomic_write_u64(&qrc_ctl->invalidations, 0);
+	pg_atomic_write_u64(&qrc_ctl->stores, 0);
+	pg_atomic_write_u64(&qrc_ctl->evictions, 0);
+	pg_atomic_write_u64(&qrc_ctl->stats_reset, GetCurrentTimestamp());
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,958 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cross-backend cache of generic plans.
+ *
+ * Each backend's plancache.c builds its own generic plans, so a statement
+ * prepared in many sessions is planned once per session, and again in each
+ * of them after every invalidation.  When shared_plan_cache_size is set, a
+ * generic plan built by one backend is also stored, in nodeToString() form,
+ * in a dshash table that lives in a fixed-size DSA area carved out of the
+ * main shared memory segment; other backends preparing the same statement
+ * copy it out instead of planning.
+ *
+ * A statement is identified by its database, the current user, its source
+ * text, its parameter types, the search_path used to parse it, its cursor
+ * options, whether row security was in effect, and a fingerprint of the
+ * settings that influence parse analysis, constant folding or the planner
+ * (see GetConfigFingerprint()).  The hash key only covers database, user
+ * and a hash of the rest; the full values are kept with the entry and
+ * compared on lookup.  Statements whose meaning cannot be reconstructed from
+ * those values are never shared: those using a parser hook (such as
+ * PL/pgSQL's variable references), query environments, temporary schemas or
+ * temporary relations.
+ *
+ * Each entry records the relations and other objects its plan depends on,
+ * exactly as CachedPlanSource and PlannedStmt do.  Staleness is detected
+ * with modification counters, as in queryresultcache.c, rather than by
+ * searching the table for affected entries on every invalidation.  Each
+ * relation OID and each PROCOID or TYPEOID hash value maps to one of a fixed
+ * number of version slots in shared memory.  inval.c notes the relations
+ * and objects the current transaction registers invalidations for, and just
+ * before the transaction commits we bump the versions of the slots noted.
+ * Changes that plancache.c would answer by discarding every plan (those to
+ * namespaces, operators and so on) bump a version common to all entries.
+ * Each entry records the versions of its dependencies' slots as they were
+ * before it was planned, and is only used while they are unchanged.  A
+ * backend that copies a plan out takes the executor locks on it and then
+ * checks the versions again, so that a change committed while it was
+ * copying is not missed.  Outdated entries are removed when they are next
+ * looked up, or when the area fills up.
+ *
+ * Plans are only stored if nothing that might affect them was committed
+ * while they were being made.  A global pair of counters is bumped before
+ * each commit that bumps any version ("started"), and again after its
+ * invalidation messages have been sent ("finished").  Before planning, we
+ * require the two to be equal, so that every commit already counted has
+ * sent its messages, and process pending invalidations; at store time,
+ * "started" must be unchanged.  Sinval resets need no special treatment:
+ * they make this backend forget its own caches, but the shared versions
+ * were already bumped by the backends making the changes.
+ *
+ * Nothing is shared by a transaction that has changed the catalogs itself,
+ * since its view of them isn't committed yet.
+ *
+ * The area is never extended.  When it is nearly full, outdated entries are
+ * removed, and if that doesn't make room new plans are simply not stored.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/guc.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+
+/* GUC parameter: size of the shared plan cache in megabytes */
+int			shared_plan_cache_size = 0;
+
+/* Number of version slots; must be a power of 2 */
+#define SPC_NUM_SLOTS	4096
+
+/*
+ * Hash key of a shared plan.  hash covers everything else that identifies
+ * the statement; see spc_compute_key().
+ */
+typedef struct SharedPlanKey
+{
+	Oid			dbid;
+	Oid			roleid;
+	uint32		hash;
+} SharedPlanKey;
+
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key, must be first */
+	uint64		entryid;		/* unique ID, see SharedPlanCacheEntryExists */
+	dsa_pointer data;			/* SharedPlanData */
+	Size		size;			/* allocated size of data */
+} SharedPlanEntry;
+
+/* A dependency on a syscache entry, as in PlanInvalItem */
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+/*
+ * Everything stored for a shared plan, in one DSA allocation.  The arrays
+ * and strings follow the struct, at the given offsets from its start.
+ */
+typedef struct SharedPlanData
+{
+	int			cursor_options;
+	bool		row_security;
+	bool		addCatalog;
+	uint64		guc_fingerprint;
+	uint64		all_version;	/* version of all_version when stored */
+	int			num_params;
+	int			num_schemas;
+	int			num_relations;
+	int			num_items;
+	Size		off_versions;	/* uint64[num_relations + num_items] */
+	Size		off_params;		/* Oid[num_params] */
+	Size		off_schemas;	/* Oid[num_schemas] */
+	Size		off_relations;	/* Oid[num_relations] */
+	Size		off_items;		/* SharedPlanInvalItem[num_items] */
+	Size		off_query;		/* query source text */
+	Size		off_plan;		/* nodeToString() of the PlannedStmt list */
+} SharedPlanData;
+
+#define SPD_ARRAY(data, type, off)	((type *) ((char *) (data) + (data)->off))
+
+typedef struct SharedPlanCacheControl
+{
+	void	   *raw_dsa_area;
+	dshash_table_handle hash_handle;
+	pg_atomic_uint64 next_entryid;
+	pg_atomic_uint64 bytes_used;	/* sum of SharedPlanEntry.size */
+	pg_atomic_uint32 nentries;
+
+	/* commits that bumped versions, see file header comments */
+	pg_atomic_uint64 started;
+	pg_atomic_uint64 finished;
+	pg_atomic_uint64 last_sweep;	/* started when spc_sweep() last ran */
+
+	pg_atomic_uint64 all_version;	/* bumped for changes to anything */
+	pg_atomic_uint64 versions[SPC_NUM_SLOTS];
+} SharedPlanCacheControl;
+
+/*
+ * The versions a plan copied out of the cache depends on, for
+ * SharedPlanCacheIsCurrent()
+ */
+struct SharedPlanVersions
+{
+	uint64		all_version;
+	int			nslots;
+	int		   *slots;
+	uint64	   *versions;
+};
+
+static const dshash_parameters spc_hash_params = {
+	sizeof(SharedPlanKey),
+	sizeof(SharedPlanEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH
+};
+
+static SharedPlanCacheControl *spc_ctl = NULL;
+static dsa_area *spc_area = NULL;
+static dshash_table *spc_hash = NULL;
+
+/* Slots whose versions the current transaction will bump */
+static uint64 spc_pending[SPC_NUM_SLOTS / 64];
+static bool spc_pending_any = false;
+static bool spc_pending_all = false;
+static bool spc_committing = false;
+
+
+/*
+ * Size of the DSA area holding the cache
+ */
+static Size
+spc_area_size(void)
+{
+	return Max((Size) shared_plan_cache_size * 1024 * 1024,
+			   dsa_minimum_size());
+}
+
+/*
+ * Report shared-memory space needed by SharedPlanCacheShmemInit
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedPlanCacheControl));
+	size = add_size(size, spc_area_size());
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the shared plan cache, if enabled
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	spc_ctl = (SharedPlanCacheControl *)
+		ShmemInitStruct("Shared Plan Cache", SharedPlanCacheShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		dsa_area   *dsa;
+		dshash_table *dsh;
+
+		Assert(!found);
+
+		spc_ctl->raw_dsa_area =
+			(char *) spc_ctl + MAXALIGN(sizeof(SharedPlanCacheControl));
+		dsa = dsa_create_in_place(spc_ctl->raw_dsa_area, spc_area_size(),
+								  LWTRANCHE_SHARED_PLAN_CACHE_DSA, 0);
+		dsa_pin(dsa);
+
+		/* the cache never grows beyond the space reserved for it here */
+		dsa_set_size_limit(dsa, spc_area_size());
+
+		dsh = dshash_create(dsa, &spc_hash_params, NULL);
+		spc_ctl->hash_handle = dshash_get_hash_table_handle(dsh);
+
+		dshash_detach(dsh);
+		dsa_detach(dsa);
+
+		pg_atomic_init_u64(&spc_ctl->next_entryid, 1);
+		pg_atomic_init_u64(&spc_ctl->bytes_used, 0);
+		pg_atomic_init_u32(&spc_ctl->nentries, 0);
+		pg_atomic_init_u64(&spc_ctl->started, 0);
+		pg_atomic_init_u64(&spc_ctl->finished, 0);
+		pg_atomic_init_u64(&spc_ctl->last_sweep, 0);
+		pg_atomic_init_u64(&spc_ctl->all_version, 0);
+		for (int i = 0; i < SPC_NUM_SLOTS; i++)
+			pg_atomic_init_u64(&spc_ctl->versions[i], 0);
+	}
+	else
+		Assert(found);
+}
+
+/*
+ * Attach to the cache's DSA area and hash table, if not done already
+ */
+static void
+spc_attach(void)
+{
+	MemoryContext oldcontext;
+
+	if (spc_hash != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	spc_area = dsa_attach_in_place(spc_ctl->raw_dsa_area, NULL);
+	dsa_pin_mapping(spc_area);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+				  PointerGetDatum(spc_ctl->raw_dsa_area));
+
+	spc_hash = dshash_attach(spc_area, &spc_hash_params,
+							 spc_ctl->hash_handle, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Version slot of a relation of the current database
+ */
+static inline int
+spc_relation_slot(Oid relid)
+{
+	return hash_combine(hash_bytes_uint32(MyDatabaseId),
+						hash_bytes_uint32(relid)) & (SPC_NUM_SLOTS - 1);
+}
+
+/*
+ * Version slot of a syscache entry
+ */
+static inline int
+spc_object_slot(int cacheId, uint32 hashValue)
+{
+	return hash_combine(hash_bytes_uint32((uint32) cacheId),
+						hashValue) & (SPC_NUM_SLOTS - 1);
+}
+
+/*
+ * Compute the hash key identifying plansource's statement, and the
+ * fingerprint of the planner settings that's part of it
+ */
+static void
+spc_compute_key(CachedPlanSource *plansource, SharedPlanKey *key,
+				uint64 *guc_fingerprint)
+{
+	SearchPathMatcher *path = plansource->search_path;
+	uint32		hash;
+	ListCell   *lc;
+
+	memset(key, 0, sizeof(SharedPlanKey));
+	key->dbid = MyDatabaseId;
+	key->roleid = GetUserId();
+
+	hash = hash_bytes((const unsigned char *) plansource->query_string,
+					  strlen(plansource->query_string));
+	if (plansource->num_params > 0)
+		hash = hash_combine(hash,
+							hash_bytes((const unsigned char *) plansource->param_types,
+									   plansource->num_params * sizeof(Oid)));
+	foreach(lc, path->schemas)
+		hash = hash_combine(hash, hash_bytes_uint32(lfirst_oid(lc)));
+	hash = hash_combine(hash, hash_bytes_uint32(path->addCatalog));
+	hash = hash_combine(hash, hash_bytes_uint32(plansource->cursor_options));
+	hash = hash_combine(hash,
+						hash_bytes_uint32(plansource->rewriteRowSecurity));
+	*guc_fingerprint = GetConfigFingerprint(GUC_FINGERPRINT_SEMANTICS |
+											 GUC_FINGERPRINT_PLANNER);
+	hash = hash_combine(hash, (uint32) *guc_fingerprint);
+
+	key->hash = hash;
+}
+
+/*
+ * Does a stored plan belong to plansource's statement?
+ */
+static bool
+spc_matches(SharedPlanData *data, CachedPlanSource *plansource,
+			uint64 guc_fingerprint)
+{
+	SearchPathMatcher *path = plansource->search_path;
+	Oid		   *schemas;
+	int			i;
+	ListCell   *lc;
+
+	if (data->cursor_options != plansource->cursor_options ||
+		data->row_security != plansource->rewriteRowSecurity ||
+		data->guc_fingerprint != guc_fingerprint ||
+		data->addCatalog != path->addCatalog ||
+		data->num_params != plansource->num_params ||
+		data->num_schemas != list_length(path->schemas))
+		return false;
+
+	if (data->num_params > 0 &&
+		memcmp(SPD_ARRAY(data, Oid, off_params), plansource->param_types,
+			   data->num_params * sizeof(Oid)) != 0)
+		return false;
+
+	schemas = SPD_ARRAY(data, Oid, off_schemas);
+	i = 0;
+	foreach(lc, path->schemas)
+	{
+		if (schemas[i++] != lfirst_oid(lc))
+			return false;
+	}
+
+	return strcmp(SPD_ARRAY(data, char, off_query),
+				  plansource->query_string) == 0;
+}
+
+/*
+ * Are the versions a stored plan was made with still current?
+ */
+static bool
+spc_is_current(SharedPlanData *data)
+{
+	Oid		   *relations = SPD_ARRAY(data, Oid, off_relations);
+	SharedPlanInvalItem *items = SPD_ARRAY(data, SharedPlanInvalItem,
+										   off_items);
+	uint64	   *versions = SPD_ARRAY(data, uint64, off_versions);
+	int			i;
+
+	if (pg_atomic_read_u64(&spc_ctl->all_version) != data->all_version)
+		return false;
+	for (i = 0; i < data->num_relations; i++)
+	{
+		int			slot = spc_relation_slot(relations[i]);
+
+		if (pg_atomic_read_u64(&spc_ctl->versions[slot]) != versions[i])
+			return false;
+	}
+	for (i = 0; i < data->num_items; i++)
+	{
+		int			slot = spc_object_slot(items[i].cacheId,
+										   items[i].hashValue);
+
+		if (pg_atomic_read_u64(&spc_ctl->versions[slot]) !=
+			versions[data->num_relations + i])
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Remove the entry at the current position of an exclusive sequential scan
+ */
+static void
+spc_remove_current(dshash_seq_status *status, SharedPlanEntry *entry)
+{
+	dsa_free(spc_area, entry->data);
+	pg_atomic_sub_fetch_u64(&spc_ctl->bytes_used, entry->size);
+	pg_atomic_sub_fetch_u32(&spc_ctl->nentries, 1);
+	dshash_delete_current(status);
+}
+
+/*
+ * Remove an outdated entry found by a lookup, unless someone has replaced it
+ * meanwhile
+ */
+static void
+spc_remove_outdated(SharedPlanKey *key, uint64 entryid)
+{
+	SharedPlanEntry *entry;
+
+	entry = dshash_find(spc_hash, key, true);
+	if (entry == NULL)
+		return;
+	if (entry->entryid != entryid)
+	{
+		dshash_release_lock(spc_hash, entry);
+		return;
+	}
+
+	dsa_free(spc_area, entry->data);
+	pg_atomic_sub_fetch_u64(&spc_ctl->bytes_used, entry->size);
+	pg_atomic_sub_fetch_u32(&spc_ctl->nentries, 1);
+	dshash_delete_entry(spc_hash, entry);
+}
+
+/*
+ * Remove all outdated entries, to make room for a new one.  This takes a
+ * full scan of the table, so don't bother unless something was committed
+ * since the last time.
+ */
+static void
+spc_sweep(void)
+{
+	dshash_seq_status status;
+	SharedPlanEntry *entry;
+	uint64		started = pg_atomic_read_u64(&spc_ctl->started);
+
+	if (pg_atomic_exchange_u64(&spc_ctl->last_sweep, started) == started)
+		return;
+
+	dshash_seq_init(&status, spc_hash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		if (!spc_is_current(dsa_get_address(spc_area, entry->data)))
+			spc_remove_current(&status, entry);
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * SharedPlanCacheEligible: may plansource's generic plan be shared?
+ *
+ * The plansource's query_list must be valid.
+ */
+bool
+SharedPlanCacheEligible(CachedPlanSource *plansource,
+						QueryEnvironment *queryEnv)
+{
+	SearchPathMatcher *path = plansource->search_path;
+	ListCell   *lc;
+
+	if (spc_ctl == NULL)
+		return false;
+
+	/* Our view of the catalogs may include our own uncommitted changes */
+	if (spc_pending_any || spc_pending_all)
+		return false;
+
+	/*
+	 * Only statements whose parse analysis depends on nothing but the
+	 * values in the key can be shared.
+	 */
+	if (plansource->is_oneshot ||
+		plansource->raw_parse_tree == NULL ||
+		plansource->parserSetup != NULL ||
+		queryEnv != NULL)
+		return false;
+
+	/* The temporary schema, if any, belongs to this backend alone */
+	if (path == NULL || path->addTemp)
+		return false;
+	foreach(lc, path->schemas)
+	{
+		if (isTempNamespace(lfirst_oid(lc)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * SharedPlanCacheLookup: fetch a copy of plansource's generic plan
+ *
+ * Returns the list of PlannedStmts, in the caller's memory context, or NIL
+ * if no current plan is stored.  *versions is set to the versions the plan
+ * depends on, for a later SharedPlanCacheIsCurrent call.
+ *
+ * No locks are taken on the objects the plan refers to; that's up to the
+ * caller.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource,
+					  SharedPlanVersions **versions)
+{
+	SharedPlanKey key;
+	uint64		guc_fingerprint;
+	SharedPlanEntry *entry;
+	SharedPlanData *data;
+	SharedPlanVersions *result;
+	Oid		   *relations;
+	SharedPlanInvalItem *items;
+	char	   *plan_str;
+	List	   *stmt_list;
+	int			i;
+
+	spc_attach();
+	spc_compute_key(plansource, &key, &guc_fingerprint);
+
+	entry = dshash_find(spc_hash, &key, false);
+	if (entry == NULL)
+		return NIL;
+
+	data = dsa_get_address(spc_area, entry->data);
+	if (!spc_matches(data, plansource, guc_fingerprint))
+	{
+		dshash_release_lock(spc_hash, entry);
+		return NIL;
+	}
+	if (!spc_is_current(data))
+	{
+		uint64		entryid = entry->entryid;
+
+		dshash_release_lock(spc_hash, entry);
+		spc_remove_outdated(&key, entryid);
+		return NIL;
+	}
+
+	result = palloc(sizeof(SharedPlanVersions));
+	result->all_version = data->all_version;
+	result->nslots = data->num_relations + data->num_items;
+	result->slots = palloc(result->nslots * sizeof(int));
+	result->versions = palloc(result->nslots * sizeof(uint64));
+	relations = SPD_ARRAY(data, Oid, off_relations);
+	for (i = 0; i < data->num_relations; i++)
+		result->slots[i] = spc_relation_slot(relations[i]);
+	items = SPD_ARRAY(data, SharedPlanInvalItem, off_items);
+	for (i = 0; i < data->num_items; i++)
+		result->slots[data->num_relations + i] =
+			spc_object_slot(items[i].cacheId, items[i].hashValue);
+	memcpy(result->versions, SPD_ARRAY(data, uint64, off_versions),
+		   result->nslots * sizeof(uint64));
+
+	plan_str = pstrdup(SPD_ARRAY(data, char, off_plan));
+	dshash_release_lock(spc_hash, entry);
+
+	stmt_list = (List *) stringToNode(plan_str);
+	pfree(plan_str);
+
+	*versions = result;
+	return stmt_list;
+}
+
+/*
+ * SharedPlanCacheIsCurrent: is a plan copied out of the cache still current?
+ *
+ * Call this after locking the objects the plan refers to, which processes
+ * any invalidations that arrived meanwhile.
+ */
+bool
+SharedPlanCacheIsCurrent(SharedPlanVersions *versions)
+{
+	if (pg_atomic_read_u64(&spc_ctl->all_version) != versions->all_version)
+		return false;
+	for (int i = 0; i < versions->nslots; i++)
+	{
+		if (pg_atomic_read_u64(&spc_ctl->versions[versions->slots[i]]) !=
+			versions->versions[i])
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * SharedPlanCacheBeginPlanning: prepare to plan a statement whose plan
+ * might be stored
+ *
+ * Returns the value of the commit counter that SharedPlanCacheStore will
+ * check, or 0 if the plan mustn't be stored because a commit that changed
+ * something is in progress.  Also processes pending invalidations, so that
+ * the planner sees the catalogs as of at least the commits counted.
+ */
+uint64
+SharedPlanCacheBeginPlanning(void)
+{
+	uint64		started;
+	uint64		finished;
+
+	/* read finished first, so that a commit starting meanwhile is seen */
+	finished = pg_atomic_read_u64(&spc_ctl->finished);
+	pg_read_barrier();
+	started = pg_atomic_read_u64(&spc_ctl->started);
+
+	AcceptInvalidationMessages();
+
+	/* counters start at 0, so make the value we return nonzero */
+	return started == finished ? started + 1 : 0;
+}
+
+/*
+ * SharedPlanCacheStore: offer plansource's new generic plan to other
+ * backends
+ *
+ * Plans that only this backend could use, and plans that don't fit, are
+ * quietly not stored.  If another backend stored a plan for the same
+ * statement meanwhile, that one is kept.
+ */
+void
+SharedPlanCacheStore(CachedPlanSource *plansource, List *stmt_list,
+					 uint64 counter)
+{
+	SearchPathMatcher *path = plansource->search_path;
+	List	   *relationOids;
+	List	   *invalItems;
+	char	   *plan_str;
+	Size		query_len;
+	Size		plan_len;
+	Size		size;
+	int			nversions;
+	uint64	   *versions;
+	SharedPlanData *data;
+	SharedPlanKey key;
+	uint64		guc_fingerprint;
+	SharedPlanEntry *entry;
+	dsa_pointer dp;
+	bool		found;
+	int			i;
+	ListCell   *lc;
+
+	if (counter == 0)
+		return;
+
+	relationOids = list_copy(plansource->relationOids);
+	invalItems = list_copy(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		relationOids = list_concat_unique_oid(relationOids,
+											  plannedstmt->relationOids);
+		invalItems = list_concat(invalItems, plannedstmt->invalItems);
+	}
+
+	foreach(lc, relationOids)
+	{
+		if (get_rel_persistence(lfirst_oid(lc)) == RELPERSISTENCE_TEMP)
+			return;
+	}
+
+	plan_str = nodeToString(stmt_list);
+
+	query_len = strlen(plansource->query_string) + 1;
+	plan_len = strlen(plan_str) + 1;
+
+	nversions = list_length(relationOids) + list_length(invalItems);
+
+	size = MAXALIGN(sizeof(SharedPlanData));
+	size += nversions * sizeof(uint64);
+	size += plansource->num_params * sizeof(Oid);
+	size += list_length(path->schemas) * sizeof(Oid);
+	size += list_length(relationOids) * sizeof(Oid);
+	size += list_length(invalItems) * sizeof(SharedPlanInvalItem);
+	size += query_len + plan_len;
+
+	spc_attach();
+
+	/* leave a quarter of the area for the hash table itself */
+	if (pg_atomic_read_u64(&spc_ctl->bytes_used) + size >
+		spc_area_size() / 4 * 3)
+	{
+		spc_sweep();
+		if (pg_atomic_read_u64(&spc_ctl->bytes_used) + size >
+			spc_area_size() / 4 * 3)
+		{
+			pfree(plan_str);
+			return;
+		}
+	}
+
+	spc_compute_key(plansource, &key, &guc_fingerprint);
+
+	data = (SharedPlanData *) palloc(size);
+	data->cursor_options = plansource->cursor_options;
+	data->row_security = plansource->rewriteRowSecurity;
+	data->addCatalog = path->addCatalog;
+	data->guc_fingerprint = guc_fingerprint;
+	data->num_params = plansource->num_params;
+	data->num_schemas = list_length(path->schemas);
+	data->num_relations = list_length(relationOids);
+	data->num_items = list_length(invalItems);
+	data->off_versions = MAXALIGN(sizeof(SharedPlanData));
+	data->off_params = data->off_versions + nversions * sizeof(uint64);
+	data->off_schemas = data->off_params + data->num_params * sizeof(Oid);
+	data->off_relations = data->off_schemas + data->num_schemas * sizeof(Oid);
+	data->off_items = data->off_relations + data->num_relations * sizeof(Oid);
+	data->off_query = data->off_items +
+		data->num_items * sizeof(SharedPlanInvalItem);
+	data->off_plan = data->off_query + query_len;
+	Assert(data->off_plan + plan_len == size);
+
+	if (data->num_params > 0)
+		memcpy(SPD_ARRAY(data, Oid, off_params), plansource->param_types,
+			   data->num_params * sizeof(Oid));
+	i = 0;
+	foreach(lc, path->schemas)
+		SPD_ARRAY(data, Oid, off_schemas)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, relationOids)
+		SPD_ARRAY(data, Oid, off_relations)[i++] = lfirst_oid(lc);
+	i = 0;
+	foreach(lc, invalItems)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+		SharedPlanInvalItem *sitem = &SPD_ARRAY(data, SharedPlanInvalItem,
+												off_items)[i++];
+
+		sitem->cacheId = item->cacheId;
+		sitem->hashValue = item->hashValue;
+	}
+	memcpy(SPD_ARRAY(data, char, off_query), plansource->query_string,
+		   query_len);
+	memcpy(SPD_ARRAY(data, char, off_plan), plan_str, plan_len);
+	pfree(plan_str);
+
+	/*
+	 * Record the versions of the plan's dependencies.  If nothing has been
+	 * committed since SharedPlanCacheBeginPlanning, they are the ones the
+	 * plan was made with.  Commits bump "started" before any version, so
+	 * checking it after reading the versions is enough.
+	 */
+	versions = SPD_ARRAY(data, uint64, off_versions);
+	data->all_version = pg_atomic_read_u64(&spc_ctl->all_version);
+	for (i = 0; i < data->num_relations; i++)
+	{
+		int			slot = spc_relation_slot(SPD_ARRAY(data, Oid,
+													   off_relations)[i]);
+
+		versions[i] = pg_atomic_read_u64(&spc_ctl->versions[slot]);
+	}
+	for (i = 0; i < data->num_items; i++)
+	{
+		SharedPlanInvalItem *sitem = &SPD_ARRAY(data, SharedPlanInvalItem,
+												off_items)[i];
+		int			slot = spc_object_slot(sitem->cacheId, sitem->hashValue);
+
+		versions[data->num_relations + i] =
+			pg_atomic_read_u64(&spc_ctl->versions[slot]);
+	}
+	pg_read_barrier();
+	if (pg_atomic_read_u64(&spc_ctl->started) + 1 != counter)
+	{
+		pfree(data);
+		return;
+	}
+
+	dp = dsa_allocate_extended(spc_area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		pfree(data);
+		return;
+	}
+	memcpy(dsa_get_address(spc_area, dp), data, size);
+	pfree(data);
+
+	entry = dshash_find_or_insert(spc_hash, &key, &found);
+	if (found)
+	{
+		/* keep a current plan someone else stored meanwhile */
+		if (spc_is_current(dsa_get_address(spc_area, entry->data)))
+		{
+			dshash_release_lock(spc_hash, entry);
+			dsa_free(spc_area, dp);
+			return;
+		}
+		dsa_free(spc_area, entry->data);
+		pg_atomic_sub_fetch_u64(&spc_ctl->bytes_used, entry->size);
+		pg_atomic_sub_fetch_u32(&spc_ctl->nentries, 1);
+	}
+	entry->entryid = pg_atomic_fetch_add_u64(&spc_ctl->next_entryid, 1);
+	entry->data = dp;
+	entry->size = size;
+	pg_atomic_add_fetch_u64(&spc_ctl->bytes_used, size);
+	pg_atomic_add_fetch_u32(&spc_ctl->nentries, 1);
+	dshash_release_lock(spc_hash, entry);
+}
+
+/*
+ * Remember that the current transaction changed something mapping to a slot
+ */
+static inline void
+spc_note_slot(int slot)
+{
+	spc_pending[slot / 64] |= UINT64CONST(1) << (slot % 64);
+	spc_pending_any = true;
+}
+
+/*
+ * SharedPlanCacheNoteRelation
+ *		Note that the current transaction registered a relcache invalidation
+ *		for a relation, or for all relations if relid == InvalidOid.
+ */
+void
+SharedPlanCacheNoteRelation(Oid relid)
+{
+	if (spc_ctl == NULL)
+		return;
+
+	if (OidIsValid(relid))
+		spc_note_slot(spc_relation_slot(relid));
+	else
+		spc_pending_all = true;
+}
+
+/*
+ * SharedPlanCacheNoteObject
+ *		Note that the current transaction registered a catcache invalidation.
+ *
+ * This must agree with the syscache callbacks of plancache.c: plans record
+ * their dependencies on PROCOID and TYPEOID entries, and changes to the
+ * other catalogs it watches invalidate all plans.
+ */
+void
+SharedPlanCacheNoteObject(int cacheId, uint32 hashValue)
+{
+	if (spc_ctl == NULL)
+		return;
+
+	switch (cacheId)
+	{
+		case PROCOID:
+		case TYPEOID:
+			spc_note_slot(spc_object_slot(cacheId, hashValue));
+			break;
+		case NAMESPACEOID:
+		case OPEROID:
+		case AMOPOPID:
+		case FOREIGNSERVEROID:
+		case FOREIGNDATAWRAPPEROID:
+			spc_pending_all = true;
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * SharedPlanCacheNoteAll
+ *		Note that the current transaction may have changed anything.
+ */
+void
+SharedPlanCacheNoteAll(void)
+{
+	if (spc_ctl == NULL)
+		return;
+
+	spc_pending_all = true;
+}
+
+/*
+ * PreCommit_SharedPlanCache
+ *		Bump the versions of everything the current transaction changed.
+ *
+ * Called just before the commit record is written.  Shared plans that
+ * depend on what the transaction changed stop being used from here on, and
+ * no new plans are stored until AtEOXact_SharedPlanCache() is called.
+ */
+void
+PreCommit_SharedPlanCache(void)
+{
+	if (!spc_pending_any && !spc_pending_all)
+		return;
+
+	/* this must come first, see SharedPlanCacheStore */
+	pg_atomic_fetch_add_u64(&spc_ctl->started, 1);
+	spc_committing = true;
+
+	if (spc_pending_all)
+		pg_atomic_fetch_add_u64(&spc_ctl->all_version, 1);
+
+	for (int i = 0; i < lengthof(spc_pending); i++)
+	{
+		uint64		word = spc_pending[i];
+
+		while (word != 0)
+		{
+			int			bit = pg_rightmost_one_pos64(word);
+
+			pg_atomic_fetch_add_u64(&spc_ctl->versions[i * 64 + bit], 1);
+			word &= ~(UINT64CONST(1) << bit);
+		}
+	}
+}
+
+/*
+ * AtEOXact_SharedPlanCache
+ *		Transaction end processing; for commit, called once the transaction's
+ *		invalidation messages have been sent.
+ */
+void
+AtEOXact_SharedPlanCache(bool isCommit)
+{
+	/* on abort after PreCommit, we still have to balance the counters */
+	if (spc_committing)
+		pg_atomic_fetch_add_u64(&spc_ctl->finished, 1);
+
+	memset(spc_pending, 0, sizeof(spc_pending));
+	spc_pending_any = false;
+	spc_pending_all = false;
+	spc_committing = false;
+}
@@ -34,6 +34,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_parameter_acl.h"
+#include "common/hashfn.h"
 #include "guc_internal.h"
 #include "libpq/pqformat.h"
 #include "libpq/protocol.h"
@@ -5570,6 +5571,120 @@ ShowGUCOption(struct config_generic *record, bool use_units)
 	return pstrdup(val);
 }
 
+/*
+ * Settings whose values change what a query means or what it returns,
+ * rather than how it is executed.  They are read by the lexer and by parse
+ * analysis, by datatype input and output functions, which
+ * eval_const_expressions() may run at plan time, and by some stable
+ * functions.
+ */
+static const char *const semantic_gucs[] = {
+	"array_nulls",
+	"backslash_quote",
+	"bytea_output",
+	"DateStyle",
+	"default_text_search_config",
+	"extra_float_digits",
+	"IntervalStyle",
+	"lc_monetary",
+	"lc_numeric",
+	"lc_time",
+	"quote_all_identifiers",
+	"standard_conforming_strings",
+	"TimeZone",
+	"timezone_abbreviations",
+	"transform_null_equals",
+	"xmlbinary",
+	"xmloption",
+};
+
+/*
+ * Does a setting influence the plans the planner makes?
+ *
+ * That's all of the "Query Tuning" settings (enable_*, the cost constants,
+ * GEQO, plan_cache_mode, constraint_exclusion, JIT and so on), plus a few
+ * resource settings the planner looks at.
+ */
+static bool
+guc_affects_plans(struct config_generic *gconf)
+{
+	switch (gconf->group)
+	{
+		case QUERY_TUNING_METHOD:
+		case QUERY_TUNING_COST:
+		case QUERY_TUNING_GEQO:
+		case QUERY_TUNING_OTHER:
+			return true;
+		default:
+			break;
+	}
+
+	return strcmp(gconf->name, "work_mem") == 0 ||
+		strcmp(gconf->name, "hash_mem_multiplier") == 0 ||
+		strcmp(gconf->name, "max_parallel_workers_per_gather") == 0;
+}
+
+static uint64
+fingerprint_add_option(uint64 hash, struct config_generic *gconf)
+{
+	char	   *value = ShowGUCOption(gconf, false);
+
+	hash = hash_combine64(hash,
+						  hash_bytes_extended((const unsigned char *) gconf->name,
+											  strlen(gconf->name), 0));
+	hash = hash_combine64(hash,
+						  hash_bytes_extended((const unsigned char *) value,
+											  strlen(value), 0));
+	pfree(value);
+
+	return hash;
+}
+
+/*
+ * GetConfigFingerprint: hash the current values of a class of settings
+ *
+ * Caches that share parsed or planned statements, or their results, between
+ * sessions include this in their keys, so that sessions whose settings would
+ * give a different answer don't share one.  "which" is a bitmask of
+ * GUC_FINGERPRINT_SEMANTICS (settings that parse analysis, constant folding
+ * and datatype I/O depend on) and GUC_FINGERPRINT_PLANNER (settings that
+ * steer the planner).
+ */
+uint64
+GetConfigFingerprint(int which)
+{
+	uint64		hash = 0;
+
+	if (which & GUC_FINGERPRINT_SEMANTICS)
+	{
+		for (int i = 0; i < lengthof(semantic_gucs); i++)
+		{
+			struct config_generic *gconf;
+
+			gconf = find_option(semantic_gucs[i], false, true, ERROR);
+			if (gconf != NULL)
+				hash = fingerprint_add_option(hash, gconf);
+		}
+	}
+
+	if (which & GUC_FINGERPRINT_PLANNER)
+	{
+		struct config_generic **gucs;
+		int			num_gucs;
+
+		/* sorted by name, so the result doesn't depend on hash order */
+		gucs = get_guc_variables(&num_gucs);
+		for (int i = 0; i < num_gucs; i++)
+		{
+			if (guc_affects_plans(gucs[i]))
+				hash = fingerprint_add_option(hash, gucs[i]);
+		}
+		pfree(gucs);
+	}
+
+	return hash;
+}
+
 
 #ifdef EXEC_BACKEND
 
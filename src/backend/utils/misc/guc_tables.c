@@ -50,6 +50,7 @@
 #include "libpq/libpq.h"
 #include "libpq/scram.h"
 #include "nodes/queryjumble.h"
+#include "optimizer/cardfeedback.h"
 #include "optimizer/cost.h"
 #include "optimizer/geqo.h"
 #include "optimizer/optimizer.h"
@@ -87,6 +88,8 @@
 #include "utils/pg_locale.h"
 #include "utils/plancache.h"
 #include "utils/ps_status.h"
+#include "utils/queryresultcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/xml.h"
 
 /* This value is normally passed in from the Makefile */
@@ -930,6 +933,16 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_eager_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation below joins."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_eager_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -950,6 +963,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_insert", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables parallel workers to insert rows for INSERT ... SELECT and CREATE TABLE AS."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_insert,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -977,6 +1000,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_adaptive_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables nested-loop joins to switch to hashing at run time."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_adaptive_join,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of async append plans."),
@@ -997,6 +1030,36 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"graph_join_search", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Enables join order search over the join graph for large joins."),
+			gettext_noop("When enabled, this is used instead of GEQO once "
+						 "geqo_threshold is reached."),
+			GUC_EXPLAIN
+		},
+		&enable_graph_join_search,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"cardinality_feedback", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Corrects row estimates of table scans using row counts from earlier executions."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&cardinality_feedback,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"query_result_cache", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Reuses results of identical read-only queries from the query result cache."),
+			NULL
+		},
+		&query_result_cache,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -2093,6 +2156,26 @@ struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"graph_join_search_limit", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of join pairs beyond which the join "
+						 "graph search builds its join tree greedily."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&graph_join_search_limit,
+		10000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"cardinality_feedback_max_entries", PGC_POSTMASTER, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of row estimate corrections kept for cardinality feedback."),
+			gettext_noop("0 disables cardinality feedback.")
+		},
+		&cardinality_feedback_max_entries,
+		1000, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2244,6 +2327,28 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans between sessions."),
+			gettext_noop("0 disables the shared plan cache."),
+			GUC_UNIT_MB
+		},
+		&shared_plan_cache_size,
+		0, 0, (int) Min((size_t) INT_MAX, SIZE_MAX / (1024 * 1024)),
+		NULL, NULL, NULL
+	},
+
+	{
+		{"query_result_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share query results between sessions."),
+			gettext_noop("0 disables the query result cache."),
+			GUC_UNIT_MB
+		},
+		&query_result_cache_size,
+		0, 0, (int) Min((size_t) INT_MAX, SIZE_MAX / (1024 * 1024)),
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We sometimes multiply the number of shared buffers by two without
 	 * checking for overflow, so we mustn't allow more than INT_MAX / 2.
@@ -42,10 +42,13 @@
  * end of the input is reached, we dump out remaining tuples in memory into
  * a final run, then merge the runs.
  *
- * When merging runs, we use a heap containing just the frontmost tuple from
- * each source run; we repeatedly output the smallest tuple and replace it
- * with the next tuple from its source tape (if any).  When the heap empties,
- * the merge is complete.  The basic merge algorithm thus needs very little
+ * When merging runs, we keep just the frontmost tuple from each source run
+ * in a tournament tree of "losers" (Knuth's Algorithm R, section 5.4.1); we
+ * repeatedly output the smallest tuple and replace it with the next tuple
+ * from its source tape (if any).  Replacing the winner needs only one
+ * comparison per level of the tree, about half as many as sifting a binary
+ * heap would.  When all the source runs are exhausted, the merge is
+ * complete.  The basic merge algorithm thus needs very little
  * memory --- only M tuples for an M-way merge, and M is constrained to a
  * small number.  However, we can still make good use of our full workMem
  * allocation by pre-reading additional blocks from each source tape.  Without
@@ -211,15 +214,29 @@ struct Tuplesortstate
 	/*
 	 * This array holds the tuples now in sort memory.  If we are in state
 	 * INITIAL, the tuples are in no particular order; if we are in state
-	 * SORTEDINMEM, the tuples are in final sorted order; in states BUILDRUNS
-	 * and FINALMERGE, the tuples are organized in "heap" order per Algorithm
-	 * H.  In state SORTEDONTAPE, the array is not used.
+	 * SORTEDINMEM, the tuples are in final sorted order; in state BOUNDED,
+	 * the tuples are organized in "heap" order per Algorithm H.  While
+	 * merging (including state FINALMERGE), memtuples[i] holds the current
+	 * tuple of input tape i, or has srctape == -1 if that tape's run is
+	 * exhausted, and memtupcount is the number of runs not yet exhausted.
+	 * In state SORTEDONTAPE, the array is not used.
 	 */
 	SortTuple  *memtuples;		/* array of SortTuple structs */
 	int			memtupcount;	/* number of tuples currently present */
 	int			memtupsize;		/* allocated length of memtuples array */
 	bool		growmemtuples;	/* memtuples' growth still underway? */
 
+	/*
+	 * Tournament tree used while merging.  mergetree[0] is the memtuples[]
+	 * index of the current winner, that is the next tuple to output, and
+	 * mergetree[1 .. mergeleaves-1] are the internal nodes of the tree, each
+	 * holding the index of the loser of the match played there.  The leaves
+	 * are implicit: memtuples[i] is leaf mergeleaves + i, and the parent of
+	 * node n is node n / 2.
+	 */
+	int		   *mergetree;		/* array of memtupsize entries */
+	int			mergeleaves;	/* number of input tapes in current merge */
+
 	/*
 	 * Memory for tuples is sometimes allocated using a simple slab allocator,
 	 * rather than with palloc().  Currently, we switch to slab allocation
@@ -231,8 +248,8 @@ struct Tuplesortstate
 	 * For the slab, we use one large allocation, divided into SLAB_SLOT_SIZE
 	 * slots.  The allocation is sized to have one slot per tape, plus one
 	 * additional slot.  We need that many slots to hold all the tuples kept
-	 * in the heap during merge, plus the one we have last returned from the
-	 * sort, with tuplesort_gettuple.
+	 * in the tournament tree during merge, plus the one we have last
+	 * returned from the sort, with tuplesort_gettuple.
 	 *
 	 * Initially, all the slots are kept in a linked list of free slots.  When
 	 * a tuple is read from a tape, it is put to the next available slot, if
@@ -464,6 +481,9 @@ static void mergeruns(Tuplesortstate *state);
 static void mergeonerun(Tuplesortstate *state);
 static void beginmerge(Tuplesortstate *state);
 static bool mergereadnext(Tuplesortstate *state, LogicalTape *srcTape, SortTuple *stup);
+static inline bool mergetree_precedes(Tuplesortstate *state, int a, int b);
+static void mergetree_build(Tuplesortstate *state);
+static void mergetree_replay(Tuplesortstate *state, int leaf);
 static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
@@ -622,6 +642,244 @@ qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Radix sort for SortTuples whose leading datum1 is compared by one of the
+ * ssup_datum_{unsigned,signed,int32}_cmp comparators.
+ *
+ * For those comparators, datum1 can be mapped to an unsigned "normalized key"
+ * whose numeric order is the sort order, direction included.  That lets us
+ * distribute tuples into buckets one key byte at a time, most significant
+ * byte first (an in-place "American flag" sort), instead of comparing them.
+ * Buckets that get small are handed to the specialized quicksort for the
+ * comparator, as are tuples whose normalized keys are identical, when they
+ * still need to be ordered by the tiebreak comparator (because datum1 is an
+ * abbreviation, or there are more sort keys).  NULLs are set aside first.
+ *
+ * This only pays off for reasonably large inputs, so smaller sorts keep using
+ * quicksort directly.
+ */
+#define RADIX_SORT_MIN_TUPLES		4096
+#define RADIX_SORT_QSORT_THRESHOLD	64
+
+typedef enum
+{
+	RADIX_KEY_UNSIGNED,
+#if SIZEOF_DATUM >= 8
+	RADIX_KEY_SIGNED,
+#endif
+	RADIX_KEY_INT32,
+} RadixKeyKind;
+
+static pg_attribute_always_inline Datum
+radix_normalize_key(Datum datum, RadixKeyKind kind, bool reverse)
+{
+	Datum		key;
+
+	switch (kind)
+	{
+		case RADIX_KEY_UNSIGNED:
+			key = datum;
+			break;
+#if SIZEOF_DATUM >= 8
+		case RADIX_KEY_SIGNED:
+			/* flip the sign bit so that negative values sort first */
+			key = datum ^ ((Datum) 1 << 63);
+			break;
+#endif
+		case RADIX_KEY_INT32:
+			key = (Datum) ((uint32) DatumGetInt32(datum) ^ ((uint32) 1 << 31));
+			break;
+		default:
+			pg_unreachable();
+	}
+
+	return reverse ? ~key : key;
+}
+
+static pg_attribute_always_inline int
+radix_key_byte(SortTuple *stup, int level, RadixKeyKind kind, bool reverse)
+{
+	Datum		key = radix_normalize_key(stup->datum1, kind, reverse);
+
+	/* level 0 is the most significant byte */
+	return (key >> ((SIZEOF_DATUM - 1 - level) * BITS_PER_BYTE)) & 0xFF;
+}
+
+/*
+ * Sort a range of SortTuples that all have equal normalized-key bytes above
+ * "level", or that are too few to be worth distributing, by comparison.
+ */
+static void
+radix_sort_fallback(SortTuple *begin, size_t n, RadixKeyKind kind,
+					Tuplesortstate *state)
+{
+	switch (kind)
+	{
+		case RADIX_KEY_UNSIGNED:
+			qsort_tuple_unsigned(begin, n, state);
+			break;
+#if SIZEOF_DATUM >= 8
+		case RADIX_KEY_SIGNED:
+			qsort_tuple_signed(begin, n, state);
+			break;
+#endif
+		case RADIX_KEY_INT32:
+			qsort_tuple_int32(begin, n, state);
+			break;
+	}
+}
+
+static void
+radix_sort_level(SortTuple *begin, size_t n, int level, RadixKeyKind kind,
+				 bool reverse, Tuplesortstate *state)
+{
+	size_t		counts[256] = {0};
+	size_t		next[256];
+	size_t		ends[256];
+	size_t		offset = 0;
+	int			b;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (size_t i = 0; i < n; i++)
+		counts[radix_key_byte(&begin[i], level, kind, reverse)]++;
+
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = offset;
+		offset += counts[b];
+		ends[b] = offset;
+	}
+
+	/*
+	 * Move each tuple into its bucket, following the cycle of displaced
+	 * tuples until we find one that belongs in the slot we started from.
+	 */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < ends[b])
+		{
+			SortTuple	tmp = begin[next[b]];
+			int			tb = radix_key_byte(&tmp, level, kind, reverse);
+
+			while (tb != b)
+			{
+				SortTuple	displaced = begin[next[tb]];
+
+				begin[next[tb]++] = tmp;
+				tmp = displaced;
+				tb = radix_key_byte(&tmp, level, kind, reverse);
+			}
+			begin[next[b]++] = tmp;
+		}
+	}
+
+	/* Now order each bucket on its own */
+	offset = 0;
+	for (b = 0; b < 256; b++)
+	{
+		SortTuple  *bucket = begin + offset;
+		size_t		count = counts[b];
+
+		offset += count;
+		if (count < 2)
+			continue;
+
+		if (level == SIZEOF_DATUM - 1)
+		{
+			/* Normalized keys are equal, so only the tiebreak is left */
+			if (state->base.onlyKey == NULL)
+				radix_sort_fallback(bucket, count, kind, state);
+		}
+		else if (count < RADIX_SORT_QSORT_THRESHOLD)
+			radix_sort_fallback(bucket, count, kind, state);
+		else
+			radix_sort_level(bucket, count, level + 1, kind, reverse, state);
+	}
+}
+
+static void
+radix_sort_tuple(SortTuple *begin, size_t n, RadixKeyKind kind,
+				 Tuplesortstate *state)
+{
+	SortSupport ssup = &state->base.sortKeys[0];
+	bool		reverse = ssup->ssup_reverse;
+	SortTuple  *notnull = begin;
+	size_t		nnulls = 0;
+	size_t		nnotnull;
+	Datum		first = 0;
+	Datum		diff = 0;
+	int			level;
+
+	/*
+	 * Partition NULLs to the front or the back, as their position doesn't
+	 * depend on datum1.
+	 */
+	if (ssup->ssup_nulls_first)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			if (begin[i].isnull1)
+			{
+				SortTuple	tmp = begin[nnulls];
+
+				begin[nnulls++] = begin[i];
+				begin[i] = tmp;
+			}
+		}
+		notnull = begin + nnulls;
+	}
+	else
+	{
+		size_t		j = n;
+
+		for (size_t i = n; i > 0; i--)
+		{
+			if (begin[i - 1].isnull1)
+			{
+				SortTuple	tmp = begin[--j];
+
+				begin[j] = begin[i - 1];
+				begin[i - 1] = tmp;
+			}
+		}
+		nnulls = n - j;
+	}
+	nnotnull = n - nnulls;
+
+	/* NULLs are equal in datum1, so sort them only if there's a tiebreak */
+	if (nnulls > 1 && state->base.onlyKey == NULL)
+		radix_sort_fallback(ssup->ssup_nulls_first ? begin : begin + nnotnull,
+							nnulls, kind, state);
+
+	if (nnotnull < 2)
+		return;
+
+	/*
+	 * Skip leading key bytes that are the same for all tuples, such as the
+	 * upper half of int32 keys, rather than distributing everything into a
+	 * single bucket.
+	 */
+	first = radix_normalize_key(notnull[0].datum1, kind, reverse);
+	for (size_t i = 1; i < nnotnull; i++)
+		diff |= radix_normalize_key(notnull[i].datum1, kind, reverse) ^ first;
+
+	if (diff == 0)
+	{
+		if (state->base.onlyKey == NULL)
+			radix_sort_fallback(notnull, nnotnull, kind, state);
+		return;
+	}
+
+	for (level = 0; level < SIZEOF_DATUM - 1; level++)
+	{
+		if ((diff >> ((SIZEOF_DATUM - 1 - level) * BITS_PER_BYTE)) != 0)
+			break;
+	}
+
+	radix_sort_level(notnull, nnotnull, level, kind, reverse, state);
+}
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -805,6 +1063,11 @@ tuplesort_begin_batch(Tuplesortstate *state)
 		state->memtuples = NULL;
 		state->memtupsize = INITIAL_MEMTUPSIZE;
 	}
+	if (state->mergetree != NULL)
+	{
+		pfree(state->mergetree);
+		state->mergetree = NULL;
+	}
 	if (state->memtuples == NULL)
 	{
 		state->memtuples = (SortTuple *) palloc(state->memtupsize * sizeof(SortTuple));
@@ -1682,11 +1945,11 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 			 */
 			if (state->memtupcount > 0)
 			{
-				int			srcTapeIndex = state->memtuples[0].srctape;
+				int			srcTapeIndex = state->mergetree[0];
 				LogicalTape *srcTape = state->inputTapes[srcTapeIndex];
-				SortTuple	newtup;
+				SortTuple  *top = &state->memtuples[srcTapeIndex];
 
-				*stup = state->memtuples[0];
+				*stup = *top;
 
 				/*
 				 * Remember the tuple we return, so that we can recycle its
@@ -1695,16 +1958,20 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 				state->lastReturnedTuple = stup->tuple;
 
 				/*
-				 * Pull next tuple from tape, and replace the returned tuple
-				 * at top of the heap with it.
+				 * Pull next tuple from tape into the returned tuple's leaf,
+				 * and replay the matches on its path to the root.
 				 */
-				if (!mergereadnext(state, srcTape, &newtup))
+				if (mergereadnext(state, srcTape, top))
+					top->srctape = srcTapeIndex;
+				else
 				{
 					/*
 					 * If no more data, we've reached end of run on this tape.
-					 * Remove the top node from the heap.
+					 * Mark the leaf as exhausted, so that it loses every
+					 * match from now on.
 					 */
-					tuplesort_heap_delete_top(state);
+					top->srctape = -1;
+					state->memtupcount--;
 					state->nInputRuns--;
 
 					/*
@@ -1712,10 +1979,8 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					 * anyway, but better to release the memory early.
 					 */
 					LogicalTapeClose(srcTape);
-					return true;
 				}
-				newtup.srctape = srcTapeIndex;
-				tuplesort_heap_replace_top(state, &newtup);
+				mergetree_replay(state, srcTapeIndex);
 				return true;
 			}
 			return false;
@@ -2073,7 +2338,7 @@ mergeruns(Tuplesortstate *state)
 
 	/*
 	 * We no longer need a large memtuples array.  (We will allocate a smaller
-	 * one for the heap later.)
+	 * one for the merge later.)
 	 */
 	FREEMEM(state, GetMemoryChunkSpace(state->memtuples));
 	pfree(state->memtuples);
@@ -2081,7 +2346,7 @@ mergeruns(Tuplesortstate *state)
 
 	/*
 	 * Initialize the slab allocator.  We need one slab slot per input tape,
-	 * for the tuples in the heap, plus one to hold the tuple last returned
+	 * for the tuples being merged, plus one to hold the tuple last returned
 	 * from tuplesort_gettuple.  (If we're sorting pass-by-val Datums,
 	 * however, we don't need to do allocate anything.)
 	 *
@@ -2098,8 +2363,8 @@ mergeruns(Tuplesortstate *state)
 		init_slab_allocator(state, 0);
 
 	/*
-	 * Allocate a new 'memtuples' array, for the heap.  It will hold one tuple
-	 * from each input tape.
+	 * Allocate a new 'memtuples' array, and the tournament tree over it.  It
+	 * will hold one tuple from each input tape.
 	 *
 	 * We could shrink this, too, between passes in a multi-pass merge, but we
 	 * don't bother.  (The initial input tapes are still in outputTapes.  The
@@ -2109,6 +2374,9 @@ mergeruns(Tuplesortstate *state)
 	state->memtuples = (SortTuple *) MemoryContextAlloc(state->base.maincontext,
 														state->nOutputTapes * sizeof(SortTuple));
 	USEMEM(state, GetMemoryChunkSpace(state->memtuples));
+	state->mergetree = (int *) MemoryContextAlloc(state->base.maincontext,
+												  state->nOutputTapes * sizeof(int));
+	USEMEM(state, GetMemoryChunkSpace(state->mergetree));
 
 	/*
 	 * Use all the remaining memory we have available for tape buffers among
@@ -2236,49 +2504,49 @@ mergeonerun(Tuplesortstate *state)
 
 	/*
 	 * Start the merge by loading one tuple from each active source tape into
-	 * the heap.
+	 * the tournament tree.
 	 */
 	beginmerge(state);
 
 	Assert(state->slabAllocatorUsed);
 
 	/*
-	 * Execute merge by repeatedly extracting lowest tuple in heap, writing it
-	 * out, and replacing it with next tuple from same tape (if there is
-	 * another one).
+	 * Execute merge by repeatedly writing out the winner of the tournament,
+	 * and replacing it with next tuple from same tape (if there is another
+	 * one).
 	 */
 	while (state->memtupcount > 0)
 	{
-		SortTuple	stup;
+		SortTuple  *top;
 
 		/* write the tuple to destTape */
-		srcTapeIndex = state->memtuples[0].srctape;
+		srcTapeIndex = state->mergetree[0];
 		srcTape = state->inputTapes[srcTapeIndex];
-		WRITETUP(state, state->destTape, &state->memtuples[0]);
+		top = &state->memtuples[srcTapeIndex];
+		WRITETUP(state, state->destTape, top);
 
 		/* recycle the slot of the tuple we just wrote out, for the next read */
-		if (state->memtuples[0].tuple)
-			RELEASE_SLAB_SLOT(state, state->memtuples[0].tuple);
+		if (top->tuple)
+			RELEASE_SLAB_SLOT(state, top->tuple);
 
 		/*
-		 * pull next tuple from the tape, and replace the written-out tuple in
-		 * the heap with it.
+		 * pull next tuple from the tape into the written-out tuple's leaf,
+		 * and replay the matches on its path to the root.
 		 */
-		if (mergereadnext(state, srcTape, &stup))
-		{
-			stup.srctape = srcTapeIndex;
-			tuplesort_heap_replace_top(state, &stup);
-		}
+		if (mergereadnext(state, srcTape, top))
+			top->srctape = srcTapeIndex;
 		else
 		{
-			tuplesort_heap_delete_top(state);
+			top->srctape = -1;
+			state->memtupcount--;
 			state->nInputRuns--;
 		}
+		mergetree_replay(state, srcTapeIndex);
 	}
 
 	/*
-	 * When the heap empties, we're done.  Write an end-of-run marker on the
-	 * output tape.
+	 * When all the runs are exhausted, we're done.  Write an end-of-run
+	 * marker on the output tape.
 	 */
 	markrunend(state->destTape);
 }
@@ -2286,7 +2554,8 @@ mergeonerun(Tuplesortstate *state)
 /*
  * beginmerge - initialize for a merge pass
  *
- * Fill the merge heap with the first tuple from each input tape.
+ * Load the first tuple from each input tape, and build the tournament tree
+ * over them.
  */
 static void
 beginmerge(Tuplesortstate *state)
@@ -2294,21 +2563,27 @@ beginmerge(Tuplesortstate *state)
 	int			activeTapes;
 	int			srcTapeIndex;
 
-	/* Heap should be empty here */
+	/* Tree should be empty here */
 	Assert(state->memtupcount == 0);
 
 	activeTapes = Min(state->nInputTapes, state->nInputRuns);
+	Assert(activeTapes <= state->memtupsize);
 
 	for (srcTapeIndex = 0; srcTapeIndex < activeTapes; srcTapeIndex++)
 	{
-		SortTuple	tup;
+		SortTuple  *tup = &state->memtuples[srcTapeIndex];
 
-		if (mergereadnext(state, state->inputTapes[srcTapeIndex], &tup))
+		if (mergereadnext(state, state->inputTapes[srcTapeIndex], tup))
 		{
-			tup.srctape = srcTapeIndex;
-			tuplesort_heap_insert(state, &tup);
+			tup->srctape = srcTapeIndex;
+			state->memtupcount++;
 		}
+		else
+			tup->srctape = -1;
 	}
+
+	state->mergeleaves = activeTapes;
+	mergetree_build(state);
 }
 
 /*
@@ -2329,6 +2604,108 @@ mergereadnext(Tuplesortstate *state, LogicalTape *srcTape, SortTuple *stup)
 	return true;
 }
 
+/*
+ * mergetree_precedes - does leaf a win its match against leaf b?
+ *
+ * An exhausted leaf loses against everything.  Ties go to the leaf with the
+ * lower index, which keeps the tree's output independent of which side of a
+ * match each leaf happens to enter from.
+ */
+static inline bool
+mergetree_precedes(Tuplesortstate *state, int a, int b)
+{
+	SortTuple  *ta = &state->memtuples[a];
+	SortTuple  *tb = &state->memtuples[b];
+	int			compare;
+
+	if (tb->srctape < 0)
+		return true;
+	if (ta->srctape < 0)
+		return false;
+
+	compare = COMPARETUP(state, ta, tb);
+	if (compare != 0)
+		return compare < 0;
+	return a < b;
+}
+
+/*
+ * mergetree_build - play all the matches of a fresh tournament
+ *
+ * Plays the tree bottom-up, remembering the loser of each match in
+ * mergetree[] and passing the winner on to the next level.  This takes
+ * mergeleaves - 1 comparisons.
+ */
+static void
+mergetree_build(Tuplesortstate *state)
+{
+	int			nleaves = state->mergeleaves;
+	int		   *winners;
+	int			node;
+
+	if (nleaves <= 1)
+	{
+		/* a single leaf (or none) wins by default */
+		state->mergetree[0] = 0;
+		return;
+	}
+
+	/* winners[n] is the winner of the subtree rooted at node n */
+	winners = (int *) palloc(2 * nleaves * sizeof(int));
+	for (node = 0; node < nleaves; node++)
+		winners[nleaves + node] = node;
+
+	for (node = nleaves - 1; node >= 1; node--)
+	{
+		int			left = winners[2 * node];
+		int			right = winners[2 * node + 1];
+
+		if (mergetree_precedes(state, left, right))
+		{
+			winners[node] = left;
+			state->mergetree[node] = right;
+		}
+		else
+		{
+			winners[node] = right;
+			state->mergetree[node] = left;
+		}
+	}
+	state->mergetree[0] = winners[1];
+
+	pfree(winners);
+}
+
+/*
+ * mergetree_replay - replay the matches after a leaf's tuple has changed
+ *
+ * Called after the winner's leaf has been refilled from its tape, or marked
+ * as exhausted.  Only the matches on the path from that leaf to the root can
+ * have a different outcome, and at each of them the new contender only has
+ * to play the loser stored there, so this costs one comparison per level.
+ */
+static void
+mergetree_replay(Tuplesortstate *state, int leaf)
+{
+	int		   *tree = state->mergetree;
+	int			winner = leaf;
+	int			node;
+
+	Assert(leaf == tree[0]);
+
+	for (node = (state->mergeleaves + leaf) / 2; node >= 1; node /= 2)
+	{
+		if (mergetree_precedes(state, tree[node], winner))
+		{
+			int			tmp = tree[node];
+
+			tree[node] = winner;
+			winner = tmp;
+		}
+	}
+	tree[0] = winner;
+}
+
 /*
  * dumptuples - remove tuples from memtuples and write initial run to tape
  *
@@ -2706,9 +3083,9 @@ sort_bounded_heap(Tuplesortstate *state)
 }
 
 /*
- * Sort all memtuples using specialized qsort() routines.
+ * Sort all memtuples using specialized qsort() or radix sort routines.
  *
- * Quicksort is used for small in-memory sorts, and external sort runs.
+ * This is used for in-memory sorts, and external sort runs.
  */
 static void
 tuplesort_sort_memtuples(Tuplesortstate *state)
@@ -2723,27 +3100,47 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 		 */
 		if (state->base.haveDatum1 && state->base.sortKeys)
 		{
+			bool		use_radix = state->memtupcount >= RADIX_SORT_MIN_TUPLES;
+
 			if (state->base.sortKeys[0].comparator == ssup_datum_unsigned_cmp)
 			{
-				qsort_tuple_unsigned(state->memtuples,
+				if (use_radix)
+					radix_sort_tuple(state->memtuples,
 									 state->memtupcount,
+									 RADIX_KEY_UNSIGNED,
 									 state);
+				else
+					qsort_tuple_unsigned(state->memtuples,
+										 state->memtupcount,
+										 state);
 				return;
 			}
 #if SIZEOF_DATUM >= 8
 			else if (state->base.sortKeys[0].comparator == ssup_datum_signed_cmp)
 			{
-				qsort_tuple_signed(state->memtuples,
-								   state->memtupcount,
-								   state);
+				if (use_radix)
+					radix_sort_tuple(state->memtuples,
+									 state->memtupcount,
+									 RADIX_KEY_SIGNED,
+									 state);
+				else
+					qsort_tuple_signed(state->memtuples,
+									   state->memtupcount,
+									   state);
 				return;
 			}
 #endif
 			else if (state->base.sortKeys[0].comparator == ssup_datum_int32_cmp)
 			{
-				qsort_tuple_int32(state->memtuples,
-								  state->memtupcount,
-								  state);
+				if (use_radix)
+					radix_sort_tuple(state->memtuples,
+									 state->memtupcount,
+									 RADIX_KEY_INT32,
+									 state);
+				else
+					qsort_tuple_int32(state->memtuples,
+									  state->memtupcount,
+									  state);
 				return;
 			}
 		}
@@ -3055,11 +3452,14 @@ worker_freeze_result_tape(Tuplesortstate *state)
 
 	/*
 	 * Free most remaining memory, in case caller is sensitive to our holding
-	 * on to it.  memtuples may not be a tiny merge heap at this point.
+	 * on to it.  memtuples may not be a tiny merge array at this point.
 	 */
 	pfree(state->memtuples);
+	if (state->mergetree)
+		pfree(state->mergetree);
 	/* Be tidy */
 	state->memtuples = NULL;
+	state->mergetree = NULL;
 	state->memtupsize = 0;
 
 	/*
@@ -324,6 +324,8 @@ extern void heap_multi_insert(Relation relation, struct TupleTableSlot **slots,
 extern TM_Result heap_delete(Relation relation, ItemPointer tid,
 							 CommandId cid, Snapshot crosscheck, bool wait,
 							 struct TM_FailureData *tmfd, bool changingPart);
+extern int	heap_multi_delete(Relation relation, ItemPointer tids, int ntids,
+							  CommandId cid, bool *deleted);
 extern void heap_finish_speculative(Relation relation, ItemPointer tid);
 extern void heap_abort_speculative(Relation relation, ItemPointer tid);
 extern TM_Result heap_update(Relation relation, ItemPointer otid,
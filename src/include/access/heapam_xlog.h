@@ -103,6 +103,7 @@
 #define XLH_DELETE_CONTAINS_OLD_KEY				(1<<2)
 #define XLH_DELETE_IS_SUPER						(1<<3)
 #define XLH_DELETE_IS_PARTITION_MOVE			(1<<4)
+#define XLH_DELETE_IS_MULTI						(1<<5)
 
 /* convenience macro for checking whether any form of old tuple was logged */
 #define XLH_DELETE_CONTAINS_OLD						\
@@ -119,6 +120,22 @@ typedef struct xl_heap_delete
 
 #define SizeOfHeapDelete	(offsetof(xl_heap_delete, flags) + sizeof(uint8))
 
+/*
+ * With XLH_DELETE_IS_MULTI, the record deletes several tuples on the same
+ * page, all getting the same xmax and infobits_set, and xl_heap_delete is
+ * followed by this.  offnum is then the same as offsets[0].  If the record
+ * contains old tuple data, the offsets are followed by an
+ * xl_multi_insert_tuple struct and the data for each tuple, with padding to
+ * align each struct, as in XLOG_HEAP2_MULTI_INSERT.
+ */
+typedef struct xl_heap_delete_multi
+{
+	uint16		ntuples;
+	OffsetNumber offsets[FLEXIBLE_ARRAY_MEMBER];
+} xl_heap_delete_multi;
+
+#define SizeOfHeapDeleteMulti	offsetof(xl_heap_delete_multi, offsets)
+
 /*
  * xl_heap_truncate flag values, 8 bits are available.
  */
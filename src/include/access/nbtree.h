@@ -1037,6 +1037,36 @@ typedef struct BTArrayKeyInfo
 	Datum	   *elem_values;	/* array of num_elems Datums */
 } BTArrayKeyInfo;
 
+/*
+ * Skip scan support.
+ *
+ * A scan whose keys all constrain the second or later index attributes can
+ * still use the index efficiently when the first attribute has few distinct
+ * values: we enumerate those values one at a time, with a descent of the tree
+ * per value, and scan the matching range of each "group" using the original
+ * keys plus an equality key on the first attribute.  The NULL group, if any,
+ * is visited in the position implied by the index's NULLS FIRST/LAST option.
+ * When a group turns out to be small enough that consecutive groups share a
+ * leaf page, the extra descents are a loss; after a few such groups we give up
+ * skipping and scan the rest of the index in one go.
+ *
+ * The same machinery serves btskip, which callers use to move on to the next
+ * leading value as soon as they've seen a tuple from the current one (see
+ * amskip in the index AM documentation).
+ */
+typedef enum BTSkipGroupKind
+{
+	BTSKIP_START,				/* no group visited yet */
+	BTSKIP_VALUE,				/* scanning leading attribute = skipValue */
+	BTSKIP_NULL,				/* scanning leading attribute IS NULL */
+	BTSKIP_REST,				/* scanning all remaining non-NULL values */
+	BTSKIP_DONE,				/* no more groups */
+	BTSKIP_END,					/* btskip found no more groups */
+} BTSkipGroupKind;
+
+#define BT_SKIP_MAX_USELESS		8	/* groups sharing a leaf page before we
+									 * stop skipping */
+
 typedef struct BTScanOpaqueData
 {
 	/* these fields are set by _bt_preprocess_keys(): */
@@ -1052,6 +1082,24 @@ typedef struct BTScanOpaqueData
 	FmgrInfo   *orderProcs;		/* ORDER procs for required equality keys */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/* workspace for skip scan support (only used when skipScan is set) */
+	bool		skipScan;		/* skipping over leading attribute values? */
+	bool		skipDistinct;	/* can btskip be used? */
+	BTSkipGroupKind skipGroup;	/* current group */
+	Datum		skipValue;		/* leading attribute value, if BTSKIP_VALUE
+								 * or BTSKIP_REST */
+	ScanDirection skipDir;		/* direction BTSKIP_REST was entered in */
+	int			skipUseless;	/* consecutive groups sharing a leaf page */
+	BlockNumber skipPage;		/* leaf page the last group started on */
+	BTSkipGroupKind skipMarkGroup;	/* group saved by btmarkpos */
+	Datum		skipMarkValue;
+	ScanDirection skipMarkDir;
+	int			skipNumKeys;	/* number of keys in skipKeyData */
+	ScanKey		skipKeyData;	/* leading attribute key + original keys */
+	ScanKeyData skipOpKeys[BTMaxStrategyNumber];	/* leading attribute
+													 * key templates */
+	MemoryContext skipContext;	/* scan-lifespan context for skip data */
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -1173,6 +1221,7 @@ extern Size btestimateparallelscan(int nkeys, int norderbys);
 extern void btinitparallelscan(void *target);
 extern bool btgettuple(IndexScanDesc scan, ScanDirection dir);
 extern int64 btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm);
+extern bool btskip(IndexScanDesc scan, ScanDirection dir);
 extern void btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 					 ScanKey orderbys, int norderbys);
 extern void btparallelrescan(IndexScanDesc scan);
@@ -1279,6 +1328,10 @@ extern OffsetNumber _bt_binsrch_insert(Relation rel, BTInsertState insertstate);
 extern int32 _bt_compare(Relation rel, BTScanInsert key, Page page, OffsetNumber offnum);
 extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_skip_next_group(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_skip_past_value(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_skip_mark(IndexScanDesc scan);
+extern void _bt_skip_restore(IndexScanDesc scan);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost);
 
 /*
@@ -1289,6 +1342,7 @@ extern void _bt_freestack(BTStack stack);
 extern bool _bt_start_prim_scan(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
+extern void _bt_skip_setup(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, BTReadPageState *pstate, bool arrayKeys,
 						  IndexTuple tuple, int tupnatts);
 extern void _bt_killitems(IndexScanDesc scan);
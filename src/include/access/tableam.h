@@ -541,6 +541,14 @@ typedef struct TableAmRoutine
 								 TM_FailureData *tmfd,
 								 bool changingPart);
 
+	/*
+	 * See table_multi_delete() for reference about parameters.
+	 *
+	 * Optional callback.
+	 */
+	int			(*multi_delete) (Relation rel, ItemPointer tids, int ntids,
+								 CommandId cid, bool *deleted);
+
 	/* see table_tuple_update() for reference about parameters */
 	TM_Result	(*tuple_update) (Relation rel,
 								 ItemPointer otid,
@@ -1498,6 +1506,27 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
 										 wait, tmfd, changingPart);
 }
 
+/*
+ * Delete multiple tuples from the same block of a table.
+ *
+ * This is like calling table_tuple_delete() without a crosscheck snapshot
+ * for each of the `ntids` TIDs in `tids`, which must all point into the same
+ * block, except that the AM is free to leave alone any tuple that needs more
+ * than being marked deleted: one that is locked or being modified by another
+ * transaction, was already modified by the current command, and so on.
+ * deleted[i] is set to tell whether the i'th tuple was deleted; the caller
+ * must pass the others to table_tuple_delete(), which waits for or reports
+ * the conflict as usual.  Returns the number of tuples deleted.
+ *
+ * May only be called for AMs providing the multi_delete callback.
+ */
+static inline int
+table_multi_delete(Relation rel, ItemPointer tids, int ntids, CommandId cid,
+				   bool *deleted)
+{
+	return rel->rd_tableam->multi_delete(rel, tids, ntids, cid, deleted);
+}
+
 /*
  * Update a tuple.
  *
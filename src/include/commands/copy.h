@@ -17,6 +17,8 @@
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 #include "tcop/dest.h"
 
 /*
@@ -60,6 +62,7 @@ typedef struct CopyFormatOptions
 	int			file_encoding;	/* file or remote side's character encoding,
 								 * -1 if not specified */
 	bool		binary;			/* binary format? */
+	bool		arrow;			/* Arrow IPC stream format? (implies binary) */
 	bool		freeze;			/* freeze rows on loading? */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	CopyHeaderChoice header_line;	/* header line? */
@@ -84,6 +87,7 @@ typedef struct CopyFormatOptions
 	CopyOnErrorChoice on_error; /* what to do when error happened */
 	CopyLogVerbosityChoice log_verbosity;	/* verbosity of logged messages */
 	List	   *convert_select; /* list of column names (can be NIL) */
+	int			nworkers;		/* requested parallel workers, 0 if none */
 } CopyFormatOptions;
 
 /* These are private in commands/copy[from|to].c */
@@ -106,11 +110,18 @@ extern bool NextCopyFrom(CopyFromState cstate, ExprContext *econtext,
 						 Datum *values, bool *nulls);
 extern bool NextCopyFromRawFields(CopyFromState cstate,
 								  char ***fields, int *nfields);
+extern bool NextCopyFromLine(CopyFromState cstate, uint64 *prev_lineno);
 extern void CopyFromErrorCallback(void *arg);
 extern char *CopyLimitPrintoutLength(const char *str);
 
 extern uint64 CopyFrom(CopyFromState cstate);
 
+/* in commands/copyparallel.c */
+extern bool ParallelCopyFrom(ParseState *pstate, Relation rel,
+							 Node *whereClause, const CopyStmt *stmt,
+							 CopyFromState cstate, uint64 *processed);
+extern void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
+
 extern DestReceiver *CreateCopyDestReceiver(void);
 
 /*
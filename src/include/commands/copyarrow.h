@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyarrow.h
+ *	  Arrow IPC stream output for COPY TO.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/commands/copyarrow.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COPYARROW_H
+#define COPYARROW_H
+
+#include "access/tupdesc.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "nodes/pg_list.h"
+
+/* Private to commands/copyarrow.c */
+typedef struct ArrowWriter ArrowWriter;
+
+extern ArrowWriter *ArrowWriterBegin(TupleDesc tupDesc, List *attnumlist,
+									 FmgrInfo *out_functions);
+extern void ArrowWriterSchema(ArrowWriter *writer, StringInfo out);
+extern bool ArrowWriterAddRow(ArrowWriter *writer, TupleTableSlot *slot);
+extern void ArrowWriterFlush(ArrowWriter *writer, StringInfo out);
+extern void ArrowWriterFinish(ArrowWriter *writer, StringInfo out);
+
+#endif							/* COPYARROW_H */
@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * incrmatview.h
+ *	  prototypes for incrmatview.c.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/commands/incrmatview.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef INCRMATVIEW_H
+#define INCRMATVIEW_H
+
+#include "nodes/parsenodes.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+
+extern void CheckIncrementalMatViewQuery(Query *query, List *colNames);
+extern Query *AddIncrementalMatViewColumns(Query *query);
+extern void CreateIncrementalMatViewLogs(Oid matviewOid, Query *query);
+
+extern bool IncrementalRefreshMatView(Relation matviewRel, Query *query,
+									  Oid relowner, int save_sec_context,
+									  uint64 *processed);
+extern void ClearIncrementalMatViewLogs(Relation matviewRel, Query *query,
+										Snapshot snapshot);
+
+#endif							/* INCRMATVIEW_H */
@@ -32,5 +32,7 @@ extern ObjectAddress RefreshMatViewByOid(Oid matviewOid, bool skipData, bool con
 extern DestReceiver *CreateTransientRelDestReceiver(Oid transientoid);
 
 extern bool MatViewIncrementalMaintenanceIsEnabled(void);
+extern void OpenMatViewIncrementalMaintenance(void);
+extern void CloseMatViewIncrementalMaintenance(void);
 
 #endif							/* MATVIEW_H */
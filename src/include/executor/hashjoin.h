@@ -255,6 +255,9 @@ typedef struct ParallelHashJoinState
 	int			nparticipants;
 	size_t		space_allowed;
 	size_t		total_tuples;	/* total number of inner tuples */
+	bool		keyrange_valid; /* has any participant seen a prune key? */
+	Datum		keyrange_min;	/* smallest prune key, if pass-by-value */
+	Datum		keyrange_max;	/* largest prune key, if pass-by-value */
 	LWLock		lock;			/* lock protecting the above */
 
 	Barrier		build_barrier;	/* synchronization for the build phases */
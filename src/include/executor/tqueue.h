@@ -14,6 +14,8 @@
 #ifndef TQUEUE_H
 #define TQUEUE_H
 
+#include <signal.h>
+
 #include "storage/shm_mq.h"
 #include "tcop/dest.h"
 
@@ -23,6 +25,10 @@ typedef struct TupleQueueReader TupleQueueReader;
 /* Use this to send tuples to a shm_mq. */
 extern DestReceiver *CreateTupleQueueDestReceiver(shm_mq_handle *handle);
 
+/* Sending batches of tuples that have waited too long. */
+extern PGDLLIMPORT volatile sig_atomic_t TupleQueueFlushPending;
+extern void ProcessTupleQueueFlush(void);
+
 /* Use these to receive tuples from a shm_mq. */
 extern TupleQueueReader *CreateTupleQueueReader(shm_mq_handle *handle);
 extern void DestroyTupleQueueReader(TupleQueueReader *reader);
@@ -708,6 +708,14 @@ typedef struct EState
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
 
+	/*
+	 * CREATE TABLE AS target that parallel workers below a top-level Gather
+	 * may insert into directly, and the table_tuple_insert options to use;
+	 * InvalidOid if the workers must send their rows to the leader.
+	 */
+	Oid			es_parallel_into_relid;
+	int			es_parallel_into_options;
+
 	/*
 	 * JIT information. es_jit_flags indicates whether JIT should be performed
 	 * and with which options.  es_jit is created on-demand when JITing is
@@ -1417,6 +1425,15 @@ typedef struct ModifyTableState
 	double		mt_merge_inserted;
 	double		mt_merge_updated;
 	double		mt_merge_deleted;
+
+	/*
+	 * For a plain DELETE, TIDs of rows to delete from the same block of
+	 * mt_delete_rel, handed to the table AM together; mt_delete_tids is NULL
+	 * if the node cannot batch deletes at all.
+	 */
+	ResultRelInfo *mt_delete_rel;
+	ItemPointerData *mt_delete_tids;
+	int			mt_delete_ntids;
 } ModifyTableState;
 
 /* ----------------
@@ -1561,6 +1578,7 @@ typedef struct BitmapOrState
  *		currentRelation    relation being scanned (NULL if none)
  *		currentScanDesc    current scan descriptor for scan (NULL if none)
  *		ScanTupleSlot	   pointer to slot in tuple table holding scan tuple
+ *		ScanDone		   true if ExecScan has reached the end of the scan
  * ----------------
  */
 typedef struct ScanState
@@ -1569,6 +1587,7 @@ typedef struct ScanState
 	Relation	ss_currentRelation;
 	struct TableScanDescData *ss_currentScanDesc;
 	TupleTableSlot *ss_ScanTupleSlot;
+	bool		ss_ScanDone;
 } ScanState;
 
 /* ----------------
@@ -1639,6 +1658,7 @@ typedef struct
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		SkipPending		   skip to the next leading value before next fetch?
  *
  *		ReorderQueue	   tuples that need reordering due to re-check
  *		ReachedEnd		   have we fetched all tuples from index already?
@@ -1665,6 +1685,7 @@ typedef struct IndexScanState
 	ExprContext *iss_RuntimeContext;
 	Relation	iss_RelationDesc;
 	struct IndexScanDescData *iss_ScanDesc;
+	bool		iss_SkipPending;
 
 	/* These are needed for re-checking ORDER BY expr ordering */
 	pairingheap *iss_ReorderQueue;
@@ -1691,6 +1712,7 @@ typedef struct IndexScanState
  *		RuntimeContext	   expr context for evaling runtime Skeys
  *		RelationDesc	   index relation descriptor
  *		ScanDesc		   index scan descriptor
+ *		SkipPending		   skip to the next leading value before next fetch?
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
  *		PscanLen		   size of parallel index-only scan descriptor
@@ -1712,6 +1734,7 @@ typedef struct IndexOnlyScanState
 	ExprContext *ioss_RuntimeContext;
 	Relation	ioss_RelationDesc;
 	struct IndexScanDescData *ioss_ScanDesc;
+	bool		ioss_SkipPending;
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
 	Size		ioss_PscanLen;
@@ -2100,6 +2123,17 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *
+ *	The remaining fields support hashing the inner side at run time, if the
+ *	plan allows it (see nodeNestloop.c):
+ *
+ *		OuterTuples		   number of outer tuples fetched so far
+ *		HashThreshold	   hash the inner side once OuterTuples exceeds this;
+ *						   0 if we may not, or have given up trying
+ *		HashedAfter		   OuterTuples when the inner side was hashed, or 0
+ *		HashTable		   inner tuples, hashed on the inner keys
+ *		HashMatches		   inner tuples matching the current outer tuple
+ *		HashMatchIdx	   next entry of HashMatches to return
  * ----------------
  */
 typedef struct NestLoopState
@@ -2108,6 +2142,25 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+
+	double		nl_OuterTuples;
+	double		nl_HashThreshold;
+	double		nl_HashedAfter;
+	int			nl_NumHashKeys;
+	AttrNumber *nl_HashKeyColIdx;	/* 1..n, for the projected keys */
+	Oid		   *nl_HashEqFuncOids;	/* inner-to-inner equality functions */
+	Oid		   *nl_HashCollations;
+	FmgrInfo   *nl_InnerHashFunctions;
+	FmgrInfo   *nl_OuterHashFunctions;
+	ProjectionInfo *nl_OuterHashKeys;
+	ProjectionInfo *nl_InnerHashKeys;
+	ExprState  *nl_HashCrossEq; /* outer-to-inner equality of keys */
+	TupleHashTable nl_HashTable;
+	MemoryContext nl_HashTableCxt;
+	MemoryContext nl_HashTempCxt;
+	TupleTableSlot *nl_HashInnerSlot;
+	List	   *nl_HashMatches;
+	int			nl_HashMatchIdx;
 } NestLoopState;
 
 /* ----------------
@@ -2181,6 +2234,8 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_KeyRangePublished	true if the Hash node has published its join
+ *								key range for pruning the outer plan before
  * ----------------
  */
 
@@ -2208,6 +2263,7 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	bool		hj_KeyRangePublished;
 } HashJoinState;
 
 
@@ -2249,6 +2305,11 @@ typedef struct MemoizeInstrumentation
 									 * cache when filling it due to not being
 									 * able to free enough space to store the
 									 * current scan's tuples. */
+	uint64		cache_rejections;	/* number of cache misses whose results
+									 * the admission policy chose not to
+									 * cache */
+	uint64		cache_bypasses; /* number of rescans that skipped the cache
+								 * due to a low hit ratio */
 	uint64		mem_peak;		/* peak memory usage in bytes */
 } MemoizeInstrumentation;
 
@@ -2297,6 +2358,14 @@ typedef struct MemoizeState
 								 * complete after caching the first tuple. */
 	bool		binary_mode;	/* true when cache key should be compared bit
 								 * by bit, false when using hash equality ops */
+	uint8	   *freq_sketch;	/* count-min sketch of cache key frequencies */
+	uint32		freq_sketch_mask;	/* counters per sketch row, minus 1 */
+	uint64		freq_sketch_additions;	/* increments since the sketch's
+										 * counters were last halved */
+	uint64		window_lookups; /* cache lookups in current hit ratio window */
+	uint64		window_hits;	/* cache hits in current hit ratio window */
+	uint64		bypass_rescans; /* number of upcoming rescans to perform
+								 * without consulting the cache */
 	MemoizeInstrumentation stats;	/* execution statistics */
 	SharedMemoizeInfo *shared_info; /* statistics for parallel workers */
 	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
@@ -2431,6 +2500,7 @@ typedef struct AggregateInstrumentation
 	Size		hash_mem_peak;	/* peak hash table memory usage */
 	uint64		hash_disk_used; /* kB of disk space used */
 	int			hash_batches_used;	/* batches used during entire execution */
+	uint64		hash_bypass_tuples; /* input tuples passed through ungrouped */
 } AggregateInstrumentation;
 
 /* ----------------
@@ -2526,13 +2596,18 @@ typedef struct AggState
 										 * memory in all hash tables */
 	uint64		hash_disk_used; /* kB of disk space used */
 	int			hash_batches_used;	/* batches used during entire execution */
+	uint64		hash_input_tuples;	/* input tuples read by the initial fill */
+	bool		hash_bypass;	/* stopped grouping partial agg input? */
+	uint64		hash_bypass_tuples; /* input tuples passed through ungrouped */
+	AggStatePerGroup hash_bypass_pergroup;	/* transition states for the
+											 * tuple being passed through */
 
 	AggStatePerHash perhash;	/* array of per-hashtable data */
 	AggStatePerGroup *hash_pergroup;	/* grouping set indexed array of
 										 * per-group pointers */
 
 	/* support for evaluation of agg input expressions: */
-#define FIELDNO_AGGSTATE_ALL_PERGROUPS 53
+#define FIELDNO_AGGSTATE_ALL_PERGROUPS 57
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	SharedAggInfo *shared_info; /* one entry per worker */
@@ -2766,6 +2841,19 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/*
+	 * Range of the inner join key published for pruning the outer plan's
+	 * partitions, if the Hash plan has a pruneKey.
+	 */
+	ExprState  *prunekey;		/* ExprState for the key, or NULL */
+	SortSupport prunesortkey;	/* ordering of the key's values */
+	int16		prunetyplen;	/* type info for copying the key's values */
+	bool		prunetypbyval;
+	bool		prunehaverange; /* have we seen any non-null key? */
+	Datum		prunemin;		/* smallest key seen so far */
+	Datum		prunemax;		/* largest key seen so far */
+	Bitmapset  *pruneparams;	/* IDs of the params the range is stored in */
 } HashState;
 
 /* ----------------
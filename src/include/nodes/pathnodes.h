@@ -128,6 +128,12 @@ typedef struct PlannerGlobal
 	/* "flat" list of AppendRelInfos */
 	List	   *appendRelations;
 
+	/* PartitionPruneInfos with initial pruning steps */
+	List	   *partPruneInfos;
+
+	/* "flat" RT indexes of leaf partitions those might prune */
+	Bitmapset  *prunableRelids;
+
 	/* OIDs of relations the plan depends on */
 	List	   *relationOids;
 
@@ -744,6 +750,9 @@ typedef struct PartitionSchemeData *PartitionScheme;
  *					clauses at a single tuple (only used for base rels)
  *		baserestrict_min_security - Smallest security_level found among
  *					clauses in baserestrictinfo
+ *		feedback_key - fingerprint of baserestrictinfo, if a cardinality
+ *					feedback correction was looked up for the rel, else 0
+ *		feedback_rows - estimated rows before that correction was applied
  *		joininfo  - List of RestrictInfo nodes, containing info about each
  *					join clause in which this relation participates (but
  *					note this excludes clauses that might be derivable from
@@ -981,6 +990,10 @@ typedef struct RelOptInfo
 	QualCost	baserestrictcost;
 	/* min security_level found in baserestrictinfo */
 	Index		baserestrict_min_security;
+	/* cardinality feedback key of baserestrictinfo, or 0 */
+	uint64		feedback_key;
+	/* estimated rows before cardinality feedback */
+	Cardinality feedback_rows;
 	/* RestrictInfo structures for join clauses involving this rel */
 	List	   *joininfo;
 	/* T means joininfo is incomplete */
@@ -1198,6 +1211,8 @@ struct IndexOptInfo
 	bool		amhasgettuple;
 	/* does AM have amgetbitmap interface? */
 	bool		amhasgetbitmap;
+	/* does AM have amskip interface? */
+	bool		amcanskip;
 	bool		amcanparallel;
 	/* does AM have ammarkpos interface? */
 	bool		amcanmarkpos;
@@ -1705,6 +1720,9 @@ typedef struct Path
  * we need not recompute them when considering using the same index in a
  * bitmap index/heap scan (see BitmapHeapPath).  The costs of the IndexPath
  * itself represent the costs of an IndexScan or IndexOnlyScan plan type.
+ *
+ * 'indexskip' is true if the scan returns only the first tuple for each
+ * value of the index's leading column (see create_index_skip_path).
  *----------
  */
 typedef struct IndexPath
@@ -1717,6 +1735,7 @@ typedef struct IndexPath
 	ScanDirection indexscandir;
 	Cost		indextotalcost;
 	Selectivity indexselectivity;
+	bool		indexskip;
 } IndexPath;
 
 /*
@@ -65,6 +65,9 @@ typedef struct PlannedStmt
 
 	bool		parallelModeNeeded; /* parallel mode required to execute? */
 
+	bool		resultCacheable;	/* may the query result cache keep the
+									 * result? */
+
 	int			jitFlags;		/* which forms of JIT should be performed */
 
 	struct Plan *planTree;		/* tree of Plan nodes */
@@ -79,6 +82,17 @@ typedef struct PlannedStmt
 
 	List	   *appendRelations;	/* list of AppendRelInfo nodes */
 
+	/*
+	 * PartitionPruneInfos that have initial pruning steps depending only on
+	 * parameter values (these are also attached to their Append or
+	 * MergeAppend nodes), and the RT indexes of the leaf partitions they
+	 * might prune that nothing else in the plan opens unconditionally.  The
+	 * plan cache need not lock the latter until initial pruning has been
+	 * done.
+	 */
+	List	   *partPruneInfos;
+	Bitmapset  *prunableRelids;
+
 	List	   *subplans;		/* Plan trees for SubPlan expressions; note
 								 * that some could be NULL */
 
@@ -387,6 +401,10 @@ typedef struct Scan
 
 	Plan		plan;
 	Index		scanrelid;		/* relid is index into the range table */
+	/* cardinality feedback key of the scan's quals, or 0 if none */
+	uint64		feedback_key;
+	/* planner's row estimate before cardinality feedback */
+	Cardinality feedback_rows;
 } Scan;
 
 /* ----------------
@@ -444,6 +462,11 @@ typedef struct SampleScan
  *
  * indexorderdir specifies the scan ordering, for indexscans on amcanorder
  * indexes (for other indexes it should be "don't care").
+ *
+ * If indexskip is true, the scan skips to the next value of the index's
+ * leading column after returning each tuple (see index_skip).  The planner
+ * only asks for this when a Unique or Agg node above only needs the first
+ * tuple of each such group, and there are no filter quals.
  * ----------------
  */
 typedef struct IndexScan
@@ -456,6 +479,7 @@ typedef struct IndexScan
 	List	   *indexorderbyorig;	/* the same in original form */
 	List	   *indexorderbyops;	/* OIDs of sort ops for ORDER BY exprs */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* skip past each returned leading value? */
 } IndexScan;
 
 /* ----------------
@@ -498,6 +522,7 @@ typedef struct IndexOnlyScan
 	List	   *indexorderby;	/* list of index ORDER BY exprs */
 	List	   *indextlist;		/* TargetEntry list describing index's cols */
 	ScanDirection indexorderdir;	/* forward or backward or don't care */
+	bool		indexskip;		/* skip past each returned leading value? */
 } IndexOnlyScan;
 
 /* ----------------
@@ -808,6 +833,13 @@ typedef struct NestLoop
 {
 	Join		join;
 	List	   *nestParams;		/* list of NestLoopParam nodes */
+
+	/*
+	 * Hashable "outer = inner" join clauses, with which the executor may
+	 * hash the inner input if the outer turns out much larger than estimated
+	 * (see nodeNestloop.c); NIL if that must not be done.
+	 */
+	List	   *hashclauses;
 } NestLoop;
 
 typedef struct NestLoopParam
@@ -1206,6 +1238,18 @@ typedef struct Hash
 	Oid			skewTable;		/* outer join key's table OID, or InvalidOid */
 	AttrNumber	skewColumn;		/* outer join key's column #, or zero */
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
+
+	/*
+	 * If pruneKey isn't NULL, the smallest and largest non-null values of
+	 * this inner join key are stored in the given PARAM_EXEC params once the
+	 * hash table is built, for run-time pruning of the partitions of the
+	 * HashJoin's outer plan.
+	 */
+	Expr	   *pruneKey;		/* inner join key, or NULL */
+	Oid			pruneSortOp;	/* "<" operator ordering the key's values */
+	Oid			pruneCollation; /* collation of that ordering */
+	int			pruneParamMin;	/* ID of param holding the smallest key */
+	int			pruneParamMax;	/* ID of param holding the largest key */
 	/* all other info is in the parent HashJoin node */
 	Cardinality rows_total;		/* estimate total rows if parallel_aware */
 } Hash;
@@ -1470,6 +1514,9 @@ typedef struct PartitionedRelPruneInfo
 	/* relation OID by partition index, or 0 */
 	Oid		   *relid_map pg_node_attr(array_size(nparts));
 
+	/* RT index of leaf partition by partition index, or 0 */
+	int		   *leafpart_rti_map pg_node_attr(array_size(nparts));
+
 	/*
 	 * initial_pruning_steps shows how to prune during executor startup (i.e.,
 	 * without use of any PARAM_EXEC Params); it is NIL if no startup pruning
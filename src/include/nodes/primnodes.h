@@ -167,6 +167,7 @@ typedef struct IntoClause
 	char	   *tableSpaceName; /* table space to use, or NULL */
 	/* materialized view's SELECT query */
 	Node	   *viewQuery pg_node_attr(query_jumble_ignore);
+	bool		incremental;	/* true for INCREMENTAL MATERIALIZED VIEW */
 	bool		skipData;		/* true for WITH NO DATA */
 } IntoClause;
 
@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------
+ *
+ * cardfeedback.h
+ *	  Learned corrections to row estimates of base relation scans.
+ *
+ * See cardfeedback.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/optimizer/cardfeedback.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CARDFEEDBACK_H
+#define CARDFEEDBACK_H
+
+#include "executor/execdesc.h"
+#include "nodes/pathnodes.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool cardinality_feedback;
+extern PGDLLIMPORT int cardinality_feedback_max_entries;
+
+extern Size CardinalityFeedbackShmemSize(void);
+extern void CardinalityFeedbackShmemInit(void);
+extern void CheckPointCardinalityFeedback(void);
+
+extern double CardinalityFeedbackAdjust(PlannerInfo *root, RelOptInfo *rel,
+										double nrows);
+extern bool CardinalityFeedbackScan(Plan *plan);
+extern void CardinalityFeedbackRecord(QueryDesc *queryDesc);
+
+#endif							/* CARDFEEDBACK_H */
@@ -49,6 +49,9 @@ extern IndexPath *create_index_path(PlannerInfo *root,
 									Relids required_outer,
 									double loop_count,
 									bool partial_path);
+extern IndexPath *create_index_skip_path(PlannerInfo *root,
+										 IndexPath *subpath,
+										 double ngroups);
 extern BitmapHeapPath *create_bitmap_heap_path(PlannerInfo *root,
 											   RelOptInfo *rel,
 											   Path *bitmapqual,
@@ -112,6 +112,16 @@ extern void mark_dummy_rel(RelOptInfo *rel);
 extern void init_dummy_sjinfo(SpecialJoinInfo *sjinfo, Relids left_relids,
 							  Relids right_relids);
 
+/*
+ * joingraph.c
+ *	  join order search driven by the join graph
+ */
+extern PGDLLIMPORT bool enable_graph_join_search;
+extern PGDLLIMPORT int graph_join_search_limit;
+
+extern RelOptInfo *graph_join_search(PlannerInfo *root, int levels_needed,
+									 List *initial_rels);
+
 /*
  * equivclass.c
  *	  routines for managing EquivalenceClasses
@@ -34,6 +34,8 @@ extern RelOptInfo *query_planner(PlannerInfo *root,
  * prototypes for plan/planagg.c
  */
 extern void preprocess_minmax_aggregates(PlannerInfo *root);
+extern bool get_common_minmax_agg(PlannerInfo *root, Expr **target,
+								 Oid *sortop, Oid *inputcollid);
 
 /*
  * prototypes for plan/createplan.c
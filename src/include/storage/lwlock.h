@@ -215,6 +215,11 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_SUBTRANS_SLRU,
 	LWTRANCHE_XACT_SLRU,
 	LWTRANCHE_PARALLEL_VACUUM_DSA,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH,
+	LWTRANCHE_CARDINALITY_FEEDBACK,
+	LWTRANCHE_QUERY_RESULT_CACHE_DSA,
+	LWTRANCHE_QUERY_RESULT_CACHE_HASH,
 	LWTRANCHE_FIRST_USER_DEFINED,
 }			BuiltinTrancheIds;
 
@@ -403,6 +403,12 @@ extern void AlterSystemSetConfigFile(AlterSystemStmt *altersysstmt);
 extern char *GetConfigOptionByName(const char *name, const char **varname,
 								   bool missing_ok);
 
+/* bits for GetConfigFingerprint() */
+#define GUC_FINGERPRINT_SEMANTICS	0x0001	/* parsing, folding and I/O */
+#define GUC_FINGERPRINT_PLANNER		0x0002	/* plan choice */
+
+extern uint64 GetConfigFingerprint(int which);
+
 extern void TransformGUCArray(ArrayType *array, List **names,
 							  List **values);
 extern void ProcessGUCArray(ArrayType *array,
@@ -156,6 +156,9 @@ typedef struct PortalData
 	/* If not NULL, Executor is active; call ExecutorEnd eventually: */
 	QueryDesc  *queryDesc;		/* info needed for executor invocation */
 
+	/* If not NULL, the result may be stored in the query result cache: */
+	struct QueryResultCacheProbe *resultCacheProbe;
+
 	/* If portal returns tuples, this is their tupdesc: */
 	TupleDesc	tupDesc;		/* descriptor for result tuples */
 	/* and these are the format codes to use for the columns: */
@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * queryresultcache.h
+ *	  Cross-backend cache of query results.
+ *
+ * See queryresultcache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/queryresultcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef QUERYRESULTCACHE_H
+#define QUERYRESULTCACHE_H
+
+#include "tcop/dest.h"
+#include "utils/portal.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT int query_result_cache_size;
+extern PGDLLIMPORT bool query_result_cache;
+
+extern Size QueryResultCacheShmemSize(void);
+extern void QueryResultCacheShmemInit(void);
+
+extern bool QueryResultCacheStart(Portal portal);
+extern DestReceiver *QueryResultCacheCapture(Portal portal, bool forward,
+											 long count, DestReceiver *dest);
+extern void QueryResultCacheFinish(Portal portal);
+
+extern void QueryResultCacheNoteRelation(Oid relid);
+extern void QueryResultCacheNoteObject(int cacheId, uint32 hashValue);
+extern void QueryResultCacheNoteAll(void);
+extern void PreCommit_QueryResultCache(void);
+extern void AtEOXact_QueryResultCache(bool isCommit);
+
+#endif							/* QUERYRESULTCACHE_H */
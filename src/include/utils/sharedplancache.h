@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cross-backend cache of generic plans.
+ *
+ * See sharedplancache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "nodes/pg_list.h"
+#include "utils/plancache.h"
+
+/* GUC parameter */
+extern PGDLLIMPORT int shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+/* opaque: the versions a plan copied out of the cache depends on */
+typedef struct SharedPlanVersions SharedPlanVersions;
+
+extern bool SharedPlanCacheEligible(CachedPlanSource *plansource,
+									QueryEnvironment *queryEnv);
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource,
+								   SharedPlanVersions **versions);
+extern bool SharedPlanCacheIsCurrent(SharedPlanVersions *versions);
+extern uint64 SharedPlanCacheBeginPlanning(void);
+extern void SharedPlanCacheStore(CachedPlanSource *plansource,
+								 List *stmt_list, uint64 counter);
+
+extern void SharedPlanCacheNoteRelation(Oid relid);
+extern void SharedPlanCacheNoteObject(int cacheId, uint32 hashValue);
+extern void SharedPlanCacheNoteAll(void);
+extern void PreCommit_SharedPlanCache(void);
+extern void AtEOXact_SharedPlanCache(bool isCommit);
+
+#endif							/* SHAREDPLANCACHE_H */
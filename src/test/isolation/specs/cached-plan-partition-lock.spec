@@ -0,0 +1,47 @@
+# Verify that a generic plan only leaves partitions unlocked when initial
+# pruning is sure to remove them at execution, and that it is replanned when
+# a partition it does lock was changed meanwhile.
+
+setup
+{
+  CREATE TABLE cplock (a int, b int) PARTITION BY LIST (a);
+  CREATE TABLE cplock1 PARTITION OF cplock FOR VALUES IN (1);
+  CREATE TABLE cplock2 PARTITION OF cplock FOR VALUES IN (2);
+  INSERT INTO cplock VALUES (1, 10), (2, 20);
+  CREATE INDEX cplock2_b ON cplock2 (b);
+  CREATE FUNCTION cplock_one() RETURNS int STABLE LANGUAGE plpgsql
+    AS $$ BEGIN RETURN 1; END $$;
+}
+
+teardown
+{
+  DROP TABLE cplock;
+  DROP FUNCTION cplock_one();
+}
+
+session s1
+setup
+{
+  DEALLOCATE ALL;
+  SET plan_cache_mode = force_generic_plan;
+  SET enable_seqscan = off;
+}
+step s1prepq  { PREPARE q(int) AS SELECT * FROM cplock WHERE a = $1 AND b > 0; }
+step s1q1     { EXECUTE q(1); }
+step s1q2     { EXECUTE q(2); }
+step s1prepr  { PREPARE r AS SELECT * FROM cplock WHERE a = cplock_one() AND b > 0; }
+step s1r      { EXECUTE r; }
+
+session s2
+step s2begin  { BEGIN; }
+step s2drop   { DROP INDEX cplock2_b; }
+step s2commit { COMMIT; }
+
+# Pruning by a parameter value leaves the other partition unlocked, so
+# executing for partition 1 doesn't wait for the DROP INDEX on partition 2.
+# Executing for partition 2 does, and must not use the old plan's index scan.
+permutation s1prepq s1q1 s2begin s2drop s1q1 s1q2 s2commit
+
+# A stable function might return something else when the executor prunes,
+# so every partition is locked up front, and the plan is replanned.
+permutation s1prepr s1r s2begin s2drop s1r s2commit
@@ -316,6 +316,7 @@ dihandler(PG_FUNCTION_ARGS)
 	amroutine->amrescan = direscan;
 	amroutine->amgettuple = NULL;
 	amroutine->amgetbitmap = NULL;
+	amroutine->amskip = NULL;
 	amroutine->amendscan = diendscan;
 	amroutine->ammarkpos = NULL;
 	amroutine->amrestrpos = NULL;
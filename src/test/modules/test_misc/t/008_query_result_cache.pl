@@ -0,0 +1,173 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test the query result cache: when stored results are used, and that they
+# are not used once they might be outdated or not visible to the user.
+
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+# Autovacuum would outdate results at random moments
+$node->append_conf(
+	'postgresql.conf', qq(
+query_result_cache_size = 8MB
+query_result_cache = on
+autovacuum = off
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE qrc (a int, b text);
+INSERT INTO qrc SELECT g, 'row ' || g FROM generate_series(1, 10) g;
+CREATE SCHEMA qrc_other;
+CREATE ROLE qrc_reader;
+GRANT SELECT ON qrc TO qrc_reader;
+CREATE ROLE qrc_member;
+GRANT qrc_reader TO qrc_member;
+));
+
+my $query = 'SELECT count(*), sum(a) FROM qrc';
+
+# Return "hits|misses|invalidations" and reset the statistics
+sub cache_stats
+{
+	my $stats = $node->safe_psql('postgres',
+		'SELECT hits, misses, invalidations FROM pg_stat_query_result_cache'
+	);
+	$node->safe_psql('postgres', 'SELECT pg_stat_reset_query_result_cache()');
+	return $stats;
+}
+
+# Run the query in a new session, after the given commands if any
+sub run_query
+{
+	my $prefix = shift // '';
+
+	return $node->safe_psql('postgres', $prefix . $query);
+}
+
+cache_stats();
+
+# The first execution stores the result, the following ones use it
+is(run_query(), '10|55', 'first execution');
+is(run_query(), '10|55', 'second execution');
+is(run_query(), '10|55', 'third execution');
+is(cache_stats(), '2|1|0', 'result is stored once and then used');
+
+# Every kind of change outdates the stored result
+my @changes = (
+	[ 'INSERT', 'INSERT INTO qrc VALUES (11, \'row 11\')', '11|66' ],
+	[ 'UPDATE', 'UPDATE qrc SET a = a + 1 WHERE a = 11', '11|67' ],
+	[ 'DELETE', 'DELETE FROM qrc WHERE a = 12', '10|55' ],
+	[
+		'TRUNCATE',
+		'TRUNCATE qrc; INSERT INTO qrc SELECT g, \'row\' FROM generate_series(1, 5) g',
+		'5|15'
+	],
+	[ 'ALTER', 'ALTER TABLE qrc ADD COLUMN c int', '5|15' ]);
+foreach my $change (@changes)
+{
+	my ($name, $sql, $expected) = @$change;
+
+	$node->safe_psql('postgres', $sql);
+	is(run_query(), $expected, "result after $name");
+	is(run_query(), $expected, "result after $name, second execution");
+	is(cache_stats(), '1|1|1', "$name outdates the stored result");
+}
+
+# Rows inserted by parallel COPY workers outdate the result too
+my $copyfile = PostgreSQL::Test::Utils::tempdir() . '/qrc.data';
+open(my $fh, '>', $copyfile) or die "could not open \"$copyfile\": $!";
+print $fh "$_\trow $_\n" foreach (6 .. 2000);
+close($fh);
+$node->safe_psql('postgres',
+	"COPY qrc (a, b) FROM '$copyfile' WITH (PARALLEL 2)");
+is(run_query(), '2000|2001000', 'result after parallel COPY');
+is(cache_stats(), '0|1|1', 'parallel COPY outdates the stored result');
+
+# The same statement text as another role or with another search_path is a
+# different statement
+run_query();
+cache_stats();
+is(run_query('SET ROLE qrc_reader; '), '2000|2001000',
+	'result as another role');
+is(run_query('SET search_path = qrc_other, public; '),
+	'2000|2001000', 'result with another search_path');
+is(cache_stats(), '0|2|0', 'role and search_path are part of the key');
+
+# So are the settings that change how literals are read or how values are
+# converted to text
+my $tz_query =
+  "SELECT count(*) FROM qrc WHERE timestamptz '2024-01-01 00:00' - timestamptz '2024-01-01 00:00+00' > interval '1 hour'";
+is($node->safe_psql('postgres', "SET TimeZone = UTC; $tz_query"),
+	'0', 'literal read in UTC');
+is( $node->safe_psql(
+		'postgres', "SET TimeZone = 'Etc/GMT+5'; $tz_query"),
+	'2000',
+	'literal read in another time zone');
+my $ds_query = "SELECT count(*) FROM qrc WHERE a < date '01/02/2024' - date '2024-01-01'";
+is( $node->safe_psql(
+		'postgres', "SET DateStyle = 'ISO, MDY'; $ds_query"),
+	'0',
+	'literal read as month/day');
+is( $node->safe_psql(
+		'postgres', "SET DateStyle = 'ISO, DMY'; $ds_query"),
+	'30',
+	'literal read as day/month');
+my $bytea_query = 'SELECT b::bytea::text FROM qrc WHERE a = 6';
+is( $node->safe_psql(
+		'postgres', "SET bytea_output = hex; $bytea_query"),
+	'\\x726f772036',
+	'bytea output in hex');
+is( $node->safe_psql(
+		'postgres', "SET bytea_output = escape; $bytea_query"),
+	'row 6',
+	'bytea output escaped');
+is(cache_stats(), '0|6|0', 'settings are part of the key');
+
+# Privileges are checked again when a stored result is used
+is(run_query('SET ROLE qrc_member; '), '2000|2001000', 'result as member');
+is(run_query('SET ROLE qrc_member; '),
+	'2000|2001000', 'result as member, second execution');
+is(cache_stats(), '1|1|0', 'result as member is stored and used');
+$node->safe_psql('postgres', 'REVOKE qrc_reader FROM qrc_member');
+my ($ret, $stdout, $stderr) =
+  $node->psql('postgres', "SET ROLE qrc_member; $query");
+isnt($ret, 0, 'stored result is not returned without privileges');
+like(
+	$stderr,
+	qr/permission denied for table qrc/,
+	'privileges are checked on use');
+
+# Nothing is used or stored in REPEATABLE READ transactions, nor after the
+# transaction has written anything
+cache_stats();
+is( $node->safe_psql(
+		'postgres', qq(
+BEGIN ISOLATION LEVEL REPEATABLE READ;
+$query;
+COMMIT;
+)),
+	'2000|2001000',
+	'result in REPEATABLE READ');
+is( $node->safe_psql(
+		'postgres', qq(
+BEGIN;
+INSERT INTO qrc VALUES (2001, 'row 2001');
+$query;
+ROLLBACK;
+)),
+	'2001|2003001',
+	'result after a write in the same transaction');
+is(cache_stats(), '0|0|0', 'cache is bypassed in these transactions');
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,173 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test the shared plan cache: when plans made by other sessions are used,
+# and that they are not used once they might be outdated or were made with
+# different planner or parser settings.
+
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+# Autovacuum would change the statistics of the table at random moments
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_plan_cache_size = 8MB
+plan_cache_mode = force_generic_plan
+max_prepared_transactions = 2
+autovacuum = off
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE spc (a int, b text);
+INSERT INTO spc SELECT g, 'row ' || g FROM generate_series(1, 10000) g;
+CREATE INDEX spc_a ON spc (a);
+ANALYZE spc;
+CREATE ROLE spc_reader;
+GRANT SELECT ON spc TO spc_reader;
+));
+
+my $prepare = 'PREPARE s AS SELECT b FROM spc WHERE a = $1';
+
+# Prepare and run the statement in a new session, after the given commands
+# if any.  Returns the plan and whether this session planned the statement
+# itself: with log_planner_stats, the planner reports its resource usage
+# each time it runs.
+sub run_statement
+{
+	my $prefix = shift // '';
+
+	my ($ret, $stdout, $stderr) = $node->psql(
+		'postgres', qq(
+SET log_planner_stats = on;
+SET client_min_messages = log;
+$prefix
+$prepare;
+EXPLAIN (COSTS OFF) EXECUTE s(42);
+));
+	die "statement failed: $stderr" if $ret != 0;
+	$stdout =~ s/\n/ /g;
+
+	return ($stdout, $stderr =~ /PLANNER STATISTICS/ ? 'planned' : 'shared');
+}
+
+# The first session plans the statement, the following ones use its plan
+my ($plan, $source) = run_statement();
+like($plan, qr/Index Scan using spc_a/, 'first session uses the index');
+is($source, 'planned', 'first session plans the statement');
+($plan, $source) = run_statement();
+like($plan, qr/Index Scan using spc_a/, 'second session uses the index');
+is($source, 'shared', 'second session uses the shared plan');
+
+# Different planner settings mean a different plan
+($plan, $source) =
+  run_statement('SET enable_indexscan = off; SET enable_bitmapscan = off;');
+like($plan, qr/Seq Scan on spc/, 'plan without index scans');
+is($source, 'planned', 'planner settings are part of the key');
+($plan, $source) = run_statement('SET work_mem = 1234;');
+is($source, 'planned', 'work_mem is part of the key');
+($plan, $source) = run_statement('SET work_mem = 1234;');
+is($source, 'shared', 'plan with the same settings is shared');
+($plan, $source) = run_statement();
+like($plan, qr/Index Scan using spc_a/,
+	'plan with the original settings is still stored');
+is($source, 'shared', 'plan with the original settings is still shared');
+
+# Settings that parse analysis and constant folding read are part of the
+# key too, or a session would get a plan whose constants were interpreted
+# differently than its own settings say
+sub run_folded
+{
+	my ($setting, $query) = @_;
+
+	my ($ret, $stdout, $stderr) = $node->psql(
+		'postgres', qq(
+SET log_planner_stats = on;
+SET client_min_messages = log;
+SET $setting;
+PREPARE f AS $query;
+EXECUTE f;
+));
+	die "statement failed: $stderr" if $ret != 0;
+
+	return ($stdout, $stderr =~ /PLANNER STATISTICS/ ? 'planned' : 'shared');
+}
+
+my $tz_query =
+  "SELECT timestamptz '2024-01-01 00:00' - timestamptz '2024-01-01 00:00+00'";
+my $result;
+($result, $source) = run_folded('TimeZone = UTC', $tz_query);
+is($result, '00:00:00', 'literal read in UTC');
+($result, $source) = run_folded('TimeZone = UTC', $tz_query);
+is($source, 'shared', 'plan is shared with the same TimeZone');
+($result, $source) = run_folded("TimeZone = 'Etc/GMT+5'", $tz_query);
+is($result, '05:00:00', 'literal read in another time zone');
+is($source, 'planned', 'TimeZone is part of the key');
+
+my $ds_query = "SELECT date '01/02/2024' - date '2024-01-01'";
+($result, $source) = run_folded("DateStyle = 'ISO, MDY'", $ds_query);
+is($result, '1', 'literal read as month/day');
+($result, $source) = run_folded("DateStyle = 'ISO, DMY'", $ds_query);
+is($result, '31', 'literal read as day/month');
+is($source, 'planned', 'DateStyle is part of the key');
+
+# The same statement as another role is a different statement
+($plan, $source) = run_statement('SET ROLE spc_reader;');
+is($source, 'planned', 'current user is part of the key');
+
+# Uncommitted changes don't affect the shared plan, and a session that has
+# changed the catalogs doesn't share plans
+($plan, $source) = run_statement('BEGIN; DROP INDEX spc_a;');
+like($plan, qr/Seq Scan on spc/, 'plan after uncommitted DROP INDEX');
+is($source, 'planned', 'plan is not shared after uncommitted changes');
+($plan, $source) = run_statement();
+like($plan, qr/Index Scan using spc_a/,
+	'plan after the other transaction was rolled back');
+is($source, 'shared', 'rolled back changes leave the plan alone');
+
+# Committed changes to the objects the plan depends on outdate it
+$node->safe_psql('postgres', 'DROP INDEX spc_a');
+($plan, $source) = run_statement();
+like($plan, qr/Seq Scan on spc/, 'plan after DROP INDEX');
+is($source, 'planned', 'DROP INDEX outdates the shared plan');
+($plan, $source) = run_statement();
+is($source, 'shared', 'new plan is shared');
+
+$node->safe_psql('postgres', 'CREATE INDEX spc_a ON spc (a)');
+($plan, $source) = run_statement();
+like($plan, qr/Index Scan using spc_a/, 'plan after CREATE INDEX');
+is($source, 'planned', 'CREATE INDEX outdates the shared plan');
+
+$node->safe_psql('postgres', 'ALTER TABLE spc ALTER COLUMN b SET NOT NULL');
+($plan, $source) = run_statement();
+is($source, 'planned', 'ALTER TABLE outdates the shared plan');
+
+# Committing a prepared transaction outdates every shared plan
+run_statement();
+$node->safe_psql(
+	'postgres', qq(
+BEGIN;
+CREATE TABLE spc_other (a int);
+PREPARE TRANSACTION 'spc';
+));
+($plan, $source) = run_statement();
+is($source, 'shared', 'plan is shared while a transaction is prepared');
+$node->safe_psql('postgres', "COMMIT PREPARED 'spc'");
+($plan, $source) = run_statement();
+is($source, 'planned', 'COMMIT PREPARED outdates the shared plan');
+
+# Changes to other relations don't
+$node->safe_psql('postgres', 'ALTER TABLE spc_other ADD COLUMN b int');
+($plan, $source) = run_statement();
+is($source, 'shared', 'changes to other relations leave the plan alone');
+
+$node->stop;
+
+done_testing();
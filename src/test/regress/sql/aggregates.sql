@@ -1544,6 +1544,23 @@ create table agg_hash_4 as
 select (g/2)::numeric as c1, array_agg(g::numeric) as c2, count(*) as c3
   from agg_data_2k group by g/2;
 
+-- Parallel hash aggregation, where the partial aggregation steps fill up
+-- work_mem while finding few duplicates and so stop grouping their input
+
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+
+create table agg_hash_5 as
+select g%10000 as c1, sum(g::numeric) as c2, count(*) as c3
+  from agg_data_20k group by g%10000;
+
+reset max_parallel_workers_per_gather;
+reset min_parallel_table_scan_size;
+reset parallel_tuple_cost;
+reset parallel_setup_cost;
+
 set enable_sort = true;
 set work_mem to default;
 
@@ -1565,6 +1582,10 @@ set work_mem to default;
   union all
 (select * from agg_group_4 except select * from agg_hash_4);
 
+(select * from agg_hash_5 except select * from agg_group_1)
+  union all
+(select * from agg_group_1 except select * from agg_hash_5);
+
 drop table agg_group_1;
 drop table agg_group_2;
 drop table agg_group_3;
@@ -1573,3 +1594,98 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+drop table agg_hash_5;
+
+-- EXPLAIN ANALYZE reports the rows a partial aggregation passed through
+-- ungrouped.  Partitionwise aggregation gives partial aggregation steps
+-- without parallel workers, whose number would vary.
+create function explain_agg_bypass(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off, summary off) %s',
+            query)
+    loop
+        if ln ~ 'Aggregate|Rows Passed Through' then
+            return next regexp_replace(ln, '\d+', 'N', 'g');
+        end if;
+    end loop;
+end;
+$$;
+create table agg_bypass (a int, b int, c int) partition by range (a);
+create table agg_bypass_1 partition of agg_bypass for values from (0) to (10000);
+create table agg_bypass_2 partition of agg_bypass for values from (10000) to (20000);
+insert into agg_bypass select g, g, g % 10 from generate_series(0, 19999) g;
+-- make the planner expect few groups, so that it aggregates each partition
+alter table agg_bypass alter column b set (n_distinct_inherited = 20);
+alter table agg_bypass_1 alter column b set (n_distinct = 10);
+alter table agg_bypass_2 alter column b set (n_distinct = 10);
+analyze agg_bypass;
+set enable_partitionwise_aggregate = on;
+set enable_sort = off;
+set max_parallel_workers_per_gather = 0;
+set work_mem = '64kB';
+-- nearly every row starts a group of its own, so the partial steps give up
+select explain_agg_bypass('select b, count(*) from agg_bypass group by b');
+-- but not when the grouping is selective
+select explain_agg_bypass('select c, count(*) from agg_bypass group by c');
+reset work_mem;
+reset max_parallel_workers_per_gather;
+reset enable_sort;
+reset enable_partitionwise_aggregate;
+drop table agg_bypass;
+drop function explain_agg_bypass(text);
+
+--
+-- Test eager aggregation, ie partial aggregation below a join
+--
+create temp table eager_dim as
+  select g as id, 'name' || (g % 10) as name from generate_series(0, 999) g;
+analyze eager_dim;
+
+create function eager_agg_used(query text) returns bool
+language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in execute 'explain (costs off) ' || query
+  loop
+    if ln ~ 'Partial HashAggregate' then
+      return true;
+    end if;
+  end loop;
+  return false;
+end;
+$$;
+
+set enable_eager_aggregate = on;
+select eager_agg_used('select d.name, sum(f.unique1), count(*)
+  from tenk1 f join eager_dim d on f.thousand = d.id group by d.name');
+select d.name, sum(f.unique1), count(*)
+  from tenk1 f join eager_dim d on f.thousand = d.id
+  group by d.name order by d.name;
+
+-- an aggregate that uses both sides can't be computed below the join
+select eager_agg_used('select d.name, sum(f.unique1 + d.id)
+  from tenk1 f join eager_dim d on f.thousand = d.id group by d.name');
+
+-- grouping below the join would merge numerics that merely compare equal
+create temp table eager_num as
+  select case when g % 2 = 0 then (g % 5)::numeric
+         else round((g % 5)::numeric, 1) end as k
+  from generate_series(1, 1000) g;
+analyze eager_num;
+select eager_agg_used('select f.k::text, count(*), sum(f.k)
+  from eager_num f join eager_dim d on f.k = d.id group by f.k::text');
+select f.k::text as k, count(*), sum(f.k)
+  from eager_num f join eager_dim d on f.k = d.id
+  group by f.k::text order by 1;
+drop table eager_num;
+
+reset enable_eager_aggregate;
+drop function eager_agg_used(text);
+drop table eager_dim;
@@ -282,3 +282,65 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test skip scans, which visit each distinct value of the leading column
+-- when the quals only constrain later columns
+--
+CREATE TABLE btree_skip (a int, b int);
+INSERT INTO btree_skip SELECT a, b FROM generate_series(1, 4) a, generate_series(1, 2000) b;
+INSERT INTO btree_skip SELECT NULL, b FROM generate_series(1, 2000) b;
+CREATE INDEX btree_skip_idx ON btree_skip (a, b);
+VACUUM ANALYZE btree_skip;
+-- the few groups make skipping through the index cheapest
+EXPLAIN (COSTS OFF)
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a, b;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a, b;
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a DESC, b DESC;
+SELECT a, b FROM btree_skip WHERE b > 1998 ORDER BY a, b;
+SELECT count(*) FROM btree_skip WHERE b IS NULL;
+-- Merge join, with duplicates on both sides, so that the inner skip scan
+-- gets restored to a mark
+SET enable_hashjoin = off;
+SET enable_nestloop = off;
+SET enable_material = off;
+SELECT count(*), sum(s1.b + s2.b)
+  FROM btree_skip s1 JOIN btree_skip s2 ON s1.a = s2.a
+  WHERE s1.b < 3 AND s2.b BETWEEN 5 AND 7;
+RESET enable_hashjoin;
+RESET enable_nestloop;
+RESET enable_material;
+-- Scrolling back and forth through a skip scan
+BEGIN;
+DECLARE c SCROLL CURSOR FOR
+  SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a, b;
+FETCH 2 FROM c;
+FETCH BACKWARD 1 FROM c;
+FETCH LAST FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH NEXT FROM c;
+COMMIT;
+RESET enable_bitmapscan;
+SET enable_indexscan = off;
+SELECT count(*) FROM btree_skip WHERE b < 3;
+RESET enable_indexscan;
+SET enable_bitmapscan = off;
+-- Same again with a descending index and NULLs last
+DROP INDEX btree_skip_idx;
+CREATE INDEX btree_skip_idx ON btree_skip (a DESC NULLS LAST, b);
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a, b;
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a DESC, b DESC;
+SELECT a, b FROM btree_skip WHERE b > 1998 ORDER BY a, b;
+-- Many small groups: the scan gives up skipping and reads the rest
+CREATE TABLE btree_skip_small AS
+  SELECT i AS a, i % 10 AS b FROM generate_series(1, 10000) i;
+CREATE INDEX btree_skip_small_idx ON btree_skip_small (a, b);
+VACUUM ANALYZE btree_skip_small;
+SELECT count(*), sum(a) FROM btree_skip_small WHERE b = 3;
+SELECT a FROM btree_skip_small WHERE b = 3 ORDER BY a DESC LIMIT 3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_skip;
+DROP TABLE btree_skip_small;
@@ -856,6 +856,21 @@ RESET enable_partitionwise_aggregate;
 RESET max_parallel_workers_per_gather;
 RESET enable_incremental_sort;
 
+-- eager aggregation mustn't group by a nondeterministic collation below
+-- the join
+CREATE TABLE eager_ci (x text COLLATE case_insensitive, y int);
+INSERT INTO eager_ci
+  SELECT CASE WHEN g % 2 = 0 THEN 'abc' ELSE 'ABC' END, g
+  FROM generate_series(1, 100) g;
+CREATE TABLE eager_ci_dim (x text COLLATE case_insensitive);
+INSERT INTO eager_ci_dim VALUES ('abc');
+ANALYZE eager_ci, eager_ci_dim;
+SET enable_eager_aggregate TO on;
+SELECT f.x COLLATE "C", sum(f.y) FROM eager_ci f JOIN eager_ci_dim d ON f.x = d.x
+  GROUP BY f.x COLLATE "C" ORDER BY 1;
+RESET enable_eager_aggregate;
+DROP TABLE eager_ci, eager_ci_dim;
+
 -- cleanup
 RESET search_path;
 SET client_min_messages TO warning;
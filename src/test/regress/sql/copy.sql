@@ -320,3 +320,29 @@ COPY parted_si(id, data) FROM :'filename';
 SELECT tableoid::regclass, id % 2 = 0 is_even, count(*) from parted_si GROUP BY 1, 2 ORDER BY 1;
 
 DROP TABLE parted_si;
+
+-- Arrow IPC stream format: a schema message, the batches, and an
+-- end-of-stream marker
+CREATE TABLE copy_arrow (a int, b text);
+INSERT INTO copy_arrow VALUES (1, 'one'), (2, NULL), (3, 'one');
+\set filename :abs_builddir '/results/copy_arrow.arrow'
+COPY copy_arrow TO :'filename' (FORMAT arrow);
+SELECT length(f), substr(f, 1, 4) AS marker, substr(f, length(f) - 7) AS eos
+  FROM pg_read_binary_file(:'filename') AS f;
+-- the values are in the batch buffers, converted to the Unix epoch where
+-- needed: 32-bit integers, the dictionary of b, 64-bit integers, timestamps
+-- and dates, all little-endian
+SELECT position('\x010000000200000003000000'::bytea IN f) > 0 AS a_values,
+       position('\x00000000030000006f6e65'::bytea IN f) > 0 AS b_dictionary
+  FROM pg_read_binary_file(:'filename') AS f;
+COPY (SELECT * FROM (VALUES (1::int8, timestamp '1970-01-01 00:00:01', date '1970-01-02'),
+                            (-1, timestamp '2000-01-01', date '2000-01-01')) v)
+  TO :'filename' (FORMAT arrow);
+SELECT position('\x0100000000000000ffffffffffffffff'::bytea IN f) > 0 AS int8_values,
+       position('\x40420f000000000000e0373b015d0300'::bytea IN f) > 0 AS timestamps,
+       position('\x01000000cd2a0000'::bytea IN f) > 0 AS dates
+  FROM pg_read_binary_file(:'filename') AS f;
+-- timestamps in the last days of the range don't fit in 64 bits of
+-- microseconds since the Unix epoch
+COPY (SELECT timestamp '294276-12-31 23:59:59') TO :'filename' (FORMAT arrow);
+DROP TABLE copy_arrow;
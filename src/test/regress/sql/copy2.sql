@@ -68,6 +68,7 @@ COPY x from stdin (convert_selectively (a), convert_selectively (b));
 COPY x from stdin (encoding 'sql_ascii', encoding 'sql_ascii');
 COPY x from stdin (on_error ignore, on_error ignore);
 COPY x from stdin (log_verbosity default, log_verbosity verbose);
+COPY x from stdin (parallel 1, parallel 2);
 
 -- incorrect options
 COPY x from stdin (format BINARY, delimiter ',');
@@ -88,6 +89,12 @@ COPY x to stdout (format CSV, force_null(a));
 COPY x to stdout (format CSV, force_null *);
 COPY x to stdout (format BINARY, on_error unsupported);
 COPY x from stdin (log_verbosity unsupported);
+COPY x from stdin (format BINARY, parallel 2);
+COPY x to stdout (parallel 2);
+COPY x from stdin (parallel -1);
+COPY x from stdin (format ARROW);
+COPY x to stdout (format ARROW, delimiter ',');
+COPY x to stdout (format ARROW, encoding 'LATIN1');
 
 -- too many columns in column list: should fail
 COPY x (a, b, c, d, e, d, c) from stdin;
@@ -682,3 +689,49 @@ truncate copy_default;
 
 -- DEFAULT cannot be used in COPY TO
 copy (select 1 as test) TO stdout with (default '\D');
+
+-- PARALLEL option; the results don't depend on whether workers were used
+create table copy_parallel (a int primary key, b text, c int check (c >= 0));
+copy copy_parallel from stdin with (format csv, header, parallel 2);
+a,b,c
+1,one,10
+2,"two
+lines",20
+3,three,30
+\.
+copy copy_parallel from stdin with (on_error ignore, parallel 2);
+4	four	40
+x	bad	50
+6	six	60
+\.
+select a, length(b), c from copy_parallel order by a;
+drop table copy_parallel;
+
+-- Lines longer than a SIMD vector, with quoted newlines, doubled quotes and
+-- escapes falling across vector boundaries
+create temp table copy_wide (a int, b text, c int);
+copy copy_wide from stdin with (format csv);
+1,"aaaaaaaaaaaaa""bbbbbbbbbbbbbb
+ccccccccccccccc""d",2
+2,"eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee",3
+3,gggggggggggggggggggggggggggggggggggggggggggg,4
+\.
+-- line numbers must count the quoted newlines (should fail on line 5)
+copy copy_wide from stdin with (format csv);
+4,"hhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhh
+hhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhh
+hhhh",5
+5,iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiii,6
+6,jjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjjj,x
+\.
+copy copy_wide from stdin with (format csv, escape '\');
+7,"kkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkkk\"ll\\mm
+nnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnnn\"",8
+\.
+copy copy_wide from stdin;
+9	oooooooooooooooooooooooooooooooooooooooo\tpp\\qq\nrr\101	10
+10	ssssssssssssssssssssssssssssssssssssssss	\N
+\.
+select a, replace(replace(b, E'\n', '<nl>'), E'\t', '<tab>') as b, c
+  from copy_wide order by a;
+drop table copy_wide;
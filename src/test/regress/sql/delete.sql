@@ -23,3 +23,12 @@ DELETE FROM delete_test WHERE a > 25;
 SELECT id, a, char_length(b) FROM delete_test;
 
 DROP TABLE delete_test;
+
+-- delete many rows from the same pages
+CREATE TABLE delete_many (a int, b text);
+INSERT INTO delete_many SELECT g, repeat('x', 100) FROM generate_series(1, 1000) g;
+DELETE FROM delete_many WHERE a % 3 <> 0;
+SELECT count(*), min(a), max(a) FROM delete_many;
+DELETE FROM delete_many;
+SELECT count(*) FROM delete_many;
+DROP TABLE delete_many;
@@ -2155,3 +2155,32 @@ SET client_min_messages TO warning;
 DROP SCHEMA fkpart12 CASCADE;
 RESET client_min_messages;
 RESET search_path;
+
+-- Foreign key checks that probe the referenced index directly, with index
+-- columns in a different order than the foreign key's and a cross-type key
+CREATE TABLE fkpath_pk (a int, b text, PRIMARY KEY (a, b));
+INSERT INTO fkpath_pk VALUES (1, 'x'), (2, 'y');
+CREATE TABLE fkpath_fk (b text, a bigint,
+  FOREIGN KEY (b, a) REFERENCES fkpath_pk (b, a));
+INSERT INTO fkpath_fk SELECT 'x', 1 FROM generate_series(1, 3);
+INSERT INTO fkpath_fk VALUES ('x', 1), ('y', 2), ('y', 1); -- should fail
+-- a key checked earlier in the transaction must be checked again
+BEGIN;
+INSERT INTO fkpath_fk VALUES ('y', 2);
+DELETE FROM fkpath_fk WHERE a = 2;
+DELETE FROM fkpath_pk WHERE a = 2;
+INSERT INTO fkpath_fk VALUES ('y', 2); -- should fail
+ROLLBACK;
+SELECT * FROM fkpath_fk;
+-- nor may a key checked by an earlier transaction be trusted
+INSERT INTO fkpath_fk VALUES ('y', 2);
+DELETE FROM fkpath_fk WHERE a = 2;
+DELETE FROM fkpath_pk WHERE a = 2;
+INSERT INTO fkpath_fk VALUES ('y', 2); -- should fail
+-- the checked keys are only remembered until the end of the transaction
+BEGIN;
+INSERT INTO fkpath_fk VALUES ('x', 1);
+SELECT count(*) FROM pg_backend_memory_contexts WHERE name = 'RI last check';
+COMMIT;
+SELECT count(*) FROM pg_backend_memory_contexts WHERE name = 'RI last check';
+DROP TABLE fkpath_fk, fkpath_pk;
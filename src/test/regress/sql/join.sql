@@ -378,6 +378,7 @@ select count(*) from tenk1 x where
 
 -- try that with GEQO too
 begin;
+set graph_join_search = off;
 set geqo = on;
 set geqo_threshold = 2;
 select count(*) from tenk1 x where
@@ -386,6 +387,20 @@ select count(*) from tenk1 x where
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
 rollback;
 
+-- and with the join graph search, both exhaustive and greedy
+begin;
+set geqo_threshold = 2;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+set graph_join_search_limit = 0;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+rollback;
+
 --
 -- regression test: be sure we cope with proven-dummy append rels
 --
@@ -2965,3 +2980,30 @@ SELECT 1 FROM group_tbl t1
 GROUP BY s.c1, s.c2;
 
 DROP TABLE group_tbl;
+
+--
+-- Test nestloops switching to hashing their inner side at run time
+--
+CREATE FUNCTION nlhash_rows(n int) RETURNS SETOF int LANGUAGE plpgsql ROWS 1
+AS $$ BEGIN RETURN QUERY SELECT generate_series(1, n); END $$;
+CREATE TABLE nlhash_inner (a int, b int);
+INSERT INTO nlhash_inner SELECT g, g * 10 FROM generate_series(0, 99) g;
+ANALYZE nlhash_inner;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+
+EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+SELECT count(*) FROM nlhash_rows(3000) o(x)
+  LEFT JOIN nlhash_inner i ON i.a = o.x % 100;
+
+-- duplicate and null inner keys
+INSERT INTO nlhash_inner VALUES (5, 1), (NULL, 2);
+SELECT count(*), sum(i.b) FROM nlhash_rows(3000) o(x)
+  LEFT JOIN nlhash_inner i ON i.a = o.x % 100;
+SELECT count(*) FROM nlhash_rows(3000) o(x)
+  WHERE NOT EXISTS (SELECT 1 FROM nlhash_inner i WHERE i.a = o.x % 200);
+
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+DROP TABLE nlhash_inner;
+DROP FUNCTION nlhash_rows(int);
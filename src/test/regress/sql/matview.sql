@@ -314,3 +314,113 @@ EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)
   CREATE MATERIALIZED VIEW IF NOT EXISTS matview_ine_tab AS
     SELECT 1 / 0 WITH NO DATA; -- ok
 DROP MATERIALIZED VIEW matview_ine_tab;
+
+-- incrementally maintained materialized views
+CREATE TABLE mvi_t (a int, b int, c numeric);
+CREATE TABLE mvi_u (a int, d text);
+INSERT INTO mvi_t VALUES (1, 10, 1.5), (1, 20, 2.5), (2, 30, NULL), (3, NULL, 4);
+INSERT INTO mvi_u VALUES (1, 'one'), (2, 'two'), (2, 'deux');
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_agg AS
+  SELECT a, count(*) AS n, count(b) AS nb, sum(b) AS sb, avg(c) AS ac,
+         min(b) AS lo, max(b) AS hi
+  FROM mvi_t GROUP BY a;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_join AS
+  SELECT t.a, t.b, u.d FROM mvi_t t JOIN mvi_u u ON t.a = u.a;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_total AS
+  SELECT sum(b) AS sb, max(c) AS hc FROM mvi_t;
+SELECT relname, relisivm FROM pg_class
+  WHERE relname LIKE 'mvi\_%' AND relkind = 'm' ORDER BY relname;
+SELECT attname FROM pg_attribute
+  WHERE attrelid = 'mvi_agg'::regclass AND attnum > 0 ORDER BY attnum;
+SELECT indexrelid::regclass FROM pg_index WHERE indrelid = 'mvi_agg'::regclass;
+SELECT count(*) FROM pg_class WHERE relname LIKE 'pg\_ivm\_log\_%';
+CREATE VIEW mvi_agg_v AS
+  SELECT a, count(*) AS n, count(b) AS nb, sum(b) AS sb, avg(c) AS ac,
+         min(b) AS lo, max(b) AS hi
+  FROM mvi_t GROUP BY a;
+CREATE VIEW mvi_join_v AS
+  SELECT t.a, t.b, u.d FROM mvi_t t JOIN mvi_u u ON t.a = u.a;
+CREATE VIEW mvi_total_v AS
+  SELECT sum(b) AS sb, max(c) AS hc FROM mvi_t;
+SELECT a, n, nb, sb, round(ac, 2) AS ac, lo, hi FROM mvi_agg ORDER BY a;
+-- changes are applied only by REFRESH
+INSERT INTO mvi_t VALUES (1, 5, 0.5), (4, 40, 4), (2, 31, 7);
+UPDATE mvi_t SET b = b + 1 WHERE a = 1;
+DELETE FROM mvi_t WHERE a = 3;
+UPDATE mvi_t SET c = c WHERE a = 2;
+INSERT INTO mvi_u VALUES (4, 'four');
+DELETE FROM mvi_u WHERE d = 'deux';
+SELECT a, n, nb, sb, round(ac, 2) AS ac, lo, hi FROM mvi_agg ORDER BY a;
+REFRESH MATERIALIZED VIEW mvi_agg;
+REFRESH MATERIALIZED VIEW mvi_join;
+REFRESH MATERIALIZED VIEW mvi_total;
+SELECT a, n, nb, sb, round(ac, 2) AS ac, lo, hi FROM mvi_agg ORDER BY a;
+SELECT * FROM mvi_join ORDER BY a, b, d;
+SELECT sb, hc FROM mvi_total;
+SELECT count(*) FROM
+  ((SELECT a, n, nb, sb, ac, lo, hi FROM mvi_agg EXCEPT ALL TABLE mvi_agg_v)
+   UNION ALL
+   (TABLE mvi_agg_v EXCEPT ALL SELECT a, n, nb, sb, ac, lo, hi FROM mvi_agg)) x;
+SELECT count(*) FROM
+  ((TABLE mvi_join EXCEPT ALL TABLE mvi_join_v)
+   UNION ALL
+   (TABLE mvi_join_v EXCEPT ALL TABLE mvi_join)) x;
+SELECT count(*) FROM
+  ((SELECT sb, hc FROM mvi_total EXCEPT ALL TABLE mvi_total_v)
+   UNION ALL
+   (TABLE mvi_total_v EXCEPT ALL SELECT sb, hc FROM mvi_total)) x;
+-- TRUNCATE makes the next refresh recompute the view
+TRUNCATE mvi_u;
+INSERT INTO mvi_u VALUES (1, 'uno'), (4, 'vier');
+REFRESH MATERIALIZED VIEW mvi_join;
+SELECT * FROM mvi_join ORDER BY a, b, d;
+SELECT count(*) FROM
+  ((TABLE mvi_join EXCEPT ALL TABLE mvi_join_v)
+   UNION ALL
+   (TABLE mvi_join_v EXCEPT ALL TABLE mvi_join)) x;
+-- emptied groups go away, and min and max are recomputed
+DELETE FROM mvi_t WHERE b > 20;
+REFRESH MATERIALIZED VIEW mvi_agg;
+REFRESH MATERIALIZED VIEW mvi_total;
+SELECT a, n, nb, sb, round(ac, 2) AS ac, lo, hi FROM mvi_agg ORDER BY a;
+SELECT sb, hc FROM mvi_total;
+SELECT count(*) FROM
+  ((SELECT a, n, nb, sb, ac, lo, hi FROM mvi_agg EXCEPT ALL TABLE mvi_agg_v)
+   UNION ALL
+   (TABLE mvi_agg_v EXCEPT ALL SELECT a, n, nb, sb, ac, lo, hi FROM mvi_agg)) x;
+SELECT count(*) FROM
+  ((SELECT sb, hc FROM mvi_total EXCEPT ALL TABLE mvi_total_v)
+   UNION ALL
+   (TABLE mvi_total_v EXCEPT ALL SELECT sb, hc FROM mvi_total)) x;
+DELETE FROM mvi_t;
+REFRESH MATERIALIZED VIEW mvi_agg;
+REFRESH MATERIALIZED VIEW mvi_total;
+SELECT count(*) FROM mvi_agg;
+SELECT * FROM mvi_total;
+BEGIN ISOLATION LEVEL REPEATABLE READ;
+REFRESH MATERIALIZED VIEW mvi_agg; -- error
+ROLLBACK;
+-- the logging trigger function is only for the internal triggers
+SELECT has_function_privilege('public', 'incremental_matview_log()', 'EXECUTE');
+CREATE TABLE mvi_fake (a int);
+CREATE TRIGGER mvi_fake_trig AFTER INSERT ON mvi_fake
+  FOR EACH STATEMENT EXECUTE FUNCTION incremental_matview_log('1', '2');
+INSERT INTO mvi_fake VALUES (1); -- error
+DROP TABLE mvi_fake;
+-- unsupported queries
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_err AS
+  SELECT DISTINCT a FROM mvi_t;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_err AS
+  SELECT t.a FROM mvi_t t LEFT JOIN mvi_u u ON t.a = u.a;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_err AS
+  SELECT a, string_agg(d, ',') FROM mvi_u GROUP BY a;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_err AS
+  SELECT t1.a FROM mvi_t t1 JOIN mvi_t t2 ON t1.a = t2.b;
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_err (__ivm_x) AS
+  SELECT a FROM mvi_t;
+EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)
+  CREATE INCREMENTAL MATERIALIZED VIEW mvi_err AS SELECT a FROM mvi_t;
+DROP VIEW mvi_agg_v, mvi_join_v, mvi_total_v;
+DROP MATERIALIZED VIEW mvi_agg, mvi_join, mvi_total;
+SELECT count(*) FROM pg_class WHERE relname LIKE 'pg\_ivm\_log\_%';
+DROP TABLE mvi_t, mvi_u;
@@ -781,6 +781,93 @@ order by tbl1.col1, tprt.col1;
 
 drop table tbl1, tprt;
 
+-- Hash join whose inner join keys prune the partitions of its outer side
+create table hjp (a int, b int) partition by range (a);
+create table hjp_p1 partition of hjp for values from (0) to (10);
+create table hjp_p2 partition of hjp for values from (10) to (20);
+create table hjp_p3 partition of hjp for values from (20) to (30);
+insert into hjp select i % 30, i from generate_series(1, 300) i;
+create table hjp_dim (k int, tag text);
+insert into hjp_dim values (12, 'x'), (15, 'y'), (40, 'z');
+analyze hjp, hjp_dim;
+
+create function explain_hashjoin_prune(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            $1)
+    loop
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+set enable_hashjoin = on;
+set enable_nestloop = off;
+
+-- Only hjp_p2 can contain the keys 12 and 15
+select explain_hashjoin_prune('
+select hjp.* from hjp join hjp_dim on hjp.a = hjp_dim.k where hjp_dim.tag <> ''z''');
+
+select hjp.a, count(*) from hjp join hjp_dim on hjp.a = hjp_dim.k
+where hjp_dim.tag <> 'z' group by hjp.a order by hjp.a;
+
+-- Right joins prune the same way
+select explain_hashjoin_prune('
+select hjp.a, hjp_dim.k from hjp right join hjp_dim on hjp.a = hjp_dim.k
+where hjp_dim.tag <> ''z''');
+
+-- Each rebuild of the hash table prunes again: for the key 40 no partition
+-- is left
+select explain_hashjoin_prune('
+select v.t, (select count(*) from hjp join hjp_dim on hjp.a = hjp_dim.k
+             where hjp_dim.tag = v.t)
+from (values (''x''), (''z'')) v(t)');
+
+select v.t, (select count(*) from hjp join hjp_dim on hjp.a = hjp_dim.k
+             where hjp_dim.tag = v.t)
+from (values ('x'), ('z')) v(t);
+
+-- MergeAppend on the outer side
+create index on hjp (a);
+set enable_sort = off;
+select explain_hashjoin_prune('
+select hjp.a, hjp.b from hjp join hjp_dim on hjp.a = hjp_dim.k
+where hjp_dim.tag <> ''z'' order by hjp.a');
+reset enable_sort;
+drop index hjp_a_idx;
+
+-- Under Parallel Hash, the participants merge their ranges, so that each
+-- of them prunes the Parallel Append the same way
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+select regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N') as explain_parallel_append
+from explain_parallel_append('
+select hjp.* from hjp join hjp_dim on hjp.a = hjp_dim.k where hjp_dim.tag <> ''z''') ln;
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+
+-- When the hash table holds only NULL keys, the range is NULL and every
+-- partition is pruned
+insert into hjp_dim values (null, 'n');
+select explain_hashjoin_prune('
+select hjp.a, hjp_dim.k from hjp right join hjp_dim on hjp.a = hjp_dim.k
+where hjp_dim.k is null');
+
+reset enable_nestloop;
+set enable_hashjoin = off;
+drop table hjp, hjp_dim;
+drop function explain_hashjoin_prune(text);
+
 -- Test with columns defined in varying orders between each level
 create table part_abc (a int not null, b int not null, c int not null) partition by list (a);
 create table part_bac (b int not null, a int not null, c int not null) partition by list (b);
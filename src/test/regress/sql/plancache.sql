@@ -223,3 +223,35 @@ select name, generic_plans, custom_plans from pg_prepared_statements
   where  name = 'test_mode_pp';
 
 drop table test_mode;
+
+-- Generic plans lock only the partitions that survive initial pruning
+create table prunelock (a int) partition by list (a);
+create table prunelock1 partition of prunelock for values in (1);
+create table prunelock2 partition of prunelock for values in (2);
+create table prunelock3 partition of prunelock for values in (3);
+insert into prunelock values (1), (2), (3);
+set plan_cache_mode to force_generic_plan;
+prepare prunelock_q (int) as select * from prunelock where a = $1;
+execute prunelock_q(1);
+begin;
+execute prunelock_q(2);
+select relation::regclass::text as rel, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'prunelock%'
+  order by 1;
+commit;
+-- a partition added since planning invalidates the plan, and pruning
+-- then works against the new plan
+create table prunelock4 partition of prunelock for values in (4);
+insert into prunelock values (4);
+execute prunelock_q(4);
+begin;
+execute prunelock_q(3);
+select relation::regclass::text as rel, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'prunelock%'
+  order by 1;
+commit;
+deallocate prunelock_q;
+reset plan_cache_mode;
+drop table prunelock;
@@ -193,6 +193,53 @@ RESET max_parallel_workers_per_gather;
 RESET min_parallel_table_scan_size;
 RESET parallel_setup_cost;
 
+--
+-- Test skipping through an index to each distinct value of its leading
+-- column
+--
+CREATE TABLE distinct_skip (a int, b int);
+INSERT INTO distinct_skip
+  SELECT i % 10, CASE WHEN i % 7 = 0 THEN NULL ELSE i END
+  FROM generate_series(1, 10000) i;
+INSERT INTO distinct_skip VALUES (NULL, 1), (NULL, NULL);
+CREATE INDEX distinct_skip_a_b_idx ON distinct_skip (a, b);
+VACUUM ANALYZE distinct_skip;
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM distinct_skip ORDER BY a;
+SELECT DISTINCT a FROM distinct_skip ORDER BY a;
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT ON (a) a, b FROM distinct_skip ORDER BY a, b;
+SELECT DISTINCT ON (a) a, b FROM distinct_skip ORDER BY a, b;
+
+-- MIN() over the second index column can use the first row of each group
+EXPLAIN (COSTS OFF)
+SELECT a, min(b) FROM distinct_skip WHERE b > 100 GROUP BY a ORDER BY a;
+SELECT a, min(b) FROM distinct_skip WHERE b > 100 GROUP BY a ORDER BY a;
+
+-- No skipping where btree would decline to at execution time: with
+-- array keys, or when the leading column isn't stored as the opclass's
+-- input type
+SET enable_seqscan = off;
+SET enable_hashagg = off;
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM distinct_skip WHERE a = ANY ('{1,2,3}') ORDER BY a;
+SELECT DISTINCT a FROM distinct_skip WHERE a = ANY ('{1,2,3}') ORDER BY a;
+CREATE TABLE distinct_skip_name (n name);
+INSERT INTO distinct_skip_name
+  SELECT 'n' || (i % 10) FROM generate_series(1, 10000) i;
+CREATE INDEX distinct_skip_name_n_idx ON distinct_skip_name (n);
+VACUUM ANALYZE distinct_skip_name;
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT n FROM distinct_skip_name ORDER BY n;
+SELECT DISTINCT n FROM distinct_skip_name ORDER BY n;
+RESET enable_seqscan;
+RESET enable_hashagg;
+DROP TABLE distinct_skip_name;
+
+DROP TABLE distinct_skip;
+
 --
 -- Also, some tests of IS DISTINCT FROM, which doesn't quite deserve its
 -- very own regression file.
@@ -78,6 +78,39 @@ select count(*) from tenk1 where stringu1 = 'GRAAAA';
 reset max_parallel_workers;
 reset parallel_leader_participation;
 
+-- tuples are sent from the workers to the leader in batches; make sure wide
+-- rows arrive intact, also when the leader stops reading part-way through
+set parallel_leader_participation = off;
+select count(*), sum(sp_parallel_restricted(length(w))),
+       count(*) filter (where w <> repeat(stringu1::text, unique1 % 300))
+  from (select unique1, stringu1, repeat(stringu1::text, unique1 % 300) as w
+        from tenk1 offset 0) ss;
+select count(*), sum(sp_parallel_restricted(length(w)))
+  from (select repeat(stringu1::text, 200) as w from tenk1 limit 2000) ss;
+reset parallel_leader_participation;
+
+-- a worker doesn't hold back the tuples it has found while it keeps on
+-- scanning: here the leader receives the first three rows long before the
+-- worker produces the last one
+create table sp_slow_scan as select g as a from generate_series(1, 50) g;
+create function sp_slow_match(int) returns bool as
+  $$begin
+    if $1 in (1, 2, 3, 50) then return true; end if;
+    perform pg_sleep(0.01);
+    return false;
+  end$$ language plpgsql parallel safe;
+set parallel_leader_participation = off;
+set max_parallel_workers_per_gather = 1;
+with r as materialized (
+  select a, clock_timestamp() as produced from sp_slow_scan
+  where sp_slow_match(a)),
+s as materialized (
+  select a, produced, clock_timestamp() as received from r)
+select a, received < max(produced) over () as before_scan_end
+  from s order by a;
+reset max_parallel_workers_per_gather;
+reset parallel_leader_participation;
+
 -- test that parallel_restricted function doesn't run in worker
 alter table tenk1 set (parallel_workers = 4);
 explain (verbose, costs off)
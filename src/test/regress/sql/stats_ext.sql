@@ -1547,6 +1547,58 @@ SELECT c0 FROM ONLY expr_stats_incompatible_test WHERE
 
 DROP TABLE expr_stats_incompatible_test;
 
+-- join estimates using multi-column statistics on both sides
+CREATE TABLE join_stats_1 (a INT, b INT, c INT) WITH (autovacuum_enabled = off);
+CREATE TABLE join_stats_2 (a INT, b INT, c INT) WITH (autovacuum_enabled = off);
+
+INSERT INTO join_stats_1 SELECT mod(i, 100), mod(i, 100), i FROM generate_series(1, 3000) s(i);
+INSERT INTO join_stats_2 SELECT mod(i, 100), mod(i, 100), i FROM generate_series(1, 3000) s(i);
+
+ANALYZE join_stats_1, join_stats_2;
+
+-- without extended statistics, the join columns are assumed independent
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 j1 JOIN join_stats_2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+-- MCV lists on the join columns of both sides
+CREATE STATISTICS join_stats_1_mcv (mcv) ON a, b FROM join_stats_1;
+CREATE STATISTICS join_stats_2_mcv (mcv) ON a, b FROM join_stats_2;
+
+ANALYZE join_stats_1, join_stats_2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 j1 JOIN join_stats_2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+-- ndistinct statistics help too
+DROP STATISTICS join_stats_1_mcv, join_stats_2_mcv;
+CREATE STATISTICS join_stats_1_nd (ndistinct) ON a, b FROM join_stats_1;
+CREATE STATISTICS join_stats_2_nd (ndistinct) ON a, b FROM join_stats_2;
+
+ANALYZE join_stats_1, join_stats_2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 j1 JOIN join_stats_2 j2 ON (j1.a = j2.a AND j1.b = j2.b)');
+
+DROP TABLE join_stats_1, join_stats_2;
+
+-- cardinality feedback corrects a misestimate once the scan has run
+CREATE TABLE card_feedback (a INT, b INT) WITH (autovacuum_enabled = off);
+INSERT INTO card_feedback SELECT mod(i, 10), mod(i, 10) FROM generate_series(1, 1000) s(i);
+ANALYZE card_feedback;
+SET cardinality_feedback = on;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM card_feedback WHERE a = 1 AND b = 1');
+SELECT * FROM check_estimated_rows('SELECT * FROM card_feedback WHERE a = 1 AND b = 1');
+-- the clauses are matched regardless of their order
+SELECT * FROM check_estimated_rows('SELECT * FROM card_feedback WHERE b = 1 AND a = 1');
+SELECT samples, round(correction::numeric, 2) AS correction FROM pg_cardinality_feedback WHERE relid = 'card_feedback'::regclass;
+
+-- different constants are learned separately
+SELECT * FROM check_estimated_rows('SELECT * FROM card_feedback WHERE a = 2 AND b = 2');
+
+SELECT pg_cardinality_feedback_reset();
+SELECT * FROM check_estimated_rows('SELECT * FROM card_feedback WHERE a = 1 AND b = 1');
+
+RESET cardinality_feedback;
+DROP TABLE card_feedback;
+
 -- Permission tests. Users should not be able to see specific data values in
 -- the extended statistics, if they lack permission to see those values in
 -- the underlying table.
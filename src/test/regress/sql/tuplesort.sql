@@ -305,3 +305,78 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+----
+-- test radix sort of in-memory sorts on integer-like leading keys
+----
+
+CREATE TEMP TABLE radix_sort_data AS
+    SELECT g AS id,
+           (g * 7919) % 10007 - 5000 AS i4,
+           ((g * 7919) % 10007 - 5000)::int8 * 1000003 AS i8
+    FROM generate_series(1, 10006) g;
+INSERT INTO radix_sort_data VALUES (0, NULL, NULL), (10007, NULL, NULL);
+
+SELECT i4, i8 FROM radix_sort_data ORDER BY i4 OFFSET 10002;
+
+SELECT i8, i4 FROM radix_sort_data ORDER BY i8 DESC NULLS LAST OFFSET 10002;
+
+SELECT i8, i4 FROM radix_sort_data ORDER BY i8 DESC OFFSET 10002;
+
+SELECT i4 % 10 AS m, id FROM radix_sort_data ORDER BY i4 % 10 NULLS FIRST, id OFFSET 10002;
+
+SELECT i4 % 10 AS m, id FROM radix_sort_data ORDER BY i4 % 10 DESC NULLS LAST, id DESC OFFSET 10002;
+
+SELECT (i4 + 5000)::text COLLATE "C" AS t FROM radix_sort_data ORDER BY 1 OFFSET 10002;
+
+----
+-- test merging of sorted runs in external sorts
+----
+
+-- shuffled holds each of 1..50020 once, descending gives each run a range
+-- of its own, and mixed does so for most rows but then adds values that
+-- overlap those of the earlier runs, so that runs are exhausted at
+-- different times
+CREATE TEMP TABLE merge_sort_data AS
+    SELECT g AS id,
+           (g * 7919) % 50021 AS shuffled,
+           50021 - g AS descending,
+           CASE WHEN g <= 40000 THEN g ELSE (g * 7919) % 50021 END AS mixed
+    FROM generate_series(1, 50020) g;
+
+BEGIN;
+-- with work_mem at its minimum, there are too few tapes to merge all runs
+-- at once, so these sorts take several merge passes
+SET LOCAL work_mem = '64kB';
+
+PREPARE merge_check(int) AS
+    SELECT count(*) AS n,
+           count(*) FILTER (WHERE s <= s_prev) AS shuffled_misordered,
+           count(*) FILTER (WHERE d <= d_prev) AS descending_misordered,
+           count(*) FILTER (WHERE m < m_prev) AS mixed_misordered
+    FROM (SELECT shuffled AS s, lag(shuffled) OVER (ORDER BY shuffled) AS s_prev,
+                 descending AS d, lag(descending) OVER (ORDER BY descending) AS d_prev,
+                 mixed AS m, lag(mixed) OVER (ORDER BY mixed) AS m_prev
+          FROM merge_sort_data WHERE id <= $1) x;
+
+-- a few different numbers of runs, which need not be powers of two
+EXECUTE merge_check(9000);
+EXECUTE merge_check(23000);
+EXECUTE merge_check(50020);
+
+-- bounded sorts, both ones that fit in memory and ones that don't
+SELECT shuffled FROM merge_sort_data ORDER BY shuffled LIMIT 5;
+SELECT mixed, id FROM merge_sort_data ORDER BY mixed, id LIMIT 5;
+SELECT shuffled FROM merge_sort_data ORDER BY shuffled DESC OFFSET 20000 LIMIT 5;
+SELECT mixed, id FROM merge_sort_data ORDER BY mixed DESC, id OFFSET 20000 LIMIT 5;
+
+-- mark/restore in the merged output, which the inner side of a merge join
+-- needs when it can't be materialized
+SET LOCAL enable_nestloop = off;
+SET LOCAL enable_hashjoin = off;
+SET LOCAL enable_material = off;
+SELECT count(*), sum(a.id), sum(b.id)
+FROM merge_sort_data a
+    JOIN merge_sort_data b ON a.shuffled / 10 = b.descending / 10;
+
+COMMIT;
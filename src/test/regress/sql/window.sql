@@ -1905,6 +1905,47 @@ SELECT i, b, bool_and(b) OVER w, bool_or(b) OVER w
   FROM (VALUES (1,true), (2,true), (3,false), (4,false), (5,true)) v(i,b)
   WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FOLLOWING);
 
+-- Aggregates with a combine function but no inverse transition function are
+-- evaluated incrementally over sliding frames.  Check them against plain
+-- aggregation over the same rows.
+CREATE TEMP TABLE sliding_data AS
+SELECT i, CASE WHEN i % 7 = 0 THEN NULL ELSE (i * 37) % 101 END AS v,
+       ((i * 13) % 17)::text AS t
+  FROM generate_series(1, 500) i;
+
+SELECT count(*) FROM (
+  SELECT i,
+         max(v) OVER w AS max_v,
+         min(t) OVER w AS min_t,
+         bit_or(v) OVER w AS bit_or_v,
+         max(v) FILTER (WHERE v % 2 = 0) OVER w AS max_even_v
+    FROM sliding_data
+  WINDOW w AS (ORDER BY i ROWS BETWEEN 20 PRECEDING AND 5 FOLLOWING)
+) s
+WHERE max_v IS DISTINCT FROM
+        (SELECT max(v) FROM sliding_data d WHERE d.i BETWEEN s.i - 20 AND s.i + 5)
+   OR min_t IS DISTINCT FROM
+        (SELECT min(t) FROM sliding_data d WHERE d.i BETWEEN s.i - 20 AND s.i + 5)
+   OR bit_or_v IS DISTINCT FROM
+        (SELECT bit_or(v) FROM sliding_data d WHERE d.i BETWEEN s.i - 20 AND s.i + 5)
+   OR max_even_v IS DISTINCT FROM
+        (SELECT max(v) FROM sliding_data d
+          WHERE d.i BETWEEN s.i - 20 AND s.i + 5 AND v % 2 = 0);
+
+-- same, with partitions and frames that do not include the current row
+SELECT count(*) FROM (
+  SELECT i, max(v) OVER w AS max_v, min(t) OVER w AS min_t
+    FROM sliding_data
+  WINDOW w AS (PARTITION BY i % 3 ORDER BY i
+               ROWS BETWEEN 3 PRECEDING AND 1 PRECEDING)
+) s
+WHERE max_v IS DISTINCT FROM
+        (SELECT max(v) FROM sliding_data d
+          WHERE d.i % 3 = s.i % 3 AND d.i BETWEEN s.i - 9 AND s.i - 3)
+   OR min_t IS DISTINCT FROM
+        (SELECT min(t) FROM sliding_data d
+          WHERE d.i % 3 = s.i % 3 AND d.i BETWEEN s.i - 9 AND s.i - 3);
+
 --
 -- Test WindowAgg costing takes into account the number of rows that need to
 -- be fetched before the first row can be output.
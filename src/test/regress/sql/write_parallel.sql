@@ -40,4 +40,23 @@ explain (costs off) create table parallel_write as execute prep_stmt;
 create table parallel_write as execute prep_stmt;
 drop table parallel_write;
 
+-- workers insert the rows they produce themselves when nothing stops them
+explain (costs off) create table parallel_write as
+    select unique1, stringu1 from tenk1 where hundred < 50;
+create table parallel_write as
+    select unique1, stringu1 from tenk1 where hundred < 50;
+select count(*) from parallel_write;
+select count(*) from (select unique1, stringu1 from tenk1 where hundred < 50
+    except select * from parallel_write) s;
+drop table parallel_write;
+
+-- parallel INSERT ... SELECT; charge for tuples sent to the leader again
+reset parallel_tuple_cost;
+create table parallel_insert (a int primary key, b text check (length(b) > 0));
+explain (costs off) insert into parallel_insert select unique1, stringu1 from tenk1;
+insert into parallel_insert select unique1, stringu1 from tenk1;
+select count(*), count(distinct b) = (select count(distinct stringu1) from tenk1)
+    from parallel_insert;
+drop table parallel_insert;
+
 rollback;